@@ -0,0 +1,73 @@
+#include "BatteryEstimator.h"
+#include <cmath>
+
+void BatteryEstimator::anchor(qint64 timestampMs, double battery, bool charging, bool aligned) {
+    m_anchorTime = timestampMs;
+    m_anchorBattery = battery;
+    m_anchorCharging = charging;
+    m_anchored = true;
+    m_aligned = aligned;
+}
+
+void BatteryEstimator::addSample(qint64 timestampMs, double battery, bool charging, bool present) {
+    m_battery = battery;
+    m_charging = charging;
+    m_present = present;
+
+    if (!present) {
+        m_anchored = false;
+        return;
+    }
+
+    const qint64 elapsedMs = timestampMs - m_anchorTime;
+    if (!m_anchored || charging != m_anchorCharging || elapsedMs < 0 || elapsedMs > kMaxGapMs) {
+        anchor(timestampMs, battery, charging, false);
+        return;
+    }
+
+    // Same level: keep the anchor so the next step is measured over its full length
+    const double delta = battery - m_anchorBattery;
+    if (delta == 0.0) {
+        return;
+    }
+
+    // A level moving against the charging state is a recalibration, not a rate
+    if ((delta > 0.0) != charging) {
+        anchor(timestampMs, battery, charging, false);
+        return;
+    }
+
+    // The first step after anchoring started mid-level and would overstate the rate
+    if (m_aligned && elapsedMs > 0) {
+        const double rate = std::abs(delta) * 3600000.0 / double(elapsedMs);
+        RateModel& model = charging ? m_charge : m_discharge;
+        model.perHour = model.observations == 0 ? rate : model.perHour + kSmoothing * (rate - model.perHour);
+        ++model.observations;
+    }
+    anchor(timestampMs, battery, charging, true);
+}
+
+qint32 BatteryEstimator::secondsRemaining() const {
+    if (!m_present) {
+        return -1;
+    }
+
+    const RateModel& model = m_charging ? m_charge : m_discharge;
+    if (model.observations == 0 || model.perHour <= 0.0) {
+        return -1;
+    }
+
+    const double percentLeft = m_charging ? 100.0 - m_battery : m_battery;
+    if (percentLeft <= 0.0) {
+        return m_charging ? -1 : 0;
+    }
+
+    // Clamp to a week; anything longer is noise from a near-zero rate
+    const double seconds = percentLeft / model.perHour * 3600.0;
+    return qint32(qMin(seconds, 7.0 * 24 * 3600));
+}
+
+double BatteryEstimator::ratePerHour(bool charging) const {
+    const RateModel& model = charging ? m_charge : m_discharge;
+    return model.observations > 0 ? model.perHour : 0.0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <QtGlobal>
+
+/**
+ * @class BatteryEstimator
+ * @brief Time-to-empty and time-to-full estimate for one headset
+ *
+ * Keeps an exponentially weighted average of the discharge rate and,
+ * separately, of the charge rate, so switching between the two keeps the
+ * other model warm. Headsets report their level in coarse steps, so a rate
+ * is measured from one level change to the next rather than per sample;
+ * the first change after (re)anchoring is only used to align to a step
+ * edge. Each sample costs O(1) time and no allocation.
+ */
+class BatteryEstimator {
+public:
+    /** @brief Weight of the newest rate observation */
+    static constexpr double kSmoothing = 0.3;
+
+    /** @brief Longer gaps between samples restart the measurement */
+    static constexpr qint64 kMaxGapMs = 6 * 60 * 60 * 1000;
+
+    /**
+     * @brief Feeds one battery sample
+     * @param timestampMs Sample time in milliseconds, monotonically increasing
+     * @param battery Battery percentage (0-100)
+     * @param charging True if the device is charging
+     * @param present True if the device is physically present
+     */
+    void addSample(qint64 timestampMs, double battery, bool charging, bool present);
+
+    /**
+     * @brief Seconds until empty (discharging) or full (charging)
+     * @return Estimate for the latest sample, or -1 while no rate is known
+     */
+    qint32 secondsRemaining() const;
+
+    /**
+     * @brief Smoothed rate in percent per hour, 0 while unknown
+     * @param charging Charge rate if true, discharge rate otherwise
+     */
+    double ratePerHour(bool charging) const;
+
+    /**
+     * @brief Forgets both models and the current measurement
+     */
+    void reset() { *this = BatteryEstimator(); }
+
+private:
+    struct RateModel {
+        double perHour = 0.0;
+        int observations = 0;
+    };
+
+    void anchor(qint64 timestampMs, double battery, bool charging, bool aligned);
+
+    RateModel m_discharge;
+    RateModel m_charge;
+
+    // Start of the current level-to-level measurement
+    qint64 m_anchorTime = 0;
+    double m_anchorBattery = 0.0;
+    bool m_anchorCharging = false;
+    bool m_anchored = false;
+    bool m_aligned = false;
+
+    // Latest sample
+    double m_battery = 0.0;
+    bool m_charging = false;
+    bool m_present = false;
+};
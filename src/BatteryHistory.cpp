@@ -0,0 +1,286 @@
+#include "BatteryHistory.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <sys/mman.h>
+
+using namespace BatteryHistoryFormat;
+
+namespace {
+constexpr quint8 kFlagCharging = 0x01;
+constexpr quint8 kFlagPresent = 0x02;
+
+bool isValidRecord(const Record& record, quint32 slot, quint32 capacity) {
+    return record.sequence != 0
+        && (record.sequence - 1) % capacity == slot
+        && record.check == recordCheck(record);
+}
+
+BatterySample toSample(const Record& record) {
+    BatterySample sample;
+    sample.timestamp = record.timestamp;
+    sample.battery = record.battery / 100.0;
+    sample.isCharging = record.flags & kFlagCharging;
+    sample.isPresent = record.flags & kFlagPresent;
+    return sample;
+}
+
+// Visits valid records in sequence order, starting after the newest one
+template<typename Visit>
+void visitRecords(const Record *records, quint32 capacity, Visit visit) {
+    quint32 newest = 0;
+    quint32 newestSlot = 0;
+    for (quint32 slot = 0; slot < capacity; ++slot) {
+        if (isValidRecord(records[slot], slot, capacity) && records[slot].sequence > newest) {
+            newest = records[slot].sequence;
+            newestSlot = slot;
+        }
+    }
+    if (newest == 0) {
+        return;
+    }
+
+    // Only the last `capacity` sequence numbers can still be in the ring
+    const quint32 oldest = newest > capacity ? newest - capacity + 1 : 1;
+    for (quint32 i = 1; i <= capacity; ++i) {
+        const quint32 slot = (newestSlot + i) % capacity;
+        const Record& record = records[slot];
+        if (isValidRecord(record, slot, capacity) && record.sequence >= oldest) {
+            visit(record);
+        }
+    }
+}
+
+bool hasValidHeader(const Header& header) {
+    return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+        && header.version == kVersion
+        && header.recordSize == sizeof(Record)
+        && header.capacity > 0;
+}
+}
+
+quint32 BatteryHistoryFormat::recordCheck(const Record& record) {
+    // FNV-1a over everything but the check itself
+    const auto *bytes = reinterpret_cast<const uchar*>(&record);
+    quint32 hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Record, check); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+BatteryHistory::BatteryHistory(const QString& filePath, quint32 capacity, const QString& model)
+    : m_file(filePath)
+    , m_capacity(capacity)
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        m_error = m_file.errorString();
+        return;
+    }
+
+    // Reuse an existing file with its own capacity; start over if it is not ours
+    Header existing{};
+    if (m_file.size() >= qint64(sizeof(Header))
+        && m_file.read(reinterpret_cast<char*>(&existing), sizeof(existing)) == qint64(sizeof(existing))
+        && hasValidHeader(existing)
+        && m_file.size() == qint64(sizeof(Header) + existing.capacity * sizeof(Record))) {
+        m_capacity = existing.capacity;
+    } else if (!initialize(model)) {
+        return;
+    }
+
+    m_map = m_file.map(0, m_file.size());
+    if (!m_map) {
+        m_error = m_file.errorString();
+        return;
+    }
+
+    m_records = reinterpret_cast<Record*>(m_map + sizeof(Header));
+    recover();
+}
+
+BatteryHistory::~BatteryHistory() {
+    flush();
+}
+
+bool BatteryHistory::initialize(const QString& model) {
+    if (m_capacity == 0) {
+        m_error = QStringLiteral("History capacity must be positive");
+        return false;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.recordSize = sizeof(Record);
+    header.capacity = m_capacity;
+    const QByteArray modelUtf8 = model.toUtf8().left(sizeof(header.model) - 1);
+    std::memcpy(header.model, modelUtf8.constData(), modelUtf8.size());
+
+    // The records start out zeroed, i.e. empty
+    if (!m_file.resize(0) || !m_file.resize(sizeof(Header) + qint64(m_capacity) * sizeof(Record))
+        || !m_file.seek(0)
+        || m_file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != qint64(sizeof(header))
+        || !m_file.flush()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void BatteryHistory::recover() {
+    // The newest valid record is the head; torn writes simply fail validation
+    quint32 newest = 0;
+    for (quint32 slot = 0; slot < m_capacity; ++slot) {
+        if (isValidRecord(m_records[slot], slot, m_capacity)) {
+            newest = qMax(newest, m_records[slot].sequence);
+        }
+    }
+    m_nextSequence = newest + 1;
+}
+
+int BatteryHistory::size() const {
+    if (!isOpen()) {
+        return 0;
+    }
+    return int(qMin<quint32>(m_nextSequence - 1, m_capacity));
+}
+
+bool BatteryHistory::append(const BatterySample& sample) {
+    if (!isOpen()) {
+        return false;
+    }
+
+    Record& record = m_records[(m_nextSequence - 1) % m_capacity];
+
+    // Invalidate the slot first so a crash mid-write cannot leave a record
+    // that passes validation with mixed old and new fields
+    record.sequence = 0;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    Record next{};
+    next.sequence = m_nextSequence;
+    next.timestamp = quint32(qMax<qint64>(0, sample.timestamp));
+    next.battery = quint16(qBound(0.0, sample.battery, 100.0) * 100.0 + 0.5);
+    next.flags = (sample.isCharging ? kFlagCharging : 0) | (sample.isPresent ? kFlagPresent : 0);
+    next.check = recordCheck(next);
+
+    record.timestamp = next.timestamp;
+    record.battery = next.battery;
+    record.flags = next.flags;
+    record.reserved = 0;
+    record.check = next.check;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    record.sequence = next.sequence;
+
+    ++m_nextSequence;
+    return true;
+}
+
+QList<BatterySample> BatteryHistory::samples() const {
+    QList<BatterySample> result;
+    if (!isOpen()) {
+        return result;
+    }
+
+    result.reserve(size());
+    visitRecords(m_records, m_capacity, [&result](const Record& record) {
+        result.append(toSample(record));
+    });
+    return result;
+}
+
+void BatteryHistory::flush() {
+    if (m_map) {
+        ::msync(m_map, size_t(m_file.size()), MS_ASYNC);
+    }
+}
+
+QString BatteryHistory::defaultDirectory() {
+    QString stateHome = qEnvironmentVariable("XDG_STATE_HOME");
+    if (stateHome.isEmpty()) {
+        stateHome = QDir::homePath() + "/.local/state";
+    }
+    return stateHome + "/headsetstatus/history";
+}
+
+QString BatteryHistory::fileNameFor(const QString& nativePath, const QString& model) {
+    const QByteArray identity = (nativePath + '\n' + model).toUtf8();
+    const QByteArray digest = QCryptographicHash::hash(identity, QCryptographicHash::Sha1);
+    return QString::fromLatin1(digest.toHex().left(16)) + ".hist";
+}
+
+BatteryHistoryReader::BatteryHistoryReader(const QString& filePath) : m_file(filePath) {
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < qint64(sizeof(Header))) {
+        return;
+    }
+
+    const uchar *map = m_file.map(0, m_file.size());
+    if (!map) {
+        return;
+    }
+
+    const auto *header = reinterpret_cast<const Header*>(map);
+    if (!hasValidHeader(*header)
+        || m_file.size() != qint64(sizeof(Header) + header->capacity * sizeof(Record))) {
+        return;
+    }
+
+    m_capacity = header->capacity;
+    m_model = QString::fromUtf8(header->model, qstrnlen(header->model, sizeof(header->model)));
+    m_records = reinterpret_cast<const Record*>(map + sizeof(Header));
+}
+
+void BatteryHistoryReader::forEachSample(const std::function<void(const BatterySample&)>& visit) const {
+    if (!isValid()) {
+        return;
+    }
+
+    visitRecords(m_records, m_capacity, [&visit](const Record& record) {
+        visit(toSample(record));
+    });
+}
+
+QList<BatterySample> BatteryHistoryReader::samples() const {
+    QList<BatterySample> result;
+    forEachSample([&result](const BatterySample& sample) {
+        result.append(sample);
+    });
+    return result;
+}
+
+BatteryHistoryStore::BatteryHistoryStore(const QString& directory) : m_directory(directory) {
+}
+
+void BatteryHistoryStore::record(const HeadsetDevice& device, qint64 timestamp) {
+    auto it = m_histories.find(device.dbusPath);
+    if (it == m_histories.end()) {
+        const QString filePath = m_directory + '/' + BatteryHistory::fileNameFor(device.nativePath, device.model);
+        auto history = std::make_shared<BatteryHistory>(filePath, BatteryHistory::kDefaultCapacity, device.model);
+        if (!history->isOpen()) {
+            qWarning() << "Failed to open battery history" << filePath << history->errorString();
+        }
+        it = m_histories.insert(device.dbusPath, history);
+    }
+
+    BatterySample sample;
+    sample.timestamp = timestamp;
+    sample.battery = device.battery;
+    sample.isCharging = device.isCharging;
+    sample.isPresent = device.isPresent;
+    (*it)->append(sample);
+}
+
+void BatteryHistoryStore::forget(const QString& dbusPath) {
+    m_histories.remove(dbusPath);
+}
+
+BatteryHistory* BatteryHistoryStore::historyFor(const QString& dbusPath) const {
+    return m_histories.value(dbusPath).get();
+}
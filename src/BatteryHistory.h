@@ -0,0 +1,196 @@
+#pragma once
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <functional>
+#include <memory>
+#include "HeadsetDevice.h"
+
+/**
+ * @struct BatterySample
+ * @brief One point of a device's battery history
+ */
+struct BatterySample {
+    qint64 timestamp = 0;    ///< Seconds since the Unix epoch (UTC)
+    double battery = 0.0;    ///< Battery percentage, 0.01 % resolution
+    bool isCharging = false;
+    bool isPresent = false;
+};
+
+/**
+ * @namespace BatteryHistoryFormat
+ * @brief On-disk layout shared by BatteryHistory and BatteryHistoryReader
+ *
+ * A history file is a 64-byte header followed by a fixed number of 16-byte
+ * records used as a ring, all in host byte order. A record is valid when
+ * its sequence number is non-zero, maps to its own slot and matches its
+ * check value; the newest valid sequence number marks the ring's head. A
+ * write interrupted by a crash leaves a record that fails the check and is
+ * skipped, so the file never needs repair.
+ */
+namespace BatteryHistoryFormat {
+constexpr char kMagic[4] = {'H', 'S', 'B', 'H'};
+constexpr quint16 kVersion = 1;
+
+struct Header {
+    char magic[4];
+    quint16 version;
+    quint16 recordSize;
+    quint32 capacity;
+    quint32 reserved;
+    char model[48];          ///< UTF-8, NUL-padded, for readers listing files
+};
+
+struct Record {
+    quint32 sequence;        ///< 1-based; 0 marks an empty slot
+    quint32 timestamp;       ///< Seconds since the Unix epoch
+    quint16 battery;         ///< Hundredths of a percent
+    quint8 flags;            ///< Bit 0 charging, bit 1 present
+    quint8 reserved;
+    quint32 check;           ///< Hash of the preceding 12 bytes
+};
+
+static_assert(sizeof(Header) == 64, "history header must stay 64 bytes");
+static_assert(sizeof(Record) == 16, "history record must stay 16 bytes");
+
+quint32 recordCheck(const Record& record);
+}
+
+/**
+ * @class BatteryHistory
+ * @brief Memory-mapped ring buffer of one device's battery samples
+ *
+ * The file is mapped read-write once; append() is a plain memory write with
+ * no system call, and the kernel writes dirty pages back on its own, so the
+ * history survives both restarts and crashes of the process.
+ */
+class BatteryHistory {
+public:
+    /** @brief Default number of samples kept per device (64 KiB per file) */
+    static constexpr quint32 kDefaultCapacity = 4096;
+
+    /**
+     * @param filePath History file; created if it does not exist
+     * @param capacity Number of records for a new file; an existing file
+     *        keeps its own capacity
+     * @param model Model name stored in the header of a new file
+     */
+    explicit BatteryHistory(const QString& filePath, quint32 capacity = kDefaultCapacity,
+                            const QString& model = QString());
+    ~BatteryHistory();
+
+    BatteryHistory(const BatteryHistory&) = delete;
+    BatteryHistory& operator=(const BatteryHistory&) = delete;
+
+    bool isOpen() const { return m_records != nullptr; }
+    QString errorString() const { return m_error; }
+    QString filePath() const { return m_file.fileName(); }
+
+    quint32 capacity() const { return m_capacity; }
+
+    /** @brief Number of valid samples, at most capacity() */
+    int size() const;
+
+    /**
+     * @brief Writes a sample over the oldest slot once the ring is full
+     */
+    bool append(const BatterySample& sample);
+
+    /**
+     * @brief Returns all samples, oldest first
+     */
+    QList<BatterySample> samples() const;
+
+    /**
+     * @brief Schedules write-back of dirty pages without waiting for it
+     */
+    void flush();
+
+    /**
+     * @brief ~/.local/state/headsetstatus/history, honouring XDG_STATE_HOME
+     */
+    static QString defaultDirectory();
+
+    /**
+     * @brief File name for a device, stable across reconnects and restarts
+     * @param nativePath System native path of the device
+     * @param model Device model name
+     */
+    static QString fileNameFor(const QString& nativePath, const QString& model);
+
+private:
+    bool initialize(const QString& model);
+    void recover();
+
+    QFile m_file;
+    QString m_error;
+    uchar *m_map = nullptr;
+    BatteryHistoryFormat::Record *m_records = nullptr;
+    quint32 m_capacity = 0;
+    quint32 m_nextSequence = 1;
+};
+
+/**
+ * @class BatteryHistoryReader
+ * @brief Read-only, zero-copy view of a history file
+ *
+ * Maps the file read-only and decodes records in place, so a CLI dump or a
+ * chart can read a history while HeadsetStatus keeps appending to it.
+ */
+class BatteryHistoryReader {
+public:
+    explicit BatteryHistoryReader(const QString& filePath);
+
+    bool isValid() const { return m_records != nullptr; }
+    QString model() const { return m_model; }
+    quint32 capacity() const { return m_capacity; }
+
+    /**
+     * @brief Calls @p visit for every valid sample, oldest first
+     */
+    void forEachSample(const std::function<void(const BatterySample&)>& visit) const;
+
+    QList<BatterySample> samples() const;
+
+private:
+    QFile m_file;
+    QString m_model;
+    const BatteryHistoryFormat::Record *m_records = nullptr;
+    quint32 m_capacity = 0;
+};
+
+/**
+ * @class BatteryHistoryStore
+ * @brief Keeps one open BatteryHistory per tracked device
+ */
+class BatteryHistoryStore {
+public:
+    /**
+     * @param directory Directory holding one history file per device
+     */
+    explicit BatteryHistoryStore(const QString& directory = BatteryHistory::defaultDirectory());
+
+    /**
+     * @brief Appends the device's current state to its history
+     * @param device Device to record
+     * @param timestamp Seconds since the Unix epoch
+     */
+    void record(const HeadsetDevice& device, qint64 timestamp);
+
+    /**
+     * @brief Closes the history of a device that went away; the file stays
+     */
+    void forget(const QString& dbusPath);
+
+    /**
+     * @brief Open history of a device, or nullptr if none was recorded yet
+     */
+    BatteryHistory* historyFor(const QString& dbusPath) const;
+
+    QString directory() const { return m_directory; }
+
+private:
+    QString m_directory;
+    QHash<QString, std::shared_ptr<BatteryHistory>> m_histories;
+};
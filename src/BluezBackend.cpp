@@ -0,0 +1,301 @@
+#include "BluezBackend.h"
+#include <QDBusArgument>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
+#include <QDebug>
+
+namespace {
+const QString kObjectManagerInterface = QStringLiteral("org.freedesktop.DBus.ObjectManager");
+const QString kPropertiesInterface = QStringLiteral("org.freedesktop.DBus.Properties");
+const QString kDeviceInterface = QStringLiteral("org.bluez.Device1");
+const QString kBatteryInterface = QStringLiteral("org.bluez.Battery1");
+const QString kBluezPathPrefix = QStringLiteral("/org/bluez/");
+
+// Class of Device: major class in bits 8-12, minor class in bits 2-7
+constexpr uint kMajorAudioVideo = 0x04;
+constexpr uint kMinorWearableHeadset = 0x01;
+constexpr uint kMinorHandsFree = 0x02;
+constexpr uint kMinorHeadphones = 0x06;
+
+// arg0 of PropertiesChanged is the interface name; media transports and
+// adapters change far more often than anything shown
+const QStringList kTrackedArgumentMatches[] = {{kDeviceInterface}, {kBatteryInterface}};
+
+bool isTrackedInterface(const QString& interface) {
+    return interface == kDeviceInterface || interface == kBatteryInterface;
+}
+}
+
+BluezBackend::BluezBackend(Classify classify, const QDBusConnection& bus, QObject *parent)
+    : QObject(parent)
+    , m_classify(std::move(classify))
+    , m_bus(bus)
+{
+    qDBusRegisterMetaType<InterfaceMap>();
+    qDBusRegisterMetaType<ManagedObjects>();
+}
+
+bool BluezBackend::isHeadsetClass(const QString& icon, uint deviceClass) {
+    if (!icon.isEmpty()) {
+        return icon == QLatin1String("audio-headset") || icon == QLatin1String("audio-headphones");
+    }
+
+    const uint major = (deviceClass >> 8) & 0x1f;
+    const uint minor = (deviceClass >> 2) & 0x3f;
+    return major == kMajorAudioVideo
+        && (minor == kMinorWearableHeadset || minor == kMinorHandsFree || minor == kMinorHeadphones);
+}
+
+const HeadsetDevice* BluezBackend::deviceAt(const QString& objectPath) const {
+    const auto it = m_headsets.constFind(objectPath);
+    return it == m_headsets.constEnd() ? nullptr : &it.value();
+}
+
+bool BluezBackend::start() {
+    if (!m_bus.isConnected()) {
+        return false;
+    }
+
+    const QString service = QLatin1String(kServiceName);
+    m_bus.connect(service, QStringLiteral("/"), kObjectManagerInterface, QStringLiteral("InterfacesAdded"),
+                  this, SLOT(onInterfacesAdded(QDBusMessage)));
+    m_bus.connect(service, QStringLiteral("/"), kObjectManagerInterface, QStringLiteral("InterfacesRemoved"),
+                  this, SLOT(onInterfacesRemoved(QDBusMessage)));
+    for (const QStringList& argumentMatch : kTrackedArgumentMatches) {
+        m_bus.connect(service, QString(), kPropertiesInterface, QStringLiteral("PropertiesChanged"),
+                      argumentMatch, QString(), this, SLOT(onPropertiesChanged(QDBusMessage)));
+    }
+
+    // bluetoothd restarting drops every object; the next instance needs a new snapshot
+    m_serviceWatcher = new QDBusServiceWatcher(service, m_bus,
+                                               QDBusServiceWatcher::WatchForOwnerChange, this);
+    connect(m_serviceWatcher, &QDBusServiceWatcher::serviceUnregistered, this, &BluezBackend::onServiceUnregistered);
+    connect(m_serviceWatcher, &QDBusServiceWatcher::serviceRegistered, this, &BluezBackend::requestSnapshot);
+
+    requestSnapshot();
+    return true;
+}
+
+void BluezBackend::requestSnapshot() {
+    const quint64 generation = ++m_generation;
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        QLatin1String(kServiceName), QStringLiteral("/"), kObjectManagerInterface, QStringLiteral("GetManagedObjects"));
+
+    auto *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this,
+            [this, generation](QDBusPendingCallWatcher *w) { onSnapshotFinished(w, generation); });
+}
+
+void BluezBackend::onSnapshotFinished(QDBusPendingCallWatcher *watcher, quint64 generation) {
+    watcher->deleteLater();
+
+    // A restart while the call was in flight made this reply stale
+    if (generation != m_generation) {
+        return;
+    }
+
+    QDBusPendingReply<ManagedObjects> reply = *watcher;
+    if (reply.isError()) {
+        // No bluetoothd yet; the service watcher asks again once it starts
+        qDebug() << "BlueZ snapshot unavailable:" << reply.error().message();
+        return;
+    }
+
+    // Signals received before the reply are older than the snapshot and
+    // already contained in it
+    QSet<QString> paths(m_objects.keyBegin(), m_objects.keyEnd());
+    m_objects.clear();
+
+    const ManagedObjects objects = reply.value();
+    for (auto it = objects.constBegin(); it != objects.constEnd(); ++it) {
+        InterfaceMap tracked;
+        for (auto iface = it->constBegin(); iface != it->constEnd(); ++iface) {
+            if (isTrackedInterface(iface.key())) {
+                tracked.insert(iface.key(), iface.value());
+            }
+        }
+        if (tracked.contains(kDeviceInterface)) {
+            m_objects.insert(it.key().path(), tracked);
+            paths.insert(it.key().path());
+        }
+    }
+
+    m_hasSnapshot = true;
+    refreshDevices(paths);
+}
+
+void BluezBackend::onServiceUnregistered() {
+    ++m_generation;
+    m_hasSnapshot = false;
+    m_objects.clear();
+    if (!m_headsets.isEmpty()) {
+        m_headsets.clear();
+        emit devicesChanged();
+    }
+}
+
+void BluezBackend::onInterfacesAdded(const QDBusMessage& message) {
+    const QVariantList arguments = message.arguments();
+    if (!m_hasSnapshot || arguments.size() < 2) {
+        return;
+    }
+
+    const QString path = arguments.at(0).value<QDBusObjectPath>().path();
+    if (!path.startsWith(kBluezPathPrefix)) {
+        return;
+    }
+
+    const InterfaceMap interfaces = qdbus_cast<InterfaceMap>(arguments.at(1));
+    bool tracked = false;
+    for (auto it = interfaces.constBegin(); it != interfaces.constEnd(); ++it) {
+        if (isTrackedInterface(it.key())) {
+            m_objects[path].insert(it.key(), it.value());
+            tracked = true;
+        }
+    }
+
+    if (tracked) {
+        refreshDevices({path});
+    }
+}
+
+void BluezBackend::onInterfacesRemoved(const QDBusMessage& message) {
+    const QVariantList arguments = message.arguments();
+    if (!m_hasSnapshot || arguments.size() < 2) {
+        return;
+    }
+
+    const QString path = arguments.at(0).value<QDBusObjectPath>().path();
+    auto it = m_objects.find(path);
+    if (it == m_objects.end()) {
+        return;
+    }
+
+    for (const QString& interface : arguments.at(1).toStringList()) {
+        it->remove(interface);
+    }
+    if (!it->contains(kDeviceInterface)) {
+        m_objects.erase(it);
+    }
+    refreshDevices({path});
+}
+
+void BluezBackend::onPropertiesChanged(const QDBusMessage& message) {
+    ++m_propertySignals;
+    const QVariantList arguments = message.arguments();
+    if (!m_hasSnapshot || arguments.size() < 2) {
+        return;
+    }
+
+    const QString interface = arguments.at(0).toString();
+    auto object = m_objects.find(message.path());
+    if (!isTrackedInterface(interface) || object == m_objects.end()) {
+        return;
+    }
+
+    QVariantMap& properties = (*object)[interface];
+    const QVariantMap changed = qdbus_cast<QVariantMap>(arguments.at(1));
+    for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+        properties.insert(it.key(), it.value());
+    }
+    if (arguments.size() > 2) {
+        for (const QString& name : arguments.at(2).toStringList()) {
+            properties.remove(name);
+        }
+    }
+
+    refreshDevices({message.path()});
+}
+
+bool BluezBackend::readDevice(const QString& path, HeadsetDevice *device) {
+    const auto object = m_objects.constFind(path);
+    if (object == m_objects.constEnd() || !object->contains(kBatteryInterface)) {
+        return false;
+    }
+
+    const QVariantMap properties = object->value(kDeviceInterface);
+    const QVariantMap battery = object->value(kBatteryInterface);
+    const auto percentage = battery.constFind(QStringLiteral("Percentage"));
+    if (percentage == battery.constEnd()) {
+        return false;
+    }
+
+    QString model = properties.value(QStringLiteral("Alias")).toString();
+    if (model.isEmpty()) {
+        model = properties.value(QStringLiteral("Name")).toString();
+    }
+
+    const bool headsetClass = isHeadsetClass(properties.value(QStringLiteral("Icon")).toString(),
+                                             properties.value(QStringLiteral("Class")).toUInt());
+    if (!m_classify(path, path, model, headsetClass)) {
+        return false;
+    }
+
+    device->model = model;
+    device->nativePath = path;
+    device->dbusPath = path;
+    device->connectionType = ConnectionType::Bluetooth;
+    device->battery = qBound(0, percentage->toInt(), 100);
+    device->isCharging = false;
+    device->isPresent = properties.value(QStringLiteral("Connected")).toBool();
+    return true;
+}
+
+void BluezBackend::rescan() {
+    QSet<QString> paths(m_objects.keyBegin(), m_objects.keyEnd());
+    for (auto it = m_headsets.constBegin(); it != m_headsets.constEnd(); ++it) {
+        paths.insert(it.key());
+    }
+    refreshDevices(paths);
+}
+
+void BluezBackend::refreshDevices(const QSet<QString>& paths) {
+    bool membershipChanged = false;
+
+    for (const QString& path : paths) {
+        HeadsetDevice device;
+        const bool isHeadset = readDevice(path, &device);
+        auto it = m_headsets.find(path);
+
+        if (!isHeadset) {
+            if (it != m_headsets.end()) {
+                m_headsets.erase(it);
+                membershipChanged = true;
+            }
+            continue;
+        }
+
+        if (it == m_headsets.end()) {
+            m_headsets.insert(path, device);
+            membershipChanged = true;
+            continue;
+        }
+
+        // A renamed device goes through a full update like DeviceAdded does
+        if (it->model != device.model) {
+            *it = device;
+            membershipChanged = true;
+            continue;
+        }
+
+        QVariantMap properties;
+        if (it->battery != device.battery) {
+            properties.insert(QStringLiteral("Percentage"), device.battery);
+        }
+        if (it->isPresent != device.isPresent) {
+            properties.insert(QStringLiteral("IsPresent"), device.isPresent);
+        }
+        *it = device;
+
+        if (!properties.isEmpty()) {
+            emit devicePropertiesChanged(device.dbusPath, properties);
+        }
+    }
+
+    if (membershipChanged) {
+        emit devicesChanged();
+    }
+}
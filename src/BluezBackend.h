@@ -0,0 +1,145 @@
+#pragma once
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMetaType>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVariantMap>
+#include <functional>
+#include "HeadsetDevice.h"
+
+class QDBusPendingCallWatcher;
+class QDBusServiceWatcher;
+
+/**
+ * @class BluezBackend
+ * @brief Reads Bluetooth headset batteries straight from BlueZ's Battery1
+ *
+ * BlueZ reports HFP and AVRCP battery levels through org.bluez.Battery1
+ * before UPower mirrors them, and some headsets never reach UPower at all.
+ * Every device and battery is read with one ObjectManager.GetManagedObjects
+ * call; afterwards the backend only follows InterfacesAdded,
+ * InterfacesRemoved and PropertiesChanged. The snapshot is taken again
+ * only when bluetoothd restarts.
+ *
+ * Headsets are recognised by Device1.Icon ("audio-headset",
+ * "audio-headphones"), or by the Class of Device when no icon is set, not
+ * by model keywords. A device keeps its BlueZ object path as both dbusPath
+ * and nativePath, which is the NativePath UPower gives its mirror. Changes
+ * are reported with UPower property names like PowerSupplyBackend does.
+ */
+class BluezBackend : public QObject {
+    Q_OBJECT
+public:
+    static constexpr const char *kServiceName = "org.bluez";
+
+    /// Interfaces of one object with their properties, a{sa{sv}}
+    using InterfaceMap = QMap<QString, QVariantMap>;
+    /// GetManagedObjects result, a{oa{sa{sv}}}
+    using ManagedObjects = QMap<QDBusObjectPath, InterfaceMap>;
+
+    /**
+     * @brief Decides whether a device with a battery is a headset
+     * @param objectPath BlueZ object path of the device
+     * @param nativePath Same as objectPath; the identity UPower reports
+     * @param model Device alias
+     * @param headsetClass True if Icon or Class says headset or headphones
+     */
+    using Classify = std::function<bool(const QString& objectPath, const QString& nativePath,
+                                        const QString& model, bool headsetClass)>;
+
+    /**
+     * @param classify Headset decision, usually headsetClass unless overridden
+     * @param bus Connection bluetoothd is reached on (the system bus)
+     */
+    explicit BluezBackend(Classify classify, const QDBusConnection& bus = QDBusConnection::systemBus(),
+                          QObject *parent = nullptr);
+
+    /**
+     * @brief Subscribes to BlueZ signals and requests the initial snapshot
+     *
+     * The snapshot arrives asynchronously and is announced by devicesChanged().
+     *
+     * @return False if the bus is not connected
+     */
+    bool start();
+
+    /**
+     * @brief Re-classifies the known devices, e.g. after an override changed
+     *
+     * Works on the cached properties; no D-Bus call is made.
+     */
+    void rescan();
+
+    /**
+     * @brief Returns true once a GetManagedObjects snapshot was applied
+     */
+    bool hasSnapshot() const { return m_hasSnapshot; }
+
+    /**
+     * @brief Headsets with a battery, ordered by object path
+     */
+    QList<HeadsetDevice> devices() const { return m_headsets.values(); }
+
+    /**
+     * @brief Headset for a BlueZ object path, or nullptr
+     */
+    const HeadsetDevice* deviceAt(const QString& objectPath) const;
+
+    /**
+     * @brief Number of PropertiesChanged signals the bus delivered
+     *
+     * Only Device1 and Battery1 changes are subscribed to.
+     */
+    int propertySignalCount() const { return m_propertySignals; }
+
+    /**
+     * @brief Returns true if Device1.Icon or Device1.Class describe a headset
+     *
+     * @param icon Freedesktop icon name BlueZ derived for the device
+     * @param deviceClass Bluetooth Class of Device, 0 if unknown
+     */
+    static bool isHeadsetClass(const QString& icon, uint deviceClass);
+
+signals:
+    /**
+     * @brief A headset appeared, disappeared or changed its name
+     */
+    void devicesChanged();
+
+    /**
+     * @brief Battery or connection state of a known headset changed
+     * @param dbusPath Object path of the device
+     * @param properties Changed values under their UPower property names
+     */
+    void devicePropertiesChanged(const QString& dbusPath, const QVariantMap& properties);
+
+private slots:
+    void onInterfacesAdded(const QDBusMessage& message);
+    void onInterfacesRemoved(const QDBusMessage& message);
+    void onPropertiesChanged(const QDBusMessage& message);
+
+private:
+    void requestSnapshot();
+    void onSnapshotFinished(QDBusPendingCallWatcher *watcher, quint64 generation);
+    void onServiceUnregistered();
+    bool readDevice(const QString& path, HeadsetDevice *device);
+    void refreshDevices(const QSet<QString>& paths);
+
+    Classify m_classify;
+    QDBusConnection m_bus;
+    QDBusServiceWatcher *m_serviceWatcher = nullptr;
+    QHash<QString, InterfaceMap> m_objects;
+    QMap<QString, HeadsetDevice> m_headsets;
+    quint64 m_generation = 0;
+    int m_propertySignals = 0;
+    bool m_hasSnapshot = false;
+};
+
+Q_DECLARE_METATYPE(BluezBackend::InterfaceMap)
+Q_DECLARE_METATYPE(BluezBackend::ManagedObjects)
@@ -4,6 +4,14 @@
 #include <QDebug>
 #include <QFileInfo>
 
+namespace {
+// Bumped whenever stored settings need migrating; see ConfigManager::migrate()
+constexpr int kSettingsVersion = 2;
+
+// Fixed poll interval of version 1, which save() wrote out with every change
+constexpr int kLegacyUpdateInterval = 30000;
+}
+
 ConfigManager::ConfigManager(QObject *parent, const QString& configFilePath)
     : QObject(parent)
     , m_notificationsEnabled(true)
@@ -11,7 +19,10 @@ ConfigManager::ConfigManager(QObject *parent, const QString& configFilePath)
     , m_notifyOnLowBattery(true)
     , m_notifyOnChargingComplete(true)
     , m_notifyOnDisconnect(false)
-    , m_updateInterval(30000) // 30 seconds fallback polling
+    , m_updateInterval(900000) // Upper bound for adaptive fallback polling, 15 minutes
+    , m_prewarmTrayIcons(true)
+    , m_sysfsBackendEnabled(true)
+    , m_bluezBackendEnabled(true)
 {
     QString finalConfigPath = configFilePath;
 
@@ -37,13 +48,32 @@ ConfigManager::ConfigManager(QObject *parent, const QString& configFilePath)
     load();
 }
 
+void ConfigManager::migrate() {
+    const int version = m_settings->value("general/settingsVersion", 1).toInt();
+    if (version >= kSettingsVersion) {
+        return;
+    }
+
+    // Version 1 wrote its 30 s default on every save, so a stored 30000 is
+    // almost never a choice; as the adaptive maximum it would pin polling
+    if (m_settings->value("general/updateInterval").toInt() == kLegacyUpdateInterval) {
+        m_settings->remove("general/updateInterval");
+    }
+    m_settings->setValue("general/settingsVersion", kSettingsVersion);
+    m_settings->sync();
+}
+
 void ConfigManager::load() {
+    migrate();
     m_notificationsEnabled = m_settings->value("notifications/enabled", true).toBool();
     m_lowBatteryThreshold = m_settings->value("notifications/lowBatteryThreshold", 20).toInt();
     m_notifyOnLowBattery = m_settings->value("notifications/notifyOnLowBattery", true).toBool();
     m_notifyOnChargingComplete = m_settings->value("notifications/notifyOnChargingComplete", true).toBool();
     m_notifyOnDisconnect = m_settings->value("notifications/notifyOnDisconnect", false).toBool();
-    m_updateInterval = m_settings->value("general/updateInterval", 30000).toInt();
+    m_updateInterval = m_settings->value("general/updateInterval", 900000).toInt();
+    m_prewarmTrayIcons = m_settings->value("general/prewarmTrayIcons", true).toBool();
+    m_sysfsBackendEnabled = m_settings->value("backends/sysfs", true).toBool();
+    m_bluezBackendEnabled = m_settings->value("backends/bluez", true).toBool();
 
     qDebug() << "Configuration loaded from:" << m_settings->fileName();
 }
@@ -55,6 +85,10 @@ void ConfigManager::save() {
     m_settings->setValue("notifications/notifyOnChargingComplete", m_notifyOnChargingComplete);
     m_settings->setValue("notifications/notifyOnDisconnect", m_notifyOnDisconnect);
     m_settings->setValue("general/updateInterval", m_updateInterval);
+    m_settings->setValue("general/prewarmTrayIcons", m_prewarmTrayIcons);
+    m_settings->setValue("backends/sysfs", m_sysfsBackendEnabled);
+    m_settings->setValue("backends/bluez", m_bluezBackendEnabled);
+    m_settings->setValue("general/settingsVersion", kSettingsVersion);
 
     m_settings->sync();
     qDebug() << "Configuration saved to:" << m_settings->fileName();
@@ -112,6 +146,27 @@ void ConfigManager::setUpdateInterval(int interval) {
     }
 }
 
+void ConfigManager::setPrewarmTrayIcons(bool prewarm) {
+    if (m_prewarmTrayIcons != prewarm) {
+        m_prewarmTrayIcons = prewarm;
+        markDirtyAndMaybeSave();
+    }
+}
+
+void ConfigManager::setSysfsBackendEnabled(bool enabled) {
+    if (m_sysfsBackendEnabled != enabled) {
+        m_sysfsBackendEnabled = enabled;
+        markDirtyAndMaybeSave();
+    }
+}
+
+void ConfigManager::setBluezBackendEnabled(bool enabled) {
+    if (m_bluezBackendEnabled != enabled) {
+        m_bluezBackendEnabled = enabled;
+        markDirtyAndMaybeSave();
+    }
+}
+
 void ConfigManager::beginBatchUpdate() {
     ++m_batchDepth;
 }
@@ -32,6 +32,9 @@ public:
     bool notifyOnChargingComplete() const { return m_notifyOnChargingComplete; }
     bool notifyOnDisconnect() const { return m_notifyOnDisconnect; }
     int updateInterval() const { return m_updateInterval; }
+    bool prewarmTrayIcons() const { return m_prewarmTrayIcons; }
+    bool sysfsBackendEnabled() const { return m_sysfsBackendEnabled; }
+    bool bluezBackendEnabled() const { return m_bluezBackendEnabled; }
 
     // Setters
     void setNotificationsEnabled(bool enabled);
@@ -40,6 +43,9 @@ public:
     void setNotifyOnChargingComplete(bool notify);
     void setNotifyOnDisconnect(bool notify);
     void setUpdateInterval(int interval);
+    void setPrewarmTrayIcons(bool prewarm);
+    void setSysfsBackendEnabled(bool enabled);
+    void setBluezBackendEnabled(bool enabled);
 
     void beginBatchUpdate();
     void endBatchUpdate();
@@ -48,6 +54,11 @@ signals:
     void configChanged();
 
 private:
+    /**
+     * @brief Brings settings written by older versions up to the current layout
+     */
+    void migrate();
+
     QSettings *m_settings;
 
     // Configuration values
@@ -56,7 +67,10 @@ private:
     bool m_notifyOnLowBattery;
     bool m_notifyOnChargingComplete;
     bool m_notifyOnDisconnect;
-    int m_updateInterval; // in milliseconds
+    int m_updateInterval; // Maximum fallback poll interval, in milliseconds
+    bool m_prewarmTrayIcons; // render all tray icons in the background at startup
+    bool m_sysfsBackendEnabled; // read power_supply entries directly; applied at startup
+    bool m_bluezBackendEnabled; // read BlueZ Battery1 directly; applied at startup
     int m_batchDepth = 0;
     bool m_dirty = false;
 
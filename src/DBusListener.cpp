@@ -0,0 +1,32 @@
+#include "DBusListener.h"
+
+void DBusListener::propertiesChanged(const QString& interfaceName,
+                                     const QVariantMap& changedProperties,
+                                     const QStringList& invalidatedProperties,
+                                     const QDBusMessage& message) {
+    Q_UNUSED(invalidatedProperties)
+
+    if (interfaceName != "org.freedesktop.UPower.Device") {
+        return;
+    }
+
+    if (changedProperties.contains("Percentage") ||
+        changedProperties.contains("IsCharging") ||
+        changedProperties.contains("State") ||
+        changedProperties.contains("IsPresent")) {
+        emit devicePropertiesChanged(message.path(), changedProperties);
+    }
+    if (changedProperties.contains("Model")) {
+        emit deviceModelChanged(message.path());
+    }
+}
+
+void DBusListener::deviceAdded(const QDBusObjectPath& path) {
+    Q_UNUSED(path)
+    emit statusRelevantEvent();
+}
+
+void DBusListener::deviceRemoved(const QDBusObjectPath& path) {
+    emit devicePathRemoved(path.path());
+    emit statusRelevantEvent();
+}
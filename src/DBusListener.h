@@ -0,0 +1,50 @@
+#pragma once
+#include <QObject>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QStringList>
+#include <QVariantMap>
+
+/**
+ * @class DBusListener
+ * @brief Listens for D-Bus property changes from UPower
+ */
+class DBusListener : public QObject {
+    Q_OBJECT
+public:
+    explicit DBusListener(QObject *parent = nullptr) : QObject(parent) {}
+
+signals:
+    /**
+     * @brief Emitted when the set of UPower devices changed
+     */
+    void statusRelevantEvent();
+
+    /**
+     * @brief Emitted when battery-related properties of one device changed
+     * @param dbusPath Object path of the device that emitted the change
+     * @param changedProperties Changed property values
+     */
+    void devicePropertiesChanged(const QString& dbusPath, const QVariantMap& changedProperties);
+
+    /**
+     * @brief Emitted when the Model of one device changed
+     * @param dbusPath Object path of the device that emitted the change
+     */
+    void deviceModelChanged(const QString& dbusPath);
+
+    /**
+     * @brief Emitted when UPower removed a device object
+     * @param dbusPath Object path of the removed device
+     */
+    void devicePathRemoved(const QString& dbusPath);
+
+public slots:
+    void propertiesChanged(const QString& interfaceName,
+                           const QVariantMap& changedProperties,
+                           const QStringList& invalidatedProperties,
+                           const QDBusMessage& message);
+
+    void deviceAdded(const QDBusObjectPath& path);
+    void deviceRemoved(const QDBusObjectPath& path);
+};
@@ -0,0 +1,72 @@
+#include "DBusSubscriptionManager.h"
+#include <QDebug>
+
+namespace {
+const QString kUPowerService = QStringLiteral("org.freedesktop.UPower");
+const QString kPropertiesInterface = QStringLiteral("org.freedesktop.DBus.Properties");
+const QString kPropertiesChanged = QStringLiteral("PropertiesChanged");
+
+// arg0 of PropertiesChanged is the interface name
+const QStringList kDeviceArgumentMatch = {QStringLiteral("org.freedesktop.UPower.Device")};
+}
+
+DBusSubscriptionManager::DBusSubscriptionManager(const QDBusConnection& bus, QObject *receiver,
+                                                 const char *slot, QObject *parent)
+    : QObject(parent)
+    , m_bus(bus)
+    , m_receiver(receiver)
+    , m_slot(slot)
+{
+}
+
+DBusSubscriptionManager::~DBusSubscriptionManager() {
+    setTrackedPaths(QStringList());
+}
+
+void DBusSubscriptionManager::setTrackedPaths(const QStringList& paths) {
+    const QSet<QString> wanted(paths.cbegin(), paths.cend());
+
+    const QSet<QString> current = m_paths;
+    for (const QString& path : current) {
+        if (!wanted.contains(path)) {
+            untrack(path);
+        }
+    }
+
+    for (const QString& path : wanted) {
+        track(path);
+    }
+}
+
+bool DBusSubscriptionManager::track(const QString& dbusPath) {
+    if (m_paths.contains(dbusPath)) {
+        return true;
+    }
+
+    if (!m_receiver) {
+        return false;
+    }
+
+    const bool connected = m_bus.connect(kUPowerService, dbusPath,
+                                         kPropertiesInterface, kPropertiesChanged,
+                                         kDeviceArgumentMatch, QString(),
+                                         m_receiver, m_slot.constData());
+    if (!connected) {
+        qWarning() << "Failed to subscribe to PropertiesChanged for" << dbusPath;
+        return false;
+    }
+
+    m_paths.insert(dbusPath);
+    return true;
+}
+
+void DBusSubscriptionManager::untrack(const QString& dbusPath) {
+    if (!m_paths.remove(dbusPath) || !m_receiver) {
+        return;
+    }
+
+    m_bus.disconnect(kUPowerService, dbusPath,
+                     kPropertiesInterface, kPropertiesChanged,
+                     kDeviceArgumentMatch, QString(),
+                     m_receiver, m_slot.constData());
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <QObject>
+#include <QDBusConnection>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @class DBusSubscriptionManager
+ * @brief Keeps one PropertiesChanged match rule per tracked UPower device
+ *
+ * Instead of a single catch-all subscription that wakes the process for every
+ * UPower object (laptop battery, mice, DisplayDevice), each tracked headset
+ * path gets its own rule with arg0='org.freedesktop.UPower.Device', so the
+ * bus daemon does the filtering.
+ */
+class DBusSubscriptionManager : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * @param bus Bus the UPower service lives on
+     * @param receiver Object receiving PropertiesChanged
+     * @param slot SLOT() signature invoked for each change
+     * @param parent Parent object
+     */
+    DBusSubscriptionManager(const QDBusConnection& bus, QObject *receiver, const char *slot,
+                            QObject *parent = nullptr);
+    ~DBusSubscriptionManager() override;
+
+    /**
+     * @brief Subscribes to exactly the given paths, adding and removing rules as needed
+     * @param paths Object paths of the devices to track
+     */
+    void setTrackedPaths(const QStringList& paths);
+
+    /**
+     * @brief Adds a match rule for one device path
+     * @return True if the path is subscribed after the call
+     */
+    bool track(const QString& dbusPath);
+
+    /**
+     * @brief Removes the match rule for one device path
+     */
+    void untrack(const QString& dbusPath);
+
+    bool isTracked(const QString& dbusPath) const { return m_paths.contains(dbusPath); }
+    int trackedCount() const { return m_paths.size(); }
+
+private:
+    QDBusConnection m_bus;
+    QPointer<QObject> m_receiver;
+    QByteArray m_slot;
+    QSet<QString> m_paths;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <QFlags>
+#include <QHashFunctions>
+#include <QList>
+#include <QString>
+#include "HeadsetDevice.h"
+
+/**
+ * @brief Fields of a HeadsetDevice that can change between two updates
+ */
+enum class DeviceField : quint8 {
+    None       = 0,
+    Model      = 1 << 0,
+    Connection = 1 << 1,
+    Battery    = 1 << 2,
+    Charging   = 1 << 3,
+    Presence   = 1 << 4,
+    Added      = 1 << 5, ///< Device was not known before this update
+    Removed    = 1 << 6, ///< Device is gone; no other bit is set
+    Estimate   = 1 << 7, ///< Time remaining changed; set by the estimator, not by diffDevice()
+};
+Q_DECLARE_FLAGS(DeviceFields, DeviceField)
+Q_DECLARE_OPERATORS_FOR_FLAGS(DeviceFields)
+
+/**
+ * @brief Fields that change what the tray, menu and notifications show
+ */
+constexpr DeviceFields kDeviceStateFields = DeviceFields(DeviceField::Model) | DeviceField::Connection
+    | DeviceField::Battery | DeviceField::Charging | DeviceField::Presence | DeviceField::Added
+    | DeviceField::Estimate;
+
+/**
+ * @brief Hash of every displayed field of one device
+ *
+ * Equal fingerprints let an update skip the field-by-field comparison; a
+ * different fingerprint is always confirmed with diffDevice().
+ */
+inline size_t deviceFingerprint(const HeadsetDevice& device) {
+    return qHashMulti(0, device.model, quint8(device.connectionType), device.battery,
+                      device.isCharging, device.isPresent);
+}
+
+/**
+ * @brief Returns the displayed fields that differ between two states of a device
+ *
+ * The time remaining is derived state and not compared; see
+ * DeviceStateCache::setSecondsRemaining().
+ */
+inline DeviceFields diffDevice(const HeadsetDevice& before, const HeadsetDevice& after) {
+    DeviceFields fields;
+    if (before.model != after.model) fields |= DeviceField::Model;
+    if (before.connectionType != after.connectionType) fields |= DeviceField::Connection;
+    if (before.battery != after.battery) fields |= DeviceField::Battery;
+    if (before.isCharging != after.isCharging) fields |= DeviceField::Charging;
+    if (before.isPresent != after.isPresent) fields |= DeviceField::Presence;
+    return fields;
+}
+
+/**
+ * @struct DeviceChange
+ * @brief Which fields of one device changed in an update
+ */
+struct DeviceChange {
+    QString dbusPath;
+    DeviceFields fields;
+};
+
+/**
+ * @struct DeviceChangeSet
+ * @brief Everything that changed in one update, computed once and shared
+ *        by the tray, menu and notification layers
+ */
+struct DeviceChangeSet {
+    QList<DeviceChange> changes;  ///< Changed, added and removed devices
+    bool orderChanged = false;    ///< Device list membership or order differs
+    bool everything = false;      ///< Previous state unknown; treat all as changed
+
+    /**
+     * @brief Change set for consumers that have to re-render everything
+     */
+    static DeviceChangeSet all() {
+        DeviceChangeSet set;
+        set.orderChanged = true;
+        set.everything = true;
+        return set;
+    }
+
+    bool isEmpty() const { return changes.isEmpty() && !orderChanged && !everything; }
+};
@@ -0,0 +1,150 @@
+#include "DeviceClassifier.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+namespace {
+QString defaultOverridesPath() {
+    const QString configPath = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
+    return configPath + "/headsetstatus/devices.ini";
+}
+
+struct OverrideGroup {
+    const char *name;
+    DeviceClassifier::Override value;
+};
+
+const OverrideGroup kOverrideGroups[] = {
+    {"alwaysHeadset", DeviceClassifier::Override::AlwaysHeadset},
+    {"neverHeadset", DeviceClassifier::Override::NeverHeadset},
+};
+}
+
+DeviceClassifier::DeviceClassifier(KeywordMatch keywordMatch, const QString& overridesFilePath)
+    : m_keywordMatch(std::move(keywordMatch))
+    , m_settings(overridesFilePath.isEmpty() ? defaultOverridesPath() : overridesFilePath,
+                 QSettings::IniFormat)
+{
+    loadOverrides();
+}
+
+QString DeviceClassifier::identity(const QString& nativePath, const QString& model) {
+    return nativePath + QLatin1Char('\n') + model;
+}
+
+bool DeviceClassifier::isHeadset(const QString& dbusPath, const QString& nativePath, const QString& model) {
+    const QString key = identity(nativePath, model);
+
+    bool headset;
+    const auto overrideIt = m_overrides.constFind(key);
+    const auto cachedIt = m_byIdentity.constFind(key);
+    if (overrideIt != m_overrides.constEnd()) {
+        headset = overrideIt.value() == Override::AlwaysHeadset;
+    } else if (cachedIt != m_byIdentity.constEnd()) {
+        headset = cachedIt.value();
+    } else {
+        headset = m_keywordMatch(model, dbusPath);
+
+        // Bluetooth devices can appear before their model is known; only
+        // remember a negative decision once there is a model to judge
+        if (headset || !model.isEmpty()) {
+            m_byIdentity.insert(key, headset);
+        }
+    }
+
+    if (headset || !model.isEmpty() || overrideIt != m_overrides.constEnd()) {
+        m_byPath.insert(dbusPath, headset);
+    }
+    return headset;
+}
+
+bool DeviceClassifier::isKnownNonHeadset(const QString& dbusPath) const {
+    const auto it = m_byPath.constFind(dbusPath);
+    return it != m_byPath.constEnd() && !it.value();
+}
+
+void DeviceClassifier::forgetPath(const QString& dbusPath) {
+    m_byPath.remove(dbusPath);
+}
+
+void DeviceClassifier::clearCache() {
+    m_byIdentity.clear();
+    m_byPath.clear();
+}
+
+void DeviceClassifier::setOverride(const QString& nativePath, const QString& model, Override value) {
+    const QString key = identity(nativePath, model);
+    if (overrideFor(nativePath, model) == value) {
+        return;
+    }
+
+    if (value == Override::None) {
+        m_overrides.remove(key);
+    } else {
+        m_overrides.insert(key, value);
+    }
+
+    // Path decisions may now be stale; they are rebuilt on the next enumeration
+    m_byIdentity.remove(key);
+    m_byPath.clear();
+    saveOverrides();
+}
+
+DeviceClassifier::Override DeviceClassifier::overrideFor(const QString& nativePath, const QString& model) const {
+    return m_overrides.value(identity(nativePath, model), Override::None);
+}
+
+QList<DeviceClassifier::StoredOverride> DeviceClassifier::readOverrides(const QString& overridesFilePath) {
+    QSettings settings(overridesFilePath.isEmpty() ? defaultOverridesPath() : overridesFilePath,
+                       QSettings::IniFormat);
+    return readOverrides(settings);
+}
+
+QList<DeviceClassifier::StoredOverride> DeviceClassifier::readOverrides(QSettings& settings) {
+    QList<StoredOverride> overrides;
+    for (const OverrideGroup& group : kOverrideGroups) {
+        const int count = settings.beginReadArray(group.name);
+        for (int i = 0; i < count; ++i) {
+            settings.setArrayIndex(i);
+            overrides.append({settings.value("nativePath").toString(),
+                              settings.value("model").toString(), group.value});
+        }
+        settings.endArray();
+    }
+    return overrides;
+}
+
+void DeviceClassifier::loadOverrides() {
+    m_overrides.clear();
+
+    for (const StoredOverride& stored : readOverrides(m_settings)) {
+        m_overrides.insert(identity(stored.nativePath, stored.model), stored.value);
+    }
+}
+
+void DeviceClassifier::saveOverrides() {
+    const QString dirPath = QFileInfo(m_settings.fileName()).absolutePath();
+    QDir dir;
+    if (!dir.exists(dirPath)) {
+        dir.mkpath(dirPath);
+    }
+
+    for (const OverrideGroup& group : kOverrideGroups) {
+        m_settings.remove(group.name);
+        m_settings.beginWriteArray(group.name);
+        int index = 0;
+        for (auto it = m_overrides.constBegin(); it != m_overrides.constEnd(); ++it) {
+            if (it.value() != group.value) {
+                continue;
+            }
+
+            const int separator = it.key().indexOf(QLatin1Char('\n'));
+            m_settings.setArrayIndex(index++);
+            m_settings.setValue("nativePath", it.key().left(separator));
+            m_settings.setValue("model", it.key().mid(separator + 1));
+        }
+        m_settings.endArray();
+    }
+
+    m_settings.sync();
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <QHash>
+#include <QList>
+#include <QSettings>
+#include <QString>
+#include <functional>
+
+/**
+ * @class DeviceClassifier
+ * @brief Caches headset/non-headset decisions per device and persists user overrides
+ *
+ * Each UPower device is classified once per lifetime, keyed by its stable
+ * identity (native path plus model). User overrides ("always treat as
+ * headset" / "never") are stored in ~/.config/headsetstatus/devices.ini and
+ * take precedence over keyword matching.
+ */
+class DeviceClassifier {
+public:
+    enum class Override {
+        None,
+        AlwaysHeadset,
+        NeverHeadset
+    };
+
+    /**
+     * @brief One entry of the overrides file
+     */
+    struct StoredOverride {
+        QString nativePath;
+        QString model;
+        Override value = Override::None;
+    };
+
+    using KeywordMatch = std::function<bool(const QString& model, const QString& dbusPath)>;
+
+    /**
+     * @param keywordMatch Fallback used for devices without a cached decision
+     * @param overridesFilePath Overrides file; defaults to the config directory
+     */
+    explicit DeviceClassifier(KeywordMatch keywordMatch, const QString& overridesFilePath = QString());
+
+    /**
+     * @brief Builds the stable identity used as cache and override key
+     */
+    static QString identity(const QString& nativePath, const QString& model);
+
+    /**
+     * @brief Classifies a device, consulting overrides and the cache first
+     * @param dbusPath D-Bus object path of the device
+     * @param nativePath UPower NativePath
+     * @param model UPower Model
+     * @return True if the device should be treated as a headset
+     */
+    bool isHeadset(const QString& dbusPath, const QString& nativePath, const QString& model);
+
+    /**
+     * @brief Returns true if the object path is known not to be a headset
+     *
+     * Such devices can be skipped during enumeration without fetching any
+     * properties.
+     */
+    bool isKnownNonHeadset(const QString& dbusPath) const;
+
+    /**
+     * @brief Drops the per-path decision, e.g. after UPower removed the object
+     */
+    void forgetPath(const QString& dbusPath);
+
+    /**
+     * @brief Drops every cached decision; overrides are kept
+     */
+    void clearCache();
+
+    /**
+     * @brief Stores a user override and persists it
+     * @param nativePath UPower NativePath
+     * @param model UPower Model
+     * @param value Override to apply; Override::None removes it
+     */
+    void setOverride(const QString& nativePath, const QString& model, Override value);
+    Override overrideFor(const QString& nativePath, const QString& model) const;
+
+    QString overridesFileName() const { return m_settings.fileName(); }
+
+    /**
+     * @brief Reads the overrides stored in a file, e.g. to list them in the UI
+     * @param overridesFilePath Overrides file; defaults to the config directory
+     */
+    static QList<StoredOverride> readOverrides(const QString& overridesFilePath = QString());
+
+private:
+    static QList<StoredOverride> readOverrides(QSettings& settings);
+    void loadOverrides();
+    void saveOverrides();
+
+    KeywordMatch m_keywordMatch;
+    QSettings m_settings;
+    QHash<QString, Override> m_overrides;
+    QHash<QString, bool> m_byIdentity;
+    QHash<QString, bool> m_byPath;
+};
@@ -0,0 +1,171 @@
+#include "DeviceJsonEncoder.h"
+#include <QtMath>
+#include <charconv>
+#include <iterator>
+#include "DeviceStateCache.h"
+
+namespace {
+QByteArray escapeJsonString(const QString& value) {
+    static const char kHex[] = "0123456789abcdef";
+    const QByteArray utf8 = value.toUtf8();
+    QByteArray out;
+    out.reserve(utf8.size() + 2);
+    out.append('"');
+    for (const char c : utf8) {
+        switch (c) {
+        case '"':  out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (uchar(c) < 0x20) {
+                out.append("\\u00");
+                out.append(kHex[uchar(c) >> 4]);
+                out.append(kHex[uchar(c) & 0xf]);
+            } else {
+                out.append(c);
+            }
+        }
+    }
+    out.append('"');
+    return out;
+}
+
+void appendInteger(QByteArray& out, qint64 value) {
+    char buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr - buffer);
+}
+
+// Locale-independent and allocation-free; UPower reports at most two decimals
+void appendPercentage(QByteArray& out, double value) {
+    qint64 hundredths = qRound64(value * 100);
+    if (hundredths < 0) {
+        out.append('-');
+        hundredths = -hundredths;
+    }
+    appendInteger(out, hundredths / 100);
+    const int fraction = int(hundredths % 100);
+    if (fraction != 0) {
+        out.append('.');
+        out.append(char('0' + fraction / 10));
+        if (fraction % 10 != 0) {
+            out.append(char('0' + fraction % 10));
+        }
+    }
+}
+
+void appendBool(QByteArray& out, bool value) {
+    out.append(value ? "true" : "false");
+}
+}
+
+DeviceJsonEncoder::DeviceJsonEncoder(const DeviceStateCache& cache) : m_cache(cache) {
+}
+
+const DeviceJsonEncoder::EscapedDevice& DeviceJsonEncoder::escaped(const HeadsetDevice& device) {
+    auto it = m_escaped.find(device.dbusPath);
+    if (it == m_escaped.end()) {
+        EscapedDevice entry;
+        entry.path = escapeJsonString(device.dbusPath);
+        entry.nativePath = escapeJsonString(device.nativePath);
+        it = m_escaped.insert(device.dbusPath, entry);
+    }
+
+    // Model names are interned, so this is usually a pointer comparison
+    if (it->model != device.model || it->jsonModel.isEmpty()) {
+        it->model = device.model;
+        it->jsonModel = escapeJsonString(device.model);
+    }
+    return *it;
+}
+
+void DeviceJsonEncoder::appendDevice(QByteArray& out, const HeadsetDevice& device, DeviceFields fields) {
+    const bool all = fields & DeviceField::Added;
+    const EscapedDevice& strings = escaped(device);
+
+    out.append("{\"path\":");
+    out.append(strings.path);
+    if (all || (fields & DeviceField::Model)) {
+        out.append(",\"model\":");
+        out.append(strings.jsonModel);
+    }
+    if (all) {
+        out.append(",\"native_path\":");
+        out.append(strings.nativePath);
+    }
+    if (all || (fields & DeviceField::Connection)) {
+        switch (device.connectionType) {
+        case ConnectionType::USB:
+            out.append(",\"connection\":\"USB\"");
+            break;
+        case ConnectionType::Unknown:
+            out.append(",\"connection\":\"Unknown\"");
+            break;
+        case ConnectionType::Bluetooth:
+            out.append(",\"connection\":\"Bluetooth\"");
+            break;
+        }
+    }
+    if (all || (fields & DeviceField::Battery)) {
+        out.append(",\"battery\":");
+        appendPercentage(out, device.battery);
+    }
+    if (all || (fields & DeviceField::Charging)) {
+        out.append(",\"charging\":");
+        appendBool(out, device.isCharging);
+    }
+    if (all || (fields & DeviceField::Presence)) {
+        out.append(",\"present\":");
+        appendBool(out, device.isPresent);
+    }
+    if (all || (fields & DeviceField::Estimate)) {
+        out.append(",\"time_remaining\":");
+        appendInteger(out, device.secondsRemaining);
+    }
+    out.append('}');
+}
+
+void DeviceJsonEncoder::appendSnapshot(QByteArray& out) {
+    // Drop strings of devices that went away without a removal record
+    for (auto it = m_escaped.begin(); it != m_escaped.end();) {
+        it = m_cache.contains(it.key()) ? std::next(it) : m_escaped.erase(it);
+    }
+
+    out.append("{\"event\":\"snapshot\",\"devices\":[");
+    bool first = true;
+    for (const HeadsetDevice& device : m_cache.devices()) {
+        if (!first) {
+            out.append(',');
+        }
+        first = false;
+        appendDevice(out, device, DeviceField::Added);
+    }
+    out.append("]}\n");
+}
+
+int DeviceJsonEncoder::appendChanges(const DeviceChangeSet& changes, QByteArray& out) {
+    int lines = 0;
+    for (const DeviceChange& change : changes.changes) {
+        if (change.fields & DeviceField::Removed) {
+            const auto it = m_escaped.constFind(change.dbusPath);
+            out.append("{\"event\":\"removed\",\"device\":{\"path\":");
+            out.append(it != m_escaped.constEnd() ? it->path : escapeJsonString(change.dbusPath));
+            out.append("}}\n");
+            m_escaped.remove(change.dbusPath);
+            ++lines;
+        } else if (change.fields & kDeviceStateFields) {
+            const HeadsetDevice *device = m_cache.find(change.dbusPath);
+            if (!device) {
+                continue;
+            }
+            out.append(change.fields & DeviceField::Added
+                       ? "{\"event\":\"added\",\"device\":" : "{\"event\":\"changed\",\"device\":");
+            appendDevice(out, *device, change.fields);
+            out.append("}\n");
+            ++lines;
+        }
+    }
+    return lines;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include "DeviceChange.h"
+
+class DeviceStateCache;
+
+/**
+ * @class DeviceJsonEncoder
+ * @brief Encodes the headset state as newline-delimited JSON records
+ *
+ * Shared by --watch --json and the status socket:
+ *
+ *     {"event":"snapshot","devices":[{"path":"/org/...","model":"...",...}]}
+ *     {"event":"changed","device":{"path":"/org/...","battery":49}}
+ *     {"event":"removed","device":{"path":"/org/..."}}
+ *
+ * Added devices and the snapshot carry every key (path, model, native_path,
+ * connection, battery, charging, present, time_remaining); changed devices
+ * only the path and what changed. The escaped strings of each device are
+ * kept until it is removed and numbers are formatted on the stack, so
+ * encoding into a reused buffer does not allocate.
+ */
+class DeviceJsonEncoder {
+public:
+    /** @brief Output buffer size that fits a snapshot of a few dozen headsets without growing */
+    static constexpr qsizetype kBufferCapacity = 4096;
+
+    /**
+     * @param cache Device state the records are built from; must outlive the encoder
+     */
+    explicit DeviceJsonEncoder(const DeviceStateCache& cache);
+
+    /**
+     * @brief Appends one snapshot line with every cached device
+     */
+    void appendSnapshot(QByteArray& out);
+
+    /**
+     * @brief Appends one line per added, changed or removed device
+     * @return Number of lines appended
+     */
+    int appendChanges(const DeviceChangeSet& changes, QByteArray& out);
+
+private:
+    struct EscapedDevice {
+        QString model;
+        QByteArray path;
+        QByteArray jsonModel;
+        QByteArray nativePath;
+    };
+
+    const EscapedDevice& escaped(const HeadsetDevice& device);
+    void appendDevice(QByteArray& out, const HeadsetDevice& device, DeviceFields fields);
+
+    const DeviceStateCache& m_cache;
+    QHash<QString, EscapedDevice> m_escaped;
+};
@@ -0,0 +1,21 @@
+#include "DeviceSource.h"
+
+DeviceSource::DeviceSource(QObject *parent) : QObject(parent) {}
+
+DeviceSource::~DeviceSource() = default;
+
+void DeviceSource::setTrackedDevices(const QList<HeadsetDevice>& devices) {
+    Q_UNUSED(devices)
+}
+
+void DeviceSource::ignoreDevice(const HeadsetDevice& device) {
+    Q_UNUSED(device)
+}
+
+void DeviceSource::pinDevice(const HeadsetDevice& device) {
+    Q_UNUSED(device)
+}
+
+void DeviceSource::resetDevice(const HeadsetDevice& device) {
+    Q_UNUSED(device)
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+#include "HeadsetDevice.h"
+
+/**
+ * @class DeviceSource
+ * @brief Where HeadsetStatusApp gets its headsets from
+ *
+ * HeadsetManager implements it on UPower plus the direct sysfs and BlueZ
+ * backends; ReplaySource plays back a recorded trace. The application only
+ * talks to this interface, so a trace recorded on one machine drives the
+ * same update, tray and notification code on another.
+ */
+class DeviceSource : public QObject {
+    Q_OBJECT
+public:
+    explicit DeviceSource(QObject *parent = nullptr);
+    ~DeviceSource() override;
+
+    /**
+     * @brief Starts an enumeration; the result is delivered through devicesReady()
+     *
+     * A request made while another is running may be merged with it, but
+     * is always answered.
+     */
+    virtual void requestDevices() = 0;
+
+    /**
+     * @brief Returns true while an enumeration is running
+     */
+    virtual bool isRefreshPending() const = 0;
+
+    /**
+     * @brief Tells the source which devices the application shows
+     *
+     * Sources that subscribe to changes per device follow this list; the
+     * default does nothing.
+     */
+    virtual void setTrackedDevices(const QList<HeadsetDevice>& devices);
+
+    /**
+     * @brief The user asked not to treat the device as a headset again
+     *
+     * The default does nothing; the next enumeration is requested by the caller.
+     */
+    virtual void ignoreDevice(const HeadsetDevice& device);
+
+    /**
+     * @brief The user asked to always treat the device as a headset
+     *
+     * The default does nothing; the next enumeration is requested by the caller.
+     */
+    virtual void pinDevice(const HeadsetDevice& device);
+
+    /**
+     * @brief The user asked to drop a "never" or "always" decision again
+     *
+     * Only nativePath and model of @p device are used, so it need not be
+     * connected. The default does nothing; the next enumeration is
+     * requested by the caller.
+     */
+    virtual void resetDevice(const HeadsetDevice& device);
+
+signals:
+    /**
+     * @brief Result of requestDevices(), or a snapshot the source took itself
+     * @param devices Connected headsets, in enumeration order
+     */
+    void devicesReady(const QList<HeadsetDevice>& devices);
+
+    /**
+     * @brief A headset appeared, disappeared or changed identity; a new
+     *        enumeration is due
+     */
+    void devicesChanged();
+
+    /**
+     * @brief Properties of one headset changed
+     * @param dbusPath Object path of the device
+     * @param properties Changed values under their UPower property names
+     */
+    void devicePropertiesChanged(const QString& dbusPath, const QVariantMap& properties);
+};
@@ -0,0 +1,130 @@
+#include "DeviceStateCache.h"
+#include <utility>
+
+QList<HeadsetDevice> DeviceStateCache::replaceAll(const QList<HeadsetDevice>& devices,
+                                                  DeviceChangeSet *changes) {
+    QHash<QString, int> index;
+    index.reserve(devices.size());
+    QList<size_t> fingerprints;
+    fingerprints.reserve(devices.size());
+    QList<std::pair<int, qint32>> estimates;
+    bool orderChanged = devices.size() != m_devices.size();
+
+    for (int i = 0; i < devices.size(); ++i) {
+        const HeadsetDevice& device = devices.at(i);
+        index.insert(device.dbusPath, i);
+        fingerprints.append(deviceFingerprint(device));
+
+        const auto previous = m_index.constFind(device.dbusPath);
+        if (previous == m_index.constEnd()) {
+            orderChanged = true;
+            if (changes) {
+                changes->changes.append({device.dbusPath, DeviceField::Added});
+            }
+            continue;
+        }
+
+        orderChanged |= previous.value() != i;
+
+        const qint32 secondsRemaining = m_devices.at(previous.value()).secondsRemaining;
+        if (secondsRemaining >= 0 && device.secondsRemaining < 0) {
+            estimates.append({i, secondsRemaining});
+        }
+
+        // Only devices whose fingerprint moved are compared field by field
+        if (changes && fingerprints.last() != m_fingerprints.at(previous.value())) {
+            const DeviceFields fields = diffDevice(m_devices.at(previous.value()), device);
+            if (fields) {
+                changes->changes.append({device.dbusPath, fields});
+            }
+        }
+    }
+
+    QList<HeadsetDevice> removed;
+    for (const HeadsetDevice& device : std::as_const(m_devices)) {
+        if (!index.contains(device.dbusPath)) {
+            removed.append(device);
+            if (changes) {
+                changes->changes.append({device.dbusPath, DeviceField::Removed});
+            }
+        }
+    }
+
+    if (changes) {
+        changes->orderChanged |= orderChanged;
+    }
+
+    m_devices = devices;
+    for (const auto& [i, secondsRemaining] : std::as_const(estimates)) {
+        m_devices[i].secondsRemaining = secondsRemaining;
+    }
+    m_fingerprints = std::move(fingerprints);
+    m_index = std::move(index);
+    return removed;
+}
+
+bool DeviceStateCache::applyProperties(const QString& dbusPath, const QVariantMap& changedProperties,
+                                       HeadsetDevice *updated, DeviceFields *changedFields) {
+    const auto it = m_index.constFind(dbusPath);
+    if (it == m_index.constEnd()) {
+        return false;
+    }
+
+    HeadsetDevice& device = m_devices[it.value()];
+    DeviceFields fields;
+
+    const auto percentage = changedProperties.constFind(QStringLiteral("Percentage"));
+    if (percentage != changedProperties.constEnd()) {
+        const double battery = percentage->toDouble();
+        if (battery != device.battery) {
+            device.battery = battery;
+            fields |= DeviceField::Battery;
+        }
+    }
+
+    auto charging = changedProperties.constFind(QStringLiteral("IsCharging"));
+    bool isCharging = device.isCharging;
+    if (charging != changedProperties.constEnd()) {
+        isCharging = charging->toBool();
+    } else if ((charging = changedProperties.constFind(QStringLiteral("State"))) != changedProperties.constEnd()) {
+        isCharging = charging->toUInt() == kUPowerStateCharging;
+    }
+    if (isCharging != device.isCharging) {
+        device.isCharging = isCharging;
+        fields |= DeviceField::Charging;
+    }
+
+    const auto present = changedProperties.constFind(QStringLiteral("IsPresent"));
+    if (present != changedProperties.constEnd() && present->toBool() != device.isPresent) {
+        device.isPresent = present->toBool();
+        fields |= DeviceField::Presence;
+    }
+
+    if (!fields) {
+        return false;
+    }
+
+    m_fingerprints[it.value()] = deviceFingerprint(device);
+    if (updated) {
+        *updated = device;
+    }
+    if (changedFields) {
+        *changedFields = fields;
+    }
+    return true;
+}
+
+bool DeviceStateCache::setSecondsRemaining(const QString& dbusPath, qint32 seconds) {
+    const auto it = m_index.constFind(dbusPath);
+    if (it == m_index.constEnd() || m_devices.at(it.value()).secondsRemaining == seconds) {
+        return false;
+    }
+
+    m_devices[it.value()].secondsRemaining = seconds;
+    return true;
+}
+
+const HeadsetDevice* DeviceStateCache::find(const QString& dbusPath) const {
+    const auto it = m_index.constFind(dbusPath);
+    return it == m_index.constEnd() ? nullptr : &m_devices.at(it.value());
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVariantMap>
+#include "DeviceChange.h"
+#include "HeadsetDevice.h"
+
+/**
+ * @class DeviceStateCache
+ * @brief Last known state of every tracked headset, keyed by D-Bus path
+ *
+ * Holds the result of the latest full enumeration and merges UPower
+ * PropertiesChanged payloads into it, so a single property change costs a
+ * hash lookup instead of a rescan of every device. Every update reports
+ * which device and which fields changed, using a per-device fingerprint to
+ * skip devices that are unchanged.
+ */
+class DeviceStateCache {
+public:
+    /**
+     * @brief Replaces the cached devices with a fresh enumeration result
+     * @param devices Devices in enumeration order
+     * @param changes Receives added, changed and removed devices (may be null)
+     * @return Devices that were cached before but are missing from @p devices
+     */
+    QList<HeadsetDevice> replaceAll(const QList<HeadsetDevice>& devices,
+                                    DeviceChangeSet *changes = nullptr);
+
+    /**
+     * @brief Merges changed UPower Device properties into a cached device
+     * @param dbusPath D-Bus object path the change was emitted for
+     * @param changedProperties Payload of the PropertiesChanged signal
+     * @param updated Receives the merged device if it changed (may be null)
+     * @param changedFields Receives the fields that changed (may be null)
+     * @return True if the path is cached and a tracked field changed
+     */
+    bool applyProperties(const QString& dbusPath, const QVariantMap& changedProperties,
+                         HeadsetDevice *updated = nullptr, DeviceFields *changedFields = nullptr);
+
+    /**
+     * @brief Stores the estimated time remaining of a cached device
+     *
+     * The estimate is kept across replaceAll(), since enumeration results
+     * never carry one.
+     * @return True if the path is cached and the estimate changed
+     */
+    bool setSecondsRemaining(const QString& dbusPath, qint32 seconds);
+
+    /**
+     * @brief Looks up a cached device
+     * @return Pointer to the device, or nullptr if the path is not cached
+     */
+    const HeadsetDevice* find(const QString& dbusPath) const;
+
+    bool contains(const QString& dbusPath) const { return m_index.contains(dbusPath); }
+    int size() const { return m_devices.size(); }
+    bool isEmpty() const { return m_devices.isEmpty(); }
+
+    /**
+     * @brief Returns the cached devices in enumeration order
+     */
+    const QList<HeadsetDevice>& devices() const { return m_devices; }
+
+private:
+    QList<HeadsetDevice> m_devices;
+    QList<size_t> m_fingerprints;
+    QHash<QString, int> m_index;
+};
@@ -0,0 +1,388 @@
+#include "DeviceTrace.h"
+#include <QStringList>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr int kHeaderSize = 8;
+
+// Flags byte of a snapshot device
+constexpr quint8 kFlagCharging = 1 << 0;
+constexpr quint8 kFlagPresent = 1 << 1;
+constexpr quint8 kFlagUsb = 1 << 2;
+constexpr quint8 kFlagUnknownConnection = 1 << 3;
+
+// Type tags of property values
+enum class ValueTag : quint8 {
+    False = 0,
+    True = 1,
+    Double = 2,
+    UInt = 3,
+    Int = 4,
+    String = 5,
+};
+
+void setError(QString *error, const QString& message) {
+    if (error) {
+        *error = message;
+    }
+}
+
+/**
+ * @brief Bounds-checked cursor over a trace; every read fails once past the end
+ */
+class TraceReader {
+public:
+    TraceReader(const QByteArray& data, int offset) : m_data(data), m_pos(offset) {}
+
+    bool atEnd() const { return m_pos >= m_data.size(); }
+
+    bool readByte(quint8 *value) {
+        if (m_pos >= m_data.size()) {
+            return false;
+        }
+        *value = quint8(m_data.at(m_pos++));
+        return true;
+    }
+
+    bool readVarint(quint64 *value) {
+        quint64 result = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            quint8 byte;
+            if (!readByte(&byte)) {
+                return false;
+            }
+            result |= quint64(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                *value = result;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readString(QString *value) {
+        quint64 index;
+        if (!readVarint(&index) || index > quint64(m_strings.size())) {
+            return false;
+        }
+        if (index < quint64(m_strings.size())) {
+            *value = m_strings.at(int(index));
+            return true;
+        }
+
+        quint64 length;
+        if (!readVarint(&length) || length > quint64(m_data.size() - m_pos)) {
+            return false;
+        }
+        *value = QString::fromUtf8(m_data.constData() + m_pos, int(length));
+        m_pos += int(length);
+        m_strings.append(*value);
+        return true;
+    }
+
+    bool readDouble(double *value) {
+        if (m_data.size() - m_pos < 8) {
+            return false;
+        }
+        const quint64 bits = qFromLittleEndian<quint64>(m_data.constData() + m_pos);
+        std::memcpy(value, &bits, sizeof(bits));
+        m_pos += 8;
+        return true;
+    }
+
+    bool readValue(QVariant *value) {
+        quint8 tag;
+        if (!readByte(&tag)) {
+            return false;
+        }
+        switch (ValueTag(tag)) {
+        case ValueTag::False:
+        case ValueTag::True:
+            *value = tag == quint8(ValueTag::True);
+            return true;
+        case ValueTag::Double: {
+            double number;
+            if (!readDouble(&number)) {
+                return false;
+            }
+            *value = number;
+            return true;
+        }
+        case ValueTag::UInt: {
+            quint64 number;
+            if (!readVarint(&number)) {
+                return false;
+            }
+            *value = uint(number);
+            return true;
+        }
+        case ValueTag::Int: {
+            quint64 zigzag;
+            if (!readVarint(&zigzag)) {
+                return false;
+            }
+            *value = int(qint64(zigzag >> 1) ^ -qint64(zigzag & 1));
+            return true;
+        }
+        case ValueTag::String: {
+            QString text;
+            if (!readString(&text)) {
+                return false;
+            }
+            *value = text;
+            return true;
+        }
+        }
+        return false;
+    }
+
+private:
+    const QByteArray& m_data;
+    int m_pos;
+    QStringList m_strings;
+};
+}
+
+bool DeviceTraceWriter::open(const QString& path, QString *error) {
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        setError(error, QString("Cannot write %1: %2").arg(path, m_file.errorString()));
+        return false;
+    }
+
+    const QByteArray header = fileHeader();
+    if (m_file.write(header) != header.size() || !m_file.flush()) {
+        setError(error, QString("Cannot write %1: %2").arg(path, m_file.errorString()));
+        m_file.close();
+        return false;
+    }
+
+    m_strings.clear();
+    m_lastTimeUs = 0;
+    m_bytesWritten = header.size();
+    return true;
+}
+
+QByteArray DeviceTraceWriter::fileHeader() {
+    QByteArray header(kMagic, kHeaderSize - 1);
+    header.append(char(kVersion));
+    return header;
+}
+
+QByteArray DeviceTraceWriter::encode(const QList<DeviceTraceEvent>& events) {
+    DeviceTraceWriter writer;
+    QByteArray data = fileHeader();
+    for (const DeviceTraceEvent& event : events) {
+        writer.encodeRecord(event);
+        data.append(writer.m_record);
+    }
+    return data;
+}
+
+void DeviceTraceWriter::close() {
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+void DeviceTraceWriter::appendVarint(quint64 value) {
+    while (value >= 0x80) {
+        m_record.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    m_record.append(char(value));
+}
+
+void DeviceTraceWriter::appendString(const QString& value) {
+    const auto it = m_strings.constFind(value);
+    if (it != m_strings.constEnd()) {
+        appendVarint(it.value());
+        return;
+    }
+
+    // The next free index announces a new string
+    const quint32 index = quint32(m_strings.size());
+    m_strings.insert(value, index);
+    const QByteArray utf8 = value.toUtf8();
+    appendVarint(index);
+    appendVarint(quint64(utf8.size()));
+    m_record.append(utf8);
+}
+
+void DeviceTraceWriter::appendValue(const QVariant& value) {
+    switch (value.typeId()) {
+    case QMetaType::Bool:
+        m_record.append(char(value.toBool() ? ValueTag::True : ValueTag::False));
+        break;
+    case QMetaType::UChar:
+    case QMetaType::UShort:
+    case QMetaType::UInt:
+    case QMetaType::ULongLong:
+        m_record.append(char(ValueTag::UInt));
+        appendVarint(value.toULongLong());
+        break;
+    case QMetaType::Short:
+    case QMetaType::Int:
+    case QMetaType::LongLong: {
+        const qint64 number = value.toLongLong();
+        m_record.append(char(ValueTag::Int));
+        appendVarint((quint64(number) << 1) ^ quint64(number >> 63));
+        break;
+    }
+    case QMetaType::Double:
+    case QMetaType::Float: {
+        const double number = value.toDouble();
+        quint64 bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        char buffer[8];
+        qToLittleEndian(bits, buffer);
+        m_record.append(char(ValueTag::Double));
+        m_record.append(buffer, sizeof(buffer));
+        break;
+    }
+    default:
+        m_record.append(char(ValueTag::String));
+        appendString(value.toString());
+        break;
+    }
+}
+
+bool DeviceTraceWriter::write(const DeviceTraceEvent& event) {
+    if (!m_file.isOpen()) {
+        return false;
+    }
+
+    encodeRecord(event);
+    if (m_file.write(m_record) != m_record.size() || !m_file.flush()) {
+        // Whatever reached the file ends in a cut-short record, which
+        // readDeviceTrace() drops
+        m_file.close();
+        m_strings.clear();
+        return false;
+    }
+    m_bytesWritten += m_record.size();
+    return true;
+}
+
+void DeviceTraceWriter::encodeRecord(const DeviceTraceEvent& event) {
+    m_record.resize(0);
+    appendVarint(quint64(qMax<qint64>(0, event.timeUs - m_lastTimeUs)));
+    m_lastTimeUs = qMax(m_lastTimeUs, event.timeUs);
+    m_record.append(char(event.type));
+
+    switch (event.type) {
+    case DeviceTraceEvent::Type::Snapshot:
+        appendVarint(quint64(event.devices.size()));
+        for (const HeadsetDevice& device : event.devices) {
+            appendString(device.dbusPath);
+            appendString(device.model);
+            appendString(device.nativePath);
+            appendVarint(quint64(std::lround(qBound(0.0, device.battery, 100.0) * 100)));
+            quint8 flags = 0;
+            if (device.isCharging) flags |= kFlagCharging;
+            if (device.isPresent) flags |= kFlagPresent;
+            if (device.connectionType == ConnectionType::USB) flags |= kFlagUsb;
+            if (device.connectionType == ConnectionType::Unknown) flags |= kFlagUnknownConnection;
+            m_record.append(char(flags));
+        }
+        break;
+    case DeviceTraceEvent::Type::DevicesChanged:
+        break;
+    case DeviceTraceEvent::Type::PropertiesChanged:
+        appendString(event.dbusPath);
+        appendVarint(quint64(event.properties.size()));
+        for (auto it = event.properties.constBegin(); it != event.properties.constEnd(); ++it) {
+            appendString(it.key());
+            appendValue(it.value());
+        }
+        break;
+    }
+}
+
+bool readDeviceTrace(const QString& path, QList<DeviceTraceEvent> *events, QString *error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(error, QString("Cannot read %1: %2").arg(path, file.errorString()));
+        return false;
+    }
+
+    const QByteArray data = file.readAll();
+    if (data.size() < kHeaderSize
+        || std::memcmp(data.constData(), DeviceTraceWriter::kMagic, kHeaderSize - 1) != 0) {
+        setError(error, path + " is not a headset trace");
+        return false;
+    }
+    if (quint8(data.at(kHeaderSize - 1)) != DeviceTraceWriter::kVersion) {
+        setError(error, QString("%1 has unsupported trace version %2").arg(path).arg(quint8(data.at(kHeaderSize - 1))));
+        return false;
+    }
+
+    events->clear();
+    TraceReader reader(data, kHeaderSize);
+    qint64 timeUs = 0;
+
+    // A failed read inside a record means the file ends in the middle of it
+    while (!reader.atEnd()) {
+        DeviceTraceEvent event;
+        quint64 delta;
+        quint8 type;
+        if (!reader.readVarint(&delta) || !reader.readByte(&type)) {
+            break;
+        }
+        timeUs += qint64(delta);
+        event.timeUs = timeUs;
+        event.type = DeviceTraceEvent::Type(type);
+
+        bool complete = true;
+        switch (event.type) {
+        case DeviceTraceEvent::Type::Snapshot: {
+            quint64 count;
+            complete = reader.readVarint(&count);
+            for (quint64 i = 0; complete && i < count; ++i) {
+                HeadsetDevice device;
+                quint64 hundredths;
+                quint8 flags;
+                complete = reader.readString(&device.dbusPath) && reader.readString(&device.model)
+                    && reader.readString(&device.nativePath) && reader.readVarint(&hundredths)
+                    && reader.readByte(&flags);
+                if (complete) {
+                    device.battery = hundredths / 100.0;
+                    device.isCharging = flags & kFlagCharging;
+                    device.isPresent = flags & kFlagPresent;
+                    device.connectionType = (flags & kFlagUsb) ? ConnectionType::USB
+                        : (flags & kFlagUnknownConnection) ? ConnectionType::Unknown : ConnectionType::Bluetooth;
+                    event.devices.append(device);
+                }
+            }
+            break;
+        }
+        case DeviceTraceEvent::Type::DevicesChanged:
+            break;
+        case DeviceTraceEvent::Type::PropertiesChanged: {
+            quint64 count;
+            complete = reader.readString(&event.dbusPath) && reader.readVarint(&count);
+            for (quint64 i = 0; complete && i < count; ++i) {
+                QString name;
+                QVariant value;
+                complete = reader.readString(&name) && reader.readValue(&value);
+                if (complete) {
+                    event.properties.insert(name, value);
+                }
+            }
+            break;
+        }
+        default:
+            setError(error, QString("%1: unknown record type %2").arg(path).arg(type));
+            return false;
+        }
+
+        if (!complete) {
+            break;
+        }
+        events->append(event);
+    }
+    return true;
+}
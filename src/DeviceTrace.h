@@ -0,0 +1,94 @@
+#pragma once
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVariantMap>
+#include "HeadsetDevice.h"
+
+/**
+ * @struct DeviceTraceEvent
+ * @brief One DeviceSource signal as recorded in a trace
+ */
+struct DeviceTraceEvent {
+    enum class Type : quint8 {
+        Snapshot = 1,          ///< devicesReady(devices)
+        DevicesChanged = 2,    ///< devicesChanged()
+        PropertiesChanged = 3, ///< devicePropertiesChanged(dbusPath, properties)
+    };
+
+    qint64 timeUs = 0;              ///< Since the start of the recording
+    Type type = Type::DevicesChanged;
+    QList<HeadsetDevice> devices;   ///< Snapshot only
+    QString dbusPath;               ///< PropertiesChanged only
+    QVariantMap properties;         ///< PropertiesChanged only
+};
+
+/**
+ * @class DeviceTraceWriter
+ * @brief Appends DeviceTraceEvents to a compact binary trace file
+ *
+ * The file starts with the 8 byte header "HSTRACE" plus a version byte.
+ * Every record is the time since the previous record in microseconds as a
+ * varint, a type byte and the payload. Strings (paths, models, property
+ * names) are written once and then referenced by their index, so a long
+ * trace of battery changes costs a few bytes per event. Battery levels are
+ * stored in hundredths of a percent. Each record is flushed as it is
+ * written, so a crash loses at most the record being written.
+ */
+class DeviceTraceWriter {
+public:
+    static constexpr char kMagic[] = "HSTRACE";
+    static constexpr quint8 kVersion = 1;
+
+    /**
+     * @brief Creates or truncates the trace file and writes the header
+     * @param error Receives a description on failure (may be null)
+     */
+    bool open(const QString& path, QString *error = nullptr);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    /**
+     * @brief Appends one event; timestamps must not decrease
+     *
+     * A failed write closes the writer: the strings and the time base the
+     * record introduced would be missing from the file, so nothing written
+     * after it could be read back.
+     *
+     * @return False if writing failed or the writer is not open
+     */
+    bool write(const DeviceTraceEvent& event);
+
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+    /**
+     * @brief Encodes a complete trace in memory, for files replaced as a whole
+     */
+    static QByteArray encode(const QList<DeviceTraceEvent>& events);
+
+private:
+    static QByteArray fileHeader();
+    void encodeRecord(const DeviceTraceEvent& event);
+    void appendVarint(quint64 value);
+    void appendString(const QString& value);
+    void appendValue(const QVariant& value);
+
+    QFile m_file;
+    QByteArray m_record;
+    QHash<QString, quint32> m_strings;
+    qint64 m_lastTimeUs = 0;
+    qint64 m_bytesWritten = 0;
+};
+
+/**
+ * @brief Reads every event of a trace written by DeviceTraceWriter
+ *
+ * A record cut short at the end of the file, as left by a crash, is
+ * dropped; everything before it is returned.
+ *
+ * @param error Receives a description if the file is not a valid trace (may be null)
+ * @return False if the file cannot be read or is malformed
+ */
+bool readDeviceTrace(const QString& path, QList<DeviceTraceEvent> *events, QString *error = nullptr);
@@ -1,21 +1,54 @@
 #pragma once
 #include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief How a headset is attached
+ */
+enum class ConnectionType : quint8 {
+    Bluetooth,
+    USB,
+    Unknown,  ///< Neither could be told from the device
+};
+
+/**
+ * @brief Display name of a connection type ("USB", "Bluetooth" or "Unknown")
+ */
+inline QString connectionTypeName(ConnectionType type) {
+    switch (type) {
+    case ConnectionType::USB:
+        return QStringLiteral("USB");
+    case ConnectionType::Unknown:
+        return QStringLiteral("Unknown");
+    case ConnectionType::Bluetooth:
+        break;
+    }
+    return QStringLiteral("Bluetooth");
+}
+
+/**
+ * @brief UPower Device.State value for a charging battery
+ */
+constexpr uint kUPowerStateCharging = 1;
 
 /**
  * @struct HeadsetDevice
  * @brief Represents a single headset device with its properties
  *
  * This structure holds all relevant information about a connected headset,
- * including battery status, connection type, and system paths.
+ * including battery status, connection type, and system paths. Model names
+ * are interned by HeadsetManager, so devices of the same model share one
+ * string buffer; the scalar fields are packed behind the strings.
  */
 struct HeadsetDevice {
     QString model;           ///< Device model name
-    QString connectionType;  ///< Connection type: "USB" or "Bluetooth"
+    QString nativePath;      ///< System native path (e.g., /sys/...)
+    QString dbusPath;        ///< D-Bus object path for this device
     double battery = 0.0;    ///< Battery percentage (0-100)
+    ConnectionType connectionType = ConnectionType::Bluetooth; ///< USB, Bluetooth or unknown
     bool isCharging = false; ///< True if device is currently charging
     bool isPresent = false;  ///< True if device is physically present
-    QString nativePath;      ///< System native path (e.g., /sys/...)
-    QString dbusPath;        ///< D-Bus object path for this device
+    qint32 secondsRemaining = -1; ///< Estimated time to empty, or to full while charging; -1 if unknown
 
     /**
      * @brief Equality operator for device comparison
@@ -23,4 +56,4 @@ struct HeadsetDevice {
     bool operator==(const HeadsetDevice& other) const {
         return dbusPath == other.dbusPath;
     }
-}; 
\ No newline at end of file
+};
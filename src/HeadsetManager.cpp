@@ -1,97 +1,456 @@
 #include "HeadsetManager.h"
-#include <QDBusInterface>
+#include "BluezBackend.h"
+#include "DBusListener.h"
+#include "DBusSubscriptionManager.h"
+#include "KeywordMatcher.h"
+#include "PowerSupplyBackend.h"
+#include "RuntimeStats.h"
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDBusReply>
+#include <QElapsedTimer>
+#include <QSet>
 #include <QVariant>
 
-// Known headset vendor and model keywords for better detection
-const QSet<QString> HeadsetManager::s_headsetKeywords = {
-    "headset", "headphone", "earphone", "earbud",
-    "jabra", "bose", "sony", "sennheiser", "jbl", "beats",
-    "hyperx", "steelseries", "razer", "logitech", "corsair",
-    "plantronics", "poly", "audio-technica", "beyerdynamic",
-    "akg", "skullcandy", "anker", "soundcore", "airpods",
-    "galaxy buds", "pixel buds", "surface headphones",
-    "wh-", "wf-", "qc", "quietcomfort", "evolve"
-};
+namespace {
+const QString kUPowerService = QStringLiteral("org.freedesktop.UPower");
+const QString kUPowerPath = QStringLiteral("/org/freedesktop/UPower");
+const QString kUPowerInterface = QStringLiteral("org.freedesktop.UPower");
+const QString kDeviceInterface = QStringLiteral("org.freedesktop.UPower.Device");
+const QString kPropertiesInterface = QStringLiteral("org.freedesktop.DBus.Properties");
+const QString kUPowerDevicePrefix = QStringLiteral("/org/freedesktop/UPower/devices/");
 
-HeadsetManager::HeadsetManager(QObject *parent) : QObject(parent) {}
+QDBusMessage enumerateMessage() {
+    return QDBusMessage::createMethodCall(
+        kUPowerService, kUPowerPath, kUPowerInterface, QStringLiteral("EnumerateDevices"));
+}
+
+QDBusMessage getAllMessage(const QString& path) {
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        kUPowerService, path, kPropertiesInterface, QStringLiteral("GetAll"));
+    message << kDeviceInterface;
+    return message;
+}
+}
+
+const QStringList& HeadsetManager::headsetKeywords() {
+    // Known headset vendor and model keywords for better detection
+    static const QStringList keywords = {
+        "headset", "headphone", "earphone", "earbud",
+        "jabra", "bose", "sony", "sennheiser", "jbl", "beats",
+        "hyperx", "steelseries", "razer", "logitech", "corsair",
+        "plantronics", "poly", "audio-technica", "beyerdynamic",
+        "akg", "skullcandy", "anker", "soundcore", "airpods",
+        "galaxy buds", "pixel buds", "surface headphones",
+        "wh-", "wf-", "qc", "quietcomfort", "evolve"
+    };
+    return keywords;
+}
+
+HeadsetManager::HeadsetManager(QObject *parent, const QString& overridesFilePath)
+    : DeviceSource(parent)
+    , m_bus(QDBusConnection::systemBus())
+    , m_classifier([this](const QString& model, const QString& path) {
+                       return isHeadsetDevice(model, path);
+                   },
+                   overridesFilePath)
+{
+}
+
+void HeadsetManager::setBus(const QDBusConnection& bus) {
+    m_bus = bus;
+}
+
+void HeadsetManager::forgetDevice(const QString& dbusPath) {
+    m_classifier.forgetPath(dbusPath);
+    if (m_unclassifiedPaths.remove(dbusPath)) {
+        updateSubscriptions();
+    }
+}
+
+void HeadsetManager::watchSignals() {
+    if (m_listener) {
+        return;
+    }
+    m_listener = new DBusListener(this);
+
+    // Property changes are subscribed per tracked headset path, so the bus
+    // daemon drops changes from batteries, mice and the DisplayDevice
+    m_subscriptions = new DBusSubscriptionManager(
+        m_bus, m_listener,
+        SLOT(propertiesChanged(QString,QVariantMap,QStringList,QDBusMessage)),
+        this);
+
+    bool addedConnected = m_bus.connect(
+        kUPowerService, kUPowerPath, kUPowerInterface, "DeviceAdded",
+        m_listener, SLOT(deviceAdded(QDBusObjectPath))
+    );
+
+    if (!addedConnected) {
+        qWarning() << "Failed to connect to UPower DeviceAdded signal";
+    }
+
+    bool removedConnected = m_bus.connect(
+        kUPowerService, kUPowerPath, kUPowerInterface, "DeviceRemoved",
+        m_listener, SLOT(deviceRemoved(QDBusObjectPath))
+    );
+
+    if (!removedConnected) {
+        qWarning() << "Failed to connect to UPower DeviceRemoved signal";
+    }
+
+    connect(m_listener, &DBusListener::statusRelevantEvent, this, &HeadsetManager::devicesChanged);
+    connect(m_listener, &DBusListener::devicePropertiesChanged, this, &HeadsetManager::devicePropertiesChanged);
+    connect(m_listener, &DBusListener::devicePathRemoved, m_subscriptions, &DBusSubscriptionManager::untrack);
+    connect(m_listener, &DBusListener::devicePathRemoved, this, &HeadsetManager::forgetDevice);
+    connect(m_listener, &DBusListener::deviceModelChanged, this, &HeadsetManager::onDeviceModelChanged);
+}
+
+void HeadsetManager::setTrackedDevices(const QList<HeadsetDevice>& devices) {
+    m_trackedPaths.clear();
+    m_trackedPaths.reserve(devices.size());
+    for (const HeadsetDevice& device : devices) {
+        if (isUPowerPath(device.dbusPath)) {
+            m_trackedPaths.append(device.dbusPath);
+        }
+    }
+    updateSubscriptions();
+}
+
+void HeadsetManager::updateSubscriptions() {
+    if (!m_subscriptions) {
+        return;
+    }
+
+    // Bluetooth headsets can appear before their model is known; their
+    // Model change is what makes them headsets
+    QStringList paths = m_trackedPaths;
+    for (const QString& path : std::as_const(m_unclassifiedPaths)) {
+        if (!paths.contains(path)) {
+            paths.append(path);
+        }
+    }
+    m_subscriptions->setTrackedPaths(paths);
+}
+
+void HeadsetManager::onDeviceModelChanged(const QString& dbusPath) {
+    if (m_unclassifiedPaths.contains(dbusPath)) {
+        emit devicesChanged();
+    }
+}
+
+void HeadsetManager::ignoreDevice(const HeadsetDevice& device) {
+    m_classifier.setOverride(device.nativePath, device.model, DeviceClassifier::Override::NeverHeadset);
+    rescanBackends();
+}
+
+void HeadsetManager::pinDevice(const HeadsetDevice& device) {
+    m_classifier.setOverride(device.nativePath, device.model, DeviceClassifier::Override::AlwaysHeadset);
+    rescanBackends();
+}
+
+void HeadsetManager::resetDevice(const HeadsetDevice& device) {
+    m_classifier.setOverride(device.nativePath, device.model, DeviceClassifier::Override::None);
+    rescanBackends();
+}
+
+PowerSupplyBackend* HeadsetManager::enablePowerSupply(const QString& root) {
+    if (!m_powerSupply) {
+        m_powerSupply = new PowerSupplyBackend(
+            [this](const QString& objectPath, const QString& nativePath, const QString& model) {
+                return m_classifier.isHeadset(objectPath, nativePath, model);
+            },
+            root, this);
+        m_powerSupply->start();
+        connect(m_powerSupply, &PowerSupplyBackend::devicesChanged, this, &HeadsetManager::devicesChanged);
+        connect(m_powerSupply, &PowerSupplyBackend::devicePropertiesChanged,
+                this, &HeadsetManager::devicePropertiesChanged);
+    }
+    return m_powerSupply;
+}
+
+BluezBackend* HeadsetManager::enableBluez(const QDBusConnection& bus) {
+    if (!m_bluez) {
+        m_bluez = new BluezBackend(
+            [this](const QString& objectPath, const QString& nativePath, const QString& model, bool headsetClass) {
+                switch (m_classifier.overrideFor(nativePath, model)) {
+                case DeviceClassifier::Override::AlwaysHeadset:
+                    return true;
+                case DeviceClassifier::Override::NeverHeadset:
+                    return false;
+                case DeviceClassifier::Override::None:
+                    break;
+                }
+                return headsetClass;
+            },
+            bus, this);
+        connect(m_bluez, &BluezBackend::devicesChanged, this, &HeadsetManager::devicesChanged);
+        connect(m_bluez, &BluezBackend::devicePropertiesChanged, this, &HeadsetManager::devicePropertiesChanged);
+        m_bluez->start();
+    }
+    return m_bluez;
+}
+
+void HeadsetManager::rescanBackends() {
+    if (m_powerSupply) {
+        m_powerSupply->rescan();
+    }
+    if (m_bluez) {
+        m_bluez->rescan();
+    }
+}
+
+bool HeadsetManager::isUPowerPath(const QString& dbusPath) {
+    return dbusPath.startsWith(kUPowerDevicePrefix);
+}
+
+const HeadsetDevice* HeadsetManager::directDevice(const QString& nativePath) const {
+    // UPower uses the BlueZ object path as NativePath of Bluetooth devices
+    if (m_bluez) {
+        if (const HeadsetDevice *device = m_bluez->deviceAt(nativePath)) {
+            return device;
+        }
+    }
+    if (m_powerSupply) {
+        return m_powerSupply->deviceNamed(PowerSupplyBackend::entryNameOf(nativePath));
+    }
+    return nullptr;
+}
+
+QList<HeadsetDevice> HeadsetManager::mergeBackends(const QList<HeadsetDevice>& upowerDevices) {
+    if (!m_powerSupply && !m_bluez) {
+        return upowerDevices;
+    }
+
+    // A headset UPower mirrors from sysfs or BlueZ keeps its place in the
+    // list but is reported by the direct backend, which sees changes first
+    QList<HeadsetDevice> devices;
+    QSet<QString> merged;
+    devices.reserve(upowerDevices.size());
+    for (const HeadsetDevice& device : upowerDevices) {
+        if (const HeadsetDevice *direct = directDevice(device.nativePath)) {
+            devices.append(*direct);
+            devices.last().model = m_modelNames.intern(direct->model);
+            merged.insert(direct->dbusPath);
+        } else {
+            devices.append(device);
+        }
+    }
+
+    const auto appendUnmerged = [&](const QList<HeadsetDevice>& backendDevices) {
+        for (const HeadsetDevice& device : backendDevices) {
+            if (!merged.contains(device.dbusPath)) {
+                devices.append(device);
+                devices.last().model = m_modelNames.intern(device.model);
+            }
+        }
+    };
+    if (m_powerSupply) {
+        appendUnmerged(m_powerSupply->devices());
+    }
+    if (m_bluez) {
+        appendUnmerged(m_bluez->devices());
+    }
+    return devices;
+}
 
 bool HeadsetManager::isHeadsetDevice(const QString& model, const QString& path) const {
-    QString modelLower = model.toLower();
-    QString pathLower = path.toLower();
+    // Compiled once; matching is case-insensitive and allocation-free
+    static const KeywordMatcher matcher(headsetKeywords());
 
     // Check if model or path contains any headset keywords
-    for (const QString& keyword : s_headsetKeywords) {
-        if (modelLower.contains(keyword) || pathLower.contains(keyword)) {
-            return true;
-        }
+    return matcher.matches(model) || matcher.matches(path);
+}
+
+bool HeadsetManager::deviceFromProperties(const QString& path, const QVariantMap& properties,
+                                          HeadsetDevice *device) {
+    const QVariant modelVar = properties.value(QStringLiteral("Model"));
+    if (!modelVar.isValid()) {
+        return false;
+    }
+
+    const QString model = modelVar.toString();
+    const QString nativePath = properties.value(QStringLiteral("NativePath")).toString();
+    if (model.isEmpty() && isUPowerPath(path)) {
+        m_unclassifiedPaths.insert(path);
+    } else {
+        m_unclassifiedPaths.remove(path);
+    }
+    if (!m_classifier.isHeadset(path, nativePath, model)) {
+        return false;
     }
 
-    return false;
+    // Devices of the same model share one string
+    device->model = m_modelNames.intern(model);
+
+    // Determine connection type (USB or Bluetooth)
+    device->connectionType = nativePath.contains("usb", Qt::CaseInsensitive)
+        ? ConnectionType::USB : ConnectionType::Bluetooth;
+
+    // Get battery information. UPower reports charging through State; keep
+    // honouring IsCharging for backends that expose it directly.
+    device->battery = properties.value(QStringLiteral("Percentage")).toDouble();
+    const auto isCharging = properties.constFind(QStringLiteral("IsCharging"));
+    device->isCharging = isCharging != properties.constEnd()
+        ? isCharging->toBool()
+        : properties.value(QStringLiteral("State")).toUInt() == kUPowerStateCharging;
+    device->isPresent = properties.value(QStringLiteral("IsPresent")).toBool();
+
+    // Store paths for future reference
+    device->nativePath = nativePath;
+    device->dbusPath = path;
+
+    return true;
 }
 
 QList<HeadsetDevice> HeadsetManager::getDevices() {
     QList<HeadsetDevice> devices;
 
-    // Connect to UPower service
-    QDBusInterface upower("org.freedesktop.UPower",
-                          "/org/freedesktop/UPower",
-                          "org.freedesktop.UPower",
-                          QDBusConnection::systemBus());
-
-    if (!upower.isValid()) {
+    if (!m_bus.isConnected()) {
         qWarning() << "Failed to connect to UPower service";
-        return devices;
+        return mergeBackends(devices);
     }
 
-    // Enumerate all power devices
-    QDBusReply<QList<QDBusObjectPath>> reply = upower.call("EnumerateDevices");
+    QElapsedTimer timer;
+    timer.start();
+    int calls = 1;
+
+    // Enumerate all power devices. A plain method call avoids the extra
+    // Introspect round trip a QDBusInterface would make.
+    QDBusReply<QList<QDBusObjectPath>> reply = m_bus.call(enumerateMessage());
     if (!reply.isValid()) {
         qWarning() << "Failed to enumerate UPower devices:" << reply.error().message();
-        return devices;
+        return mergeBackends(devices);
     }
 
-    // Check each device to see if it's a headset
+    // Fetch each device's properties in a single round trip
     for (const QDBusObjectPath &path : reply.value()) {
-        QDBusInterface deviceIf("org.freedesktop.UPower",
-                                path.path(),
-                                "org.freedesktop.UPower.Device",
-                                QDBusConnection::systemBus());
+        if (m_classifier.isKnownNonHeadset(path.path())) {
+            continue;
+        }
 
-        if (!deviceIf.isValid()) {
+        QDBusReply<QVariantMap> properties = m_bus.call(getAllMessage(path.path()));
+        ++calls;
+        if (!properties.isValid()) {
             continue;
         }
 
-        // Get device model
-        QVariant modelVar = deviceIf.property("Model");
-        if (!modelVar.isValid()) {
+        HeadsetDevice dev;
+        if (deviceFromProperties(path.path(), properties.value(), &dev)) {
+            devices.append(dev);
+        }
+    }
+
+    RuntimeStats& stats = RuntimeStats::global();
+    stats.enumerations.add();
+    stats.dbusCalls.add(calls);
+    stats.dbusCallsPerEnumeration.record(calls);
+    stats.enumerationUs.recordElapsed(timer);
+    updateSubscriptions();
+    return mergeBackends(devices);
+}
+
+void HeadsetManager::requestDevices() {
+    if (m_refresh.active) {
+        m_refresh.queued = true;
+        return;
+    }
+
+    m_refresh.active = true;
+    m_refresh.queued = false;
+    ++m_refresh.generation;
+    m_refresh.dbusCalls = 1;
+    m_refresh.timer.start();
+
+    auto *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(enumerateMessage()), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &HeadsetManager::onEnumerateFinished);
+}
+
+void HeadsetManager::onEnumerateFinished(QDBusPendingCallWatcher *watcher) {
+    watcher->deleteLater();
+
+    QDBusPendingReply<QList<QDBusObjectPath>> reply = *watcher;
+    if (reply.isError()) {
+        qWarning() << "Failed to enumerate UPower devices:" << reply.error().message();
+        m_refresh.devices.clear();
+        m_refresh.isHeadset.clear();
+        finishRefresh();
+        return;
+    }
+
+    const QList<QDBusObjectPath> paths = reply.value();
+    m_refresh.devices = QList<HeadsetDevice>(paths.size());
+    m_refresh.isHeadset = QList<bool>(paths.size(), false);
+    m_refresh.outstanding = 0;
+
+    // Put every GetAll on the wire before waiting for any reply. Devices
+    // already classified as non-headsets are not queried at all.
+    const quint64 generation = m_refresh.generation;
+    for (int i = 0; i < paths.size(); ++i) {
+        if (m_classifier.isKnownNonHeadset(paths.at(i).path())) {
             continue;
         }
 
-        QString model = modelVar.toString();
+        m_refresh.devices[i].dbusPath = paths.at(i).path();
+        ++m_refresh.outstanding;
+        ++m_refresh.dbusCalls;
 
-        // Check if this device is a headset
-        if (isHeadsetDevice(model, path.path())) {
-            HeadsetDevice dev;
-            dev.model = model;
+        auto *deviceWatcher = new QDBusPendingCallWatcher(
+            m_bus.asyncCall(getAllMessage(paths.at(i).path())), this);
+        connect(deviceWatcher, &QDBusPendingCallWatcher::finished, this,
+                [this, generation, i](QDBusPendingCallWatcher *w) {
+                    onDevicePropertiesFinished(w, generation, i);
+                });
+    }
 
-            // Determine connection type (USB or Bluetooth)
-            QString nativePath = deviceIf.property("NativePath").toString();
-            dev.connectionType = nativePath.contains("usb", Qt::CaseInsensitive) ? "USB" : "Bluetooth";
+    if (m_refresh.outstanding == 0) {
+        finishRefresh();
+    }
+}
 
-            // Get battery information
-            dev.battery = deviceIf.property("Percentage").toDouble();
-            dev.isCharging = deviceIf.property("IsCharging").toBool();
-            dev.isPresent = deviceIf.property("IsPresent").toBool();
+void HeadsetManager::onDevicePropertiesFinished(QDBusPendingCallWatcher *watcher, quint64 generation, int index) {
+    watcher->deleteLater();
 
-            // Store paths for future reference
-            dev.nativePath = nativePath;
-            dev.dbusPath = path.path();
+    if (generation != m_refresh.generation || !m_refresh.active) {
+        return;
+    }
 
-            devices.append(dev);
+    QDBusPendingReply<QVariantMap> reply = *watcher;
+    if (!reply.isError()) {
+        HeadsetDevice& device = m_refresh.devices[index];
+        m_refresh.isHeadset[index] = deviceFromProperties(device.dbusPath, reply.value(), &device);
+    }
+
+    if (--m_refresh.outstanding == 0) {
+        finishRefresh();
+    }
+}
 
+void HeadsetManager::finishRefresh() {
+    QList<HeadsetDevice> devices;
+    devices.reserve(m_refresh.devices.size());
+    for (int i = 0; i < m_refresh.devices.size(); ++i) {
+        if (m_refresh.isHeadset.at(i)) {
+            devices.append(m_refresh.devices.at(i));
         }
     }
 
-    return devices;
-} 
+    m_refresh.devices.clear();
+    m_refresh.isHeadset.clear();
+    m_refresh.active = false;
+
+    RuntimeStats& stats = RuntimeStats::global();
+    stats.enumerations.add();
+    stats.dbusCalls.add(m_refresh.dbusCalls);
+    stats.dbusCallsPerEnumeration.record(m_refresh.dbusCalls);
+    stats.enumerationUs.recordElapsed(m_refresh.timer);
+    updateSubscriptions();
+
+    emit devicesReady(mergeBackends(devices));
+
+    if (m_refresh.queued) {
+        requestDevices();
+    }
+}
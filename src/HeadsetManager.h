@@ -1,27 +1,97 @@
 #pragma once
-#include <QObject>
+#include <QDBusConnection>
+#include <QElapsedTimer>
 #include <QList>
 #include <QSet>
+#include <QStringList>
+#include <QVariantMap>
+#include "DeviceClassifier.h"
+#include "DeviceSource.h"
 #include "HeadsetDevice.h"
+#include "StringPool.h"
+
+class BluezBackend;
+class DBusListener;
+class DBusSubscriptionManager;
+class PowerSupplyBackend;
+class QDBusPendingCallWatcher;
 
 /**
  * @class HeadsetManager
  * @brief Manages detection and tracking of headset devices via UPower
  *
  * This class queries UPower over D-Bus to discover and monitor connected
- * headset devices, supporting both Bluetooth and USB connections.
+ * headset devices, supporting both Bluetooth and USB connections. With
+ * enablePowerSupply() and enableBluez(), headsets read directly from sysfs
+ * or BlueZ are merged into every enumeration result and take precedence
+ * over their UPower mirror. This is the DeviceSource the application uses
+ * outside of trace replays.
  */
-class HeadsetManager : public QObject {
+class HeadsetManager : public DeviceSource {
     Q_OBJECT
 public:
-    explicit HeadsetManager(QObject *parent = nullptr);
+    /**
+     * @param parent Parent object
+     * @param overridesFilePath Classification overrides file; defaults to
+     *        ~/.config/headsetstatus/devices.ini
+     */
+    explicit HeadsetManager(QObject *parent = nullptr, const QString& overridesFilePath = QString());
 
     /**
      * @brief Retrieves all currently connected headset devices
+     *
+     * Blocks until every device has answered. Prefer requestDevices() on
+     * the GUI thread.
+     *
      * @return List of HeadsetDevice objects representing connected headsets
      */
     QList<HeadsetDevice> getDevices();
 
+    /**
+     * @brief Starts an asynchronous enumeration of connected headsets
+     *
+     * Sends one Properties.GetAll per UPower device with all calls in flight
+     * at once. The result is delivered through devicesReady(). A request made
+     * while another is running is queued and started once it finishes.
+     */
+    void requestDevices() override;
+
+    /**
+     * @brief Returns true while an asynchronous enumeration is running
+     */
+    bool isRefreshPending() const override { return m_refresh.active; }
+
+    /**
+     * @brief Subscribes to DeviceAdded, DeviceRemoved and per-device
+     *        PropertiesChanged of UPower on bus()
+     *
+     * Added and removed devices are reported as devicesChanged(), property
+     * changes of tracked devices as devicePropertiesChanged().
+     */
+    void watchSignals();
+
+    /**
+     * @brief Keeps one PropertiesChanged subscription per shown UPower device
+     *
+     * Devices from other backends are not subscribed to on the UPower bus.
+     */
+    void setTrackedDevices(const QList<HeadsetDevice>& devices) override;
+
+    /**
+     * @brief Stores a "never a headset" override and re-reads the direct backends
+     */
+    void ignoreDevice(const HeadsetDevice& device) override;
+
+    /**
+     * @brief Stores an "always a headset" override and re-reads the direct backends
+     */
+    void pinDevice(const HeadsetDevice& device) override;
+
+    /**
+     * @brief Removes the device's override and re-reads the direct backends
+     */
+    void resetDevice(const HeadsetDevice& device) override;
+
     /**
      * @brief Checks if a device model name matches known headset patterns
      * @param model Device model string from UPower
@@ -30,13 +100,107 @@ public:
      */
     bool isHeadsetDevice(const QString& model, const QString& path) const;
 
-signals:
     /**
-     * @brief Emitted when the list of connected devices changes
+     * @brief Known headset vendor and model keywords (lowercase)
      */
-    void devicesChanged();
+    static const QStringList& headsetKeywords();
+
+    /**
+     * @brief Sets the bus UPower is queried on (the system bus by default)
+     * @param bus Connection to use for all further calls
+     */
+    void setBus(const QDBusConnection& bus);
+    QDBusConnection bus() const { return m_bus; }
+
+    /**
+     * @brief Per-device classification cache and user overrides
+     */
+    DeviceClassifier& classifier() { return m_classifier; }
+
+    /**
+     * @brief Adds headsets from the power_supply class to every enumeration
+     * @param root sysfs power_supply directory; tests pass a fake tree
+     * @return The backend, owned by the manager
+     */
+    PowerSupplyBackend* enablePowerSupply(const QString& root);
+    PowerSupplyBackend* powerSupply() const { return m_powerSupply; }
+
+    /**
+     * @brief Adds headsets with a BlueZ Battery1 interface to every enumeration
+     *
+     * Device overrides still apply; otherwise the BlueZ device type decides.
+     *
+     * @param bus Connection bluetoothd is reached on
+     * @return The backend, owned by the manager
+     */
+    BluezBackend* enableBluez(const QDBusConnection& bus);
+    BluezBackend* bluez() const { return m_bluez; }
+
+    /**
+     * @brief Re-classifies the devices of the direct backends, e.g. after an
+     *        override changed
+     */
+    void rescanBackends();
+
+    /**
+     * @brief Returns true for object paths of UPower devices
+     *
+     * Devices from other backends are not subscribed to on the UPower bus.
+     */
+    static bool isUPowerPath(const QString& dbusPath);
+
+public slots:
+    /**
+     * @brief Forgets cached decisions for an object path UPower removed
+     * @param dbusPath D-Bus object path of the removed device
+     */
+    void forgetDevice(const QString& dbusPath);
+
+private slots:
+    void onEnumerateFinished(QDBusPendingCallWatcher *watcher);
 
 private:
-    // Known headset vendor keywords for improved detection
-    static const QSet<QString> s_headsetKeywords;
-}; 
\ No newline at end of file
+    /**
+     * @brief Builds a device from a UPower Device GetAll reply
+     * @param path Device D-Bus path
+     * @param properties Properties returned by GetAll
+     * @param device Output device, filled only if it is a headset
+     * @return True if the properties describe a headset
+     */
+    bool deviceFromProperties(const QString& path, const QVariantMap& properties,
+                              HeadsetDevice *device);
+
+    /**
+     * @brief Subscribes to the tracked headsets and to devices without a model yet
+     */
+    void updateSubscriptions();
+    void onDeviceModelChanged(const QString& dbusPath);
+
+    void onDevicePropertiesFinished(QDBusPendingCallWatcher *watcher, quint64 generation, int index);
+    void finishRefresh();
+    QList<HeadsetDevice> mergeBackends(const QList<HeadsetDevice>& upowerDevices);
+    const HeadsetDevice* directDevice(const QString& nativePath) const;
+
+    // State of the asynchronous enumeration currently in flight
+    struct PendingRefresh {
+        bool active = false;
+        bool queued = false;
+        quint64 generation = 0;
+        int outstanding = 0;
+        int dbusCalls = 0;
+        QElapsedTimer timer;
+        QList<HeadsetDevice> devices;
+        QList<bool> isHeadset;
+    };
+
+    QDBusConnection m_bus;
+    PendingRefresh m_refresh;
+    DeviceClassifier m_classifier;
+    StringPool m_modelNames;
+    PowerSupplyBackend *m_powerSupply = nullptr;
+    BluezBackend *m_bluez = nullptr;
+    DBusListener *m_listener = nullptr;
+    DBusSubscriptionManager *m_subscriptions = nullptr;
+    QStringList m_trackedPaths;
+    QSet<QString> m_unclassifiedPaths;  ///< UPower devices that had no model to judge yet
+};
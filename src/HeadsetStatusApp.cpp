@@ -0,0 +1,485 @@
+#include "HeadsetStatusApp.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMessageBox>
+#include "version.h"
+#include "ConfigManager.h"
+#include "HeadsetManager.h"
+#include "HeadsetStatusService.h"
+#include "NotificationManager.h"
+#include "PollScheduler.h"
+#include "PowerSupplyBackend.h"
+#include "RuntimeStats.h"
+#include "SettingsDialog.h"
+#include "StatusSocketServer.h"
+#include "ThreadedDeviceSource.h"
+#include "TrayIconController.h"
+
+namespace {
+// Fields worth a battery history and estimator sample; model and connection
+// type only change what is displayed, not the charge curve
+constexpr DeviceFields kHistoryFields = DeviceFields(DeviceField::Battery) | DeviceField::Charging
+    | DeviceField::Presence | DeviceField::Added;
+
+// Connection name of the device worker's system bus connection
+const QString kDeviceBusName = QStringLiteral("headsetstatus-devices");
+
+// Battery changes arrive in bursts; the last state is written once they settle
+constexpr int kLastStateSaveDelayMs = 2000;
+}
+
+HeadsetStatusApp::HeadsetStatusApp(Mode mode, bool debug, const QDBusConnection& upowerBus,
+                                   const QDBusConnection& serviceBus)
+    : m_mode(mode)
+    , m_debug(debug)
+{
+    // Initialize managers
+    configManager = new ConfigManager(this);
+    const bool sysfsEnabled = configManager->sysfsBackendEnabled();
+    const bool bluezEnabled = configManager->bluezBackendEnabled();
+
+    // Devices are read on a worker with a system bus connection of its own,
+    // so a slow UPower, bluetoothd or sysfs read never stalls the tray.
+    // Tests hand in a private bus, which is shared instead.
+    const bool ownConnection = upowerBus.name() == QDBusConnection::systemBus().name();
+    m_source = new ThreadedDeviceSource([upowerBus, ownConnection, sysfsEnabled, bluezEnabled]() {
+        const QDBusConnection bus = ownConnection
+            ? QDBusConnection::connectToBus(QDBusConnection::SystemBus, kDeviceBusName)
+            : upowerBus;
+
+        auto *headsetManager = new HeadsetManager();
+        headsetManager->setBus(bus);
+        if (sysfsEnabled) {
+            headsetManager->enablePowerSupply(PowerSupplyBackend::kDefaultRoot);
+        }
+        if (bluezEnabled) {
+            headsetManager->enableBluez(bus);
+        }
+        headsetManager->watchSignals();
+        return headsetManager;
+    }, this);
+
+    initialize(serviceBus);
+}
+
+HeadsetStatusApp::HeadsetStatusApp(DeviceSource *source, Mode mode, bool debug,
+                                   const QDBusConnection& serviceBus)
+    : m_mode(mode)
+    , m_debug(debug)
+    , m_source(source)
+{
+    configManager = new ConfigManager(this);
+    m_source->setParent(this);
+
+    initialize(serviceBus);
+}
+
+void HeadsetStatusApp::initialize(const QDBusConnection& serviceBus) {
+    notificationManager = new NotificationManager(this);
+
+    // Apply config to notification manager; a watcher leaves them to the main instance
+    notificationManager->setNotificationsEnabled(configManager->notificationsEnabled() && m_mode != Mode::Watch);
+    notificationManager->setLowBatteryThreshold(configManager->lowBatteryThreshold());
+
+    // Only create tray controller in GUI mode
+    if (m_mode == Mode::Tray) {
+        trayController = new TrayIconController(this);
+        trayController->setLowBatteryThreshold(configManager->lowBatteryThreshold());
+        if (configManager->prewarmTrayIcons()) {
+            trayController->prewarmIcons();
+        }
+
+        // Remembered state until UPower answers, clearly marked as such
+        QList<HeadsetDevice> lastDevices;
+        qint64 savedAtMs = 0;
+        if (m_lastState.load(&lastDevices, &savedAtMs)) {
+            trayController->showLastKnown(lastDevices, savedAtMs);
+        }
+
+        // Connect tray signals
+        connect(trayController, &TrayIconController::informationRequested, this, &HeadsetStatusApp::showInformation);
+        connect(trayController, &TrayIconController::settingsRequested, this, &HeadsetStatusApp::showSettings);
+        connect(trayController, &TrayIconController::aboutRequested, this, &HeadsetStatusApp::showAbout);
+        connect(trayController, &TrayIconController::deviceDetailsRequested, this, &HeadsetStatusApp::showDeviceDetails);
+        connect(trayController, &TrayIconController::deviceIgnoreRequested, this, &HeadsetStatusApp::ignoreDevice);
+        connect(trayController, &TrayIconController::deviceResetRequested, this, &HeadsetStatusApp::resetDevice);
+    }
+
+    m_updateDebounceTimer = new QTimer(this);
+    m_updateDebounceTimer->setSingleShot(true);
+    m_updateDebounceTimer->setInterval(120);
+    connect(m_updateDebounceTimer, &QTimer::timeout, this, &HeadsetStatusApp::updateStatus);
+    connect(m_source, &DeviceSource::devicesReady, this, &HeadsetStatusApp::applyDevices);
+
+    // Fallback enumeration for changes the signals miss; its interval adapts
+    m_pollScheduler = new PollScheduler(this);
+    m_pollScheduler->setLowBatteryThreshold(configManager->lowBatteryThreshold());
+    connect(m_pollScheduler, &PollScheduler::pollDue, this, &HeadsetStatusApp::scheduleStatusUpdate);
+    if (m_debug) {
+        connect(m_pollScheduler, &PollScheduler::intervalChanged, this,
+                [](int intervalMs, PollScheduler::Reason reason) {
+            qDebug() << "Fallback poll every" << intervalMs / 1000 << "s:" << PollScheduler::reasonName(reason);
+        });
+    }
+    m_pollScheduler->setMaximumInterval(configManager->updateInterval());
+
+    // Connect signals
+    connect(m_source, &DeviceSource::devicesChanged, m_pollScheduler, &PollScheduler::noteSignal);
+    connect(m_source, &DeviceSource::devicePropertiesChanged, m_pollScheduler, &PollScheduler::noteSignal);
+    connect(m_source, &DeviceSource::devicesChanged, this, &HeadsetStatusApp::scheduleStatusUpdate);
+    connect(m_source, &DeviceSource::devicePropertiesChanged, this, &HeadsetStatusApp::applyDeviceChange);
+    connect(configManager, &ConfigManager::configChanged, this, &HeadsetStatusApp::onConfigChanged);
+
+    // Status bars and agents read the cache instead of polling UPower themselves
+    if (m_mode != Mode::Watch) {
+        m_service = new HeadsetStatusService(m_knownDevices, this);
+        if (!m_service->registerOn(serviceBus) && m_debug) {
+            qDebug() << "Headset status service not available on the session bus";
+        }
+
+        m_socketServer = new StatusSocketServer(m_knownDevices, this);
+        if (m_debug) {
+            connect(m_socketServer, &StatusSocketServer::slowClientDropped, this, []() {
+                qDebug() << "Disconnecting status socket client that stopped reading";
+            });
+        }
+        const QString socketPath = StatusSocketServer::defaultPath();
+        QString socketError;
+        if (!socketPath.isEmpty() && !m_socketServer->listen(socketPath, &socketError)) {
+            qWarning() << "Status socket not available:" << socketError;
+        }
+    }
+
+    // The watcher leaves the last state to the main instance, like the history
+    if (m_mode != Mode::Watch) {
+        m_lastStateTimer = new QTimer(this);
+        m_lastStateTimer->setSingleShot(true);
+        m_lastStateTimer->setTimerType(Qt::VeryCoarseTimer);
+        m_lastStateTimer->setInterval(kLastStateSaveDelayMs);
+        connect(m_lastStateTimer, &QTimer::timeout, this, &HeadsetStatusApp::saveLastState);
+        connect(this, &HeadsetStatusApp::devicesUpdated, this, &HeadsetStatusApp::scheduleLastStateSave);
+    }
+
+    if (m_debug) {
+        const char *modeName = m_mode == Mode::Tray ? "GUI" : m_mode == Mode::Headless ? "headless" : "watch";
+        qDebug() << "HeadsetStatus started in" << modeName << "mode";
+    }
+
+    // Initial status update, once the event loop runs; until then the tray
+    // shows the last known state
+    QTimer::singleShot(0, this, &HeadsetStatusApp::updateStatus);
+}
+
+HeadsetStatusApp::~HeadsetStatusApp() {
+    if (m_lastStateTimer && m_lastStateTimer->isActive()) {
+        saveLastState();
+    }
+}
+
+void HeadsetStatusApp::scheduleLastStateSave(const DeviceChangeSet& changes) {
+    // The first update is written even if empty, replacing a stale device list
+    bool changed = changes.orderChanged || !m_lastStateWritten;
+    for (const DeviceChange& change : changes.changes) {
+        changed |= bool(change.fields & kDeviceStateFields);
+    }
+    if (changed && !m_lastStateTimer->isActive()) {
+        m_lastStateTimer->start();
+    }
+}
+
+void HeadsetStatusApp::saveLastState() {
+    m_lastStateTimer->stop();
+    m_lastStateWritten = m_lastState.save(m_knownDevices.devices(), QDateTime::currentMSecsSinceEpoch());
+}
+
+void HeadsetStatusApp::scheduleStatusUpdate() {
+    ++m_statusUpdateRequests;
+    RuntimeStats::global().statusUpdateRequests.add();
+    if (!m_updateDebounceTimer->isActive()) {
+        m_updateDebounceTimer->start();
+    }
+}
+
+void HeadsetStatusApp::updateStatus() {
+    ++m_statusUpdatesRun;
+    RuntimeStats::global().statusUpdatesRun.add();
+
+    // Measured to the end of applyDevices(); a queued request extends the first
+    if (!m_statusUpdateTimer.isValid()) {
+        m_statusUpdateTimer.start();
+    }
+
+    // Results arrive through DeviceSource::devicesReady -> applyDevices()
+    m_source->requestDevices();
+}
+
+void HeadsetStatusApp::applyDevices(const QList<HeadsetDevice>& currentDevices) {
+    if (m_debug) {
+        qDebug() << "Status update: found" << currentDevices.size() << "devices";
+    }
+
+    // Computed once and handed to every consumer
+    DeviceChangeSet changes;
+    const QList<HeadsetDevice> removedDevices = m_knownDevices.replaceAll(currentDevices, &changes);
+
+    if (changes.orderChanged) {
+        m_source->setTrackedDevices(currentDevices);
+    }
+
+    for (const HeadsetDevice& device : removedDevices) {
+        // Check for disconnected devices
+        if (configManager->notifyOnDisconnect()) {
+            notificationManager->notifyDeviceDisconnected(device);
+        }
+
+        m_lowBatteryNotified.remove(device.dbusPath);
+        m_previouslyCharging.remove(device.dbusPath);
+        m_batteryHistory.forget(device.dbusPath);
+        m_estimators.remove(device.dbusPath);
+    }
+
+    // A poll that finds something the signals did not deliver tightens polling
+    if (m_pollScheduler->isPollInFlight()) {
+        bool foundChanges = changes.orderChanged;
+        for (const DeviceChange& change : std::as_const(changes.changes)) {
+            foundChanges |= bool(change.fields & kDeviceStateFields);
+        }
+        m_pollScheduler->pollFinished(foundChanges);
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (DeviceChange& change : changes.changes) {
+        if (change.fields & kHistoryFields) {
+            recordSample(change, now);
+        }
+    }
+
+    // Only devices that were added or changed can cross a notification threshold
+    for (const DeviceChange& change : std::as_const(changes.changes)) {
+        if (change.fields & kDeviceStateFields) {
+            checkDeviceNotifications(*m_knownDevices.find(change.dbusPath));
+        }
+    }
+    // Disconnects and threshold crossings of this update go out as one batch
+    notificationManager->flush();
+
+    m_pollScheduler->updateDevices(m_knownDevices.devices());
+
+    // Update tray icon (GUI mode only)
+    if (trayController) {
+        trayController->updateIcon(m_knownDevices.devices(), changes);
+    }
+
+    if (m_service) {
+        m_service->publish(changes);
+        m_socketServer->publish(changes);
+    }
+    emit devicesUpdated(changes);
+
+    if (m_statusUpdateTimer.isValid()) {
+        RuntimeStats::global().statusUpdateUs.recordElapsed(m_statusUpdateTimer);
+        m_statusUpdateTimer.invalidate();
+    }
+}
+
+void HeadsetStatusApp::applyDeviceChange(const QString& dbusPath, const QVariantMap& changedProperties) {
+    QElapsedTimer timer;
+    timer.start();
+
+    // Devices we are not tracking are picked up by the next full enumeration
+    HeadsetDevice device;
+    DeviceFields fields;
+    if (!m_knownDevices.applyProperties(dbusPath, changedProperties, &device, &fields)) {
+        return;
+    }
+
+    if (m_debug) {
+        qDebug() << "Property change for" << device.model << "battery" << device.battery;
+    }
+
+    DeviceChange change{dbusPath, fields};
+    if (fields & kHistoryFields) {
+        recordSample(change, QDateTime::currentMSecsSinceEpoch());
+    }
+
+    checkDeviceNotifications(*m_knownDevices.find(dbusPath));
+    notificationManager->flush();
+    m_pollScheduler->updateDevices(m_knownDevices.devices());
+
+    DeviceChangeSet changes;
+    changes.changes.append(change);
+    if (trayController) {
+        trayController->updateIcon(m_knownDevices.devices(), changes);
+    }
+    if (m_service) {
+        m_service->publish(changes);
+        m_socketServer->publish(changes);
+    }
+    emit devicesUpdated(changes);
+
+    RuntimeStats::global().propertyChanges.add();
+    RuntimeStats::global().propertyChangeUs.recordElapsed(timer);
+}
+
+void HeadsetStatusApp::recordSample(DeviceChange& change, qint64 timestampMs) {
+    const HeadsetDevice& device = *m_knownDevices.find(change.dbusPath);
+
+    // The history files have a single writer, the main instance
+    if (m_mode != Mode::Watch) {
+        m_batteryHistory.record(device, timestampMs / 1000);
+    }
+
+    BatteryEstimator& estimator = m_estimators[change.dbusPath];
+    estimator.addSample(timestampMs, device.battery, device.isCharging, device.isPresent);
+    if (m_knownDevices.setSecondsRemaining(change.dbusPath, estimator.secondsRemaining())) {
+        change.fields |= DeviceField::Estimate;
+    }
+}
+
+void HeadsetStatusApp::checkDeviceNotifications(const HeadsetDevice& device) {
+    // Check for low battery and send notifications
+    if (configManager->notifyOnLowBattery()) {
+        if (device.isPresent && !device.isCharging &&
+            device.battery <= configManager->lowBatteryThreshold()) {
+            if (!m_lowBatteryNotified.contains(device.dbusPath)) {
+                notificationManager->notifyLowBattery(device);
+                m_lowBatteryNotified.insert(device.dbusPath);
+            }
+        } else {
+            m_lowBatteryNotified.remove(device.dbusPath);
+        }
+    }
+
+    // Check for charging complete
+    if (configManager->notifyOnChargingComplete()) {
+        if (device.battery >= 95 && !device.isCharging) {
+            if (m_previouslyCharging.contains(device.dbusPath)) {
+                notificationManager->notifyChargingComplete(device);
+                m_previouslyCharging.remove(device.dbusPath);
+            }
+        } else if (device.isCharging) {
+            m_previouslyCharging.insert(device.dbusPath);
+        }
+    }
+}
+
+void HeadsetStatusApp::showInformation() {
+    if (trayController) {
+        QMessageBox::information(nullptr, "Headset Information",
+            trayController->trayIcon()->toolTip());
+    }
+}
+
+void HeadsetStatusApp::onConfigChanged() {
+    notificationManager->setNotificationsEnabled(configManager->notificationsEnabled() && m_mode != Mode::Watch);
+    notificationManager->setLowBatteryThreshold(configManager->lowBatteryThreshold());
+    m_pollScheduler->setLowBatteryThreshold(configManager->lowBatteryThreshold());
+    m_pollScheduler->setMaximumInterval(configManager->updateInterval());
+    m_pollScheduler->updateDevices(m_knownDevices.devices());
+
+    // Thresholds may have moved; every device is re-evaluated and re-rendered
+    for (const HeadsetDevice& device : m_knownDevices.devices()) {
+        checkDeviceNotifications(device);
+    }
+    if (trayController) {
+        trayController->setLowBatteryThreshold(configManager->lowBatteryThreshold());
+        trayController->updateIcon(m_knownDevices.devices());
+    }
+}
+
+void HeadsetStatusApp::showSettings() {
+    SettingsDialog dialog(configManager, DeviceClassifier::readOverrides(), nullptr);
+    connect(&dialog, &SettingsDialog::classificationChanged, this, &HeadsetStatusApp::setClassification);
+    dialog.exec();
+}
+
+void HeadsetStatusApp::showDeviceDetails(const QString& dbusPath) {
+    const HeadsetDevice *device = m_knownDevices.find(dbusPath);
+    if (!device) {
+        QMessageBox::warning(nullptr, "Device Not Found",
+            "The selected device is no longer connected.");
+        return;
+    }
+
+    const HeadsetDevice targetDevice = *device;
+    QString details = QString(
+        "<b>%1</b><br><br>"
+        "<b>Connection Type:</b> %2<br>"
+        "<b>Battery Level:</b> %3%<br>"
+        "<b>Charging:</b> %4<br>"
+        "<b>Present:</b> %5<br>"
+        "<br><b>Technical Details:</b><br>"
+        "<small>D-Bus Path: %6<br>"
+        "Native Path: %7</small>")
+        .arg(targetDevice.model)
+        .arg(connectionTypeName(targetDevice.connectionType))
+        .arg(int(targetDevice.battery))
+        .arg(targetDevice.isCharging ? "Yes" : "No")
+        .arg(targetDevice.isPresent ? "Yes" : "No")
+        .arg(targetDevice.dbusPath)
+        .arg(targetDevice.nativePath);
+
+    QMessageBox::information(nullptr,
+        QString("Device Details: %1").arg(targetDevice.model),
+        details);
+}
+
+void HeadsetStatusApp::ignoreDevice(const QString& dbusPath) {
+    const HeadsetDevice *device = m_knownDevices.find(dbusPath);
+    if (!device) {
+        return;
+    }
+
+    m_source->ignoreDevice(*device);
+    scheduleStatusUpdate();
+}
+
+void HeadsetStatusApp::resetDevice(const QString& dbusPath) {
+    const HeadsetDevice *device = m_knownDevices.find(dbusPath);
+    if (!device) {
+        return;
+    }
+
+    m_source->resetDevice(*device);
+    scheduleStatusUpdate();
+}
+
+void HeadsetStatusApp::setClassification(const QString& nativePath, const QString& model,
+                                         DeviceClassifier::Override value) {
+    // Overrides are keyed by identity, so the device need not be connected
+    HeadsetDevice device;
+    device.nativePath = nativePath;
+    device.model = model;
+
+    switch (value) {
+    case DeviceClassifier::Override::AlwaysHeadset:
+        m_source->pinDevice(device);
+        break;
+    case DeviceClassifier::Override::NeverHeadset:
+        m_source->ignoreDevice(device);
+        break;
+    case DeviceClassifier::Override::None:
+        m_source->resetDevice(device);
+        break;
+    }
+    scheduleStatusUpdate();
+}
+
+void HeadsetStatusApp::showAbout() {
+    QMessageBox aboutBox;
+    aboutBox.setWindowTitle("About HeadsetStatus");
+    aboutBox.setTextFormat(Qt::RichText);
+    aboutBox.setText(QString("<b>HeadsetStatus</b><br>"
+        "Version %1<br>"
+        "A fast Linux tray app for headset battery and connection status.<br>"
+        "<a href='https://github.com/mewset/headsetstatus'>GitHub</a><br>"
+        "License: MIT<br><br>"
+        "&copy; 2025 mewset").arg(HEADSETSTATUS_VERSION));
+    aboutBox.setStandardButtons(QMessageBox::Ok);
+
+    if (trayController) {
+        aboutBox.installEventFilter(trayController);
+    }
+    aboutBox.exec();
+}
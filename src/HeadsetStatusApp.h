@@ -0,0 +1,136 @@
+#pragma once
+#include <QObject>
+#include <QDBusConnection>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+#include "BatteryEstimator.h"
+#include "BatteryHistory.h"
+#include "DeviceClassifier.h"
+#include "DeviceStateCache.h"
+#include "HeadsetDevice.h"
+#include "LastStateStore.h"
+
+class ConfigManager;
+class DeviceSource;
+class HeadsetStatusService;
+class NotificationManager;
+class PollScheduler;
+class StatusSocketServer;
+class TrayIconController;
+
+/**
+ * @class HeadsetStatusApp
+ * @brief Main application class coordinating all components
+ *
+ * Supports GUI mode (system tray), headless mode (notifications only) and
+ * watch mode, which only keeps the device state current for devicesUpdated().
+ */
+class HeadsetStatusApp : public QObject {
+    Q_OBJECT
+public:
+    enum class Mode {
+        Tray,      ///< System tray icon and notifications
+        Headless,  ///< Notifications only
+        Watch,     ///< No tray, notifications, service, socket or history; for --watch
+    };
+
+    /**
+     * @param mode What the instance presents; Watch runs on a QCoreApplication
+     * @param debug Enable debug output
+     * @param upowerBus Bus UPower is reached on; the system bus outside of tests, where
+     *        the device worker thread opens a connection of its own
+     * @param serviceBus Bus HeadsetStatusService is exported on; the session bus outside of tests
+     */
+    explicit HeadsetStatusApp(Mode mode = Mode::Tray, bool debug = false,
+                              const QDBusConnection& upowerBus = QDBusConnection::systemBus(),
+                              const QDBusConnection& serviceBus = QDBusConnection::sessionBus());
+
+    /**
+     * @brief Runs on a given device source instead of UPower, e.g. a ReplaySource
+     * @param source Source of devices and changes; the application takes ownership
+     */
+    HeadsetStatusApp(DeviceSource *source, Mode mode, bool debug = false,
+                     const QDBusConnection& serviceBus = QDBusConnection::sessionBus());
+
+    /**
+     * @brief Writes a last device state that is still waiting to be saved
+     */
+    ~HeadsetStatusApp() override;
+
+    const DeviceStateCache& knownDevices() const { return m_knownDevices; }
+    const BatteryHistoryStore& batteryHistory() const { return m_batteryHistory; }
+    TrayIconController* tray() const { return trayController; }
+    NotificationManager* notifications() const { return notificationManager; }
+    PollScheduler* pollScheduler() const { return m_pollScheduler; }
+    HeadsetStatusService* service() const { return m_service; }
+    DeviceSource* deviceSource() const { return m_source; }
+    StatusSocketServer* socketServer() const { return m_socketServer; }
+
+    /**
+     * @brief Number of full updates requested through the debounce timer
+     */
+    int statusUpdateRequests() const { return m_statusUpdateRequests; }
+
+    /**
+     * @brief Number of full updates that actually ran
+     *
+     * The difference to statusUpdateRequests() is what the debounce coalesced.
+     */
+    int statusUpdatesRun() const { return m_statusUpdatesRun; }
+
+signals:
+    /**
+     * @brief Emitted after every update was applied to knownDevices()
+     *
+     * Also emitted for enumerations that changed nothing, so the first one
+     * marks when knownDevices() is complete.
+     */
+    void devicesUpdated(const DeviceChangeSet& changes);
+
+private slots:
+    void scheduleStatusUpdate();
+    void updateStatus();
+    void applyDevices(const QList<HeadsetDevice>& currentDevices);
+    void applyDeviceChange(const QString& dbusPath, const QVariantMap& changedProperties);
+    void showInformation();
+    void onConfigChanged();
+    void showSettings();
+    void showDeviceDetails(const QString& dbusPath);
+    void ignoreDevice(const QString& dbusPath);
+    void resetDevice(const QString& dbusPath);
+    void setClassification(const QString& nativePath, const QString& model, DeviceClassifier::Override value);
+    void showAbout();
+    void saveLastState();
+
+private:
+    void initialize(const QDBusConnection& serviceBus);
+    void checkDeviceNotifications(const HeadsetDevice& device);
+    void recordSample(DeviceChange& change, qint64 timestampMs);
+    void scheduleLastStateSave(const DeviceChangeSet& changes);
+
+    Mode m_mode;
+    bool m_debug;
+    DeviceSource *m_source = nullptr;
+    TrayIconController *trayController = nullptr;
+    NotificationManager *notificationManager;
+    ConfigManager *configManager;
+    QTimer *m_updateDebounceTimer = nullptr;
+    PollScheduler *m_pollScheduler = nullptr;
+    HeadsetStatusService *m_service = nullptr;
+    StatusSocketServer *m_socketServer = nullptr;
+    int m_statusUpdateRequests = 0;
+    int m_statusUpdatesRun = 0;
+    QElapsedTimer m_statusUpdateTimer;
+
+    // Track device and notification states
+    DeviceStateCache m_knownDevices;
+    QSet<QString> m_lowBatteryNotified;
+    QSet<QString> m_previouslyCharging;
+    BatteryHistoryStore m_batteryHistory;
+    QHash<QString, BatteryEstimator> m_estimators;
+    LastStateStore m_lastState;
+    QTimer *m_lastStateTimer = nullptr;
+    bool m_lastStateWritten = false;
+};
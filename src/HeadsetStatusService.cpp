@@ -0,0 +1,121 @@
+#include "HeadsetStatusService.h"
+#include <QDBusConnectionInterface>
+#include <QDBusMetaType>
+#include <QDebug>
+#include "DeviceStateCache.h"
+
+HeadsetStatusService::HeadsetStatusService(const DeviceStateCache& cache, QObject *parent)
+    : QObject(parent)
+    , m_cache(cache)
+    , m_bus(QString())
+{
+    qDBusRegisterMetaType<QList<QVariantMap>>();
+    qDBusRegisterMetaType<QList<QDBusObjectPath>>();
+}
+
+HeadsetStatusService::~HeadsetStatusService() {
+    if (m_registered) {
+        m_bus.unregisterObject(kObjectPath);
+        m_bus.unregisterService(kServiceName);
+    }
+}
+
+bool HeadsetStatusService::registerOn(const QDBusConnection& bus) {
+    m_bus = bus;
+    if (!m_bus.isConnected()) {
+        return false;
+    }
+
+    if (!m_bus.registerObject(kObjectPath, this,
+                              QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableSignals)) {
+        qWarning() << "Failed to export" << kObjectPath << m_bus.lastError().message();
+        return false;
+    }
+
+    // Another instance may own the name; the object stays reachable by unique name
+    if (!m_bus.registerService(kServiceName)) {
+        qWarning() << "Failed to claim" << kServiceName << m_bus.lastError().message();
+        m_bus.unregisterObject(kObjectPath);
+        return false;
+    }
+
+    m_registered = true;
+    return true;
+}
+
+QVariantMap HeadsetStatusService::deviceProperties(const HeadsetDevice& device) {
+    QVariantMap properties;
+    properties.insert(QStringLiteral("Path"), QVariant::fromValue(QDBusObjectPath(device.dbusPath)));
+    properties.insert(QStringLiteral("Model"), device.model);
+    properties.insert(QStringLiteral("NativePath"), device.nativePath);
+    properties.insert(QStringLiteral("Connection"), connectionTypeName(device.connectionType));
+    properties.insert(QStringLiteral("Percentage"), device.battery);
+    properties.insert(QStringLiteral("IsCharging"), device.isCharging);
+    properties.insert(QStringLiteral("IsPresent"), device.isPresent);
+    properties.insert(QStringLiteral("TimeRemaining"), device.secondsRemaining);
+    return properties;
+}
+
+QVariantMap HeadsetStatusService::deviceDelta(const HeadsetDevice& device, DeviceFields fields) {
+    if (fields & DeviceField::Added) {
+        return deviceProperties(device);
+    }
+
+    QVariantMap delta;
+    delta.insert(QStringLiteral("Path"), QVariant::fromValue(QDBusObjectPath(device.dbusPath)));
+    if (fields & DeviceField::Model) {
+        delta.insert(QStringLiteral("Model"), device.model);
+    }
+    if (fields & DeviceField::Connection) {
+        delta.insert(QStringLiteral("Connection"), connectionTypeName(device.connectionType));
+    }
+    if (fields & DeviceField::Battery) {
+        delta.insert(QStringLiteral("Percentage"), device.battery);
+    }
+    if (fields & DeviceField::Charging) {
+        delta.insert(QStringLiteral("IsCharging"), device.isCharging);
+    }
+    if (fields & DeviceField::Presence) {
+        delta.insert(QStringLiteral("IsPresent"), device.isPresent);
+    }
+    if (fields & DeviceField::Estimate) {
+        delta.insert(QStringLiteral("TimeRemaining"), device.secondsRemaining);
+    }
+    return delta;
+}
+
+void HeadsetStatusService::publish(const DeviceChangeSet& changes) {
+    if (!m_registered) {
+        return;
+    }
+
+    QList<QVariantMap> changed;
+    QList<QDBusObjectPath> removed;
+    if (changes.everything) {
+        changed = GetDevices();
+    }
+    for (const DeviceChange& change : changes.changes) {
+        if (change.fields & DeviceField::Removed) {
+            removed.append(QDBusObjectPath(change.dbusPath));
+        } else if (!changes.everything && (change.fields & kDeviceStateFields)) {
+            if (const HeadsetDevice *device = m_cache.find(change.dbusPath)) {
+                changed.append(deviceDelta(*device, change.fields));
+            }
+        }
+    }
+
+    // A pure reorder is not worth waking every consumer for
+    if (changed.isEmpty() && removed.isEmpty()) {
+        return;
+    }
+    emit DevicesChanged(changed, removed);
+}
+
+QList<QVariantMap> HeadsetStatusService::GetDevices() const {
+    QList<QVariantMap> devices;
+    devices.reserve(m_cache.size());
+    for (const HeadsetDevice& device : m_cache.devices()) {
+        devices.append(deviceProperties(device));
+    }
+    return devices;
+}
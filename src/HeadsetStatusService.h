@@ -0,0 +1,80 @@
+#pragma once
+#include <QDBusConnection>
+#include <QDBusObjectPath>
+#include <QList>
+#include <QObject>
+#include <QVariantMap>
+#include "DeviceChange.h"
+
+class DeviceStateCache;
+
+/**
+ * @class HeadsetStatusService
+ * @brief Publishes the cached headset state on the session bus
+ *
+ * Registers org.mewset.HeadsetStatus at /org/mewset/HeadsetStatus so status
+ * bars and monitoring agents can read what HeadsetStatus already knows
+ * instead of each polling UPower. GetDevices() is answered from the
+ * DeviceStateCache without any UPower traffic, and DevicesChanged carries
+ * only what changed since the previous signal.
+ *
+ * A device is an a{sv} with the keys Path, Model, NativePath, Connection
+ * ("USB", "Bluetooth" or "Unknown"), Percentage, IsCharging, IsPresent and
+ * TimeRemaining (seconds, -1 if unknown).
+ */
+class HeadsetStatusService : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.mewset.HeadsetStatus")
+public:
+    static constexpr const char *kServiceName = "org.mewset.HeadsetStatus";
+    static constexpr const char *kObjectPath = "/org/mewset/HeadsetStatus";
+
+    /**
+     * @param cache Device state the service answers from; must outlive it
+     */
+    explicit HeadsetStatusService(const DeviceStateCache& cache, QObject *parent = nullptr);
+    ~HeadsetStatusService() override;
+
+    /**
+     * @brief Exports the object and claims the service name
+     * @return False if the object or the name could not be registered
+     */
+    bool registerOn(const QDBusConnection& bus);
+
+    /**
+     * @brief Emits DevicesChanged for one update, if it changed anything visible
+     * @param changes Change set of the update the cache just applied
+     */
+    void publish(const DeviceChangeSet& changes);
+
+    /**
+     * @brief All properties of a device, as sent by GetDevices()
+     */
+    static QVariantMap deviceProperties(const HeadsetDevice& device);
+
+    /**
+     * @brief Path plus only the properties named by @p fields
+     */
+    static QVariantMap deviceDelta(const HeadsetDevice& device, DeviceFields fields);
+
+public slots:
+    /**
+     * @brief Returns every tracked headset in enumeration order
+     */
+    Q_SCRIPTABLE QList<QVariantMap> GetDevices() const;
+
+signals:
+    /**
+     * @brief Headsets that were added or changed, and paths that were removed
+     * @param changed Added devices with all properties, changed devices
+     *        with Path and the changed properties only
+     * @param removed UPower object paths of removed headsets
+     */
+    Q_SCRIPTABLE void DevicesChanged(const QList<QVariantMap>& changed,
+                                     const QList<QDBusObjectPath>& removed);
+
+private:
+    const DeviceStateCache& m_cache;
+    QDBusConnection m_bus;
+    bool m_registered = false;
+};
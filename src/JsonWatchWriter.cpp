@@ -0,0 +1,41 @@
+#include "JsonWatchWriter.h"
+#include <cerrno>
+#include <unistd.h>
+
+JsonWatchWriter::JsonWatchWriter(const DeviceStateCache& cache, int fd, QObject *parent)
+    : QObject(parent)
+    , m_encoder(cache)
+    , m_fd(fd)
+{
+    m_buffer.reserve(DeviceJsonEncoder::kBufferCapacity);
+}
+
+void JsonWatchWriter::write(const DeviceChangeSet& changes) {
+    if (m_closed) {
+        return;
+    }
+
+    m_buffer.resize(0);
+    if (!m_snapshotWritten || changes.everything) {
+        m_snapshotWritten = true;
+        m_encoder.appendSnapshot(m_buffer);
+    } else if (m_encoder.appendChanges(changes, m_buffer) == 0) {
+        return;
+    }
+
+    const char *data = m_buffer.constData();
+    qsizetype remaining = m_buffer.size();
+    while (remaining > 0) {
+        const ssize_t written = ::write(m_fd, data, size_t(remaining));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_closed = true;
+            emit outputClosed();
+            return;
+        }
+        data += written;
+        remaining -= written;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <QByteArray>
+#include <QObject>
+#include "DeviceChange.h"
+#include "DeviceJsonEncoder.h"
+
+class DeviceStateCache;
+
+/**
+ * @class JsonWatchWriter
+ * @brief Streams the headset state as newline-delimited JSON for --watch --json
+ *
+ * The first update writes a snapshot line, every later update one line per
+ * added, changed or removed headset in the DeviceJsonEncoder format. The
+ * lines of one update are built in a reused buffer and handed to the
+ * kernel with a single write() in the common case.
+ */
+class JsonWatchWriter : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * @param cache Device state the lines are built from; must outlive the writer
+     * @param fd File descriptor to write to; not closed by the writer
+     */
+    explicit JsonWatchWriter(const DeviceStateCache& cache, int fd, QObject *parent = nullptr);
+
+public slots:
+    /**
+     * @brief Writes the lines for one update that was applied to the cache
+     */
+    void write(const DeviceChangeSet& changes);
+
+signals:
+    /**
+     * @brief Emitted once when a write fails, typically because the reader exited
+     */
+    void outputClosed();
+
+private:
+    DeviceJsonEncoder m_encoder;
+    int m_fd;
+    bool m_snapshotWritten = false;
+    bool m_closed = false;
+    QByteArray m_buffer;
+};
@@ -0,0 +1,111 @@
+#include "KeywordMatcher.h"
+#include <QtGlobal>
+#include <deque>
+
+namespace {
+// Non-ASCII code units whose lowercase form contains an ASCII letter
+constexpr char16_t kKelvinSign = 0x212A;                  // lowercases to 'k'
+constexpr char16_t kCapitalIWithDotAbove = 0x0130;        // lowercases to "i̇"
+
+char16_t asciiLower(char16_t unit) {
+    return (unit >= 'A' && unit <= 'Z') ? char16_t(unit + ('a' - 'A')) : unit;
+}
+}
+
+KeywordMatcher::KeywordMatcher(const QStringList& keywords) {
+    // Assign a class to every character that occurs in a keyword
+    for (const QString& keyword : keywords) {
+        for (const QChar ch : keyword) {
+            const char16_t unit = asciiLower(ch.unicode());
+            Q_ASSERT_X(unit < 128, "KeywordMatcher", "keywords must be ASCII");
+            if (unit < 128 && m_classOfAscii[unit] == 0) {
+                m_classOfAscii[unit] = quint8(m_classCount++);
+            }
+        }
+    }
+
+    // Build the keyword trie; 0 marks a missing edge until the BFS below
+    std::vector<std::vector<State>> trie(1, std::vector<State>(m_classCount, 0));
+    m_accepting.assign(1, false);
+
+    for (const QString& keyword : keywords) {
+        if (keyword.isEmpty()) {
+            continue;
+        }
+
+        State state = 0;
+        for (const QChar ch : keyword) {
+            const int cls = classOf(asciiLower(ch.unicode()));
+            if (trie[state][cls] == 0) {
+                trie[state][cls] = State(trie.size());
+                trie.emplace_back(m_classCount, 0);
+                m_accepting.push_back(false);
+            }
+            state = trie[state][cls];
+        }
+        m_accepting[state] = true;
+    }
+
+    // Resolve failure links breadth-first into a complete transition table
+    std::vector<State> failure(trie.size(), 0);
+    std::deque<State> queue;
+    for (int cls = 1; cls < m_classCount; ++cls) {
+        if (trie[0][cls] != 0) {
+            queue.push_back(trie[0][cls]);
+        }
+    }
+
+    while (!queue.empty()) {
+        const State state = queue.front();
+        queue.pop_front();
+        m_accepting[state] = m_accepting[state] || m_accepting[failure[state]];
+
+        for (int cls = 1; cls < m_classCount; ++cls) {
+            const State next = trie[state][cls];
+            if (next != 0) {
+                failure[next] = trie[failure[state]][cls];
+                queue.push_back(next);
+            } else {
+                trie[state][cls] = trie[failure[state]][cls];
+            }
+        }
+    }
+
+    m_transitions.reserve(trie.size() * size_t(m_classCount));
+    for (const std::vector<State>& row : trie) {
+        m_transitions.insert(m_transitions.end(), row.cbegin(), row.cend());
+    }
+}
+
+int KeywordMatcher::classOf(char16_t unit) const noexcept {
+    return unit < 128 ? m_classOfAscii[unit] : 0;
+}
+
+bool KeywordMatcher::matches(QStringView text) const noexcept {
+    State state = 0;
+    const char16_t *data = text.utf16();
+    const char16_t *end = data + text.size();
+
+    for (; data != end; ++data) {
+        char16_t unit = *data;
+        if (unit >= 128) {
+            if (unit == kKelvinSign) {
+                unit = 'k';
+            } else if (unit == kCapitalIWithDotAbove) {
+                // Full case mapping yields 'i' followed by a combining dot
+                state = step(state, classOf('i'));
+                if (m_accepting[state]) {
+                    return true;
+                }
+                unit = 0x0307;
+            }
+        }
+
+        state = step(state, classOf(asciiLower(unit)));
+        if (m_accepting[state]) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <QStringList>
+#include <QStringView>
+#include <array>
+#include <vector>
+
+/**
+ * @class KeywordMatcher
+ * @brief Case-insensitive multi-keyword substring matcher
+ *
+ * Compiles a set of ASCII keywords once into an Aho-Corasick automaton with
+ * all failure transitions resolved, so matching is a single pass over the
+ * UTF-16 text with one table lookup per code unit and no allocation.
+ * Results are identical to text.toLower().contains(keyword) for any keyword.
+ */
+class KeywordMatcher {
+public:
+    /**
+     * @brief Builds the automaton
+     * @param keywords Lowercase ASCII keywords; empty entries are ignored
+     */
+    explicit KeywordMatcher(const QStringList& keywords);
+
+    /**
+     * @brief Returns true if any keyword occurs in @p text, ignoring case
+     */
+    bool matches(QStringView text) const noexcept;
+
+private:
+    using State = quint16;
+
+    // Character classes: 0 for every code unit that is in no keyword
+    int classOf(char16_t unit) const noexcept;
+    State step(State state, int charClass) const noexcept {
+        return m_transitions[size_t(state) * m_classCount + size_t(charClass)];
+    }
+
+    std::array<quint8, 128> m_classOfAscii{};
+    int m_classCount = 1;
+    std::vector<State> m_transitions;
+    std::vector<bool> m_accepting;
+};
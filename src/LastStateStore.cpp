@@ -0,0 +1,56 @@
+#include "LastStateStore.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include "DeviceTrace.h"
+
+LastStateStore::LastStateStore(const QString& filePath) : m_filePath(filePath) {}
+
+QString LastStateStore::defaultPath() {
+    QString stateHome = qEnvironmentVariable("XDG_STATE_HOME");
+    if (stateHome.isEmpty()) {
+        stateHome = QDir::homePath() + "/.local/state";
+    }
+    return stateHome + "/headsetstatus/last-state";
+}
+
+bool LastStateStore::load(QList<HeadsetDevice> *devices, qint64 *savedAtMs) const {
+    if (!QFileInfo::exists(m_filePath)) {
+        return false;
+    }
+
+    QList<DeviceTraceEvent> events;
+    QString error;
+    if (!readDeviceTrace(m_filePath, &events, &error)) {
+        qWarning() << "Ignoring last device state:" << error;
+        return false;
+    }
+    if (events.size() != 1 || events.first().type != DeviceTraceEvent::Type::Snapshot) {
+        return false;
+    }
+
+    *devices = events.first().devices;
+    *savedAtMs = events.first().timeUs / 1000;
+    return true;
+}
+
+bool LastStateStore::save(const QList<HeadsetDevice>& devices, qint64 savedAtMs) {
+    DeviceTraceEvent snapshot;
+    snapshot.type = DeviceTraceEvent::Type::Snapshot;
+    snapshot.timeUs = savedAtMs * 1000;
+    snapshot.devices = devices;
+
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot save last device state:" << file.errorString();
+        return false;
+    }
+    file.write(DeviceTraceWriter::encode({snapshot}));
+    if (!file.commit()) {
+        qWarning() << "Cannot save last device state:" << file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <QList>
+#include <QString>
+#include "HeadsetDevice.h"
+
+/**
+ * @class LastStateStore
+ * @brief Remembers the device list across restarts
+ *
+ * The file holds one Snapshot record in the DeviceTrace format, stamped
+ * with the wall-clock time the state was current, and is replaced
+ * atomically, so a crash leaves either the old or the new state. At
+ * startup it lets the tray show what was known before UPower answers.
+ */
+class LastStateStore {
+public:
+    explicit LastStateStore(const QString& filePath = defaultPath());
+
+    /**
+     * @brief ~/.local/state/headsetstatus/last-state, honouring XDG_STATE_HOME
+     */
+    static QString defaultPath();
+
+    /**
+     * @brief Reads the saved devices
+     * @param devices Receives the devices in their saved order
+     * @param savedAtMs Receives when they were current, ms since the Unix epoch
+     * @return False if nothing valid was saved
+     */
+    bool load(QList<HeadsetDevice> *devices, qint64 *savedAtMs) const;
+
+    /**
+     * @brief Replaces the saved state
+     * @param savedAtMs When the devices were current, ms since the Unix epoch
+     */
+    bool save(const QList<HeadsetDevice>& devices, qint64 savedAtMs);
+
+    QString filePath() const { return m_filePath; }
+
+private:
+    QString m_filePath;
+};
@@ -1,61 +1,140 @@
 #include "NotificationManager.h"
 #include <QDBusConnection>
 #include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QVariantList>
 #include <QVariantMap>
 #include <QDebug>
+#include <climits>
+#include "RuntimeStats.h"
 
 NotificationManager::NotificationManager(QObject *parent)
     : QObject(parent)
+    , m_bus(QDBusConnection::sessionBus())
     , m_notificationsEnabled(true)
     , m_lowBatteryThreshold(20)
     , m_appName("HeadsetStatus")
 {
-    // Connect to the freedesktop notifications service
-    m_notificationInterface = new QDBusInterface(
-        "org.freedesktop.Notifications",
-        "/org/freedesktop/Notifications",
-        "org.freedesktop.Notifications",
-        QDBusConnection::sessionBus(),
-        this
-    );
-
-    if (!m_notificationInterface->isValid()) {
-        qWarning() << "Failed to connect to notification service:"
-                   << m_notificationInterface->lastError().message();
+    // A plain method call per notification; a QDBusInterface would block
+    // here introspecting a daemon that may not be up yet
+    if (!m_bus.isConnected()) {
+        qWarning() << "Failed to connect to notification service: no session bus";
     }
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setTimerType(Qt::CoarseTimer);
+    connect(&m_flushTimer, &QTimer::timeout, this, &NotificationManager::flush);
+    m_clock.start();
 }
 
-void NotificationManager::sendNotification(const QString& summary, const QString& body, int urgency) {
-    if (!m_notificationsEnabled || !m_notificationInterface->isValid()) {
+void NotificationManager::sendNotification(const HeadsetDevice& device, const QString& summary,
+                                           const QString& body, int urgency) {
+    if (!m_notificationsEnabled || !m_bus.isConnected()) {
         return;
     }
 
+    NotificationScheduler::Notification notification;
+    notification.key = device.dbusPath;
+    notification.summary = summary;
+    notification.body = body;
+    notification.urgency = urgency;
+    m_scheduler.post(notification);
+
+    // The rest of the current update joins this batch
+    if (!m_flushTimer.isActive() || m_flushTimer.remainingTime() > 0) {
+        m_flushTimer.start(0);
+    }
+}
+
+void NotificationManager::flush() {
+    m_flushTimer.stop();
+
+    const quint64 coalescedBefore = m_scheduler.coalescedCount();
+    const qint64 now = m_clock.elapsed();
+    NotificationScheduler::Notification popup;
+    while (m_scheduler.take(now, &popup)) {
+        showNotification(popup);
+    }
+    RuntimeStats::global().notificationsCoalesced.add(m_scheduler.coalescedCount() - coalescedBefore);
+
+    // Held back by the rate limits until a token is free
+    const qint64 next = m_scheduler.availableAt(now);
+    if (next >= 0) {
+        m_flushTimer.start(int(qMin<qint64>(next - now, INT_MAX)));
+    }
+}
+
+void NotificationManager::showNotification(const NotificationScheduler::Notification& notification) {
+    // Subscribed with the first popup, like everything else that talks to the daemon
+    if (!m_watchingClosed) {
+        m_watchingClosed = m_bus.connect("org.freedesktop.Notifications",
+                                         "/org/freedesktop/Notifications",
+                                         "org.freedesktop.Notifications",
+                                         "NotificationClosed",
+                                         this, SLOT(onNotificationClosed(uint,uint)));
+    }
+
+    const uint replacesId = m_notificationIds.value(notification.key);
+
     // Prepare notification parameters
     QVariantList args;
     args << m_appName;              // app_name
-    args << uint(0);                // replaces_id
+    args << replacesId;             // replaces_id
     args << QString("audio-headset"); // app_icon
-    args << summary;                // summary
-    args << body;                   // body
+    args << notification.summary;   // summary
+    args << notification.body;      // body
     args << QStringList();          // actions
 
     // Hints for urgency level
     QVariantMap hints;
-    hints["urgency"] = urgency;
+    hints["urgency"] = notification.urgency;
     args << hints;
 
     args << int(5000);              // timeout (5 seconds)
 
-    // Send notification via D-Bus
-    QDBusMessage reply = m_notificationInterface->callWithArgumentList(
-        QDBus::NoBlock,
-        "Notify",
-        args
+    // Sent without waiting; the reply only carries the ID to replace next time
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        "org.freedesktop.Notifications",
+        "/org/freedesktop/Notifications",
+        "org.freedesktop.Notifications",
+        "Notify"
     );
+    message.setArguments(args);
+
+    auto *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(message), this);
+    const QString key = notification.key;
+    connect(watcher, &QDBusPendingCallWatcher::finished, this,
+            [this, key](QDBusPendingCallWatcher *w) { onNotifyFinished(w, key); });
+
+    RuntimeStats::global().notificationsSent.add();
+    if (replacesId != 0) {
+        RuntimeStats::global().notificationsReplaced.add();
+    }
+    emit notificationSent(notification.summary, notification.body);
+}
+
+void NotificationManager::onNotifyFinished(QDBusPendingCallWatcher *watcher, const QString& key) {
+    watcher->deleteLater();
+
+    QDBusPendingReply<uint> reply = *watcher;
+    if (reply.isError()) {
+        qWarning() << "Failed to send notification:" << reply.error().message();
+        m_notificationIds.remove(key);
+        return;
+    }
+    m_notificationIds.insert(key, reply.value());
+}
 
-    if (reply.type() == QDBusMessage::ErrorMessage) {
-        qWarning() << "Failed to send notification:" << reply.errorMessage();
+void NotificationManager::onNotificationClosed(uint id, uint reason) {
+    Q_UNUSED(reason)
+
+    // Expired or dismissed; the next popup for the key is a new one
+    for (auto it = m_notificationIds.begin(); it != m_notificationIds.end(); ++it) {
+        if (it.value() == id) {
+            m_notificationIds.erase(it);
+            return;
+        }
     }
 }
 
@@ -65,10 +144,14 @@ void NotificationManager::notifyLowBattery(const HeadsetDevice& device) {
     }
 
     QString summary = QString("Low Battery: %1").arg(device.model);
-    QString body = QString("Battery level is at %1%. Please charge soon.")
-                       .arg(int(device.battery));
-
-    sendNotification(summary, body, 2); // Critical urgency
+    QString body = device.secondsRemaining >= 0
+        ? QString("Battery level is at %1%, about %2 left. Please charge soon.")
+              .arg(int(device.battery))
+              .arg(formatDuration(device.secondsRemaining))
+        : QString("Battery level is at %1%. Please charge soon.")
+              .arg(int(device.battery));
+
+    sendNotification(device, summary, body, 2); // Critical urgency
 }
 
 void NotificationManager::notifyChargingComplete(const HeadsetDevice& device) {
@@ -80,7 +163,7 @@ void NotificationManager::notifyChargingComplete(const HeadsetDevice& device) {
     QString body = QString("Battery is now at %1%.")
                        .arg(int(device.battery));
 
-    sendNotification(summary, body, 1); // Normal urgency
+    sendNotification(device, summary, body, 1); // Normal urgency
 }
 
 void NotificationManager::notifyDeviceDisconnected(const HeadsetDevice& device) {
@@ -91,15 +174,32 @@ void NotificationManager::notifyDeviceDisconnected(const HeadsetDevice& device)
     QString summary = QString("Headset Disconnected");
     QString body = QString("%1 has been disconnected.").arg(device.model);
 
-    sendNotification(summary, body, 1); // Normal urgency
+    sendNotification(device, summary, body, 1); // Normal urgency
+}
+
+QString NotificationManager::formatDuration(qint32 seconds) {
+    const int minutes = (seconds + 30) / 60;
+    if (minutes < 60) {
+        return QString("%1 min").arg(minutes);
+    }
+    return QString("%1 h %2 min").arg(minutes / 60).arg(minutes % 60);
 }
 
 void NotificationManager::setNotificationsEnabled(bool enabled) {
     m_notificationsEnabled = enabled;
+    if (!enabled) {
+        m_scheduler.clear();
+        m_flushTimer.stop();
+    }
+}
+
+void NotificationManager::setRateLimits(const NotificationScheduler::Limits& limits) {
+    m_scheduler = NotificationScheduler(limits);
+    m_flushTimer.stop();
 }
 
 void NotificationManager::setLowBatteryThreshold(int threshold) {
     if (threshold >= 0 && threshold <= 100) {
         m_lowBatteryThreshold = threshold;
     }
-}
\ No newline at end of file
+}
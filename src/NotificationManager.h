@@ -1,8 +1,14 @@
 #pragma once
 #include <QObject>
-#include <QDBusInterface>
+#include <QDBusConnection>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QString>
+#include <QTimer>
 #include "HeadsetDevice.h"
+#include "NotificationScheduler.h"
+
+class QDBusPendingCallWatcher;
 
 /**
  * @class NotificationManager
@@ -11,6 +17,17 @@
  * This class handles sending desktop notifications via D-Bus for events such as
  * low battery warnings and charging completion. Supports both libnotify and
  * Wayland notification systems (swaync, mako, dunst).
+ *
+ * Nothing is sent to the notification daemon until the first notification:
+ * a daemon that is slow to start at login never delays startup.
+ *
+ * Notifications go through a NotificationScheduler keyed by device and are
+ * sent once control returns to the event loop, or at flush(), so the
+ * events of one update become a single popup. Each device's popup, and the
+ * summary popup, is updated in place with the ID the daemon returned for
+ * it, and rate limits hold back a flapping device until its latest state
+ * may be shown. An ID is dropped once the daemon reports the popup closed,
+ * so devices that are gone leave nothing behind.
  */
 class NotificationManager : public QObject {
     Q_OBJECT
@@ -47,19 +64,68 @@ public:
      */
     void setLowBatteryThreshold(int threshold);
 
+    /**
+     * @brief Replaces the rate limits and drops pending notifications
+     */
+    void setRateLimits(const NotificationScheduler::Limits& limits);
+
+    /**
+     * @brief Sends what the rate limits allow now and schedules the rest
+     *
+     * Called at the end of every update so its notifications go out as
+     * one batch without waiting for the event loop.
+     */
+    void flush();
+
+    /** @brief Notifications waiting for the event loop or for the rate limits */
+    int pendingCount() const { return m_scheduler.pendingCount(); }
+
+    /**
+     * @brief Formats an estimated time remaining for a notification body
+     * @param seconds Seconds remaining (>= 0)
+     * @return "45 min" or "3 h 5 min"
+     */
+    static QString formatDuration(qint32 seconds);
+
     bool isNotificationsEnabled() const { return m_notificationsEnabled; }
     int getLowBatteryThreshold() const { return m_lowBatteryThreshold; }
 
+signals:
+    /**
+     * @brief Emitted after a notification has been handed to the notification daemon
+     * @param summary Notification title
+     * @param body Notification body text
+     */
+    void notificationSent(const QString& summary, const QString& body);
+
 private:
     /**
-     * @brief Sends a notification via D-Bus
+     * @brief Queues a notification for the next flush
+     * @param device Device the notification is about; a newer one replaces it
      * @param summary Notification title
      * @param body Notification body text
      * @param urgency Urgency level (0=low, 1=normal, 2=critical)
      */
-    void sendNotification(const QString& summary, const QString& body, int urgency = 1);
+    void sendNotification(const HeadsetDevice& device, const QString& summary,
+                          const QString& body, int urgency = 1);
 
-    QDBusInterface *m_notificationInterface;
+    /**
+     * @brief Sends one popup via D-Bus, replacing the one shown under its key
+     */
+    void showNotification(const NotificationScheduler::Notification& notification);
+
+    void onNotifyFinished(QDBusPendingCallWatcher *watcher, const QString& key);
+
+private slots:
+    void onNotificationClosed(uint id, uint reason);
+
+private:
+    QDBusConnection m_bus;
+    NotificationScheduler m_scheduler;
+    QHash<QString, uint> m_notificationIds; ///< Daemon ID of the popup shown per key
+    bool m_watchingClosed = false;
+    QTimer m_flushTimer;
+    QElapsedTimer m_clock;
     bool m_notificationsEnabled;
     int m_lowBatteryThreshold;
     QString m_appName;
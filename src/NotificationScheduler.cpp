@@ -0,0 +1,120 @@
+#include "NotificationScheduler.h"
+
+const QString NotificationScheduler::kSummaryKey = QStringLiteral("summary");
+
+TokenBucket::TokenBucket(int capacity, qint64 refillMs)
+    : m_refillMs(qMax<qint64>(0, refillMs))
+    , m_burstMs(qint64(qMax(1, capacity) - 1) * m_refillMs)
+{
+}
+
+bool TokenBucket::available(qint64 nowMs) const {
+    return m_fullAtMs <= nowMs + m_burstMs;
+}
+
+void TokenBucket::take(qint64 nowMs) {
+    m_fullAtMs = qMax(m_fullAtMs, nowMs) + m_refillMs;
+}
+
+qint64 TokenBucket::availableAt(qint64 nowMs) const {
+    return available(nowMs) ? nowMs : m_fullAtMs - m_burstMs;
+}
+
+bool TokenBucket::isFull(qint64 nowMs) const {
+    return m_fullAtMs <= nowMs;
+}
+
+NotificationScheduler::NotificationScheduler() : NotificationScheduler(Limits()) {}
+
+NotificationScheduler::NotificationScheduler(const Limits& limits)
+    : m_limits(limits)
+    , m_overall(limits.overallBurst, limits.overallRefillMs)
+{
+}
+
+void NotificationScheduler::post(const Notification& notification) {
+    if (m_pending.contains(notification.key)) {
+        ++m_coalesced;
+    } else {
+        m_order.append(notification.key);
+    }
+    m_pending.insert(notification.key, notification);
+}
+
+TokenBucket& NotificationScheduler::deviceBucket(const QString& key) {
+    auto it = m_devices.find(key);
+    if (it == m_devices.end()) {
+        it = m_devices.insert(key, TokenBucket(m_limits.deviceBurst, m_limits.deviceRefillMs));
+    }
+    return *it;
+}
+
+bool NotificationScheduler::take(qint64 nowMs, Notification *popup) {
+    if (m_order.isEmpty() || !m_overall.available(nowMs)) {
+        return false;
+    }
+
+    QStringList ready;
+    for (const QString& key : std::as_const(m_order)) {
+        if (deviceBucket(key).available(nowMs)) {
+            ready.append(key);
+        }
+    }
+    if (ready.isEmpty()) {
+        return false;
+    }
+
+    m_overall.take(nowMs);
+    if (ready.size() == 1) {
+        *popup = m_pending.take(ready.first());
+    } else {
+        // One popup for the whole batch, at the highest urgency in it
+        QStringList lines;
+        int urgency = 0;
+        for (const QString& key : std::as_const(ready)) {
+            const Notification notification = m_pending.take(key);
+            lines.append(notification.summary + ": " + notification.body);
+            urgency = qMax(urgency, notification.urgency);
+        }
+        popup->key = kSummaryKey;
+        popup->summary = QString("%1 Headset Notifications").arg(ready.size());
+        popup->body = lines.join('\n');
+        popup->urgency = urgency;
+        m_coalesced += ready.size() - 1;
+    }
+    popup->keys = ready;
+
+    for (const QString& key : std::as_const(ready)) {
+        deviceBucket(key).take(nowMs);
+        m_order.removeOne(key);
+    }
+
+    // A refilled bucket is the same as none, so devices seen once cost nothing
+    for (auto it = m_devices.begin(); it != m_devices.end();) {
+        if (!m_pending.contains(it.key()) && it->isFull(nowMs)) {
+            it = m_devices.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return true;
+}
+
+qint64 NotificationScheduler::availableAt(qint64 nowMs) const {
+    if (m_order.isEmpty()) {
+        return -1;
+    }
+
+    qint64 device = -1;
+    for (const QString& key : m_order) {
+        const auto it = m_devices.constFind(key);
+        const qint64 at = it == m_devices.constEnd() ? nowMs : it->availableAt(nowMs);
+        device = device < 0 ? at : qMin(device, at);
+    }
+    return qMax(device, m_overall.availableAt(nowMs));
+}
+
+void NotificationScheduler::clear() {
+    m_pending.clear();
+    m_order.clear();
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <limits>
+
+/**
+ * @class TokenBucket
+ * @brief Rate limit allowing bursts of up to capacity, then one per refill interval
+ *
+ * Kept as the time the bucket will be full again rather than as a token
+ * count, so it needs no periodic refill and stays exact in integers.
+ */
+class TokenBucket {
+public:
+    /**
+     * @param capacity Tokens in a full bucket, the largest burst
+     * @param refillMs Time to regain one token; 0 or less means no limit
+     */
+    TokenBucket(int capacity = 1, qint64 refillMs = 0);
+
+    /** @brief True if a token is available at @p nowMs */
+    bool available(qint64 nowMs) const;
+
+    /** @brief Consumes one token; call only after available() */
+    void take(qint64 nowMs);
+
+    /** @brief Earliest time a token is available, @p nowMs if one is already */
+    qint64 availableAt(qint64 nowMs) const;
+
+    /** @brief True if the bucket refilled completely, so forgetting it loses nothing */
+    bool isFull(qint64 nowMs) const;
+
+private:
+    qint64 m_refillMs;
+    qint64 m_burstMs;  ///< Refill time of all tokens but one
+    qint64 m_fullAtMs = std::numeric_limits<qint64>::min();
+};
+
+/**
+ * @class NotificationScheduler
+ * @brief Decides which notifications are shown, merged or held back
+ *
+ * Notifications are posted under a key, normally the device's D-Bus path.
+ * A newer one replaces one still pending under the same key, so a device
+ * that flaps between charging and discharging ends up with its latest
+ * state rather than a popup per change. take() hands out what may be shown
+ * now: a single pending notification as is, several as one summary
+ * listing them all. Every popup costs a token from the overall bucket and
+ * every device in it one from that device's bucket; a device without a
+ * token stays pending until availableAt(). Times are milliseconds on any
+ * monotonic clock, and nothing is lost by holding back.
+ */
+class NotificationScheduler {
+public:
+    /** @brief Key of the summary popup that merges several devices */
+    static const QString kSummaryKey;
+
+    struct Limits {
+        int deviceBurst = 2;              ///< Popups per device in a burst
+        qint64 deviceRefillMs = 60 * 1000;  ///< Then one per device per interval
+        int overallBurst = 4;             ///< Popups overall in a burst
+        qint64 overallRefillMs = 15 * 1000; ///< Then one overall per interval
+    };
+
+    struct Notification {
+        QString key;
+        QString summary;
+        QString body;
+        int urgency = 1;   ///< 0=low, 1=normal, 2=critical
+        QStringList keys;  ///< Devices a popup covers (set by take())
+    };
+
+    NotificationScheduler();
+    explicit NotificationScheduler(const Limits& limits);
+
+    /**
+     * @brief Queues a notification, replacing one pending under its key
+     */
+    void post(const Notification& notification);
+
+    /**
+     * @brief Takes the popup that may be shown at @p nowMs, if any
+     * @param popup Receives one notification or the summary of several
+     * @return False if nothing is pending or the limits hold everything back
+     */
+    bool take(qint64 nowMs, Notification *popup);
+
+    /**
+     * @brief When take() will next return something
+     * @return -1 if nothing is pending
+     */
+    qint64 availableAt(qint64 nowMs) const;
+
+    /** @brief Drops everything pending; the limits keep their state */
+    void clear();
+
+    bool hasPending() const { return !m_order.isEmpty(); }
+    int pendingCount() const { return m_order.size(); }
+
+    /** @brief Notifications merged into a summary or replaced while pending */
+    quint64 coalescedCount() const { return m_coalesced; }
+
+private:
+    TokenBucket& deviceBucket(const QString& key);
+
+    Limits m_limits;
+    TokenBucket m_overall;
+    QHash<QString, TokenBucket> m_devices;
+    QHash<QString, Notification> m_pending;
+    QStringList m_order;  ///< Pending keys, oldest first
+    quint64 m_coalesced = 0;
+};
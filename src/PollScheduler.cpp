@@ -0,0 +1,130 @@
+#include "PollScheduler.h"
+
+PollScheduler::PollScheduler(QObject *parent) : QObject(parent) {
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &PollScheduler::onTimeout);
+}
+
+void PollScheduler::setMaximumInterval(int intervalMs) {
+    if (intervalMs == m_maximumInterval) {
+        return;
+    }
+    m_maximumInterval = intervalMs;
+    reschedule();
+}
+
+void PollScheduler::setLowBatteryThreshold(int threshold) {
+    m_lowBatteryThreshold = threshold;
+}
+
+void PollScheduler::updateDevices(const QList<HeadsetDevice>& devices) {
+    m_headsetCount = devices.size();
+
+    // Signals should report these crossings; a missed one is worth a faster poll
+    m_nearThreshold = false;
+    for (const HeadsetDevice& device : devices) {
+        if (!device.isPresent) {
+            continue;
+        }
+        if (device.isCharging ? device.battery >= 90
+                              : device.battery <= m_lowBatteryThreshold + kThresholdMargin) {
+            m_nearThreshold = true;
+            break;
+        }
+    }
+
+    reschedule();
+}
+
+void PollScheduler::noteSignal() {
+    ++m_signalCount;
+}
+
+void PollScheduler::pollFinished(bool foundChanges) {
+    if (!m_pollInFlight) {
+        return;
+    }
+    m_pollInFlight = false;
+
+    // Changes are only "missed" if no signal arrived while the poll ran
+    if (foundChanges && m_signalCount == m_signalCountAtPoll) {
+        m_pollsUntilRecovered = kRecoveryPolls;
+    } else if (m_pollsUntilRecovered > 0) {
+        --m_pollsUntilRecovered;
+    }
+    m_verified = true;
+
+    reschedule();
+}
+
+void PollScheduler::onTimeout() {
+    m_pollInFlight = true;
+    m_signalCountAtPoll = m_signalCount;
+    emit pollDue();
+
+    // Re-armed right away, so a poll whose result never arrives cannot stop polling
+    if (m_interval > 0) {
+        m_timer.start(m_interval);
+    }
+}
+
+void PollScheduler::reschedule() {
+    Reason reason;
+    int interval;
+    if (m_maximumInterval <= 0) {
+        reason = Reason::Disabled;
+        interval = 0;
+    } else if (m_pollsUntilRecovered > 0) {
+        reason = Reason::MissedEvents;
+        interval = kMissedEventsInterval;
+    } else if (m_nearThreshold) {
+        reason = Reason::NearThreshold;
+        interval = kNearThresholdInterval;
+    } else if (!m_verified) {
+        reason = Reason::Unverified;
+        interval = kUnverifiedInterval;
+    } else if (m_headsetCount == 0) {
+        reason = Reason::NoHeadsets;
+        interval = kNoHeadsetsInterval;
+    } else {
+        reason = Reason::SignalsHealthy;
+        interval = kHealthyInterval;
+    }
+    interval = qMin(interval, m_maximumInterval);
+
+    if (interval == m_interval && reason == m_reason) {
+        return;
+    }
+
+    const bool restart = interval != m_interval;
+    m_interval = interval;
+    m_reason = reason;
+
+    if (interval <= 0) {
+        m_timer.stop();
+    } else if (restart || !m_timer.isActive()) {
+        // Second-granularity timers are enough for minutes and wake up far less
+        m_timer.setTimerType(interval >= 60 * 1000 ? Qt::VeryCoarseTimer : Qt::CoarseTimer);
+        m_timer.start(interval);
+    }
+
+    emit intervalChanged(m_interval, m_reason);
+}
+
+QString PollScheduler::reasonName(Reason reason) {
+    switch (reason) {
+    case Reason::Disabled:
+        return QStringLiteral("polling disabled");
+    case Reason::MissedEvents:
+        return QStringLiteral("signals missed changes");
+    case Reason::NearThreshold:
+        return QStringLiteral("battery near threshold");
+    case Reason::Unverified:
+        return QStringLiteral("signals not verified yet");
+    case Reason::SignalsHealthy:
+        return QStringLiteral("signals healthy");
+    case Reason::NoHeadsets:
+        return QStringLiteral("no headsets");
+    }
+    return QString();
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include "HeadsetDevice.h"
+
+/**
+ * @class PollScheduler
+ * @brief Chooses how often the fallback enumeration runs
+ *
+ * UPower signals normally deliver every change, so the fallback poll only
+ * has to catch what they miss. The scheduler verifies that by checking
+ * whether a poll found changes no signal had reported, and picks an
+ * interval from that and from the device state: tight while events go
+ * missing or a battery nears the low threshold, relaxed once signals have
+ * proven reliable, and longest with no headset at all. The configured
+ * maximum always caps the result. Coarse timers let the kernel batch the
+ * wakeups with others.
+ */
+class PollScheduler : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * @brief Why the current interval was chosen, tightest first
+     */
+    enum class Reason {
+        Disabled,       ///< Maximum interval is 0; no polling
+        MissedEvents,   ///< A recent poll found changes no signal reported
+        NearThreshold,  ///< A battery is close to the low threshold or to full
+        Unverified,     ///< No poll has confirmed the signals yet
+        SignalsHealthy, ///< Polls keep agreeing with the signals
+        NoHeadsets,     ///< Nothing to watch but DeviceAdded
+    };
+    Q_ENUM(Reason)
+
+    static constexpr int kMissedEventsInterval = 15 * 1000;
+    static constexpr int kNearThresholdInterval = 60 * 1000;
+    static constexpr int kUnverifiedInterval = 60 * 1000;
+    static constexpr int kHealthyInterval = 5 * 60 * 1000;
+    static constexpr int kNoHeadsetsInterval = 15 * 60 * 1000;
+
+    /** @brief Percent above the low threshold that counts as near it */
+    static constexpr int kThresholdMargin = 5;
+
+    /** @brief Clean polls needed after a miss before relaxing again */
+    static constexpr int kRecoveryPolls = 3;
+
+    explicit PollScheduler(QObject *parent = nullptr);
+
+    /**
+     * @brief Sets the upper bound for every interval (general/updateInterval)
+     * @param intervalMs Maximum in milliseconds; 0 or less disables polling
+     */
+    void setMaximumInterval(int intervalMs);
+
+    /**
+     * @brief Sets the battery percentage low battery notifications fire at
+     */
+    void setLowBatteryThreshold(int threshold);
+
+    /**
+     * @brief Re-evaluates the interval for the current headsets
+     */
+    void updateDevices(const QList<HeadsetDevice>& devices);
+
+    /**
+     * @brief Records that a UPower signal was received
+     */
+    void noteSignal();
+
+    /**
+     * @brief Reports the result of the enumeration started by pollDue()
+     * @param foundChanges True if the poll found state the cache did not have
+     */
+    void pollFinished(bool foundChanges);
+
+    /** @brief True between pollDue() and pollFinished() */
+    bool isPollInFlight() const { return m_pollInFlight; }
+
+    /** @brief Current interval in milliseconds, 0 while disabled */
+    int interval() const { return m_interval; }
+    Reason reason() const { return m_reason; }
+
+    /**
+     * @brief Short human-readable description of a reason
+     */
+    static QString reasonName(Reason reason);
+
+signals:
+    /**
+     * @brief A fallback enumeration should run now
+     */
+    void pollDue();
+
+    /**
+     * @brief The interval or the reason for it changed
+     */
+    void intervalChanged(int intervalMs, PollScheduler::Reason reason);
+
+private slots:
+    void onTimeout();
+
+private:
+    void reschedule();
+
+    QTimer m_timer;
+    int m_maximumInterval = 0;
+    int m_lowBatteryThreshold = 20;
+    int m_interval = 0;
+    Reason m_reason = Reason::Disabled;
+
+    int m_headsetCount = 0;
+    bool m_nearThreshold = false;
+    bool m_verified = false;
+    int m_pollsUntilRecovered = 0;
+
+    bool m_pollInFlight = false;
+    quint64 m_signalCount = 0;
+    quint64 m_signalCountAtPoll = 0;
+};
@@ -0,0 +1,340 @@
+#include "PowerSupplyBackend.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <cerrno>
+#include <cstring>
+#include <linux/netlink.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+// Netlink multicast group the kernel sends uevents to
+constexpr unsigned kKernelUeventGroup = 1;
+
+QByteArray readAttribute(const QString& directory, const char *attribute) {
+    QFile file(directory + '/' + QLatin1String(attribute));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll().trimmed();
+}
+
+// Same mapping UPower applies to entries without a numeric capacity
+double capacityFromLevel(const QByteArray& level) {
+    if (level == "Full") return 100.0;
+    if (level == "High") return 70.0;
+    if (level == "Normal") return 55.0;
+    if (level == "Low") return 10.0;
+    if (level == "Critical") return 5.0;
+    return 0.0;
+}
+}
+
+PowerSupplyBackend::PowerSupplyBackend(Classify classify, const QString& root, QObject *parent)
+    : QObject(parent)
+    , m_classify(std::move(classify))
+    , m_root(root)
+{
+}
+
+PowerSupplyBackend::~PowerSupplyBackend() {
+    if (m_notifyFd >= 0) {
+        ::close(m_notifyFd);
+    }
+}
+
+QString PowerSupplyBackend::objectPathFor(const QString& name) {
+    static const char kHex[] = "0123456789abcdef";
+    QString path = QLatin1String(kObjectPathPrefix);
+    for (const char c : name.toUtf8()) {
+        const uchar u = uchar(c);
+        if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_') {
+            path += QLatin1Char(c);
+        } else {
+            path += QLatin1Char('_');
+            path += QLatin1Char(kHex[u >> 4]);
+            path += QLatin1Char(kHex[u & 0xf]);
+        }
+    }
+    return path;
+}
+
+QString PowerSupplyBackend::entryNameOf(const QString& nativePath) {
+    return nativePath.section('/', -1);
+}
+
+const HeadsetDevice* PowerSupplyBackend::deviceNamed(const QString& name) const {
+    const auto it = m_headsets.constFind(name);
+    return it == m_headsets.constEnd() ? nullptr : &it.value();
+}
+
+bool PowerSupplyBackend::start() {
+    // sysfs attributes never raise inotify events; only uevents tell us
+    const bool realSysfs = m_root.startsWith(QLatin1String("/sys/"));
+    const bool watching = realSysfs ? setupNetlink() : setupInotify();
+    if (!watching) {
+        qWarning() << "No change notification for" << m_root << "- power_supply entries are only read on rescan";
+    }
+
+    rescan();
+    return watching;
+}
+
+void PowerSupplyBackend::rescan() {
+    QSet<QString> names;
+    const QStringList entries = QDir(m_root).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& name : entries) {
+        names.insert(name);
+        if (m_rootWatch >= 0) {
+            watchEntry(name);
+        }
+    }
+    for (auto it = m_headsets.constBegin(); it != m_headsets.constEnd(); ++it) {
+        names.insert(it.key());
+    }
+    refreshEntries(names);
+}
+
+bool PowerSupplyBackend::readEntry(const QString& name, HeadsetDevice *device) {
+    const QString directory = m_root + '/' + name;
+
+    // Laptop batteries and AC adapters have no scope or scope "System"
+    if (readAttribute(directory, "type") != "Battery" || readAttribute(directory, "scope") != "Device") {
+        return false;
+    }
+
+    QString model = QString::fromUtf8(readAttribute(directory, "model_name"));
+    if (model.isEmpty()) {
+        model = QString::fromUtf8(readAttribute(directory, "manufacturer"));
+    }
+
+    const QString objectPath = objectPathFor(name);
+    if (!m_classify(objectPath, name, model)) {
+        return false;
+    }
+
+    device->model = model;
+    device->nativePath = name;
+    device->dbusPath = objectPath;
+
+    bool numeric = false;
+    const int capacity = readAttribute(directory, "capacity").toInt(&numeric);
+    device->battery = numeric ? qBound(0, capacity, 100) : capacityFromLevel(readAttribute(directory, "capacity_level"));
+    device->isCharging = readAttribute(directory, "status") == "Charging";
+
+    const QByteArray present = readAttribute(directory, "present");
+    device->isPresent = present.isEmpty() || present != "0";
+
+    // A Bluetooth adapter usually hangs off USB itself, so look for it first
+    const QString parent = QFileInfo(directory + QLatin1String("/device")).canonicalFilePath();
+    if (parent.contains(QLatin1String("/bluetooth/"))) {
+        device->connectionType = ConnectionType::Bluetooth;
+    } else if (parent.contains(QLatin1String("/usb"))) {
+        device->connectionType = ConnectionType::USB;
+    } else {
+        device->connectionType = ConnectionType::Unknown;
+    }
+    return true;
+}
+
+void PowerSupplyBackend::refreshEntries(const QSet<QString>& names) {
+    bool membershipChanged = false;
+
+    for (const QString& name : names) {
+        HeadsetDevice device;
+        const bool isHeadset = readEntry(name, &device);
+        auto it = m_headsets.find(name);
+
+        if (!isHeadset) {
+            if (it != m_headsets.end()) {
+                m_headsets.erase(it);
+                membershipChanged = true;
+            }
+            continue;
+        }
+
+        if (it == m_headsets.end()) {
+            m_headsets.insert(name, device);
+            membershipChanged = true;
+            continue;
+        }
+
+        // Identity changes go through a full update like DeviceAdded does
+        if (it->model != device.model || it->connectionType != device.connectionType) {
+            *it = device;
+            membershipChanged = true;
+            continue;
+        }
+
+        QVariantMap properties;
+        if (it->battery != device.battery) {
+            properties.insert(QStringLiteral("Percentage"), device.battery);
+        }
+        if (it->isCharging != device.isCharging) {
+            properties.insert(QStringLiteral("IsCharging"), device.isCharging);
+        }
+        if (it->isPresent != device.isPresent) {
+            properties.insert(QStringLiteral("IsPresent"), device.isPresent);
+        }
+        *it = device;
+
+        if (!properties.isEmpty()) {
+            emit devicePropertiesChanged(device.dbusPath, properties);
+        }
+    }
+
+    if (membershipChanged) {
+        emit devicesChanged();
+    }
+}
+
+bool PowerSupplyBackend::setupNetlink() {
+    const int fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        return false;
+    }
+
+    sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = kKernelUeventGroup;
+    if (::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    m_notifyFd = fd;
+    m_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &PowerSupplyBackend::onNetlinkReadable);
+    return true;
+}
+
+bool PowerSupplyBackend::setupInotify() {
+    const int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    const int rootWatch = ::inotify_add_watch(fd, QFile::encodeName(m_root).constData(),
+                                              IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+    if (rootWatch < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    m_notifyFd = fd;
+    m_rootWatch = rootWatch;
+    m_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &PowerSupplyBackend::onInotifyReadable);
+    return true;
+}
+
+void PowerSupplyBackend::watchEntry(const QString& name) {
+    const int watch = ::inotify_add_watch(m_notifyFd, QFile::encodeName(m_root + '/' + name).constData(),
+                                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+    if (watch >= 0) {
+        m_watches.insert(watch, name);
+    }
+}
+
+void PowerSupplyBackend::onNetlinkReadable() {
+    QSet<QString> names;
+    bool overflowed = false;
+    char buffer[8192];
+
+    for (;;) {
+        sockaddr_nl sender = {};
+        socklen_t senderLength = sizeof(sender);
+        const ssize_t length = ::recvfrom(m_notifyFd, buffer, sizeof(buffer) - 1, 0,
+                                          reinterpret_cast<sockaddr *>(&sender), &senderLength);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // The receive buffer overflowed and uevents were dropped
+            if (errno == ENOBUFS) {
+                overflowed = true;
+                continue;
+            }
+            break;
+        }
+
+        // Only the kernel may speak on this group
+        if (sender.nl_pid != 0) {
+            continue;
+        }
+        buffer[length] = '\0';
+
+        // "action@devpath" followed by NUL-separated KEY=value pairs
+        bool powerSupply = false;
+        QString name;
+        QString devpathName;
+        for (const char *field = buffer; field < buffer + length; field += std::strlen(field) + 1) {
+            if (std::strcmp(field, "SUBSYSTEM=power_supply") == 0) {
+                powerSupply = true;
+            } else if (std::strncmp(field, "POWER_SUPPLY_NAME=", 18) == 0) {
+                name = QString::fromUtf8(field + 18);
+            } else if (std::strncmp(field, "DEVPATH=", 8) == 0) {
+                devpathName = QString::fromUtf8(field + 8).section('/', -1);
+            }
+        }
+        if (powerSupply) {
+            names.insert(name.isEmpty() ? devpathName : name);
+        }
+    }
+
+    if (overflowed) {
+        rescan();
+        return;
+    }
+
+    names.remove(QString());
+    if (!names.isEmpty()) {
+        refreshEntries(names);
+    }
+}
+
+void PowerSupplyBackend::onInotifyReadable() {
+    QSet<QString> names;
+    alignas(inotify_event) char buffer[4096];
+
+    for (;;) {
+        const ssize_t length = ::read(m_notifyFd, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            break;
+        }
+
+        for (const char *p = buffer; p < buffer + length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->wd == m_rootWatch) {
+                if (event->len == 0) {
+                    continue;
+                }
+                const QString name = QFile::decodeName(event->name);
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    watchEntry(name);
+                }
+                names.insert(name);
+            } else if (event->mask & IN_IGNORED) {
+                m_watches.remove(event->wd);
+            } else {
+                const QString name = m_watches.value(event->wd);
+                if (!name.isEmpty()) {
+                    names.insert(name);
+                }
+            }
+        }
+    }
+
+    if (!names.isEmpty()) {
+        refreshEntries(names);
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVariantMap>
+#include <functional>
+#include "HeadsetDevice.h"
+
+class QSocketNotifier;
+
+/**
+ * @class PowerSupplyBackend
+ * @brief Reads peripheral batteries straight from /sys/class/power_supply
+ *
+ * Many USB and HID headsets show up in power_supply before UPower picks
+ * them up, or never reach UPower at all. Entries with scope "Device" are
+ * read once at start() and then only re-read when the kernel reports that
+ * they changed: through the uevent netlink socket for the real sysfs, or
+ * through inotify for any other root, which lets tests and benchmarks use
+ * a plain directory tree.
+ *
+ * Devices get an object path under kObjectPathPrefix so they share the
+ * device cache, the D-Bus export and the overrides with UPower devices.
+ * Changes are reported with UPower property names (Percentage, IsCharging,
+ * IsPresent) so they go through the same update path as PropertiesChanged.
+ */
+class PowerSupplyBackend : public QObject {
+    Q_OBJECT
+public:
+    static constexpr const char *kDefaultRoot = "/sys/class/power_supply";
+    static constexpr const char *kObjectPathPrefix = "/org/mewset/HeadsetStatus/power_supply/";
+
+    /**
+     * @brief Decides whether an entry is a headset
+     * @param objectPath Object path the device gets (see objectPathFor())
+     * @param nativePath Entry name, e.g. "hidpp_battery_0"
+     * @param model model_name of the entry
+     */
+    using Classify = std::function<bool(const QString& objectPath, const QString& nativePath,
+                                        const QString& model)>;
+
+    /**
+     * @param classify Headset decision for peripheral batteries
+     * @param root Directory holding one subdirectory per power supply
+     */
+    explicit PowerSupplyBackend(Classify classify, const QString& root = kDefaultRoot,
+                                QObject *parent = nullptr);
+    ~PowerSupplyBackend() override;
+
+    /**
+     * @brief Starts change detection and reads every entry
+     * @return False if no change notification could be set up; devices()
+     *         is still filled, but only refreshed by rescan()
+     */
+    bool start();
+
+    /**
+     * @brief Re-reads every entry, e.g. after a classification override changed
+     */
+    void rescan();
+
+    /**
+     * @brief Headsets found under the root, ordered by entry name
+     */
+    QList<HeadsetDevice> devices() const { return m_headsets.values(); }
+
+    /**
+     * @brief Headset for an entry name, or nullptr
+     */
+    const HeadsetDevice* deviceNamed(const QString& name) const;
+
+    QString root() const { return m_root; }
+
+    /**
+     * @brief Stable object path for an entry; characters outside [A-Za-z0-9_]
+     *        are escaped as _xx
+     */
+    static QString objectPathFor(const QString& name);
+
+    /**
+     * @brief power_supply entry name of a UPower NativePath, or empty
+     *
+     * UPower reports either the bare name or the full sysfs path.
+     */
+    static QString entryNameOf(const QString& nativePath);
+
+signals:
+    /**
+     * @brief A headset entry appeared, disappeared or changed its model
+     */
+    void devicesChanged();
+
+    /**
+     * @brief Battery, charging or presence of a known headset changed
+     * @param dbusPath Object path of the device
+     * @param properties Changed values under their UPower property names
+     */
+    void devicePropertiesChanged(const QString& dbusPath, const QVariantMap& properties);
+
+private:
+    bool readEntry(const QString& name, HeadsetDevice *device);
+    void refreshEntries(const QSet<QString>& names);
+    bool setupNetlink();
+    bool setupInotify();
+    void watchEntry(const QString& name);
+    void onNetlinkReadable();
+    void onInotifyReadable();
+
+    Classify m_classify;
+    QString m_root;
+    QMap<QString, HeadsetDevice> m_headsets;
+    int m_notifyFd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QHash<int, QString> m_watches;
+    int m_rootWatch = -1;
+};
@@ -0,0 +1,86 @@
+#include "ReplaySource.h"
+
+ReplaySource::ReplaySource(QObject *parent) : DeviceSource(parent) {
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &ReplaySource::playDue);
+}
+
+bool ReplaySource::load(const QString& path, QString *error) {
+    QList<DeviceTraceEvent> events;
+    if (!readDeviceTrace(path, &events, error)) {
+        return false;
+    }
+    setEvents(events);
+    return true;
+}
+
+void ReplaySource::setEvents(const QList<DeviceTraceEvent>& events) {
+    m_timer.stop();
+    m_events = events;
+    m_position = 0;
+    m_state.replaceAll({});
+}
+
+void ReplaySource::start(Speed speed) {
+    m_speed = speed;
+    m_position = 0;
+    m_state.replaceAll({});
+    m_clock.start();
+    m_timer.start(0);
+}
+
+void ReplaySource::playDue() {
+    if (m_speed == Speed::AsFastAsPossible) {
+        // One event per iteration lets queued work of the previous one run first
+        if (!isFinished()) {
+            play(m_events.at(m_position++));
+        }
+    } else {
+        const qint64 nowUs = m_clock.nsecsElapsed() / 1000;
+        while (!isFinished() && m_events.at(m_position).timeUs <= nowUs) {
+            play(m_events.at(m_position++));
+        }
+    }
+
+    if (isFinished()) {
+        emit finished();
+        return;
+    }
+
+    if (m_speed == Speed::AsFastAsPossible) {
+        m_timer.start(0);
+    } else {
+        const qint64 waitUs = m_events.at(m_position).timeUs - m_clock.nsecsElapsed() / 1000;
+        m_timer.start(int(qMax<qint64>(0, (waitUs + 999) / 1000)));
+    }
+}
+
+void ReplaySource::play(const DeviceTraceEvent& event) {
+    switch (event.type) {
+    case DeviceTraceEvent::Type::Snapshot:
+        m_state.replaceAll(event.devices);
+        emit devicesReady(event.devices);
+        break;
+    case DeviceTraceEvent::Type::DevicesChanged:
+        emit devicesChanged();
+        break;
+    case DeviceTraceEvent::Type::PropertiesChanged:
+        m_state.applyProperties(event.dbusPath, event.properties);
+        emit devicePropertiesChanged(event.dbusPath, event.properties);
+        break;
+    }
+}
+
+void ReplaySource::requestDevices() {
+    if (m_replyPending) {
+        return;
+    }
+    m_replyPending = true;
+    QMetaObject::invokeMethod(this, &ReplaySource::answerRequest, Qt::QueuedConnection);
+}
+
+void ReplaySource::answerRequest() {
+    m_replyPending = false;
+    emit devicesReady(m_state.devices());
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include <QTimer>
+#include "DeviceSource.h"
+#include "DeviceStateCache.h"
+#include "DeviceTrace.h"
+
+/**
+ * @class ReplaySource
+ * @brief DeviceSource that plays back a trace written by TraceRecorder
+ *
+ * Recorded snapshots, membership changes and property changes are emitted
+ * in their recorded order, either at their recorded times or one per event
+ * loop iteration, as fast as the application consumes them. Enumerations
+ * the application requests itself are answered from the state replayed so
+ * far, so they never add or undo a change the trace does not contain.
+ */
+class ReplaySource : public DeviceSource {
+    Q_OBJECT
+public:
+    enum class Speed {
+        RealTime,          ///< Keep the recorded gaps between events
+        AsFastAsPossible,  ///< Next event as soon as the event loop is idle
+    };
+
+    explicit ReplaySource(QObject *parent = nullptr);
+
+    /**
+     * @brief Loads a trace file
+     * @param error Receives a description on failure (may be null)
+     */
+    bool load(const QString& path, QString *error = nullptr);
+
+    /**
+     * @brief Uses events that are already in memory, e.g. a synthetic trace
+     */
+    void setEvents(const QList<DeviceTraceEvent>& events);
+
+    /**
+     * @brief Starts playback from the first event
+     */
+    void start(Speed speed);
+
+    int eventCount() const { return m_events.size(); }
+    int position() const { return m_position; }
+    bool isFinished() const { return m_position >= m_events.size(); }
+
+    /**
+     * @brief Answers with the replayed state after returning to the event loop
+     */
+    void requestDevices() override;
+    bool isRefreshPending() const override { return m_replyPending; }
+
+signals:
+    /**
+     * @brief Emitted once the last event was played
+     */
+    void finished();
+
+private:
+    void playDue();
+    void play(const DeviceTraceEvent& event);
+    void answerRequest();
+
+    QList<DeviceTraceEvent> m_events;
+    int m_position = 0;
+    Speed m_speed = Speed::AsFastAsPossible;
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+    DeviceStateCache m_state;
+    bool m_replyPending = false;
+};
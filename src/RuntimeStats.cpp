@@ -0,0 +1,215 @@
+#include "RuntimeStats.h"
+#include <QSocketNotifier>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+const QList<qint64> kLatencyBoundsUs = {
+    10, 25, 50, 100, 250, 500,
+    1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000,
+};
+
+const QList<qint64> kCallCountBounds = {1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 64, 128};
+
+// Written by the signal handler, read on the event loop
+int g_signalPipe[2] = {-1, -1};
+
+void appendCounter(QString& out, const char *name, const StatCounter& counter) {
+    out += QLatin1String(name) + QLatin1Char(' ') + QString::number(counter.value()) + QLatin1Char('\n');
+}
+
+void appendHistogram(QString& out, const char *name, const StatHistogram& histogram) {
+    const quint64 count = histogram.count();
+    out += QLatin1String(name) + QLatin1String(" count=") + QString::number(count);
+    if (count > 0) {
+        out += QLatin1String(" mean=") + QString::number(histogram.sum() / qint64(count))
+            + QLatin1String(" p50<=") + QString::number(histogram.quantileBound(0.5))
+            + QLatin1String(" p90<=") + QString::number(histogram.quantileBound(0.9))
+            + QLatin1String(" p99<=") + QString::number(histogram.quantileBound(0.99))
+            + QLatin1String(" max=") + QString::number(histogram.max());
+
+        // Empty buckets are left out to keep the line short
+        out += QLatin1String(" buckets=");
+        bool first = true;
+        for (int i = 0; i < histogram.bucketCount(); ++i) {
+            const quint64 value = histogram.bucketValue(i);
+            if (value == 0) {
+                continue;
+            }
+            if (!first) {
+                out += QLatin1Char(',');
+            }
+            first = false;
+            const qint64 bound = histogram.bucketBound(i);
+            out += bound < 0 ? QStringLiteral("inf") : QString::number(bound);
+            out += QLatin1Char(':') + QString::number(value);
+        }
+    }
+    out += QLatin1Char('\n');
+}
+}
+
+StatHistogram::StatHistogram(const QList<qint64>& bounds) {
+    m_boundCount = int(qMin<qsizetype>(bounds.size(), kMaxBounds));
+    for (int i = 0; i < m_boundCount; ++i) {
+        m_bounds[i] = bounds.at(i);
+    }
+}
+
+void StatHistogram::record(qint64 value) {
+    int index = 0;
+    while (index < m_boundCount && value > m_bounds[index]) {
+        ++index;
+    }
+    m_buckets[index].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    qint64 max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+qint64 StatHistogram::quantileBound(double fraction) const {
+    const quint64 count = this->count();
+    if (count == 0) {
+        return 0;
+    }
+
+    // The epsilon keeps 0.99 * 100 from rounding up to rank 100
+    const quint64 rank = qMax<quint64>(1, quint64(std::ceil(fraction * double(count) - 1e-9)));
+    quint64 seen = 0;
+    for (int i = 0; i < m_boundCount; ++i) {
+        seen += bucketValue(i);
+        if (seen >= rank) {
+            return m_bounds[i];
+        }
+    }
+    return max();
+}
+
+void StatHistogram::reset() {
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+RuntimeStats& RuntimeStats::global() {
+    static RuntimeStats stats;
+    return stats;
+}
+
+RuntimeStats::RuntimeStats()
+    : dbusCallsPerEnumeration(kCallCountBounds)
+    , enumerationUs(kLatencyBoundsUs)
+    , statusUpdateUs(kLatencyBoundsUs)
+    , propertyChangeUs(kLatencyBoundsUs)
+    , iconRenderUs(kLatencyBoundsUs)
+{
+    m_uptime.start();
+}
+
+QString RuntimeStats::format() const {
+    QString out;
+    out.reserve(2048);
+    out += QLatin1String("uptime_s ") + QString::number(m_uptime.elapsed() / 1000) + QLatin1Char('\n');
+
+    appendCounter(out, "status_update_requests", statusUpdateRequests);
+    appendCounter(out, "status_updates_run", statusUpdatesRun);
+    const quint64 runs = statusUpdatesRun.value();
+    out += QLatin1String("debounce_coalescing_ratio ")
+        + (runs > 0 ? QString::number(double(statusUpdateRequests.value()) / double(runs), 'f', 2)
+                    : QStringLiteral("0"))
+        + QLatin1Char('\n');
+    appendCounter(out, "property_changes", propertyChanges);
+    appendCounter(out, "enumerations", enumerations);
+    appendCounter(out, "dbus_calls", dbusCalls);
+    appendCounter(out, "icon_renders", iconRenders);
+    appendCounter(out, "menu_rebuilds", menuRebuilds);
+    appendCounter(out, "menu_patches", menuPatches);
+    appendCounter(out, "notifications_sent", notificationsSent);
+    appendCounter(out, "notifications_replaced", notificationsReplaced);
+    appendCounter(out, "notifications_coalesced", notificationsCoalesced);
+
+    appendHistogram(out, "dbus_calls_per_enumeration", dbusCallsPerEnumeration);
+    appendHistogram(out, "enumeration_us", enumerationUs);
+    appendHistogram(out, "status_update_us", statusUpdateUs);
+    appendHistogram(out, "property_change_us", propertyChangeUs);
+    appendHistogram(out, "icon_render_us", iconRenderUs);
+    return out;
+}
+
+void RuntimeStats::reset() {
+    for (StatCounter *counter : {&statusUpdateRequests, &statusUpdatesRun, &propertyChanges,
+                                 &enumerations, &dbusCalls, &iconRenders, &menuRebuilds,
+                                 &menuPatches, &notificationsSent, &notificationsReplaced,
+                                 &notificationsCoalesced}) {
+        counter->reset();
+    }
+    for (StatHistogram *histogram : {&dbusCallsPerEnumeration, &enumerationUs, &statusUpdateUs,
+                                     &propertyChangeUs, &iconRenderUs}) {
+        histogram->reset();
+    }
+    m_uptime.start();
+}
+
+RuntimeStatsReporter::RuntimeStatsReporter(QObject *parent) : QObject(parent) {
+}
+
+RuntimeStatsReporter::~RuntimeStatsReporter() {
+    if (m_signalNumber != 0) {
+        std::signal(m_signalNumber, SIG_DFL);
+    }
+}
+
+bool RuntimeStatsReporter::installSignalHandler(int signalNumber) {
+    if (g_signalPipe[0] < 0 && ::pipe2(g_signalPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        return false;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = &RuntimeStatsReporter::handleSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (::sigaction(signalNumber, &action, nullptr) != 0) {
+        return false;
+    }
+    m_signalNumber = signalNumber;
+
+    if (!m_notifier) {
+        m_notifier = new QSocketNotifier(g_signalPipe[0], QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &RuntimeStatsReporter::onSignalPipe);
+    }
+    return true;
+}
+
+void RuntimeStatsReporter::handleSignal(int) {
+    // Only async-signal-safe calls here
+    const int savedErrno = errno;
+    const char byte = 1;
+    [[maybe_unused]] const ssize_t written = ::write(g_signalPipe[1], &byte, 1);
+    errno = savedErrno;
+}
+
+void RuntimeStatsReporter::onSignalPipe() {
+    // Several signals may have queued up; one report covers them all
+    char buffer[64];
+    while (::read(g_signalPipe[0], buffer, sizeof(buffer)) > 0) {
+    }
+    report();
+}
+
+void RuntimeStatsReporter::report() {
+    const QByteArray text = RuntimeStats::global().format().toLocal8Bit();
+    std::fputs("HeadsetStatus runtime statistics\n", stderr);
+    std::fwrite(text.constData(), 1, size_t(text.size()), stderr);
+    std::fflush(stderr);
+    emit reported();
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <array>
+#include <atomic>
+#include <csignal>
+
+class QSocketNotifier;
+
+/**
+ * @class StatCounter
+ * @brief Monotonic event counter, safe to bump from any thread
+ */
+class StatCounter {
+public:
+    void add(quint64 n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    quint64 value() const { return m_value.load(std::memory_order_relaxed); }
+    void reset() { m_value.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<quint64> m_value{0};
+};
+
+/**
+ * @class StatHistogram
+ * @brief Fixed-bucket histogram, safe to record into from any thread
+ *
+ * Bucket bounds are fixed at construction, so record() is a short linear
+ * scan and a few relaxed atomic adds with no allocation or lock.
+ */
+class StatHistogram {
+public:
+    static constexpr int kMaxBounds = 24;
+
+    /**
+     * @param bounds Inclusive upper bounds of the buckets, ascending; values
+     *        above the last bound go to an overflow bucket
+     */
+    explicit StatHistogram(const QList<qint64>& bounds);
+
+    void record(qint64 value);
+
+    /**
+     * @brief Records the time elapsed on @p timer in microseconds
+     */
+    void recordElapsed(const QElapsedTimer& timer) { record(timer.nsecsElapsed() / 1000); }
+
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+    qint64 sum() const { return m_sum.load(std::memory_order_relaxed); }
+    qint64 max() const { return m_max.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Upper bound of the bucket holding the @p fraction quantile
+     * @return The bound, max() for the overflow bucket, or 0 when empty
+     */
+    qint64 quantileBound(double fraction) const;
+
+    /** @brief Number of buckets including the overflow bucket */
+    int bucketCount() const { return m_boundCount + 1; }
+
+    /** @brief Upper bound of a bucket, or -1 for the overflow bucket */
+    qint64 bucketBound(int index) const { return index < m_boundCount ? m_bounds[index] : -1; }
+    quint64 bucketValue(int index) const { return m_buckets[index].load(std::memory_order_relaxed); }
+
+    void reset();
+
+private:
+    std::array<qint64, kMaxBounds> m_bounds{};
+    int m_boundCount = 0;
+    std::array<std::atomic<quint64>, kMaxBounds + 1> m_buckets{};
+    std::atomic<quint64> m_count{0};
+    std::atomic<qint64> m_sum{0};
+    std::atomic<qint64> m_max{0};
+};
+
+/**
+ * @class RuntimeStats
+ * @brief Process-wide counters and latency histograms
+ *
+ * Always compiled in and always recording; the cost per event is a few
+ * relaxed atomic adds. Latencies are in microseconds.
+ */
+class RuntimeStats {
+public:
+    static RuntimeStats& global();
+
+    RuntimeStats();
+    RuntimeStats(const RuntimeStats&) = delete;
+    RuntimeStats& operator=(const RuntimeStats&) = delete;
+
+    StatCounter statusUpdateRequests;  ///< Full updates asked for (before debouncing)
+    StatCounter statusUpdatesRun;      ///< Full updates actually started
+    StatCounter propertyChanges;       ///< PropertiesChanged merged into the cache
+    StatCounter enumerations;          ///< UPower enumerations completed
+    StatCounter dbusCalls;             ///< UPower method calls sent
+    StatCounter iconRenders;           ///< Tray icon images painted
+    StatCounter menuRebuilds;          ///< Devices submenu rebuilt
+    StatCounter menuPatches;           ///< Devices submenu patched in place
+    StatCounter notificationsSent;     ///< Notifications handed to the daemon
+    StatCounter notificationsReplaced; ///< Of those, updates of a popup already shown
+    StatCounter notificationsCoalesced;///< Events merged into another notification or superseded
+
+    StatHistogram dbusCallsPerEnumeration;
+    StatHistogram enumerationUs;       ///< Enumeration start to result
+    StatHistogram statusUpdateUs;      ///< updateStatus() to the tray being up to date
+    StatHistogram propertyChangeUs;    ///< Handling one PropertiesChanged
+    StatHistogram iconRenderUs;        ///< Painting one tray icon image
+
+    /**
+     * @brief Plain-text report, one "name value" line per metric
+     */
+    QString format() const;
+
+    void reset();
+
+private:
+    QElapsedTimer m_uptime;
+};
+
+/**
+ * @class RuntimeStatsReporter
+ * @brief Writes RuntimeStats::global() to stderr, on demand or on a signal
+ *
+ * The signal handler only writes a byte to a pipe; the report itself is
+ * produced on the event loop, where formatting and I/O are safe.
+ */
+class RuntimeStatsReporter : public QObject {
+    Q_OBJECT
+public:
+    explicit RuntimeStatsReporter(QObject *parent = nullptr);
+    ~RuntimeStatsReporter() override;
+
+    /**
+     * @brief Reports whenever the process receives @p signalNumber
+     * @return False if the pipe or the handler could not be set up
+     */
+    bool installSignalHandler(int signalNumber = SIGUSR1);
+
+public slots:
+    void report();
+
+signals:
+    /**
+     * @brief Emitted after a report was written
+     */
+    void reported();
+
+private:
+    static void handleSignal(int signalNumber);
+    void onSignalPipe();
+
+    QSocketNotifier *m_notifier = nullptr;
+    int m_signalNumber = 0;
+};
@@ -5,7 +5,15 @@
 #include <QLabel>
 #include <QDialogButtonBox>
 
-SettingsDialog::SettingsDialog(ConfigManager *configManager, QWidget *parent)
+namespace {
+// Item data roles of the overrides list
+constexpr int kNativePathRole = Qt::UserRole;
+constexpr int kModelRole = Qt::UserRole + 1;
+constexpr int kOverrideRole = Qt::UserRole + 2;
+}
+
+SettingsDialog::SettingsDialog(ConfigManager *configManager,
+                               const QList<DeviceClassifier::StoredOverride>& overrides, QWidget *parent)
     : QDialog(parent)
     , m_configManager(configManager)
 {
@@ -13,6 +21,11 @@ SettingsDialog::SettingsDialog(ConfigManager *configManager, QWidget *parent)
     setModal(true);
     setupUi();
     loadSettings();
+
+    for (const DeviceClassifier::StoredOverride& stored : overrides) {
+        setOverrideItem(new QListWidgetItem(m_overridesList), stored);
+    }
+    updateOverrideButtons();
 }
 
 void SettingsDialog::setupUi() {
@@ -48,6 +61,24 @@ void SettingsDialog::setupUi() {
     notificationGroup->setLayout(notificationLayout);
     mainLayout->addWidget(notificationGroup);
 
+    // Devices forced in or out of detection, connected or not
+    QGroupBox *classificationGroup = new QGroupBox("Device Classification");
+    QVBoxLayout *classificationLayout = new QVBoxLayout();
+
+    m_overridesList = new QListWidget();
+    classificationLayout->addWidget(m_overridesList);
+
+    QHBoxLayout *overrideButtonLayout = new QHBoxLayout();
+    m_toggleOverrideButton = new QPushButton("Not a Headset");
+    m_resetOverrideButton = new QPushButton("Reset Classification");
+    overrideButtonLayout->addStretch();
+    overrideButtonLayout->addWidget(m_toggleOverrideButton);
+    overrideButtonLayout->addWidget(m_resetOverrideButton);
+
+    classificationLayout->addLayout(overrideButtonLayout);
+    classificationGroup->setLayout(classificationLayout);
+    mainLayout->addWidget(classificationGroup);
+
     // Buttons
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     m_defaultsButton = new QPushButton("Restore Defaults");
@@ -66,6 +97,9 @@ void SettingsDialog::setupUi() {
     connect(m_saveButton, &QPushButton::clicked, this, &SettingsDialog::saveSettings);
     connect(m_cancelButton, &QPushButton::clicked, this, &QDialog::reject);
     connect(m_defaultsButton, &QPushButton::clicked, this, &SettingsDialog::restoreDefaults);
+    connect(m_toggleOverrideButton, &QPushButton::clicked, this, &SettingsDialog::toggleOverride);
+    connect(m_resetOverrideButton, &QPushButton::clicked, this, &SettingsDialog::resetOverride);
+    connect(m_overridesList, &QListWidget::currentItemChanged, this, &SettingsDialog::updateOverrideButtons);
 
     // Enable/disable notification options based on main checkbox
     connect(m_notificationsEnabledCheckBox, &QCheckBox::toggled, [this](bool enabled) {
@@ -108,3 +142,58 @@ void SettingsDialog::restoreDefaults() {
     m_notifyDisconnectCheckBox->setChecked(false);
     m_lowBatteryThresholdSpinBox->setValue(20);
 }
+
+void SettingsDialog::setOverrideItem(QListWidgetItem *item, const DeviceClassifier::StoredOverride& stored) {
+    const bool always = stored.value == DeviceClassifier::Override::AlwaysHeadset;
+    const QString model = stored.model.isEmpty() ? QStringLiteral("Unnamed device") : stored.model;
+    item->setText(QString("%1 — %2").arg(model, always ? "always a headset" : "never a headset"));
+    item->setToolTip(stored.nativePath);
+    item->setData(kNativePathRole, stored.nativePath);
+    item->setData(kModelRole, stored.model);
+    item->setData(kOverrideRole, static_cast<int>(stored.value));
+}
+
+void SettingsDialog::toggleOverride() {
+    QListWidgetItem *item = m_overridesList->currentItem();
+    if (!item) {
+        return;
+    }
+
+    // Only the opposite decision is a change
+    const auto current = static_cast<DeviceClassifier::Override>(item->data(kOverrideRole).toInt());
+    DeviceClassifier::StoredOverride stored;
+    stored.nativePath = item->data(kNativePathRole).toString();
+    stored.model = item->data(kModelRole).toString();
+    stored.value = current == DeviceClassifier::Override::AlwaysHeadset
+        ? DeviceClassifier::Override::NeverHeadset
+        : DeviceClassifier::Override::AlwaysHeadset;
+
+    setOverrideItem(item, stored);
+    updateOverrideButtons();
+    emit classificationChanged(stored.nativePath, stored.model, stored.value);
+}
+
+void SettingsDialog::resetOverride() {
+    QListWidgetItem *item = m_overridesList->currentItem();
+    if (!item) {
+        return;
+    }
+
+    const QString nativePath = item->data(kNativePathRole).toString();
+    const QString model = item->data(kModelRole).toString();
+    delete item;
+    updateOverrideButtons();
+    emit classificationChanged(nativePath, model, DeviceClassifier::Override::None);
+}
+
+void SettingsDialog::updateOverrideButtons() {
+    QListWidgetItem *item = m_overridesList->currentItem();
+    m_toggleOverrideButton->setEnabled(item);
+    m_resetOverrideButton->setEnabled(item);
+
+    if (item) {
+        const auto current = static_cast<DeviceClassifier::Override>(item->data(kOverrideRole).toInt());
+        m_toggleOverrideButton->setText(current == DeviceClassifier::Override::AlwaysHeadset
+                                        ? "Not a Headset" : "Always a Headset");
+    }
+}
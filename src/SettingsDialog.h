@@ -1,29 +1,52 @@
 #pragma once
 #include <QDialog>
 #include <QCheckBox>
+#include <QListWidget>
 #include <QSpinBox>
 #include <QPushButton>
 #include "ConfigManager.h"
+#include "DeviceClassifier.h"
 
 /**
  * @class SettingsDialog
  * @brief Settings dialog for configuring notification preferences
  *
  * This dialog allows users to configure notification settings, battery thresholds,
- * and other application preferences.
+ * and other application preferences. It also lists the stored classification
+ * overrides, so devices that are not connected can be reset as well.
  */
 class SettingsDialog : public QDialog {
     Q_OBJECT
 public:
-    explicit SettingsDialog(ConfigManager *configManager, QWidget *parent = nullptr);
+    /**
+     * @param configManager Settings edited by the dialog
+     * @param overrides Classification overrides stored when the dialog opens
+     * @param parent Parent widget
+     */
+    explicit SettingsDialog(ConfigManager *configManager,
+                            const QList<DeviceClassifier::StoredOverride>& overrides = {},
+                            QWidget *parent = nullptr);
+
+signals:
+    /**
+     * @brief The user changed or reset an override; applied right away,
+     *        not on Save
+     * @param value New override; Override::None resets the device to detection
+     */
+    void classificationChanged(const QString& nativePath, const QString& model,
+                               DeviceClassifier::Override value);
 
 private slots:
     void saveSettings();
     void restoreDefaults();
+    void toggleOverride();
+    void resetOverride();
+    void updateOverrideButtons();
 
 private:
     void setupUi();
     void loadSettings();
+    void setOverrideItem(QListWidgetItem *item, const DeviceClassifier::StoredOverride& stored);
 
     ConfigManager *m_configManager;
 
@@ -33,6 +56,9 @@ private:
     QCheckBox *m_notifyChargingCompleteCheckBox;
     QCheckBox *m_notifyDisconnectCheckBox;
     QSpinBox *m_lowBatteryThresholdSpinBox;
+    QListWidget *m_overridesList;
+    QPushButton *m_toggleOverrideButton;
+    QPushButton *m_resetOverrideButton;
     QPushButton *m_saveButton;
     QPushButton *m_cancelButton;
     QPushButton *m_defaultsButton;
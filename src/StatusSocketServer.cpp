@@ -0,0 +1,250 @@
+#include "StatusSocketServer.h"
+#include <QFile>
+#include <QSocketNotifier>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+bool makeAddress(const QString& path, sockaddr_un *address) {
+    const QByteArray encoded = QFile::encodeName(path);
+    if (encoded.isEmpty() || size_t(encoded.size()) >= sizeof(address->sun_path)) {
+        return false;
+    }
+    std::memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    std::memcpy(address->sun_path, encoded.constData(), size_t(encoded.size()));
+    return true;
+}
+
+void setError(QString *error, const QString& message) {
+    if (error) {
+        *error = message;
+    }
+}
+}
+
+StatusSocketServer::StatusSocketServer(const DeviceStateCache& cache, QObject *parent)
+    : QObject(parent)
+    , m_encoder(cache)
+{
+    m_buffer.reserve(DeviceJsonEncoder::kBufferCapacity);
+}
+
+StatusSocketServer::~StatusSocketServer() {
+    close();
+}
+
+QString StatusSocketServer::defaultPath() {
+    const QString runtimeDir = qEnvironmentVariable("XDG_RUNTIME_DIR");
+    return runtimeDir.isEmpty() ? QString() : runtimeDir + "/headsetstatus.sock";
+}
+
+bool StatusSocketServer::listen(const QString& path, QString *error) {
+    close();
+
+    sockaddr_un address;
+    if (!makeAddress(path, &address)) {
+        setError(error, "Socket path is empty or too long: " + path);
+        return false;
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        setError(error, QString("socket() failed: %1").arg(std::strerror(errno)));
+        return false;
+    }
+
+    // A socket file nobody accepts on is left over from a crash
+    if (QFile::exists(path)) {
+        const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool inUse = probe >= 0
+            && ::connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+        if (probe >= 0) {
+            ::close(probe);
+        }
+        if (inUse) {
+            ::close(fd);
+            setError(error, path + " is in use by another instance");
+            return false;
+        }
+        ::unlink(QFile::encodeName(path).constData());
+    }
+
+    if (::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0
+        || ::chmod(address.sun_path, S_IRUSR | S_IWUSR) != 0
+        || ::listen(fd, 16) != 0) {
+        setError(error, QString("Cannot listen on %1: %2").arg(path, std::strerror(errno)));
+        ::close(fd);
+        return false;
+    }
+
+    m_listenFd = fd;
+    m_path = path;
+    m_listenNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_listenNotifier, &QSocketNotifier::activated, this, &StatusSocketServer::acceptClients);
+    return true;
+}
+
+void StatusSocketServer::close() {
+    const QList<int> fds = m_clients.keys();
+    for (int fd : fds) {
+        dropClient(fd);
+    }
+
+    if (m_listenFd >= 0) {
+        delete m_listenNotifier;
+        m_listenNotifier = nullptr;
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        ::unlink(QFile::encodeName(m_path).constData());
+        m_path.clear();
+    }
+}
+
+void StatusSocketServer::acceptClients() {
+    for (;;) {
+        const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        if (m_clients.size() >= kMaxClients) {
+            ::close(fd);
+            continue;
+        }
+
+        Client& client = m_clients[fd];
+        client.readNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(client.readNotifier, &QSocketNotifier::activated, this, [this, fd]() { readClient(fd); });
+        client.writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+        client.writeNotifier->setEnabled(false);
+        connect(client.writeNotifier, &QSocketNotifier::activated, this, [this, fd]() { flushClient(fd); });
+
+        m_buffer.resize(0);
+        m_encoder.appendSnapshot(m_buffer);
+        if (!queue(fd, client, m_buffer)) {
+            dropClient(fd);
+        }
+    }
+}
+
+void StatusSocketServer::publish(const DeviceChangeSet& changes) {
+    if (m_clients.isEmpty()) {
+        return;
+    }
+
+    // Encoded once for every client
+    m_buffer.resize(0);
+    if (changes.everything) {
+        m_encoder.appendSnapshot(m_buffer);
+    } else if (m_encoder.appendChanges(changes, m_buffer) == 0) {
+        return;
+    }
+
+    QList<int> slowClients;
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        if (!queue(it.key(), it.value(), m_buffer)) {
+            slowClients.append(it.key());
+        }
+    }
+    for (int fd : std::as_const(slowClients)) {
+        dropClient(fd);
+        emit slowClientDropped();
+    }
+}
+
+bool StatusSocketServer::queue(int fd, Client& client, const QByteArray& data) {
+    const char *bytes = data.constData();
+    qsizetype size = data.size();
+
+    // Behind a backlog, new bytes have to wait their turn
+    if (client.pending.isEmpty()) {
+        ssize_t sent;
+        do {
+            sent = ::send(fd, bytes, size_t(size), MSG_NOSIGNAL | MSG_DONTWAIT);
+        } while (sent < 0 && errno == EINTR);
+
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            sent = 0;
+        }
+        bytes += sent;
+        size -= sent;
+        if (size == 0) {
+            return true;
+        }
+    }
+
+    if (client.pending.size() + size > kMaxPendingBytes) {
+        return false;
+    }
+    client.pending.append(bytes, size);
+    client.writeNotifier->setEnabled(true);
+    return true;
+}
+
+void StatusSocketServer::flushClient(int fd) {
+    auto it = m_clients.find(fd);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    Client& client = it.value();
+    while (!client.pending.isEmpty()) {
+        const ssize_t sent = ::send(fd, client.pending.constData(), size_t(client.pending.size()),
+                                    MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                dropClient(fd);
+            }
+            return;
+        }
+        client.pending.remove(0, sent);
+    }
+    client.writeNotifier->setEnabled(false);
+}
+
+void StatusSocketServer::readClient(int fd) {
+    // Input is ignored; reading only detects that the client went away
+    char buffer[256];
+    for (;;) {
+        const ssize_t received = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received > 0) {
+            continue;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            dropClient(fd);
+        }
+        return;
+    }
+}
+
+void StatusSocketServer::dropClient(int fd) {
+    auto it = m_clients.find(fd);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    // Notifiers may be in the middle of delivering; delete them later
+    it->readNotifier->setEnabled(false);
+    it->readNotifier->deleteLater();
+    it->writeNotifier->setEnabled(false);
+    it->writeNotifier->deleteLater();
+    m_clients.erase(it);
+    ::close(fd);
+}
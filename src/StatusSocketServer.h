@@ -0,0 +1,87 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include "DeviceChange.h"
+#include "DeviceJsonEncoder.h"
+
+class DeviceStateCache;
+class QSocketNotifier;
+
+/**
+ * @class StatusSocketServer
+ * @brief Pushes the headset state to local clients over a Unix socket
+ *
+ * Every client that connects gets a snapshot line and then the change
+ * records of every update, in the DeviceJsonEncoder format. Each update is
+ * encoded once and fanned out with non-blocking sends. Bytes a client has
+ * not taken yet are buffered up to kMaxPendingBytes; a client that falls
+ * further behind is disconnected rather than fed a stream with holes, and
+ * gets a fresh snapshot when it reconnects. A stuck client therefore never
+ * blocks the update path. Clients are not expected to send anything.
+ */
+class StatusSocketServer : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int kMaxClients = 64;
+    static constexpr qsizetype kMaxPendingBytes = 64 * 1024;
+
+    /**
+     * @param cache Device state the records are built from; must outlive the server
+     */
+    explicit StatusSocketServer(const DeviceStateCache& cache, QObject *parent = nullptr);
+    ~StatusSocketServer() override;
+
+    /**
+     * @brief $XDG_RUNTIME_DIR/headsetstatus.sock, or empty without XDG_RUNTIME_DIR
+     */
+    static QString defaultPath();
+
+    /**
+     * @brief Creates the socket; a stale socket left by a crash is replaced
+     * @param error Receives a description if listening failed (may be null)
+     * @return False if the path is in use by a running instance or cannot be bound
+     */
+    bool listen(const QString& path, QString *error = nullptr);
+
+    /**
+     * @brief Disconnects every client and removes the socket
+     */
+    void close();
+
+    bool isListening() const { return m_listenFd >= 0; }
+    QString path() const { return m_path; }
+    int clientCount() const { return int(m_clients.size()); }
+
+    /**
+     * @brief Sends the records of one update that was applied to the cache
+     */
+    void publish(const DeviceChangeSet& changes);
+
+signals:
+    /**
+     * @brief A client fell more than kMaxPendingBytes behind and was disconnected
+     */
+    void slowClientDropped();
+
+private:
+    struct Client {
+        QByteArray pending;
+        QSocketNotifier *readNotifier = nullptr;
+        QSocketNotifier *writeNotifier = nullptr;
+    };
+
+    void acceptClients();
+    bool queue(int fd, Client& client, const QByteArray& data);
+    void flushClient(int fd);
+    void readClient(int fd);
+    void dropClient(int fd);
+
+    DeviceJsonEncoder m_encoder;
+    QString m_path;
+    int m_listenFd = -1;
+    QSocketNotifier *m_listenNotifier = nullptr;
+    QHash<int, Client> m_clients;
+    QByteArray m_buffer;
+};
@@ -0,0 +1,246 @@
+#include "StatusTextBuilder.h"
+#include <utility>
+
+namespace {
+// Enough for a typical model name and status without growing
+constexpr qsizetype kSegmentReserve = 96;
+
+// Empties a string but keeps its buffer. clear() would release it; a buffer
+// still shared with a QAction or the tray is detached with a single allocation.
+void resetText(QString& text, qsizetype capacity = kSegmentReserve) {
+    text.reserve(capacity);
+    text.resize(0);
+}
+
+void appendNumber(QString& out, int value) {
+    char digits[12];
+    int pos = sizeof(digits);
+    unsigned magnitude = value < 0 ? 0u - unsigned(value) : unsigned(value);
+    do {
+        digits[--pos] = char('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) {
+        digits[--pos] = '-';
+    }
+    out.append(QLatin1String(digits + pos, int(sizeof(digits)) - pos));
+}
+
+// "45m" or "3h 05m"
+void appendDuration(QString& out, int minutes) {
+    if (minutes >= 60) {
+        appendNumber(out, minutes / 60);
+        out.append(QLatin1String("h "));
+        if (minutes % 60 < 10) {
+            out.append(QLatin1Char('0'));
+        }
+    }
+    appendNumber(out, minutes % 60);
+    out.append(QLatin1Char('m'));
+}
+
+void appendPercent(QString& out, int battery, QLatin1String suffix) {
+    appendNumber(out, battery);
+    out.append(QLatin1Char('%'));
+    out.append(suffix);
+}
+}
+
+StatusTextBuilder::StatusTextBuilder(int lowBatteryThreshold)
+    : m_lowBatteryThreshold(lowBatteryThreshold)
+{
+}
+
+void StatusTextBuilder::setLowBatteryThreshold(int threshold) {
+    if (threshold == m_lowBatteryThreshold) {
+        return;
+    }
+
+    m_lowBatteryThreshold = threshold;
+    m_reformatAll = true;
+    for (Segment& segment : m_segments) {
+        segment.formatted = false;
+    }
+}
+
+StatusTextBuilder::RenderState StatusTextBuilder::renderState(const HeadsetDevice& device) const {
+    RenderState state;
+    state.model = device.model;
+    state.connectionType = device.connectionType;
+    state.battery = int(device.battery);
+    state.charging = device.isCharging;
+    state.present = device.isPresent;
+    state.low = device.battery < m_lowBatteryThreshold;
+    state.minutesRemaining = device.secondsRemaining < 0 ? -1 : (device.secondsRemaining + 30) / 60;
+    return state;
+}
+
+int StatusTextBuilder::indexOf(const QString& dbusPath, int hint) const {
+    if (hint >= 0 && hint < m_segments.size() && m_segments.at(hint).dbusPath == dbusPath) {
+        return hint;
+    }
+    for (int i = 0; i < m_segments.size(); ++i) {
+        if (m_segments.at(i).dbusPath == dbusPath) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QString StatusTextBuilder::deviceEmoji(const HeadsetDevice& device) const {
+    if (!device.isPresent) {
+        return QStringLiteral("⚠️");
+    } else if (device.battery < m_lowBatteryThreshold && !device.isCharging) {
+        return QStringLiteral("🪫"); // Low battery
+    } else if (device.isCharging) {
+        return QStringLiteral("⚡");
+    } else if (device.connectionType == ConnectionType::USB) {
+        return QStringLiteral("🔌");
+    } else {
+        return QStringLiteral("🎧");
+    }
+}
+
+void StatusTextBuilder::format(Segment& segment, const HeadsetDevice& device) {
+    const RenderState& state = segment.state;
+    ++m_formatCount;
+
+    // Tooltip block: model, connection and battery, warnings first
+    resetText(segment.tooltip);
+    segment.tooltip.append(state.model);
+    segment.tooltip.append(QLatin1String("\nConnection: "));
+    segment.tooltip.append(connectionTypeName(state.connectionType));
+    segment.tooltip.append(QLatin1String("\nBattery: "));
+    if (!state.present) {
+        segment.tooltip.append(QLatin1String("(Not present)"));
+    } else if (state.low) {
+        appendPercent(segment.tooltip, state.battery, QLatin1String(" (Low)"));
+    } else if (state.charging) {
+        appendPercent(segment.tooltip, state.battery, QLatin1String(" (Charging)"));
+    } else {
+        appendPercent(segment.tooltip, state.battery, QLatin1String(""));
+    }
+    if (state.present && state.minutesRemaining >= 0) {
+        segment.tooltip.append(state.charging ? QLatin1String("\nTime to full: ")
+                                              : QLatin1String("\nTime left: "));
+        appendDuration(segment.tooltip, state.minutesRemaining);
+    }
+
+    resetText(segment.menuTitle);
+    segment.menuTitle.append(deviceEmoji(device));
+    segment.menuTitle.append(QLatin1Char(' '));
+    segment.menuTitle.append(state.model);
+
+    // The menu ranks charging above low battery
+    resetText(segment.batteryLabel);
+    segment.batteryLabel.append(QLatin1String("Battery: "));
+    if (!state.present) {
+        segment.batteryLabel.append(QLatin1String("Not present"));
+    } else if (state.charging) {
+        appendPercent(segment.batteryLabel, state.battery, QLatin1String(" (Charging)"));
+    } else if (state.low) {
+        appendPercent(segment.batteryLabel, state.battery, QLatin1String(" (Low)"));
+    } else {
+        appendPercent(segment.batteryLabel, state.battery, QLatin1String(""));
+    }
+
+    resetText(segment.connectionLabel);
+    segment.connectionLabel.append(QLatin1String("Connection: "));
+    segment.connectionLabel.append(connectionTypeName(state.connectionType));
+}
+
+bool StatusTextBuilder::reorder(const QList<HeadsetDevice>& devices) {
+    bool sameOrder = devices.size() == m_segments.size();
+    for (int i = 0; sameOrder && i < devices.size(); ++i) {
+        sameOrder = devices.at(i).dbusPath == m_segments.at(i).dbusPath;
+    }
+    if (sameOrder) {
+        return false;
+    }
+
+    // Devices came, went or moved; keep the segments (and their buffers) of known paths
+    QHash<QString, int> oldIndex;
+    for (int i = 0; i < m_segments.size(); ++i) {
+        oldIndex.insert(m_segments.at(i).dbusPath, i);
+    }
+
+    QList<Segment> segments;
+    segments.reserve(devices.size());
+    for (const HeadsetDevice& device : devices) {
+        const auto it = oldIndex.constFind(device.dbusPath);
+        if (it != oldIndex.constEnd()) {
+            segments.append(std::move(m_segments[*it]));
+        } else {
+            Segment segment;
+            segment.dbusPath = device.dbusPath;
+            segments.append(std::move(segment));
+        }
+    }
+    m_segments = std::move(segments);
+    return true;
+}
+
+bool StatusTextBuilder::refresh(int index, const HeadsetDevice& device) {
+    Segment& segment = m_segments[index];
+    RenderState state = renderState(device);
+    if (segment.formatted && segment.state == state) {
+        return false;
+    }
+
+    segment.state = std::move(state);
+    format(segment, device);
+    segment.formatted = true;
+    return true;
+}
+
+bool StatusTextBuilder::update(const QList<HeadsetDevice>& devices) {
+    m_reformatAll = false;
+    bool changed = reorder(devices);
+    for (int i = 0; i < devices.size(); ++i) {
+        changed |= refresh(i, devices.at(i));
+    }
+
+    if (changed) {
+        assembleTooltip();
+    }
+    return changed;
+}
+
+bool StatusTextBuilder::update(const QList<HeadsetDevice>& devices, const DeviceChangeSet& changes) {
+    if (m_reformatAll || changes.everything || changes.orderChanged
+        || devices.size() != m_segments.size()) {
+        return update(devices);
+    }
+
+    bool changed = false;
+    for (const DeviceChange& change : changes.changes) {
+        if (!(change.fields & kDeviceStateFields)) {
+            continue;
+        }
+        const int index = indexOf(change.dbusPath);
+        if (index >= 0) {
+            changed |= refresh(index, devices.at(index));
+        }
+    }
+
+    if (changed) {
+        assembleTooltip();
+    }
+    return changed;
+}
+
+void StatusTextBuilder::assembleTooltip() {
+    static const QLatin1String separator("\n\n");
+    qsizetype length = 0;
+    for (const Segment& segment : m_segments) {
+        length += segment.tooltip.size() + separator.size();
+    }
+
+    resetText(m_tooltip, length);
+    for (int i = 0; i < m_segments.size(); ++i) {
+        if (i > 0) {
+            m_tooltip.append(separator);
+        }
+        m_tooltip.append(m_segments.at(i).tooltip);
+    }
+}
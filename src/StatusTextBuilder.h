@@ -0,0 +1,114 @@
+#pragma once
+#include <QHash>
+#include <QList>
+#include <QString>
+#include "DeviceChange.h"
+#include "HeadsetDevice.h"
+
+/**
+ * @class StatusTextBuilder
+ * @brief Builds the tray tooltip and device menu labels incrementally
+ *
+ * Keeps one pre-reserved text segment per device. update() reformats only
+ * the segments whose rendered state (model, connection, whole battery
+ * percent, charging, presence, low flag, minutes remaining) changed, and
+ * reassembles the tooltip only when at least one segment or the device
+ * order changed.
+ * With unchanged state an update performs no heap allocation.
+ */
+class StatusTextBuilder {
+public:
+    /**
+     * @param lowBatteryThreshold Battery percentage below which a device is low
+     */
+    explicit StatusTextBuilder(int lowBatteryThreshold = 20);
+
+    /**
+     * @brief Sets the low battery threshold; forces every segment to be reformatted
+     */
+    void setLowBatteryThreshold(int threshold);
+
+    /**
+     * @brief Brings the texts up to date with a device list
+     * @param devices Connected headsets, in display order
+     * @return True if tooltip() changed
+     */
+    bool update(const QList<HeadsetDevice>& devices);
+
+    /**
+     * @brief Brings the texts up to date, looking only at devices in @p changes
+     * @param devices Connected headsets, in display order
+     * @param changes What changed since the previous update
+     * @return True if tooltip() changed
+     */
+    bool update(const QList<HeadsetDevice>& devices, const DeviceChangeSet& changes);
+
+    /**
+     * @brief Tooltip for all devices, blocks separated by a blank line
+     */
+    const QString& tooltip() const { return m_tooltip; }
+
+    /** @brief Number of devices from the last update() */
+    int size() const { return m_segments.size(); }
+
+    /**
+     * @brief Index of a device in the last update(), or -1
+     * @param dbusPath D-Bus object path of the device
+     * @param hint Index to check first
+     */
+    int indexOf(const QString& dbusPath, int hint = 0) const;
+
+    // Device menu labels, by index into the last update()'s device list
+    const QString& menuTitle(int index) const { return m_segments.at(index).menuTitle; }
+    const QString& batteryLabel(int index) const { return m_segments.at(index).batteryLabel; }
+    const QString& connectionLabel(int index) const { return m_segments.at(index).connectionLabel; }
+
+    /**
+     * @brief Emoji shown for a device in the devices menu
+     */
+    QString deviceEmoji(const HeadsetDevice& device) const;
+
+    /** @brief Number of segments formatted so far */
+    int formatCount() const { return m_formatCount; }
+
+private:
+    // Everything the texts depend on; compared before any formatting
+    struct RenderState {
+        QString model;
+        ConnectionType connectionType = ConnectionType::Bluetooth;
+        int battery = -1;
+        bool charging = false;
+        bool present = false;
+        bool low = false;
+        int minutesRemaining = -1;
+
+        bool operator==(const RenderState& other) const {
+            return battery == other.battery && charging == other.charging
+                && present == other.present && low == other.low
+                && minutesRemaining == other.minutesRemaining
+                && model == other.model && connectionType == other.connectionType;
+        }
+    };
+
+    struct Segment {
+        QString dbusPath;
+        RenderState state;
+        bool formatted = false;
+        QString tooltip;
+        QString menuTitle;
+        QString batteryLabel;
+        QString connectionLabel;
+    };
+
+    RenderState renderState(const HeadsetDevice& device) const;
+    void format(Segment& segment, const HeadsetDevice& device);
+    bool reorder(const QList<HeadsetDevice>& devices);
+    bool refresh(int index, const HeadsetDevice& device);
+    void assembleTooltip();
+
+    int m_lowBatteryThreshold;
+    bool m_reformatAll = false;
+    QList<Segment> m_segments;
+    QString m_tooltip;
+    int m_formatCount = 0;
+};
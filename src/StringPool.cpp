@@ -0,0 +1,11 @@
+#include "StringPool.h"
+
+QString StringPool::intern(const QString& value) {
+    const auto it = m_strings.constFind(value);
+    if (it != m_strings.constEnd()) {
+        return *it;
+    }
+
+    m_strings.insert(value);
+    return value;
+}
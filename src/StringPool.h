@@ -0,0 +1,25 @@
+#pragma once
+#include <QSet>
+#include <QString>
+
+/**
+ * @class StringPool
+ * @brief Interns strings so equal values share one implicitly shared buffer
+ *
+ * Strings demarshalled from D-Bus are fresh allocations every time. Passing
+ * them through intern() keeps a single copy per distinct value alive, and
+ * equality checks between interned strings short-circuit on the shared data.
+ */
+class StringPool {
+public:
+    /**
+     * @brief Returns the pooled copy of @p value, adding it if it is new
+     */
+    QString intern(const QString& value);
+
+    int size() const { return m_strings.size(); }
+    void clear() { m_strings.clear(); }
+
+private:
+    QSet<QString> m_strings;
+};
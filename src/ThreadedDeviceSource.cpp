@@ -0,0 +1,108 @@
+#include "ThreadedDeviceSource.h"
+#include "DeviceStateCache.h"
+
+ThreadedDeviceSource::ThreadedDeviceSource(Factory factory, QObject *parent)
+    : DeviceSource(parent)
+    , m_context(new QObject())
+{
+    m_thread.setObjectName(QStringLiteral("DeviceSource"));
+    m_context->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_context, &QObject::deleteLater);
+    m_thread.start();
+
+    // Runs first on the worker; every later call is queued behind it
+    QMetaObject::invokeMethod(m_context, [this, factory = std::move(factory)]() {
+        m_source = factory();
+        m_source->setParent(m_context);
+
+        connect(m_source, &DeviceSource::devicesReady, m_context,
+                [this](const QList<HeadsetDevice>& devices) { publish(devices); });
+        connect(m_source, &DeviceSource::devicesChanged, this, &DeviceSource::devicesChanged);
+        connect(m_source, &DeviceSource::devicePropertiesChanged, m_context,
+                [this](const QString& dbusPath, const QVariantMap& properties) {
+                    if (m_enumerating) {
+                        m_changesWhileEnumerating.append({dbusPath, properties});
+                    }
+                    const quint64 sequence = ++m_sequence;
+                    QMetaObject::invokeMethod(this, [this, sequence, dbusPath, properties]() {
+                        // Already part of the snapshot taken last
+                        if (sequence < m_snapshotSequence) {
+                            return;
+                        }
+                        emit devicePropertiesChanged(dbusPath, properties);
+                    }, Qt::QueuedConnection);
+                });
+    }, Qt::QueuedConnection);
+}
+
+ThreadedDeviceSource::~ThreadedDeviceSource() {
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void ThreadedDeviceSource::requestDevices() {
+    ++m_pendingRequests;
+    QMetaObject::invokeMethod(m_context, [this]() {
+        m_enumerating = true;
+        m_source->requestDevices();
+    }, Qt::QueuedConnection);
+}
+
+void ThreadedDeviceSource::setTrackedDevices(const QList<HeadsetDevice>& devices) {
+    QMetaObject::invokeMethod(m_context, [this, devices]() { m_source->setTrackedDevices(devices); },
+                              Qt::QueuedConnection);
+}
+
+void ThreadedDeviceSource::ignoreDevice(const HeadsetDevice& device) {
+    QMetaObject::invokeMethod(m_context, [this, device]() { m_source->ignoreDevice(device); },
+                              Qt::QueuedConnection);
+}
+
+void ThreadedDeviceSource::pinDevice(const HeadsetDevice& device) {
+    QMetaObject::invokeMethod(m_context, [this, device]() { m_source->pinDevice(device); },
+                              Qt::QueuedConnection);
+}
+
+void ThreadedDeviceSource::resetDevice(const HeadsetDevice& device) {
+    QMetaObject::invokeMethod(m_context, [this, device]() { m_source->resetDevice(device); },
+                              Qt::QueuedConnection);
+}
+
+void ThreadedDeviceSource::publish(const QList<HeadsetDevice>& devices) {
+    // The snapshot's number makes the GUI thread drop these changes, so
+    // they have to be part of it; a device may have been read before them
+    QList<HeadsetDevice> merged = devices;
+    if (!m_changesWhileEnumerating.isEmpty()) {
+        DeviceStateCache cache;
+        cache.replaceAll(devices);
+        for (const auto& change : std::as_const(m_changesWhileEnumerating)) {
+            cache.applyProperties(change.first, change.second);
+        }
+        merged = cache.devices();
+        m_changesWhileEnumerating.clear();
+    }
+    m_enumerating = false;
+
+    auto snapshot = std::make_shared<const Snapshot>(Snapshot{++m_sequence, std::move(merged)});
+    if (std::atomic_exchange(&m_snapshot, std::shared_ptr<const Snapshot>(std::move(snapshot)))) {
+        m_skippedSnapshots.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // One notification covers every snapshot published until the GUI thread runs it
+    if (!m_snapshotPosted.exchange(true)) {
+        QMetaObject::invokeMethod(this, &ThreadedDeviceSource::takeSnapshot, Qt::QueuedConnection);
+    }
+}
+
+void ThreadedDeviceSource::takeSnapshot() {
+    // Cleared before the exchange, so a snapshot published in between posts again
+    m_snapshotPosted = false;
+    const auto snapshot = std::atomic_exchange(&m_snapshot, std::shared_ptr<const Snapshot>());
+    if (!snapshot) {
+        return;
+    }
+
+    m_snapshotSequence = snapshot->sequence;
+    m_pendingRequests = 0;
+    emit devicesReady(snapshot->devices);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <QList>
+#include <QPair>
+#include <QThread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "DeviceSource.h"
+
+/**
+ * @class ThreadedDeviceSource
+ * @brief Runs another DeviceSource on a worker thread of its own
+ *
+ * The wrapped source is created on the worker by a factory, so its D-Bus
+ * connection, socket notifiers and timers belong to that thread: reply
+ * decoding, classification and sysfs reads never run on the GUI thread.
+ *
+ * Finished enumerations are published as immutable snapshots. The worker
+ * swaps a shared_ptr to the newest one in atomically and posts a single
+ * notification; the GUI thread takes whatever snapshot is current when it
+ * gets to it, so snapshots it fell behind on are skipped, not queued.
+ * Property changes are forwarded in order, except those the worker saw
+ * before the snapshot the GUI thread already took. Changes that arrive
+ * while an enumeration runs may be newer than the replies it is built
+ * from, so they are merged into its result before it is published.
+ */
+class ThreadedDeviceSource : public DeviceSource {
+    Q_OBJECT
+public:
+    /// Creates the wrapped source; called once, on the worker thread
+    using Factory = std::function<DeviceSource*()>;
+
+    explicit ThreadedDeviceSource(Factory factory, QObject *parent = nullptr);
+
+    /**
+     * @brief Stops the worker; the wrapped source is deleted on it
+     */
+    ~ThreadedDeviceSource() override;
+
+    void requestDevices() override;
+    bool isRefreshPending() const override { return m_pendingRequests > 0; }
+    void setTrackedDevices(const QList<HeadsetDevice>& devices) override;
+    void ignoreDevice(const HeadsetDevice& device) override;
+    void pinDevice(const HeadsetDevice& device) override;
+    void resetDevice(const HeadsetDevice& device) override;
+
+    /**
+     * @brief Snapshots the GUI thread skipped because a newer one was ready
+     */
+    int skippedSnapshots() const { return m_skippedSnapshots.load(std::memory_order_relaxed); }
+
+private:
+    struct Snapshot {
+        quint64 sequence;
+        QList<HeadsetDevice> devices;
+    };
+
+    void publish(const QList<HeadsetDevice>& devices);
+    void takeSnapshot();
+
+    QThread m_thread;
+    QObject *m_context;
+
+    // Worker thread only
+    DeviceSource *m_source = nullptr;
+    quint64 m_sequence = 0;
+    bool m_enumerating = false;
+    QList<QPair<QString, QVariantMap>> m_changesWhileEnumerating;
+
+    // Handed from the worker to the GUI thread
+    std::shared_ptr<const Snapshot> m_snapshot;
+    std::atomic<bool> m_snapshotPosted{false};
+    std::atomic<int> m_skippedSnapshots{0};
+
+    // GUI thread only
+    quint64 m_snapshotSequence = 0;
+    int m_pendingRequests = 0;
+};
@@ -0,0 +1,54 @@
+#include "TraceRecorder.h"
+#include <QDebug>
+#include "DeviceSource.h"
+
+TraceRecorder::TraceRecorder(QObject *parent) : QObject(parent) {}
+
+bool TraceRecorder::start(const QString& path, DeviceSource *source, QString *error) {
+    stop();
+    if (!m_writer.open(path, error)) {
+        return false;
+    }
+    m_clock.start();
+    m_eventCount = 0;
+
+    m_connections.append(connect(source, &DeviceSource::devicesReady, this,
+                                 [this](const QList<HeadsetDevice>& devices) {
+        DeviceTraceEvent event;
+        event.type = DeviceTraceEvent::Type::Snapshot;
+        event.devices = devices;
+        record(event);
+    }));
+    m_connections.append(connect(source, &DeviceSource::devicesChanged, this, [this]() {
+        DeviceTraceEvent event;
+        event.type = DeviceTraceEvent::Type::DevicesChanged;
+        record(event);
+    }));
+    m_connections.append(connect(source, &DeviceSource::devicePropertiesChanged, this,
+                                 [this](const QString& dbusPath, const QVariantMap& properties) {
+        DeviceTraceEvent event;
+        event.type = DeviceTraceEvent::Type::PropertiesChanged;
+        event.dbusPath = dbusPath;
+        event.properties = properties;
+        record(event);
+    }));
+    return true;
+}
+
+void TraceRecorder::stop() {
+    for (const QMetaObject::Connection& connection : std::as_const(m_connections)) {
+        disconnect(connection);
+    }
+    m_connections.clear();
+    m_writer.close();
+}
+
+void TraceRecorder::record(DeviceTraceEvent& event) {
+    event.timeUs = m_clock.nsecsElapsed() / 1000;
+    if (!m_writer.write(event)) {
+        qWarning() << "Failed to write trace record; recording stopped";
+        stop();
+        return;
+    }
+    ++m_eventCount;
+}
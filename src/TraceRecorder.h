@@ -0,0 +1,45 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QList>
+#include <QMetaObject>
+#include <QObject>
+#include <QString>
+#include "DeviceTrace.h"
+
+class DeviceSource;
+
+/**
+ * @class TraceRecorder
+ * @brief Writes every signal of a DeviceSource to a trace file
+ *
+ * Records snapshots, membership changes and property changes with their
+ * time since start(), so a session on a machine with a misbehaving headset
+ * can be replayed elsewhere with ReplaySource.
+ */
+class TraceRecorder : public QObject {
+    Q_OBJECT
+public:
+    explicit TraceRecorder(QObject *parent = nullptr);
+
+    /**
+     * @brief Opens the trace and starts following @p source
+     * @param error Receives a description on failure (may be null)
+     */
+    bool start(const QString& path, DeviceSource *source, QString *error = nullptr);
+
+    /**
+     * @brief Stops following the source and closes the trace
+     */
+    void stop();
+
+    int eventCount() const { return m_eventCount; }
+    qint64 bytesWritten() const { return m_writer.bytesWritten(); }
+
+private:
+    void record(DeviceTraceEvent& event);
+
+    DeviceTraceWriter m_writer;
+    QElapsedTimer m_clock;
+    QList<QMetaObject::Connection> m_connections;
+    int m_eventCount = 0;
+};
@@ -0,0 +1,184 @@
+#include "TrayIconCache.h"
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QGuiApplication>
+#include <QPainter>
+#include <QPixmap>
+#include <QPromise>
+#include <QScreen>
+#include <QThreadPool>
+#include <algorithm>
+#include <memory>
+#include "RuntimeStats.h"
+
+TrayIconCache::TrayIconCache(QObject *parent) : QObject(parent) {
+    QList<qreal> ratios = {1.0, 2.0};
+    for (QScreen *screen : QGuiApplication::screens()) {
+        ratios.append(screen->devicePixelRatio());
+        watchScreen(screen);
+    }
+    setDevicePixelRatios(ratios);
+
+    if (qGuiApp) {
+        connect(qGuiApp, &QGuiApplication::screenAdded, this, [this](QScreen *screen) {
+            watchScreen(screen);
+            addDevicePixelRatio(screen->devicePixelRatio());
+        });
+    }
+}
+
+void TrayIconCache::watchScreen(QScreen *screen) {
+    // QScreen has no signal of its own for the ratio; fractional scaling
+    // changes show up as a DPI change
+    const auto update = [this, screen]() { addDevicePixelRatio(screen->devicePixelRatio()); };
+    connect(screen, &QScreen::physicalDotsPerInchChanged, this, update);
+    connect(screen, &QScreen::logicalDotsPerInchChanged, this, update);
+}
+
+void TrayIconCache::addDevicePixelRatio(qreal ratio) {
+    const bool known = std::any_of(m_ratios.cbegin(), m_ratios.cend(),
+                                   [ratio](qreal r) { return ratioStep(r) == ratioStep(ratio); });
+    if (ratio <= 0 || known) {
+        return;
+    }
+
+    setDevicePixelRatios(m_ratios + QList<qreal>{ratio});
+    emit devicePixelRatiosChanged();
+}
+
+void TrayIconCache::setDevicePixelRatios(const QList<qreal>& ratios) {
+    QList<qreal> unique;
+    for (qreal ratio : ratios) {
+        const bool known = std::any_of(unique.cbegin(), unique.cend(),
+                                       [ratio](qreal r) { return ratioStep(r) == ratioStep(ratio); });
+        if (ratio > 0 && !known) {
+            unique.append(ratio);
+        }
+    }
+    std::sort(unique.begin(), unique.end());
+
+    m_ratios = unique;
+    m_icons.clear();
+}
+
+QIcon TrayIconCache::icon(const QString& glyph, int deviceCount) {
+    const Key iconKey{glyph, badgeCount(deviceCount), 0};
+    const auto cached = m_icons.constFind(iconKey);
+    if (cached != m_icons.constEnd()) {
+        return *cached;
+    }
+
+    QIcon icon;
+    for (qreal ratio : m_ratios) {
+        // fromImage() carries the image's pixel ratio over to the pixmap
+        icon.addPixmap(QPixmap::fromImage(image({glyph, iconKey.deviceCount, ratio})));
+    }
+    m_icons.insert(iconKey, icon);
+    return icon;
+}
+
+const QImage& TrayIconCache::image(const Key& key) {
+    auto it = m_images.find(key);
+    if (it == m_images.end()) {
+        ++m_renderCount;
+        it = m_images.insert(key, render(key.glyph, key.deviceCount, key.devicePixelRatio));
+    }
+    return *it;
+}
+
+void TrayIconCache::prewarm(const QStringList& glyphs, int maxDeviceCount) {
+    QList<Key> pending;
+    for (const QString& glyph : glyphs) {
+        for (int count = 0; count <= maxDeviceCount; ++count) {
+            if (count == 1) {
+                continue; // Renders the same as no badge
+            }
+            for (qreal ratio : m_ratios) {
+                const Key key{glyph, count, ratio};
+                if (!m_images.contains(key)) {
+                    pending.append(key);
+                }
+            }
+        }
+    }
+
+    if (pending.isEmpty()) {
+        emit prewarmed();
+        return;
+    }
+
+    // The watcher is owned by the cache, so a result arriving after the
+    // cache is gone is simply dropped
+    auto promise = std::make_shared<QPromise<QList<Rendered>>>();
+    auto *watcher = new QFutureWatcher<QList<Rendered>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        if (watcher->future().resultCount() == 0) {
+            return;
+        }
+        for (const Rendered& rendered : watcher->result()) {
+            if (!m_images.contains(rendered.key)) {
+                ++m_renderCount;
+                m_images.insert(rendered.key, rendered.image);
+            }
+        }
+        emit prewarmed();
+    });
+    watcher->setFuture(promise->future());
+
+    QThreadPool::globalInstance()->start([promise, pending]() {
+        promise->start();
+        QList<Rendered> results;
+        results.reserve(pending.size());
+        for (const Key& key : pending) {
+            results.append({key, render(key.glyph, key.deviceCount, key.devicePixelRatio)});
+        }
+        promise->addResult(results);
+        promise->finish();
+    });
+}
+
+QImage TrayIconCache::render(const QString& glyph, int deviceCount, qreal devicePixelRatio) {
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString safeGlyph = glyph.isEmpty() ? QStringLiteral("🎧") : glyph;
+    const QSize size(kLogicalSize, kLogicalSize);
+
+    QImage image(size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    image.fill(Qt::transparent);
+
+    // Painting happens in logical coordinates; the pixel ratio scales it up
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+
+    // Pixel sizes keep the glyph independent of the image's logical DPI
+    QFont emojiFont;
+    emojiFont.setPixelSize(24);
+    painter.setFont(emojiFont);
+    painter.setPen(Qt::white);
+
+    // Draw emoji centered
+    painter.drawText(QRect(QPoint(0, 0), size), Qt::AlignCenter, safeGlyph);
+
+    // Draw device count badge if multiple devices
+    if (deviceCount > 1) {
+        QFont countFont;
+        countFont.setPixelSize(13);
+        countFont.setBold(true);
+        painter.setFont(countFont);
+
+        QRect countRect(size.width() - 16, size.height() - 14, 16, 14);
+        painter.setPen(Qt::yellow);
+        painter.drawText(countRect, Qt::AlignRight | Qt::AlignBottom, QString::number(deviceCount));
+    }
+
+    painter.end();
+
+    // Also called from the prewarm thread; the stats are atomic
+    RuntimeStats::global().iconRenders.add();
+    RuntimeStats::global().iconRenderUs.recordElapsed(timer);
+    return image;
+}
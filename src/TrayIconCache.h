@@ -0,0 +1,120 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QIcon>
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class QScreen;
+
+/**
+ * @class TrayIconCache
+ * @brief Renders tray icons once per (glyph, device count, pixel ratio)
+ *
+ * Each combination is painted into a QImage the first time it is needed and
+ * kept for the lifetime of the cache. icon() hands back a QIcon carrying one
+ * pixmap per configured device pixel ratio, so HiDPI trays pick a sharp
+ * variant and repeated state changes only swap already-built icons. Screens
+ * that are plugged in or rescaled later add their ratio to the set.
+ */
+class TrayIconCache : public QObject {
+    Q_OBJECT
+public:
+    /** @brief Logical edge length of the tray icon in device-independent pixels */
+    static constexpr int kLogicalSize = 32;
+
+    /**
+     * @param parent Parent object
+     *
+     * Renders for 1x, 2x and the pixel ratio of every screen, including
+     * screens added or rescaled later.
+     */
+    explicit TrayIconCache(QObject *parent = nullptr);
+
+    /**
+     * @brief Returns the multi-resolution icon for a state glyph
+     * @param glyph Emoji shown in the icon
+     * @param deviceCount Number of devices (shows count badge if > 1)
+     */
+    QIcon icon(const QString& glyph, int deviceCount);
+
+    /**
+     * @brief Sets the device pixel ratios every icon is rendered for
+     *
+     * Drops built icons; rendered images for ratios still in use are kept.
+     */
+    void setDevicePixelRatios(const QList<qreal>& ratios);
+    QList<qreal> devicePixelRatios() const { return m_ratios; }
+
+    /**
+     * @brief Adds one device pixel ratio, e.g. of a new or rescaled screen
+     *
+     * Emits devicePixelRatiosChanged() if the ratio was not rendered yet.
+     */
+    void addDevicePixelRatio(qreal ratio);
+
+    /**
+     * @brief Renders every glyph and count up to @p maxDeviceCount in the background
+     *
+     * Painting the first emoji walks the font fallback chain, which is slow;
+     * doing it on a worker thread at startup keeps it off the first state
+     * change. Emits prewarmed() once the images are in the cache.
+     */
+    void prewarm(const QStringList& glyphs, int maxDeviceCount);
+
+    /**
+     * @brief Paints one icon variant
+     * @param glyph Emoji shown in the icon
+     * @param deviceCount Number of devices (shows count badge if > 1)
+     * @param devicePixelRatio Ratio of physical to logical pixels
+     *
+     * Only touches QImage and QPainter, so it is safe off the GUI thread.
+     */
+    static QImage render(const QString& glyph, int deviceCount, qreal devicePixelRatio);
+
+    /** @brief Number of variants painted so far, including prewarmed ones */
+    int renderCount() const { return m_renderCount; }
+
+signals:
+    void prewarmed();
+
+    /** @brief Icons returned earlier lack a ratio now in use; fetch them again */
+    void devicePixelRatiosChanged();
+
+private:
+    // Pixel ratios are told apart in hundredths, by keys, hash and the ratio list alike
+    static int ratioStep(qreal ratio) { return qRound(ratio * 100); }
+
+    struct Key {
+        QString glyph;
+        int deviceCount;
+        qreal devicePixelRatio;
+
+        bool operator==(const Key& other) const {
+            return deviceCount == other.deviceCount
+                && ratioStep(devicePixelRatio) == ratioStep(other.devicePixelRatio)
+                && glyph == other.glyph;
+        }
+    };
+    friend size_t qHash(const Key& key, size_t seed) {
+        return qHashMulti(seed, key.glyph, key.deviceCount, ratioStep(key.devicePixelRatio));
+    }
+
+    struct Rendered {
+        Key key;
+        QImage image;
+    };
+
+    // The badge only appears for two or more devices
+    static int badgeCount(int deviceCount) { return deviceCount > 1 ? deviceCount : 0; }
+
+    const QImage& image(const Key& key);
+    void watchScreen(QScreen *screen);
+
+    QList<qreal> m_ratios;
+    QHash<Key, QImage> m_images;
+    QHash<Key, QIcon> m_icons;
+    int m_renderCount = 0;
+};
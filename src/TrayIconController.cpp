@@ -1,12 +1,24 @@
 #include "TrayIconController.h"
+#include "TrayIconCache.h"
+#include "RuntimeStats.h"
+#include <utility>
 #include <QAction>
-#include <QPainter>
 #include <QApplication>
+#include <QDateTime>
 #include <QDesktopServices>
 #include <QUrl>
 #include <QKeyEvent>
+#include <QLocale>
+#include <QSet>
 
 TrayIconController::TrayIconController(QObject *parent) : QObject(parent), m_devicesMenu(nullptr) {
+    m_iconCache = new TrayIconCache(this);
+    connect(m_iconCache, &TrayIconCache::devicePixelRatiosChanged, this, [this]() {
+        // The shown icon lacks the new ratio
+        if (!m_lastIconEmoji.isEmpty()) {
+            m_trayIcon->setIcon(m_iconCache->icon(m_lastIconEmoji, m_lastDeviceCount));
+        }
+    });
     m_trayIcon = new QSystemTrayIcon(this);
     m_trayMenu = new QMenu();
 
@@ -78,58 +90,69 @@ void TrayIconController::resetKonamiCode() {
 }
 
 void TrayIconController::updateIcon(const QList<HeadsetDevice>& devices) {
+    updateIcon(devices, DeviceChangeSet::all());
+}
+
+void TrayIconController::updateIcon(const QList<HeadsetDevice>& devices, const DeviceChangeSet& changes) {
     int deviceCount = devices.size();
-    const quint64 devicesSignatureHash = buildDeviceStateSignatureHash(devices);
+    m_showingLastKnown = false;
 
-    if (devicesSignatureHash != m_lastDevicesSignatureHash) {
-        rebuildDevicesMenu(devices);
-        m_lastDevicesSignatureHash = devicesSignatureHash;
-    }
+    // Texts and menu entries are re-rendered only for the devices in the change set
+    const bool textChanged = m_statusText.update(devices, changes);
+    updateDevicesMenu(devices, changes);
 
     if (devices.isEmpty()) {
-        setTrayIconFromEmoji("🎧", 0);
-        setTooltip("No headset found");
+        setTrayIconFromEmoji(QStringLiteral("🎧"), 0);
+        setTooltip(QStringLiteral("No headset found"));
+        emit iconUpdated();
         return;
     }
 
-    QStringList tooltips;
-    QString emoji;
     bool anyWarning = false;
     bool anyCharging = false;
     bool anyUSB = false;
 
     for (const HeadsetDevice &device : devices) {
-        QString status;
-        if (!device.isPresent) {
-            status = "(Not present)";
-            anyWarning = true;
-        } else if (device.battery < m_lowBatteryThreshold) {
-            status = QString("%1% (Low)").arg(int(device.battery));
+        if (!device.isPresent || device.battery < m_lowBatteryThreshold) {
             anyWarning = true;
         } else if (device.isCharging) {
-            status = QString("%1% (Charging)").arg(int(device.battery));
             anyCharging = true;
-        } else {
-            status = QString("%1%").arg(int(device.battery));
         }
-        if (device.connectionType == "USB") anyUSB = true;
-        tooltips << QString("%1\nConnection: %2\nBattery: %3").arg(device.model).arg(device.connectionType).arg(status);
+        if (device.connectionType == ConnectionType::USB) anyUSB = true;
+    }
+
+    // Tooltip segments are only reformatted for devices whose state changed
+    if (textChanged) {
+        setTooltip(m_statusText.tooltip());
     }
 
     // Select appropriate emoji based on device state
     if (anyWarning) {
-        emoji = "⚠️";
+        setTrayIconFromEmoji(QStringLiteral("⚠️"), deviceCount);
     } else if (anyCharging) {
-        emoji = "⚡";
+        setTrayIconFromEmoji(QStringLiteral("⚡"), deviceCount);
     } else if (anyUSB) {
-        emoji = "🔌";
+        setTrayIconFromEmoji(QStringLiteral("🔌"), deviceCount);
     } else {
-        emoji = "🎧";
+        setTrayIconFromEmoji(QStringLiteral("🎧"), deviceCount);
     }
+    emit iconUpdated();
+}
+
+void TrayIconController::showLastKnown(const QList<HeadsetDevice>& devices, qint64 savedAtMs) {
+    if (devices.isEmpty()) {
+        return;
+    }
+
+    // Formatted on the side, so the first real update starts from scratch
+    StatusTextBuilder text(m_lowBatteryThreshold);
+    text.update(devices);
 
-    QString tooltip = tooltips.join("\n\n");
-    setTooltip(tooltip);
-    setTrayIconFromEmoji(emoji, deviceCount);
+    const QDateTime savedAt = QDateTime::fromMSecsSinceEpoch(savedAtMs);
+    setTrayIconFromEmoji(QStringLiteral("⏳"), devices.size());
+    setTooltip(QString("Last known state (%1), updating…\n\n%2")
+                   .arg(QLocale().toString(savedAt, QLocale::ShortFormat), text.tooltip()));
+    m_showingLastKnown = true;
 }
 
 void TrayIconController::setTooltip(const QString& text) {
@@ -143,6 +166,7 @@ void TrayIconController::setTooltip(const QString& text) {
 
 void TrayIconController::setLowBatteryThreshold(int threshold) {
     m_lowBatteryThreshold = qBound(0, threshold, 100);
+    m_statusText.setLowBatteryThreshold(m_lowBatteryThreshold);
 }
 
 QSystemTrayIcon* TrayIconController::trayIcon() const {
@@ -163,132 +187,194 @@ void TrayIconController::setTrayIconFromEmoji(const QString &emoji, int deviceCo
     m_lastIconEmoji = safeEmoji;
     m_lastDeviceCount = deviceCount;
 
-    QSize size(32, 32);
-    QPixmap pixmap(size);
-    pixmap.fill(Qt::transparent);
-
-    QPainter painter(&pixmap);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setRenderHint(QPainter::TextAntialiasing);
-
-    // Use system font for emoji rendering
-    QFont emojiFont = QFont();
-    emojiFont.setPointSize(18);
-    painter.setFont(emojiFont);
-    painter.setPen(Qt::white);
-
-    // Draw emoji centered
-    painter.drawText(pixmap.rect(), Qt::AlignCenter, safeEmoji);
-
-    // Draw device count badge if multiple devices
-    if (deviceCount > 1) {
-        QFont countFont = QFont();
-        countFont.setPointSize(10);
-        countFont.setBold(true);
-        painter.setFont(countFont);
-
-        QRect countRect(size.width() - 16, size.height() - 14, 16, 14);
-        painter.setPen(Qt::yellow);
-        painter.drawText(countRect, Qt::AlignRight | Qt::AlignBottom, QString::number(deviceCount));
-    }
+    // Rendered once per glyph, count and pixel ratio; later changes only swap icons
+    m_trayIcon->setIcon(m_iconCache->icon(safeEmoji, deviceCount));
+}
 
-    painter.end();
-    m_trayIcon->setIcon(QIcon(pixmap));
+void TrayIconController::prewarmIcons() {
+    // Every glyph updateIcon() can pick, with badges for a typical device count
+    m_iconCache->prewarm({"🎧", "⚠️", "⚡", "🔌"}, 4);
 }
 
-quint64 TrayIconController::buildDeviceStateSignatureHash(const QList<HeadsetDevice>& devices) const {
-    quint64 aggregate = static_cast<quint64>(devices.size()) * 1099511628211ULL;
+void TrayIconController::updateDevicesMenu(const QList<HeadsetDevice>& devices,
+                                           const DeviceChangeSet& changes) {
+    updateSingleDeviceActions(devices);
+
+    // Only show the devices menu if we have multiple devices
+    if (devices.size() <= 1) {
+        if (m_devicesMenu) {
+            m_trayMenu->removeAction(m_devicesMenu->menuAction());
+            m_trayMenu->removeAction(m_devicesSeparator);
+            m_devicesMenu->deleteLater();
+            m_devicesSeparator->deleteLater();
+            m_devicesMenu = nullptr;
+            m_devicesSeparator = nullptr;
+            m_deviceEntries.clear();
+        }
+        m_menuDevices.clear();
+        m_dirtyMenuPaths.clear();
+        return;
+    }
 
-    for (const HeadsetDevice& device : devices) {
-        const quint64 batteryBucket = static_cast<quint64>(device.battery * 10.0);
-        aggregate ^= qHash(device.dbusPath);
-        aggregate ^= (static_cast<quint64>(qHash(device.model)) << 1);
-        aggregate ^= (batteryBucket << 2);
-        aggregate ^= (device.isCharging ? 0x9e3779b185ebca87ULL : 0ULL);
-        aggregate ^= (device.isPresent ? 0xc2b2ae3d27d4eb4fULL : 0ULL);
+    m_menuDevices = devices;
+    m_devicesMenuRebuild |= changes.orderChanged || changes.everything;
+    for (const DeviceChange& change : changes.changes) {
+        if (change.fields & kDeviceStateFields) {
+            m_dirtyMenuPaths.insert(change.dbusPath);
+        }
     }
 
-    return aggregate;
-}
+    if (!m_devicesMenu) {
+        m_devicesMenuRebuild = true;
 
-QString TrayIconController::getDeviceEmoji(const HeadsetDevice& device) const {
-    if (!device.isPresent) {
-        return "⚠️";
-    } else if (device.battery < m_lowBatteryThreshold && !device.isCharging) {
-        return "🪫"; // Low battery
-    } else if (device.isCharging) {
-        return "⚡";
-    } else if (device.connectionType == "USB") {
-        return "🔌";
-    } else {
-        return "🎧";
+        // Entries are created when the submenu is first opened
+        m_devicesMenu = new QMenu("Connected Devices", m_trayMenu);
+        connect(m_devicesMenu, &QMenu::aboutToShow, this, &TrayIconController::syncDevicesMenu);
+
+        // Insert devices menu at the top of the menu
+        QAction *firstAction = m_trayMenu->actions().first();
+        m_trayMenu->insertMenu(firstAction, m_devicesMenu);
+        m_devicesSeparator = m_trayMenu->insertSeparator(firstAction);
+    }
+
+    // Patch the open menu in place; a closed one catches up on aboutToShow
+    if (m_trayMenu->isVisible()) {
+        syncDevicesMenu();
     }
 }
 
-void TrayIconController::rebuildDevicesMenu(const QList<HeadsetDevice>& devices) {
-    // Remove old devices menu if it exists
-    if (m_devicesMenu) {
-        m_trayMenu->removeAction(m_devicesMenu->menuAction());
-        m_devicesMenu->deleteLater();
-        m_devicesMenu = nullptr;
+void TrayIconController::syncDevicesMenu() {
+    if (!m_devicesMenu) {
+        return;
     }
 
-    // Only create devices menu if we have multiple devices
-    if (devices.size() > 1) {
-        m_devicesMenu = new QMenu("Connected Devices");
-        m_devicesMenu->setParent(m_trayMenu);
-
-        for (const HeadsetDevice& device : devices) {
-            // Create submenu for each device
-            QMenu *deviceSubmenu = m_devicesMenu->addMenu(
-                QString("%1 %2").arg(getDeviceEmoji(device)).arg(device.model)
-            );
-
-            // Battery status
-            QString batteryStatus;
-            if (!device.isPresent) {
-                batteryStatus = "Not present";
-            } else if (device.isCharging) {
-                batteryStatus = QString("%1% (Charging)").arg(int(device.battery));
-            } else if (device.battery < m_lowBatteryThreshold) {
-                batteryStatus = QString("%1% (Low)").arg(int(device.battery));
-            } else {
-                batteryStatus = QString("%1%").arg(int(device.battery));
+    // Same devices in the same order: patch only the entries that changed
+    if (!m_devicesMenuRebuild) {
+        for (const QString& dbusPath : std::as_const(m_dirtyMenuPaths)) {
+            const auto entry = m_deviceEntries.constFind(dbusPath);
+            const int index = m_statusText.indexOf(dbusPath);
+            if (entry != m_deviceEntries.constEnd() && index >= 0) {
+                updateDeviceEntry(*entry, index, m_menuDevices.at(index));
             }
+        }
+        if (!m_dirtyMenuPaths.isEmpty()) {
+            RuntimeStats::global().menuPatches.add();
+        }
+        m_dirtyMenuPaths.clear();
+        return;
+    }
+    m_devicesMenuRebuild = false;
+    RuntimeStats::global().menuRebuilds.add();
+    m_dirtyMenuPaths.clear();
+
+    // Drop entries for devices that went away
+    QSet<QString> currentPaths;
+    for (const HeadsetDevice& device : m_menuDevices) {
+        currentPaths.insert(device.dbusPath);
+    }
+    for (auto it = m_deviceEntries.begin(); it != m_deviceEntries.end();) {
+        if (!currentPaths.contains(it.key())) {
+            m_devicesMenu->removeAction(it->submenu->menuAction());
+            it->submenu->deleteLater();
+            it = m_deviceEntries.erase(it);
+        } else {
+            ++it;
+        }
+    }
 
-            QAction *batteryAction = new QAction(QString("Battery: %1").arg(batteryStatus));
-            batteryAction->setEnabled(false);
-            deviceSubmenu->addAction(batteryAction);
-
-            // Connection type
-            QAction *connectionAction = new QAction(QString("Connection: %1").arg(device.connectionType));
-            connectionAction->setEnabled(false);
-            deviceSubmenu->addAction(connectionAction);
-
-            // Charging status
-            if (device.isPresent) {
-                QAction *chargingAction = new QAction(
-                    device.isCharging ? "Status: Charging" : "Status: On Battery"
-                );
-                chargingAction->setEnabled(false);
-                deviceSubmenu->addAction(chargingAction);
-            }
+    // Add new devices and patch existing ones, keeping enumeration order
+    for (int i = 0; i < m_menuDevices.size(); ++i) {
+        const HeadsetDevice& device = m_menuDevices.at(i);
+        auto entry = m_deviceEntries.find(device.dbusPath);
+        if (entry == m_deviceEntries.end()) {
+            entry = m_deviceEntries.insert(device.dbusPath, createDeviceEntry(device.dbusPath));
+        }
+        updateDeviceEntry(*entry, m_statusText.indexOf(device.dbusPath, i), device);
+
+        QAction *menuAction = entry->submenu->menuAction();
+        if (m_devicesMenu->actions().value(i) != menuAction) {
+            m_devicesMenu->removeAction(menuAction);
+            m_devicesMenu->insertAction(m_devicesMenu->actions().value(i), menuAction);
+        }
+    }
+}
+
+TrayIconController::DeviceMenuEntry TrayIconController::createDeviceEntry(const QString& dbusPath) {
+    DeviceMenuEntry entry;
+    entry.submenu = new QMenu(m_devicesMenu);
+
+    // Status lines are informational only
+    entry.batteryAction = entry.submenu->addAction(QString());
+    entry.batteryAction->setEnabled(false);
+    entry.connectionAction = entry.submenu->addAction(QString());
+    entry.connectionAction->setEnabled(false);
+    entry.chargingAction = entry.submenu->addAction(QString());
+    entry.chargingAction->setEnabled(false);
+
+    // Add separator before action buttons
+    entry.submenu->addSeparator();
+
+    // Show details action
+    QAction *detailsAction = entry.submenu->addAction("Show Details");
+    connect(detailsAction, &QAction::triggered, this, [this, dbusPath]() {
+        emit deviceDetailsRequested(dbusPath);
+    });
+
+    addOverrideActions(entry.submenu, nullptr, [dbusPath]() { return dbusPath; });
+    return entry;
+}
 
-            // Add separator before action buttons
-            deviceSubmenu->addSeparator();
+void TrayIconController::addOverrideActions(QMenu *menu, QAction *before,
+                                            const std::function<QString()>& dbusPath) {
+    // Listed devices are already headsets, so "Always a Headset" would not
+    // change anything here; it is offered in the settings dialog instead
+    QAction *ignoreAction = new QAction("Not a Headset", menu);
+    connect(ignoreAction, &QAction::triggered, this, [this, dbusPath]() {
+        emit deviceIgnoreRequested(dbusPath());
+    });
+    QAction *resetAction = new QAction("Reset Classification", menu);
+    connect(resetAction, &QAction::triggered, this, [this, dbusPath]() {
+        emit deviceResetRequested(dbusPath());
+    });
+    menu->insertAction(before, ignoreAction);
+    menu->insertAction(before, resetAction);
+}
 
-            // Show details action
-            QAction *detailsAction = new QAction("Show Details");
-            QString dbusPath = device.dbusPath; // Capture by value
-            connect(detailsAction, &QAction::triggered, [this, dbusPath]() {
-                emit deviceDetailsRequested(dbusPath);
-            });
-            deviceSubmenu->addAction(detailsAction);
+void TrayIconController::updateSingleDeviceActions(const QList<HeadsetDevice>& devices) {
+    if (devices.size() != 1) {
+        for (QAction *action : std::as_const(m_singleDeviceActions)) {
+            m_trayMenu->removeAction(action);
+            action->deleteLater();
         }
+        m_singleDeviceActions.clear();
+        m_singleDevicePath.clear();
+        return;
+    }
 
-        // Insert devices menu at the top of the menu
+    // The actions follow whichever device is the only one
+    m_singleDevicePath = devices.first().dbusPath;
+    if (m_singleDeviceActions.isEmpty()) {
         QAction *firstAction = m_trayMenu->actions().first();
-        m_trayMenu->insertMenu(firstAction, m_devicesMenu);
+        addOverrideActions(m_trayMenu, firstAction, [this]() { return m_singleDevicePath; });
         m_trayMenu->insertSeparator(firstAction);
+
+        const QList<QAction*> actions = m_trayMenu->actions();
+        m_singleDeviceActions = actions.mid(0, actions.indexOf(firstAction));
     }
-} 
+}
+
+void TrayIconController::updateDeviceEntry(const DeviceMenuEntry& entry, int textIndex,
+                                           const HeadsetDevice& device) {
+    // Labels come pre-built from the status text; QAction and QMenu ignore
+    // setters that do not change anything
+    if (textIndex >= 0) {
+        entry.submenu->setTitle(m_statusText.menuTitle(textIndex));
+        entry.batteryAction->setText(m_statusText.batteryLabel(textIndex));
+        entry.connectionAction->setText(m_statusText.connectionLabel(textIndex));
+    }
+
+    // Charging status is only meaningful while the device is present
+    entry.chargingAction->setText(device.isCharging ? QStringLiteral("Status: Charging")
+                                                    : QStringLiteral("Status: On Battery"));
+    entry.chargingAction->setVisible(device.isPresent);
+}
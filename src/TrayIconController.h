@@ -1,13 +1,18 @@
 #pragma once
 #include <QObject>
 #include <QSystemTrayIcon>
+#include <QHash>
+#include <QSet>
 #include <QMenu>
 #include <QTimer>
 #include <QtGlobal>
-#include <limits>
+#include <functional>
+#include "DeviceChange.h"
 #include "HeadsetDevice.h"
+#include "StatusTextBuilder.h"
 
 class QKeyEvent;
+class TrayIconCache;
 
 /**
  * @class TrayIconController
@@ -27,6 +32,29 @@ public:
      */
     void updateIcon(const QList<HeadsetDevice>& devices);
 
+    /**
+     * @brief Updates the tray icon, re-rendering only what @p changes names
+     * @param devices List of currently connected headset devices
+     * @param changes Devices and fields that changed since the last update
+     */
+    void updateIcon(const QList<HeadsetDevice>& devices, const DeviceChangeSet& changes);
+
+    /**
+     * @brief Shows devices remembered from the previous run until the first updateIcon()
+     *
+     * The icon is an hourglass with the remembered device count and the
+     * tooltip lists the remembered state under the time it was current.
+     *
+     * @param devices Devices from LastStateStore
+     * @param savedAtMs When they were current, ms since the Unix epoch
+     */
+    void showLastKnown(const QList<HeadsetDevice>& devices, qint64 savedAtMs);
+
+    /**
+     * @brief Returns true while showLastKnown() has not been replaced by real state
+     */
+    bool isShowingLastKnown() const { return m_showingLastKnown; }
+
     /**
      * @brief Sets the tooltip text for the tray icon
      * @param text Tooltip text to display
@@ -39,6 +67,11 @@ public:
      */
     void setLowBatteryThreshold(int threshold);
 
+    /**
+     * @brief Renders all state icons in the background ahead of first use
+     */
+    void prewarmIcons();
+
     QSystemTrayIcon* trayIcon() const;
     QMenu* trayMenu() const;
     bool eventFilter(QObject *obj, QEvent *event) override;
@@ -48,44 +81,86 @@ signals:
     void aboutRequested();
     void settingsRequested();
     void deviceDetailsRequested(const QString& dbusPath);
+    void deviceIgnoreRequested(const QString& dbusPath);
+    void deviceResetRequested(const QString& dbusPath);
+
+    /**
+     * @brief Emitted after updateIcon() has applied a device list
+     */
+    void iconUpdated();
 
 private slots:
     void resetKonamiCode();
 
+    /**
+     * @brief Brings the devices submenu up to date with the last device list
+     *
+     * Runs when the submenu is about to open, or immediately while the tray
+     * menu is visible. Only entries of added or removed devices are created
+     * or destroyed; the rest have their texts patched in place.
+     */
+    void syncDevicesMenu();
+
 private:
     QSystemTrayIcon *m_trayIcon;
     QMenu *m_trayMenu;
     QMenu *m_devicesMenu;
+    QAction *m_devicesSeparator = nullptr;
+    TrayIconCache *m_iconCache;
     QTimer *konamiTimer;
     int m_lowBatteryThreshold = 20;
     QList<int> konamiSequence;
     int konamiIndex;
 
     /**
-     * @brief Creates a tray icon from emoji text
+     * @brief Shows the cached tray icon for emoji text
      * @param emoji Emoji character(s) to display
      * @param deviceCount Number of devices (shows count badge if > 1)
      */
     void setTrayIconFromEmoji(const QString &emoji, int deviceCount);
 
+    // Per-device submenu and the actions whose text follows device state
+    struct DeviceMenuEntry {
+        QMenu *submenu = nullptr;
+        QAction *batteryAction = nullptr;
+        QAction *connectionAction = nullptr;
+        QAction *chargingAction = nullptr;
+    };
+
     /**
-     * @brief Rebuilds the devices submenu with current device list
+     * @brief Records the device list for the devices submenu
      * @param devices List of connected headset devices
+     * @param changes Devices whose entries need patching
+     *
+     * Creates or removes the submenu itself; its entries are built lazily
+     * by syncDevicesMenu().
      */
-    void rebuildDevicesMenu(const QList<HeadsetDevice>& devices);
+    void updateDevicesMenu(const QList<HeadsetDevice>& devices, const DeviceChangeSet& changes);
+    DeviceMenuEntry createDeviceEntry(const QString& dbusPath);
 
     /**
-     * @brief Gets emoji for device state
-     * @param device Headset device to get emoji for
-     * @return Emoji string representing device state
+     * @brief Shows the classification actions in the tray menu itself
+     *        while exactly one device is listed, which gets no submenu
      */
-    QString getDeviceEmoji(const HeadsetDevice& device) const;
-    quint64 buildDeviceStateSignatureHash(const QList<HeadsetDevice>& devices) const;
+    void updateSingleDeviceActions(const QList<HeadsetDevice>& devices);
+    void addOverrideActions(QMenu *menu, QAction *before, const std::function<QString()>& dbusPath);
+    void updateDeviceEntry(const DeviceMenuEntry& entry, int textIndex, const HeadsetDevice& device);
 
     void checkKonamiCode(int key);
 
+    StatusTextBuilder m_statusText;
     QString m_lastTooltip;
     QString m_lastIconEmoji;
     int m_lastDeviceCount = -1;
-    quint64 m_lastDevicesSignatureHash = std::numeric_limits<quint64>::max();
+    bool m_showingLastKnown = false;
+
+    // Devices submenu state, keyed by D-Bus path
+    QList<HeadsetDevice> m_menuDevices;
+    QHash<QString, DeviceMenuEntry> m_deviceEntries;
+    QSet<QString> m_dirtyMenuPaths;
+    bool m_devicesMenuRebuild = false;
+
+    // Classification actions of the only device, in the tray menu itself
+    QList<QAction*> m_singleDeviceActions;
+    QString m_singleDevicePath;
 };
@@ -0,0 +1,125 @@
+#include "FakeBluez.h"
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QMutexLocker>
+
+namespace {
+const QString kObjectManagerInterface = QStringLiteral("org.freedesktop.DBus.ObjectManager");
+const QString kPropertiesInterface = QStringLiteral("org.freedesktop.DBus.Properties");
+
+const char kRootIntrospection[] =
+    "<interface name=\"org.freedesktop.DBus.ObjectManager\">"
+    "<method name=\"GetManagedObjects\">"
+    "<arg name=\"objects\" type=\"a{oa{sa{sv}}}\" direction=\"out\"/>"
+    "</method>"
+    "<signal name=\"InterfacesAdded\">"
+    "<arg name=\"object\" type=\"o\"/><arg name=\"interfaces\" type=\"a{sa{sv}}\"/>"
+    "</signal>"
+    "<signal name=\"InterfacesRemoved\">"
+    "<arg name=\"object\" type=\"o\"/><arg name=\"interfaces\" type=\"as\"/>"
+    "</signal>"
+    "</interface>";
+}
+
+FakeBluez::FakeBluez(QObject *parent) : QDBusVirtualObject(parent) {
+    qDBusRegisterMetaType<BluezBackend::InterfaceMap>();
+    qDBusRegisterMetaType<BluezBackend::ManagedObjects>();
+}
+
+bool FakeBluez::registerOn(const QDBusConnection& bus) {
+    m_bus = bus;
+    return m_bus.registerVirtualObject(QStringLiteral("/"), this, QDBusConnection::SubPath)
+        && m_bus.registerService(QLatin1String(BluezBackend::kServiceName));
+}
+
+QVariantMap FakeBluez::deviceProperties(const QString& alias, const QString& icon, bool connected) {
+    QVariantMap properties = {
+        {"Alias", alias},
+        {"Name", alias},
+        {"Connected", connected},
+        {"Paired", true},
+    };
+    if (!icon.isEmpty()) {
+        properties.insert("Icon", icon);
+    }
+    return properties;
+}
+
+QVariantMap FakeBluez::batteryProperties(int percentage) {
+    return {{"Percentage", QVariant::fromValue(uchar(percentage))}};
+}
+
+void FakeBluez::addInterfaces(const QString& path, const BluezBackend::InterfaceMap& interfaces, bool emitSignal) {
+    {
+        QMutexLocker locker(&m_mutex);
+        BluezBackend::InterfaceMap& object = m_objects[QDBusObjectPath(path)];
+        for (auto it = interfaces.constBegin(); it != interfaces.constEnd(); ++it) {
+            object.insert(it.key(), it.value());
+        }
+    }
+
+    if (emitSignal) {
+        this->emitSignal(QStringLiteral("/"), kObjectManagerInterface, "InterfacesAdded",
+                         {QVariant::fromValue(QDBusObjectPath(path)), QVariant::fromValue(interfaces)});
+    }
+}
+
+void FakeBluez::removeInterfaces(const QString& path, const QStringList& interfaces) {
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_objects.find(QDBusObjectPath(path));
+        if (it == m_objects.end()) {
+            return;
+        }
+        for (const QString& interface : interfaces) {
+            it->remove(interface);
+        }
+        if (it->isEmpty()) {
+            m_objects.erase(it);
+        }
+    }
+
+    emitSignal(QStringLiteral("/"), kObjectManagerInterface, "InterfacesRemoved",
+               {QVariant::fromValue(QDBusObjectPath(path)), interfaces});
+}
+
+void FakeBluez::changeProperties(const QString& path, const QString& interface, const QVariantMap& changedProperties) {
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_objects.find(QDBusObjectPath(path));
+        if (it == m_objects.end() || !it->contains(interface)) {
+            return;
+        }
+        QVariantMap& properties = (*it)[interface];
+        for (auto change = changedProperties.constBegin(); change != changedProperties.constEnd(); ++change) {
+            properties.insert(change.key(), change.value());
+        }
+    }
+
+    emitSignal(path, kPropertiesInterface, "PropertiesChanged", {interface, changedProperties, QStringList()});
+}
+
+void FakeBluez::emitSignal(const QString& path, const QString& interface, const QString& name,
+                           const QVariantList& arguments) {
+    QDBusMessage signal = QDBusMessage::createSignal(path, interface, name);
+    signal.setArguments(arguments);
+    m_bus.send(signal);
+}
+
+QString FakeBluez::introspect(const QString& path) const {
+    return path == QLatin1String("/") ? QString::fromLatin1(kRootIntrospection) : QString();
+}
+
+bool FakeBluez::handleMessage(const QDBusMessage& message, const QDBusConnection& connection) {
+    if (message.path() == QLatin1String("/") && message.interface() == kObjectManagerInterface
+        && message.member() == QLatin1String("GetManagedObjects")) {
+        ++m_snapshots;
+        BluezBackend::ManagedObjects objects;
+        {
+            QMutexLocker locker(&m_mutex);
+            objects = m_objects;
+        }
+        return connection.send(message.createReply(QVariant::fromValue(objects)));
+    }
+    return false;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <QDBusConnection>
+#include <QDBusVirtualObject>
+#include <QMutex>
+#include <QStringList>
+#include <atomic>
+#include "../src/BluezBackend.h"
+
+/**
+ * @class FakeBluez
+ * @brief Scriptable stand-in for bluetoothd on a private bus
+ *
+ * Answers ObjectManager.GetManagedObjects at "/" and emits InterfacesAdded,
+ * InterfacesRemoved and PropertiesChanged on demand. Only the interfaces
+ * the objects are given exist; there are no adapters unless added.
+ * Thread-safe, since QtDBus may deliver calls outside the owning thread.
+ */
+class FakeBluez : public QDBusVirtualObject {
+    Q_OBJECT
+public:
+    explicit FakeBluez(QObject *parent = nullptr);
+
+    /**
+     * @brief Claims org.bluez and exports the object tree
+     * @param bus Connection the fake serves on
+     */
+    bool registerOn(const QDBusConnection& bus);
+
+    /**
+     * @brief Device1 properties of a device with the given icon and alias
+     */
+    static QVariantMap deviceProperties(const QString& alias, const QString& icon, bool connected = true);
+
+    /**
+     * @brief Battery1 properties with the given percentage
+     */
+    static QVariantMap batteryProperties(int percentage);
+
+    /**
+     * @brief Adds interfaces to an object and emits InterfacesAdded
+     * @param emitSignal False to only change what the next snapshot returns
+     */
+    void addInterfaces(const QString& path, const BluezBackend::InterfaceMap& interfaces, bool emitSignal = true);
+    void removeInterfaces(const QString& path, const QStringList& interfaces);
+    void changeProperties(const QString& path, const QString& interface, const QVariantMap& changedProperties);
+
+    int snapshotCount() const { return m_snapshots.load(); }
+
+    QString introspect(const QString& path) const override;
+    bool handleMessage(const QDBusMessage& message, const QDBusConnection& connection) override;
+
+private:
+    void emitSignal(const QString& path, const QString& interface, const QString& name,
+                    const QVariantList& arguments);
+
+    mutable QMutex m_mutex;
+    BluezBackend::ManagedObjects m_objects;
+    QDBusConnection m_bus{QString()};
+    std::atomic<int> m_snapshots{0};
+};
@@ -0,0 +1,185 @@
+#include "FakeUPower.h"
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusObjectPath>
+#include <QDBusVariant>
+#include <QMutexLocker>
+#include <QThread>
+
+namespace {
+const QString kUPowerInterface = QStringLiteral("org.freedesktop.UPower");
+const QString kDeviceInterface = QStringLiteral("org.freedesktop.UPower.Device");
+const QString kPropertiesInterface = QStringLiteral("org.freedesktop.DBus.Properties");
+
+const char kManagerIntrospection[] =
+    "<interface name=\"org.freedesktop.UPower\">"
+    "<method name=\"EnumerateDevices\"><arg name=\"devices\" type=\"ao\" direction=\"out\"/></method>"
+    "<signal name=\"DeviceAdded\"><arg name=\"device\" type=\"o\"/></signal>"
+    "<signal name=\"DeviceRemoved\"><arg name=\"device\" type=\"o\"/></signal>"
+    "</interface>";
+
+const char kDeviceIntrospection[] =
+    "<interface name=\"org.freedesktop.UPower.Device\">"
+    "<property name=\"NativePath\" type=\"s\" access=\"read\"/>"
+    "<property name=\"Model\" type=\"s\" access=\"read\"/>"
+    "<property name=\"Percentage\" type=\"d\" access=\"read\"/>"
+    "<property name=\"State\" type=\"u\" access=\"read\"/>"
+    "<property name=\"IsPresent\" type=\"b\" access=\"read\"/>"
+    "</interface>";
+}
+
+const QString FakeUPower::kServiceName = QStringLiteral("org.freedesktop.UPower");
+const QString FakeUPower::kObjectPath = QStringLiteral("/org/freedesktop/UPower");
+
+FakeUPower::FakeUPower(QObject *parent) : QDBusVirtualObject(parent) {}
+
+bool FakeUPower::registerOn(const QDBusConnection& bus) {
+    m_bus = bus;
+    return m_bus.registerVirtualObject(kObjectPath, this, QDBusConnection::SubPath)
+        && m_bus.registerService(kServiceName);
+}
+
+QList<FakeUPowerDevice> FakeUPower::syntheticDevices(int count, int headsetEvery) {
+    QList<FakeUPowerDevice> devices;
+    devices.reserve(count);
+
+    for (int i = 0; i < count; ++i) {
+        const bool headset = headsetEvery > 0 && i % headsetEvery == 0;
+        const bool usb = i % 2 == 0;
+
+        FakeUPowerDevice device;
+        device.path = QString("%1/devices/%2_%3")
+            .arg(kObjectPath, headset ? QStringLiteral("headset_dev") : QStringLiteral("mouse_dev"))
+            .arg(i);
+        device.properties = {
+            {"NativePath", usb ? QString("usb-0000:00:14.0-%1").arg(i) : QString("/org/bluez/hci0/dev_%1").arg(i)},
+            {"Model", headset ? QString("Jabra Evolve2 %1").arg(i) : QString("MX Master %1").arg(i)},
+            {"Percentage", double(20 + i % 80)},
+            {"State", 2u},
+            {"IsPresent", true},
+        };
+        devices.append(device);
+    }
+
+    return devices;
+}
+
+void FakeUPower::setDevices(const QList<FakeUPowerDevice>& devices) {
+    QMutexLocker locker(&m_mutex);
+    m_order.clear();
+    m_devices.clear();
+    for (const FakeUPowerDevice& device : devices) {
+        m_order.append(device.path);
+        m_devices.insert(device.path, device.properties);
+    }
+}
+
+void FakeUPower::addDevice(const FakeUPowerDevice& device) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_devices.contains(device.path)) {
+            m_order.append(device.path);
+        }
+        m_devices.insert(device.path, device.properties);
+    }
+
+    emitSignal(kObjectPath, kUPowerInterface, "DeviceAdded",
+               {QVariant::fromValue(QDBusObjectPath(device.path))});
+}
+
+void FakeUPower::removeDevice(const QString& path) {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_order.removeAll(path);
+        m_devices.remove(path);
+    }
+
+    emitSignal(kObjectPath, kUPowerInterface, "DeviceRemoved",
+               {QVariant::fromValue(QDBusObjectPath(path))});
+}
+
+void FakeUPower::changeProperties(const QString& path, const QVariantMap& changedProperties) {
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_devices.find(path);
+        if (it == m_devices.end()) {
+            return;
+        }
+        for (auto change = changedProperties.constBegin(); change != changedProperties.constEnd(); ++change) {
+            it->insert(change.key(), change.value());
+        }
+    }
+
+    emitSignal(path, kPropertiesInterface, "PropertiesChanged",
+               {kDeviceInterface, changedProperties, QStringList()});
+}
+
+void FakeUPower::emitSignal(const QString& path, const QString& interface, const QString& name,
+                            const QVariantList& arguments) {
+    QDBusMessage signal = QDBusMessage::createSignal(path, interface, name);
+    signal.setArguments(arguments);
+    m_bus.send(signal);
+}
+
+QString FakeUPower::introspect(const QString& path) const {
+    if (path == kObjectPath) {
+        return QString::fromLatin1(kManagerIntrospection);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    return m_devices.contains(path) ? QString::fromLatin1(kDeviceIntrospection) : QString();
+}
+
+bool FakeUPower::handleMessage(const QDBusMessage& message, const QDBusConnection& connection) {
+    const int delay = m_replyDelayMs.load();
+    if (delay > 0) {
+        QThread::msleep(delay);
+    }
+
+    const QString& path = message.path();
+    const QString& member = message.member();
+
+    if (path == kObjectPath && message.interface() == kUPowerInterface && member == "EnumerateDevices") {
+        ++m_calls;
+        QList<QDBusObjectPath> paths;
+        {
+            QMutexLocker locker(&m_mutex);
+            paths.reserve(m_order.size());
+            for (const QString& devicePath : std::as_const(m_order)) {
+                paths.append(QDBusObjectPath(devicePath));
+            }
+        }
+        return connection.send(message.createReply(QVariant::fromValue(paths)));
+    }
+
+    if (message.interface() != kPropertiesInterface) {
+        return false;
+    }
+
+    QVariantMap properties;
+    {
+        QMutexLocker locker(&m_mutex);
+        const auto it = m_devices.constFind(path);
+        if (it == m_devices.constEnd()) {
+            return false;
+        }
+        properties = it.value();
+    }
+
+    const QVariantList arguments = message.arguments();
+    if (member == "GetAll" && arguments.size() == 1) {
+        ++m_calls;
+        return connection.send(message.createReply(QVariant(properties)));
+    }
+
+    if (member == "Get" && arguments.size() == 2) {
+        ++m_calls;
+        const QVariant value = properties.value(arguments.at(1).toString());
+        if (!value.isValid()) {
+            return connection.send(message.createErrorReply(QDBusError::InvalidArgs, "No such property"));
+        }
+        return connection.send(message.createReply(QVariant::fromValue(QDBusVariant(value))));
+    }
+
+    return false;
+}
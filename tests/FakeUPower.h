@@ -0,0 +1,74 @@
+#pragma once
+#include <QDBusConnection>
+#include <QDBusVirtualObject>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QVariantMap>
+#include <atomic>
+
+/**
+ * @struct FakeUPowerDevice
+ * @brief One synthetic org.freedesktop.UPower.Device object
+ */
+struct FakeUPowerDevice {
+    QString path;
+    QVariantMap properties;
+};
+
+/**
+ * @class FakeUPower
+ * @brief Scriptable stand-in for org.freedesktop.UPower on a private bus
+ *
+ * Answers EnumerateDevices and Properties.Get/GetAll for any number of
+ * synthetic devices from a single virtual object, and can emit DeviceAdded,
+ * DeviceRemoved and PropertiesChanged on demand. Every handled method call
+ * is counted so callers can measure round trips. Thread-safe; keep it in a
+ * thread other than the one making blocking calls against it.
+ */
+class FakeUPower : public QDBusVirtualObject {
+    Q_OBJECT
+public:
+    static const QString kServiceName;
+    static const QString kObjectPath;
+
+    explicit FakeUPower(QObject *parent = nullptr);
+
+    /**
+     * @brief Claims the UPower service name and exports the object tree
+     * @param bus Connection the fake serves on
+     */
+    bool registerOn(const QDBusConnection& bus);
+
+    /**
+     * @brief Builds devices where every @p headsetEvery-th one is a headset
+     */
+    static QList<FakeUPowerDevice> syntheticDevices(int count, int headsetEvery = 4);
+
+    void setDevices(const QList<FakeUPowerDevice>& devices);
+    void addDevice(const FakeUPowerDevice& device);
+    void removeDevice(const QString& path);
+    void changeProperties(const QString& path, const QVariantMap& changedProperties);
+
+    /**
+     * @brief Delays every reply, simulating a slow or busy UPower
+     */
+    void setReplyDelay(int milliseconds) { m_replyDelayMs = milliseconds; }
+
+    int callCount() const { return m_calls.load(); }
+    void resetCallCount() { m_calls = 0; }
+
+    QString introspect(const QString& path) const override;
+    bool handleMessage(const QDBusMessage& message, const QDBusConnection& connection) override;
+
+private:
+    void emitSignal(const QString& path, const QString& interface, const QString& name,
+                    const QVariantList& arguments);
+
+    mutable QMutex m_mutex;
+    QStringList m_order;
+    QHash<QString, QVariantMap> m_devices;
+    QDBusConnection m_bus{QString()};
+    std::atomic<int> m_calls{0};
+    std::atomic<int> m_replyDelayMs{0};
+};
@@ -0,0 +1,52 @@
+#include "PrivateDBus.h"
+#include <QStandardPaths>
+
+PrivateDBus::~PrivateDBus() {
+    for (const QString& name : std::as_const(m_connectionNames)) {
+        QDBusConnection::disconnectFromBus(name);
+    }
+
+    if (m_process.state() != QProcess::NotRunning) {
+        m_process.terminate();
+        if (!m_process.waitForFinished(2000)) {
+            m_process.kill();
+            m_process.waitForFinished(2000);
+        }
+    }
+}
+
+bool PrivateDBus::start(QString *error) {
+    const QString daemon = QStandardPaths::findExecutable("dbus-daemon");
+    if (daemon.isEmpty()) {
+        if (error) {
+            *error = "dbus-daemon not found in PATH";
+        }
+        return false;
+    }
+
+    m_process.start(daemon, {"--session", "--nofork", "--print-address"});
+    if (!m_process.waitForStarted(5000)) {
+        if (error) {
+            *error = "dbus-daemon failed to start: " + m_process.errorString();
+        }
+        return false;
+    }
+
+    // The address is the first line the daemon prints
+    while (!m_process.canReadLine()) {
+        if (!m_process.waitForReadyRead(5000)) {
+            if (error) {
+                *error = "dbus-daemon did not print its address";
+            }
+            return false;
+        }
+    }
+
+    m_address = QString::fromUtf8(m_process.readLine()).trimmed();
+    return !m_address.isEmpty();
+}
+
+QDBusConnection PrivateDBus::connect(const QString& name) {
+    m_connectionNames.append(name);
+    return QDBusConnection::connectToBus(m_address, name);
+}
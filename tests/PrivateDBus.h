@@ -0,0 +1,38 @@
+#pragma once
+#include <QDBusConnection>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @class PrivateDBus
+ * @brief Runs a throwaway dbus-daemon for tests and benchmarks
+ *
+ * Lets tests talk to stand-in services without touching the real system or
+ * session bus. The daemon is terminated when the object is destroyed.
+ */
+class PrivateDBus {
+public:
+    PrivateDBus() = default;
+    ~PrivateDBus();
+
+    /**
+     * @brief Starts the daemon and waits for its address
+     * @param error Receives a description if starting failed (may be null)
+     * @return True if the bus is up
+     */
+    bool start(QString *error = nullptr);
+
+    QString address() const { return m_address; }
+
+    /**
+     * @brief Opens a new named connection to the private bus
+     * @param name Connection name, unique per process
+     */
+    QDBusConnection connect(const QString& name);
+
+private:
+    QProcess m_process;
+    QString m_address;
+    QStringList m_connectionNames;
+};
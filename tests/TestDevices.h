@@ -0,0 +1,26 @@
+#pragma once
+#include <QString>
+#include "../src/HeadsetDevice.h"
+
+/**
+ * @brief A present Bluetooth headset, the device most tests start from
+ * @param path D-Bus object path
+ * @param model Model name
+ * @param battery Battery percentage
+ */
+inline HeadsetDevice makeDevice(const QString& path, const QString& model, double battery) {
+    HeadsetDevice device;
+    device.model = model;
+    device.connectionType = ConnectionType::Bluetooth;
+    device.battery = battery;
+    device.isPresent = true;
+    device.dbusPath = path;
+    return device;
+}
+
+/**
+ * @brief makeDevice() for a Jabra Evolve2 75
+ */
+inline HeadsetDevice makeDevice(const QString& path, double battery) {
+    return makeDevice(path, QStringLiteral("Jabra Evolve2 75"), battery);
+}
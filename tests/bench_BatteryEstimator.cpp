@@ -0,0 +1,60 @@
+#include <QtTest/QtTest>
+#include "../src/BatteryEstimator.h"
+
+/**
+ * @class BenchBatteryEstimator
+ * @brief Measures the cost of feeding one battery sample to every device
+ *
+ * Mirrors HeadsetStatusApp::recordSample(): a hash lookup by D-Bus path,
+ * addSample() and secondsRemaining() per device, at 1,000 and 10,000
+ * devices, with every device stepping one level per round.
+ */
+class BenchBatteryEstimator : public QObject {
+    Q_OBJECT
+
+private slots:
+    void benchUpdateAll_data() {
+        QTest::addColumn<int>("deviceCount");
+        QTest::newRow("1000 devices") << 1000;
+        QTest::newRow("10000 devices") << 10000;
+    }
+
+    void benchUpdateAll() {
+        QFETCH(int, deviceCount);
+
+        QStringList paths;
+        QHash<QString, BatteryEstimator> estimators;
+        for (int i = 0; i < deviceCount; ++i) {
+            paths.append(QString("/org/freedesktop/UPower/devices/headset_dev_%1").arg(i));
+            estimators.insert(paths.last(), BatteryEstimator());
+        }
+
+        qint64 time = 0;
+        int round = 0;
+        qint64 checksum = 0;
+        QBENCHMARK {
+            time += 6 * 60 * 1000;
+            const double level = 100 - round++ % 100;
+            for (const QString& path : std::as_const(paths)) {
+                BatteryEstimator& estimator = estimators[path];
+                estimator.addSample(time, level, false, true);
+                checksum += estimator.secondsRemaining();
+            }
+        }
+        QVERIFY(checksum != 0);
+    }
+
+    void benchAddSample() {
+        BatteryEstimator estimator;
+        qint64 time = 0;
+        int round = 0;
+        QBENCHMARK {
+            time += 6 * 60 * 1000;
+            estimator.addSample(time, 100 - round++ % 100, false, true);
+        }
+        QVERIFY(estimator.secondsRemaining() >= -1);
+    }
+};
+
+QTEST_MAIN(BenchBatteryEstimator)
+#include "bench_BatteryEstimator.moc"
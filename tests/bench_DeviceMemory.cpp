@@ -0,0 +1,156 @@
+#include <QtTest/QtTest>
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include "../src/HeadsetDevice.h"
+#include "../src/StringPool.h"
+
+// Live heap bytes, tracked through the real size of every block
+namespace {
+std::atomic<qint64> g_liveBytes{0};
+
+void *countedAlloc(std::size_t size) {
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    g_liveBytes.fetch_add(qint64(malloc_usable_size(ptr)), std::memory_order_relaxed);
+    return ptr;
+}
+
+void countedFree(void *ptr) {
+    if (ptr) {
+        g_liveBytes.fetch_sub(qint64(malloc_usable_size(ptr)), std::memory_order_relaxed);
+        std::free(ptr);
+    }
+}
+}
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { countedFree(ptr); }
+
+namespace {
+// HeadsetDevice as it was laid out before the connection type became an enum
+struct LegacyHeadsetDevice {
+    QString model;
+    QString connectionType;
+    double battery = 0.0;
+    bool isCharging = false;
+    bool isPresent = false;
+    QString nativePath;
+    QString dbusPath;
+};
+
+constexpr int kDeviceCount = 1000;
+
+// Each field is a fresh string, as it is when demarshalled from a GetAll reply
+QString replyModel(int i) { return QString("Jabra Evolve2 %1").arg(65 + i % 10); }
+QString replyNativePath(int i) { return QString("/org/bluez/hci0/dev_00_11_22_33_%1").arg(i, 4, 16, QChar('0')); }
+QString replyDbusPath(int i) { return QString("/org/freedesktop/UPower/devices/headset_dev_%1").arg(i); }
+
+QList<LegacyHeadsetDevice> buildLegacy() {
+    QList<LegacyHeadsetDevice> devices;
+    for (int i = 0; i < kDeviceCount; ++i) {
+        LegacyHeadsetDevice device;
+        device.model = replyModel(i);
+        device.connectionType = i % 3 == 0 ? "USB" : "Bluetooth";
+        device.battery = i % 100;
+        device.isPresent = true;
+        device.nativePath = replyNativePath(i);
+        device.dbusPath = replyDbusPath(i);
+        devices.append(device);
+    }
+    return devices;
+}
+
+QList<HeadsetDevice> buildCompact(StringPool& models) {
+    QList<HeadsetDevice> devices;
+    for (int i = 0; i < kDeviceCount; ++i) {
+        HeadsetDevice device;
+        device.model = models.intern(replyModel(i));
+        device.connectionType = i % 3 == 0 ? ConnectionType::USB : ConnectionType::Bluetooth;
+        device.battery = i % 100;
+        device.isPresent = true;
+        device.nativePath = replyNativePath(i);
+        device.dbusPath = replyDbusPath(i);
+        devices.append(device);
+    }
+    return devices;
+}
+}
+
+/**
+ * @class BenchDeviceMemory
+ * @brief Memory per device and scan cost at 1,000 devices
+ *
+ * Compares the previous HeadsetDevice layout (connection type as a string,
+ * one model string per device) with the compact one (enum connection type,
+ * interned model names, scalars packed behind the strings).
+ */
+class BenchDeviceMemory : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testMemoryPerDevice() {
+        const qint64 legacyStart = g_liveBytes.load();
+        QList<LegacyHeadsetDevice> legacy = buildLegacy();
+        const qint64 legacyBytes = g_liveBytes.load() - legacyStart;
+
+        const qint64 compactStart = g_liveBytes.load();
+        StringPool models;
+        QList<HeadsetDevice> compact = buildCompact(models);
+        const qint64 compactBytes = g_liveBytes.load() - compactStart;
+
+        qInfo().noquote() << QString("Before: %1 bytes per device (sizeof %2)")
+                                 .arg(double(legacyBytes) / kDeviceCount, 0, 'f', 1)
+                                 .arg(sizeof(LegacyHeadsetDevice));
+        qInfo().noquote() << QString("After:  %1 bytes per device (sizeof %2, %3 distinct models)")
+                                 .arg(double(compactBytes) / kDeviceCount, 0, 'f', 1)
+                                 .arg(sizeof(HeadsetDevice))
+                                 .arg(models.size());
+
+        QVERIFY(sizeof(HeadsetDevice) < sizeof(LegacyHeadsetDevice));
+        QVERIFY(compactBytes < legacyBytes);
+    }
+
+    void benchmarkScan_data() {
+        QTest::addColumn<bool>("compact");
+        QTest::newRow("legacy") << false;
+        QTest::newRow("compact") << true;
+    }
+
+    // The tray's per-update pass: warning, charging and USB flags over all devices
+    void benchmarkScan() {
+        QFETCH(bool, compact);
+        StringPool models;
+        const QList<LegacyHeadsetDevice> legacy = buildLegacy();
+        const QList<HeadsetDevice> devices = buildCompact(models);
+
+        int flags = 0;
+        QBENCHMARK {
+            bool anyWarning = false;
+            bool anyUSB = false;
+            if (compact) {
+                for (const HeadsetDevice& device : devices) {
+                    anyWarning |= !device.isPresent || device.battery < 20;
+                    anyUSB |= device.connectionType == ConnectionType::USB;
+                }
+            } else {
+                for (const LegacyHeadsetDevice& device : legacy) {
+                    anyWarning |= !device.isPresent || device.battery < 20;
+                    anyUSB |= device.connectionType == QLatin1String("USB");
+                }
+            }
+            flags += anyWarning + anyUSB;
+        }
+        QVERIFY(flags > 0);
+    }
+};
+
+QTEST_MAIN(BenchDeviceMemory)
+#include "bench_DeviceMemory.moc"
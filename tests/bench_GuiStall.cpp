@@ -0,0 +1,196 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "../src/HeadsetManager.h"
+#include "../src/ThreadedDeviceSource.h"
+#include "FakeUPower.h"
+#include "PrivateDBus.h"
+
+namespace {
+enum class Path {
+    Blocking,  ///< HeadsetManager::getDevices() on the GUI thread
+    Async,     ///< HeadsetManager::requestDevices() on the GUI thread
+    Worker,    ///< ThreadedDeviceSource around a HeadsetManager
+};
+
+struct Result {
+    std::vector<qint64> refreshUs;
+    std::vector<qint64> gapsUs;
+    int ticks = 0;
+};
+
+QString percentiles(std::vector<qint64> samples) {
+    if (samples.empty()) {
+        return "no samples";
+    }
+    std::sort(samples.begin(), samples.end());
+    const auto percentile = [&samples](int p) {
+        return samples[std::min(samples.size() - 1, samples.size() * size_t(p) / 100)] / 1000.0;
+    };
+    return QString("p50=%1ms p99=%2ms max=%3ms")
+        .arg(percentile(50), 0, 'f', 2)
+        .arg(percentile(99), 0, 'f', 2)
+        .arg(samples.back() / 1000.0, 0, 'f', 2);
+}
+
+/**
+ * Runs @p refreshes back-to-back enumerations on @p path while a 1 ms
+ * timer on the GUI thread records how long the event loop went without
+ * running it.
+ */
+Result measure(Path path, const QDBusConnection& client, const QString& overridesFile,
+               int expected, int refreshes) {
+    Result result;
+    QEventLoop loop;
+    QElapsedTimer clock;
+    clock.start();
+
+    qint64 lastTick = -1;
+    QTimer ticker;
+    ticker.setTimerType(Qt::PreciseTimer);
+    ticker.setInterval(1);
+    QObject::connect(&ticker, &QTimer::timeout, [&]() {
+        const qint64 now = clock.nsecsElapsed() / 1000;
+        if (lastTick >= 0) {
+            result.gapsUs.push_back(now - lastTick);
+        }
+        lastTick = now;
+        ++result.ticks;
+    });
+
+    const auto createManager = [client, overridesFile]() {
+        auto *manager = new HeadsetManager(nullptr, overridesFile);
+        manager->setBus(client);
+        return manager;
+    };
+
+    std::unique_ptr<DeviceSource> source;
+    HeadsetManager *manager = nullptr;
+    if (path == Path::Worker) {
+        source = std::make_unique<ThreadedDeviceSource>(createManager);
+    } else {
+        manager = createManager();
+        source.reset(manager);
+    }
+
+    int done = 0;
+    qint64 startedUs = 0;
+    std::function<void()> next;
+    const auto finished = [&](int found) {
+        if (found != expected) {
+            qWarning() << "Refresh found" << found << "headsets, expected" << expected;
+        }
+        result.refreshUs.push_back(clock.nsecsElapsed() / 1000 - startedUs);
+        if (++done == refreshes) {
+            loop.quit();
+        } else {
+            QTimer::singleShot(0, &loop, next);
+        }
+    };
+    QObject::connect(source.get(), &DeviceSource::devicesReady, &loop,
+                     [&](const QList<HeadsetDevice>& devices) { finished(devices.size()); });
+
+    next = [&]() {
+        startedUs = clock.nsecsElapsed() / 1000;
+        if (path == Path::Blocking) {
+            finished(manager->getDevices().size());
+        } else {
+            source->requestDevices();
+        }
+    };
+
+    ticker.start();
+    QTimer::singleShot(0, &loop, next);
+    loop.exec();
+    ticker.stop();
+    return result;
+}
+}
+
+/**
+ * Measures how long the GUI thread's event loop stalls while headsets are
+ * enumerated against a FakeUPower whose every reply is delayed, comparing
+ * the historical blocking enumeration, the asynchronous one on the GUI
+ * thread and the ThreadedDeviceSource worker. A 1 ms timer stands in for
+ * the tray menu and settings dialog; a gap longer than that is time the
+ * user could not interact with them.
+ */
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("GUI event-loop stall during enumeration against a slow UPower");
+    parser.addHelpOption();
+    QCommandLineOption devicesOption("devices", "UPower devices, every fourth a headset", "n", "40");
+    QCommandLineOption delayOption("delay", "Delay of every UPower reply", "ms", "5");
+    QCommandLineOption refreshesOption("refreshes", "Enumerations per path", "n", "20");
+    parser.addOption(devicesOption);
+    parser.addOption(delayOption);
+    parser.addOption(refreshesOption);
+    parser.process(app);
+
+    const int deviceCount = qMax(1, parser.value(devicesOption).toInt());
+    const int delayMs = qMax(0, parser.value(delayOption).toInt());
+    const int refreshes = qMax(1, parser.value(refreshesOption).toInt());
+
+    PrivateDBus bus;
+    QString error;
+    if (!bus.start(&error)) {
+        qCritical().noquote() << error;
+        return 1;
+    }
+
+    QTemporaryDir overridesDir;
+    const QString overridesFile = overridesDir.path() + "/devices.ini";
+
+    QThread serverThread;
+    auto *upower = new FakeUPower();
+    upower->moveToThread(&serverThread);
+    serverThread.start();
+    upower->setDevices(FakeUPower::syntheticDevices(deviceCount));
+
+    const QDBusConnection server = bus.connect("stall-upower-server");
+    bool registered = false;
+    QMetaObject::invokeMethod(upower, [&]() { registered = upower->registerOn(server); },
+                              Qt::BlockingQueuedConnection);
+    if (!registered) {
+        qCritical() << "Failed to register the mock UPower on the private bus";
+        return 1;
+    }
+
+    const QDBusConnection client = bus.connect("stall-upower-client");
+    const int expected = (deviceCount + 3) / 4;
+    upower->setReplyDelay(delayMs);
+
+    qInfo().noquote() << QString("%1 UPower devices (%2 headsets), %3 ms per reply, %4 refreshes per path")
+                             .arg(deviceCount).arg(expected).arg(delayMs).arg(refreshes);
+
+    const struct {
+        Path path;
+        const char *name;
+    } paths[] = {
+        {Path::Blocking, "blocking getDevices() on GUI thread"},
+        {Path::Async, "async requestDevices() on GUI thread"},
+        {Path::Worker, "ThreadedDeviceSource worker"},
+    };
+    for (const auto& entry : paths) {
+        const Result result = measure(entry.path, client, overridesFile, expected, refreshes);
+        qInfo().noquote() << QString("%1:").arg(QString::fromLatin1(entry.name));
+        qInfo().noquote() << "    refresh latency:    " << percentiles(result.refreshUs);
+        qInfo().noquote() << "    event-loop gaps:    " << percentiles(result.gapsUs)
+                          << QString("(%1 ticks)").arg(result.ticks);
+    }
+
+    QMetaObject::invokeMethod(upower, &QObject::deleteLater);
+    serverThread.quit();
+    serverThread.wait();
+    return 0;
+}
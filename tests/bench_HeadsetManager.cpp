@@ -0,0 +1,162 @@
+#include <QtTest/QtTest>
+#include <QEventLoop>
+#include <QTemporaryDir>
+#include <QThread>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include "../src/HeadsetManager.h"
+#include "FakeUPower.h"
+#include "PrivateDBus.h"
+
+// Heap allocations made on the benchmark thread; D-Bus I/O and the fake
+// service run on other threads and are not counted
+namespace {
+std::atomic<quint64> g_allocations{0};
+std::atomic<std::thread::id> g_countedThread{};
+
+void *countedAlloc(std::size_t size) {
+    if (std::this_thread::get_id() == g_countedThread.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+}
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+/**
+ * @class BenchHeadsetManager
+ * @brief Measures HeadsetManager enumeration against a mock UPower
+ *
+ * Starts a private dbus-daemon with a FakeUPower serving 1 to 1000 synthetic
+ * devices (every fourth one a headset) and reports latency, D-Bus round
+ * trips and heap allocations per refresh for the sync and async paths.
+ */
+class BenchHeadsetManager : public QObject {
+    Q_OBJECT
+
+private:
+    PrivateDBus m_bus;
+    QThread m_serverThread;
+    FakeUPower *m_fake = nullptr;
+    QDBusConnection m_client{QString()};
+    QTemporaryDir m_overridesDir;
+
+    HeadsetManager *createManager() {
+        auto *manager = new HeadsetManager(nullptr, m_overridesDir.path() + "/devices.ini");
+        manager->setBus(m_client);
+        return manager;
+    }
+
+    int refresh(HeadsetManager *manager, bool async) {
+        if (!async) {
+            return manager->getDevices().size();
+        }
+
+        int found = -1;
+        QEventLoop loop;
+        connect(manager, &HeadsetManager::devicesReady, &loop,
+                [&found, &loop](const QList<HeadsetDevice>& devices) {
+                    found = devices.size();
+                    loop.quit();
+                });
+        QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+        manager->requestDevices();
+        loop.exec();
+        return found;
+    }
+
+private slots:
+    void initTestCase() {
+        QString error;
+        if (!m_bus.start(&error)) {
+            QSKIP(qPrintable(error));
+        }
+        QVERIFY(m_overridesDir.isValid());
+
+        const QDBusConnection server = m_bus.connect("bench-upower-server");
+        QVERIFY(server.isConnected());
+
+        m_fake = new FakeUPower();
+        m_fake->moveToThread(&m_serverThread);
+        m_serverThread.start();
+
+        bool registered = false;
+        QMetaObject::invokeMethod(m_fake, [this, server, &registered]() {
+            registered = m_fake->registerOn(server);
+        }, Qt::BlockingQueuedConnection);
+        QVERIFY(registered);
+
+        m_client = m_bus.connect("bench-upower-client");
+        QVERIFY(m_client.isConnected());
+
+        g_countedThread = std::this_thread::get_id();
+    }
+
+    void cleanupTestCase() {
+        if (m_fake) {
+            QMetaObject::invokeMethod(m_fake, &QObject::deleteLater);
+        }
+        m_serverThread.quit();
+        m_serverThread.wait();
+    }
+
+    void benchmarkRefresh_data() {
+        QTest::addColumn<int>("deviceCount");
+        QTest::addColumn<bool>("async");
+        QTest::addColumn<bool>("warm");
+
+        for (int count : {1, 10, 100, 1000}) {
+            QTest::addRow("sync/%d", count) << count << false << true;
+            QTest::addRow("async-cold/%d", count) << count << true << false;
+            QTest::addRow("async-warm/%d", count) << count << true << true;
+        }
+    }
+
+    void benchmarkRefresh() {
+        QFETCH(int, deviceCount);
+        QFETCH(bool, async);
+        QFETCH(bool, warm);
+
+        m_fake->setDevices(FakeUPower::syntheticDevices(deviceCount));
+        const int expectedHeadsets = (deviceCount + 3) / 4;
+
+        QScopedPointer<HeadsetManager> manager(createManager());
+        if (warm) {
+            QCOMPARE(refresh(manager.data(), async), expectedHeadsets);
+        }
+
+        // One instrumented refresh for round trips and allocations
+        m_fake->resetCallCount();
+        g_allocations = 0;
+        QCOMPARE(refresh(manager.data(), async), expectedHeadsets);
+        const quint64 allocations = g_allocations.load();
+        qInfo().noquote() << QString("%1 devices, %2: %3 round trips, %4 allocations per refresh")
+                                 .arg(deviceCount)
+                                 .arg(QString::fromLatin1(QTest::currentDataTag()))
+                                 .arg(m_fake->callCount())
+                                 .arg(allocations);
+
+        // A cold refresh starts from an empty classification cache; only
+        // clearing it is timed, not building a manager
+        QBENCHMARK {
+            if (!warm) {
+                manager->classifier().clearCache();
+            }
+            refresh(manager.data(), async);
+        }
+    }
+};
+
+QTEST_MAIN(BenchHeadsetManager)
+#include "bench_HeadsetManager.moc"
@@ -0,0 +1,158 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QThread>
+#include <algorithm>
+#include <vector>
+#include "../src/HeadsetStatusApp.h"
+#include "../src/LastStateStore.h"
+#include "../src/TrayIconController.h"
+#include "FakeUPower.h"
+#include "PrivateDBus.h"
+
+namespace {
+struct Startup {
+    qint64 firstIconUs = -1;
+    qint64 freshStateUs = -1;
+};
+
+QString percentiles(std::vector<qint64> samples) {
+    if (samples.empty()) {
+        return "no samples";
+    }
+    std::sort(samples.begin(), samples.end());
+    return QString("p50=%1ms max=%2ms")
+        .arg(samples[samples.size() / 2] / 1000.0, 0, 'f', 2)
+        .arg(samples.back() / 1000.0, 0, 'f', 2);
+}
+
+/**
+ * Starts one tray instance and times its first correct icon (the last
+ * known state, or the first enumeration without one) and its first
+ * enumeration. The instance is destroyed afterwards, which saves its state
+ * for the next run.
+ */
+Startup startOnce(PrivateDBus& bus, int run, int expected) {
+    Startup result;
+    const QDBusConnection client = bus.connect(QString("startup-client-%1").arg(run));
+
+    QElapsedTimer clock;
+    clock.start();
+    HeadsetStatusApp statusApp(HeadsetStatusApp::Mode::Tray, false, client, client);
+    if (statusApp.tray()->isShowingLastKnown()) {
+        result.firstIconUs = clock.nsecsElapsed() / 1000;
+    }
+
+    QObject::connect(statusApp.tray(), &TrayIconController::iconUpdated, [&]() {
+        if (result.firstIconUs < 0) {
+            result.firstIconUs = clock.nsecsElapsed() / 1000;
+        }
+    });
+    QObject::connect(&statusApp, &HeadsetStatusApp::devicesUpdated, [&]() {
+        if (result.freshStateUs < 0 && statusApp.knownDevices().size() == expected) {
+            result.freshStateUs = clock.nsecsElapsed() / 1000;
+        }
+    });
+
+    QElapsedTimer timeout;
+    timeout.start();
+    while (result.freshStateUs < 0 && timeout.elapsed() < 10000) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return result;
+}
+}
+
+/**
+ * Measures time to the first correct tray icon and time to fresh device
+ * state at startup, with and without a saved last state, against a
+ * FakeUPower that answers every call late, like UPower still starting
+ * at login.
+ */
+int main(int argc, char *argv[]) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Startup latency of HeadsetStatus with and without a saved state");
+    parser.addHelpOption();
+    QCommandLineOption devicesOption("devices", "Headsets UPower reports", "n", "4");
+    QCommandLineOption delayOption("delay", "Delay of every UPower reply", "ms", "50");
+    QCommandLineOption runsOption("runs", "Startups per variant", "n", "10");
+    parser.addOption(devicesOption);
+    parser.addOption(delayOption);
+    parser.addOption(runsOption);
+    parser.process(app);
+
+    const int deviceCount = qMax(1, parser.value(devicesOption).toInt());
+    const int runs = qMax(1, parser.value(runsOption).toInt());
+
+    PrivateDBus bus;
+    QString error;
+    if (!bus.start(&error)) {
+        qCritical().noquote() << error;
+        return 1;
+    }
+
+    // Saved state, history and status socket stay in a scratch directory;
+    // the private bus doubles as a session bus without a notification daemon
+    QTemporaryDir stateHome;
+    qputenv("XDG_STATE_HOME", stateHome.path().toUtf8());
+    qputenv("XDG_RUNTIME_DIR", stateHome.path().toUtf8());
+    qputenv("DBUS_SESSION_BUS_ADDRESS", bus.address().toUtf8());
+
+    QThread serverThread;
+    auto *upower = new FakeUPower();
+    upower->moveToThread(&serverThread);
+    serverThread.start();
+    upower->setDevices(FakeUPower::syntheticDevices(deviceCount, 1));
+    upower->setReplyDelay(qMax(0, parser.value(delayOption).toInt()));
+
+    const QDBusConnection server = bus.connect("startup-upower-server");
+    bool registered = false;
+    QMetaObject::invokeMethod(upower, [&]() { registered = upower->registerOn(server); },
+                              Qt::BlockingQueuedConnection);
+    if (!registered) {
+        qCritical() << "Failed to register the mock UPower on the private bus";
+        return 1;
+    }
+
+    const QString lastStatePath = LastStateStore::defaultPath();
+    std::vector<qint64> firstIcon[2];
+    std::vector<qint64> freshState[2];
+    for (int run = 0; run < runs * 2; ++run) {
+        // Alternate: without a saved state, then with the one that run left
+        const bool withState = run % 2 == 1;
+        if (!withState) {
+            QFile::remove(lastStatePath);
+        }
+
+        const Startup startup = startOnce(bus, run, deviceCount);
+        if (startup.freshStateUs < 0) {
+            qCritical() << "Startup" << run << "did not reach fresh state";
+            return 1;
+        }
+        firstIcon[withState].push_back(startup.firstIconUs);
+        freshState[withState].push_back(startup.freshStateUs);
+    }
+
+    qInfo().noquote() << QString("%1 headsets, %2 ms per UPower reply, %3 startups per variant")
+                             .arg(deviceCount).arg(parser.value(delayOption)).arg(runs);
+    for (int withState : {0, 1}) {
+        qInfo().noquote() << (withState ? "With saved last state:" : "Without saved last state:");
+        qInfo().noquote() << "    time to first icon:  " << percentiles(firstIcon[withState]);
+        qInfo().noquote() << "    time to fresh state: " << percentiles(freshState[withState]);
+    }
+
+    QMetaObject::invokeMethod(upower, &QObject::deleteLater);
+    serverThread.quit();
+    serverThread.wait();
+    return 0;
+}
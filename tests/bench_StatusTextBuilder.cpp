@@ -0,0 +1,145 @@
+#include <QtTest/QtTest>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "../src/StatusTextBuilder.h"
+
+namespace {
+std::atomic<quint64> g_allocations{0};
+
+void *countedAlloc(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+}
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+/**
+ * @class BenchStatusTextBuilder
+ * @brief Measures heap allocations and time per tooltip update
+ *
+ * Compares StatusTextBuilder against the previous QString::arg() and
+ * QStringList::join() formatting at 1, 10 and 100 devices, for updates where
+ * nothing, one device or every device changed.
+ */
+class BenchStatusTextBuilder : public QObject {
+    Q_OBJECT
+
+private:
+    static QList<HeadsetDevice> makeDevices(int count) {
+        QList<HeadsetDevice> devices;
+        for (int i = 0; i < count; ++i) {
+            HeadsetDevice device;
+            device.model = QString("Jabra Evolve2 %1").arg(i);
+            device.connectionType = i % 3 == 0 ? ConnectionType::USB : ConnectionType::Bluetooth;
+            device.battery = 30 + i % 60;
+            device.isPresent = true;
+            device.dbusPath = QString("/org/freedesktop/UPower/devices/headset_dev_%1").arg(i);
+            devices.append(device);
+        }
+        return devices;
+    }
+
+    // Formatting as TrayIconController::updateIcon() did it before the builder
+    static QString naiveTooltip(const QList<HeadsetDevice>& devices, int lowBatteryThreshold) {
+        QStringList tooltips;
+        for (const HeadsetDevice &device : devices) {
+            QString status;
+            if (!device.isPresent) {
+                status = "(Not present)";
+            } else if (device.battery < lowBatteryThreshold) {
+                status = QString("%1% (Low)").arg(int(device.battery));
+            } else if (device.isCharging) {
+                status = QString("%1% (Charging)").arg(int(device.battery));
+            } else {
+                status = QString("%1%").arg(int(device.battery));
+            }
+            tooltips << QString("%1\nConnection: %2\nBattery: %3").arg(device.model).arg(connectionTypeName(device.connectionType)).arg(status);
+        }
+        return tooltips.join("\n\n");
+    }
+
+    // Applies the next step of a change pattern to the device list
+    static void mutate(QList<HeadsetDevice>& devices, const QString& pattern, int step) {
+        if (pattern == "unchanged") {
+            return;
+        }
+        const int first = pattern == "one-changed" ? step % devices.size() : 0;
+        const int last = pattern == "one-changed" ? first + 1 : devices.size();
+        for (int i = first; i < last; ++i) {
+            devices[i].battery = 30 + (int(devices[i].battery) + 1) % 60;
+        }
+    }
+
+private slots:
+    void benchmarkUpdate_data() {
+        QTest::addColumn<int>("deviceCount");
+        QTest::addColumn<QString>("pattern");
+        QTest::addColumn<bool>("builder");
+
+        for (int count : {1, 10, 100}) {
+            for (const char *pattern : {"unchanged", "one-changed", "all-changed"}) {
+                QTest::addRow("naive/%s/%d", pattern, count) << count << QString(pattern) << false;
+                QTest::addRow("builder/%s/%d", pattern, count) << count << QString(pattern) << true;
+            }
+        }
+    }
+
+    void benchmarkUpdate() {
+        QFETCH(int, deviceCount);
+        QFETCH(QString, pattern);
+        QFETCH(bool, builder);
+
+        QList<HeadsetDevice> devices = makeDevices(deviceCount);
+        StatusTextBuilder texts(20);
+        texts.update(devices);
+        QString lastTooltip = texts.tooltip();
+
+        // Each step mutates the list (outside the measurement) and then updates
+        constexpr int kSteps = 100;
+        QList<QList<HeadsetDevice>> steps;
+        for (int step = 0; step < kSteps; ++step) {
+            mutate(devices, pattern, step);
+            steps.append(devices);
+        }
+
+        g_allocations = 0;
+        for (const QList<HeadsetDevice>& step : steps) {
+            if (builder) {
+                if (texts.update(step)) {
+                    lastTooltip = texts.tooltip();
+                }
+            } else {
+                const QString tooltip = naiveTooltip(step, 20);
+                if (tooltip != lastTooltip) {
+                    lastTooltip = tooltip;
+                }
+            }
+        }
+        qInfo().noquote() << QString("%1: %2 allocations per update")
+                                 .arg(QString::fromLatin1(QTest::currentDataTag()))
+                                 .arg(double(g_allocations.load()) / kSteps, 0, 'f', 1);
+
+        int step = 0;
+        QBENCHMARK {
+            const QList<HeadsetDevice>& current = steps.at(step++ % kSteps);
+            if (builder) {
+                texts.update(current);
+            } else {
+                naiveTooltip(current, 20);
+            }
+        }
+    }
+};
+
+QTEST_MAIN(BenchStatusTextBuilder)
+#include "bench_StatusTextBuilder.moc"
@@ -0,0 +1,121 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include "../src/HeadsetStatusApp.h"
+#include "../src/ReplaySource.h"
+#include "../src/RuntimeStats.h"
+
+namespace {
+// A snapshot of @p deviceCount headsets, then battery and charging changes
+// spread over them every 10 ms, with a full re-enumeration every 100 events
+QList<DeviceTraceEvent> syntheticTrace(int deviceCount, int eventCount) {
+    QList<HeadsetDevice> devices;
+    for (int i = 0; i < deviceCount; ++i) {
+        HeadsetDevice device;
+        device.model = QString("Jabra Evolve2 %1").arg(i);
+        device.dbusPath = QString("/org/freedesktop/UPower/devices/headset_dev_%1").arg(i);
+        device.nativePath = QString("/org/bluez/hci0/dev_%1").arg(i);
+        device.battery = 80;
+        device.isPresent = true;
+        devices.append(device);
+    }
+
+    QList<DeviceTraceEvent> events;
+    DeviceTraceEvent snapshot;
+    snapshot.type = DeviceTraceEvent::Type::Snapshot;
+    snapshot.devices = devices;
+    events.append(snapshot);
+
+    for (int i = 1; i <= eventCount; ++i) {
+        HeadsetDevice& device = devices[i % deviceCount];
+        DeviceTraceEvent event;
+        event.timeUs = i * 10000LL;
+        if (i % 100 == 0) {
+            event.type = DeviceTraceEvent::Type::Snapshot;
+            event.devices = devices;
+        } else {
+            event.type = DeviceTraceEvent::Type::PropertiesChanged;
+            event.dbusPath = device.dbusPath;
+            if (i % 37 == 0) {
+                device.isCharging = !device.isCharging;
+                event.properties.insert("State", device.isCharging ? 1u : 2u);
+            } else {
+                device.battery = device.battery > 5 ? device.battery - 1 : 100;
+                event.properties.insert("Percentage", device.battery);
+            }
+        }
+        events.append(event);
+    }
+    return events;
+}
+}
+
+/**
+ * Feeds a recorded (--record-trace) or synthetic trace through a full
+ * HeadsetStatusApp in tray mode and reports replay throughput plus the
+ * runtime statistics of the update, tray and notification path. With the
+ * default fast replay the result depends only on the trace, not on UPower
+ * or the machine the trace was recorded on.
+ */
+int main(int argc, char *argv[]) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    // No popups on the desktop of whoever runs the benchmark
+    qputenv("DBUS_SESSION_BUS_ADDRESS", "");
+
+    QApplication app(argc, argv);
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a headset trace through the full application");
+    parser.addHelpOption();
+    QCommandLineOption traceOption("trace", "Trace written by HeadsetStatus --record-trace", "file");
+    QCommandLineOption realTimeOption("real-time", "Keep the recorded gaps between events");
+    QCommandLineOption devicesOption("devices", "Headsets in the synthetic trace", "n", "8");
+    QCommandLineOption eventsOption("events", "Changes in the synthetic trace", "n", "10000");
+    parser.addOption(traceOption);
+    parser.addOption(realTimeOption);
+    parser.addOption(devicesOption);
+    parser.addOption(eventsOption);
+    parser.process(app);
+
+    // Keep battery history and the status socket out of the user's directories
+    QTemporaryDir stateHome;
+    qputenv("XDG_STATE_HOME", stateHome.path().toUtf8());
+    qputenv("XDG_RUNTIME_DIR", stateHome.path().toUtf8());
+
+    auto *replay = new ReplaySource();
+    if (parser.isSet(traceOption)) {
+        QString error;
+        if (!replay->load(parser.value(traceOption), &error)) {
+            qCritical().noquote() << error;
+            return 1;
+        }
+    } else {
+        replay->setEvents(syntheticTrace(qMax(1, parser.value(devicesOption).toInt()),
+                                         qMax(1, parser.value(eventsOption).toInt())));
+    }
+
+    HeadsetStatusApp statusApp(replay, HeadsetStatusApp::Mode::Tray, false, QDBusConnection(QString()));
+    RuntimeStats::global().reset();
+
+    QElapsedTimer clock;
+    QObject::connect(replay, &ReplaySource::finished, &app, &QCoreApplication::quit);
+    clock.start();
+    replay->start(parser.isSet(realTimeOption) ? ReplaySource::Speed::RealTime
+                                               : ReplaySource::Speed::AsFastAsPossible);
+    app.exec();
+    const qint64 elapsedUs = clock.nsecsElapsed() / 1000;
+
+    qInfo().noquote() << QString("Replayed %1 events in %2 ms (%3 us/event), %4 headsets at the end")
+                             .arg(replay->eventCount())
+                             .arg(elapsedUs / 1000.0, 0, 'f', 1)
+                             .arg(double(elapsedUs) / qMax(1, replay->eventCount()), 0, 'f', 1)
+                             .arg(statusApp.knownDevices().size());
+    qInfo().noquote() << "Runtime statistics:\n" + RuntimeStats::global().format();
+    return 0;
+}
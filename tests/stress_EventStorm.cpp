@@ -0,0 +1,298 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "../src/HeadsetStatusApp.h"
+#include "../src/NotificationManager.h"
+#include "../src/RuntimeStats.h"
+#include "../src/TrayIconController.h"
+#include "FakeUPower.h"
+#include "PrivateDBus.h"
+
+/**
+ * @class FakeNotifications
+ * @brief Minimal org.freedesktop.Notifications that accepts and discards popups
+ */
+class FakeNotifications : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.Notifications")
+public:
+    using QObject::QObject;
+
+public slots:
+    uint Notify(const QString& appName, uint replacesId, const QString& appIcon,
+                const QString& summary, const QString& body, const QStringList& actions,
+                const QVariantMap& hints, int timeout) {
+        Q_UNUSED(appName) Q_UNUSED(appIcon) Q_UNUSED(summary) Q_UNUSED(body)
+        Q_UNUSED(actions) Q_UNUSED(hints) Q_UNUSED(timeout)
+        return replacesId ? replacesId : ++m_lastId;
+    }
+
+private:
+    uint m_lastId = 0;
+};
+
+namespace {
+// Percentages carry the event sequence number in their fractional part, so
+// the harness can tell which emitted event a tray update already reflects
+constexpr double kSequenceScale = 1e-6;
+
+double encodeBattery(int base, int sequence) {
+    return base + sequence * kSequenceScale;
+}
+
+int decodeSequence(double battery) {
+    return int(std::lround(std::fmod(battery, 1.0) / kSequenceScale));
+}
+
+struct PendingEvent {
+    enum Kind { Percentage, Added, Removed };
+    Kind kind;
+    QString path;
+    int sequence;
+    qint64 emittedNs;
+};
+
+struct Distribution {
+    std::vector<qint64> samples;
+
+    QString summary() const {
+        if (samples.empty()) {
+            return "no samples";
+        }
+        std::vector<qint64> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        const auto percentile = [&sorted](int p) {
+            return sorted[std::min(sorted.size() - 1, sorted.size() * size_t(p) / 100)] / 1000.0;
+        };
+        return QString("n=%1 p50=%2us p99=%3us max=%4us")
+            .arg(sorted.size())
+            .arg(percentile(50), 0, 'f', 1)
+            .arg(percentile(99), 0, 'f', 1)
+            .arg(sorted.back() / 1000.0, 0, 'f', 1);
+    }
+};
+}
+
+/**
+ * Replays a high-rate storm of PropertiesChanged, DeviceAdded and
+ * DeviceRemoved signals from a FakeUPower on a private bus against a full
+ * HeadsetStatusApp, and reports the latency from signal emission to the end
+ * of TrayIconController::updateIcon() and to NotificationManager dispatch,
+ * plus how many full updates the debounce timer coalesced.
+ */
+int main(int argc, char *argv[]) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Event-storm stress harness for HeadsetStatus");
+    parser.addHelpOption();
+    QCommandLineOption rateOption("rate", "Events per second", "n", "50");
+    QCommandLineOption durationOption("duration", "Storm duration in seconds", "s", "10");
+    QCommandLineOption devicesOption("devices", "Headsets present at start", "n", "8");
+    parser.addOption(rateOption);
+    parser.addOption(durationOption);
+    parser.addOption(devicesOption);
+    parser.process(app);
+
+    const int rate = qMax(1, parser.value(rateOption).toInt());
+    const int durationMs = qMax(1, parser.value(durationOption).toInt()) * 1000;
+    const int deviceCount = qMax(2, parser.value(devicesOption).toInt());
+
+    PrivateDBus bus;
+    QString error;
+    if (!bus.start(&error)) {
+        qCritical().noquote() << error;
+        return 1;
+    }
+
+    // Keep the storm's battery history and status socket out of the user's directories
+    QTemporaryDir stateHome;
+    qputenv("XDG_STATE_HOME", stateHome.path().toUtf8());
+    qputenv("XDG_RUNTIME_DIR", stateHome.path().toUtf8());
+
+    // The private bus doubles as the session bus for notifications
+    qputenv("DBUS_SESSION_BUS_ADDRESS", bus.address().toUtf8());
+
+    QThread serverThread;
+    auto *upower = new FakeUPower();
+    auto *notifications = new FakeNotifications();
+    upower->moveToThread(&serverThread);
+    notifications->moveToThread(&serverThread);
+    serverThread.start();
+
+    QList<FakeUPowerDevice> initialDevices = FakeUPower::syntheticDevices(deviceCount, 1);
+    upower->setDevices(initialDevices);
+
+    QDBusConnection server = bus.connect("storm-server");
+    bool registered = false;
+    QMetaObject::invokeMethod(upower, [&]() {
+        registered = upower->registerOn(server)
+            && server.registerObject("/org/freedesktop/Notifications", notifications,
+                                     QDBusConnection::ExportAllSlots)
+            && server.registerService("org.freedesktop.Notifications");
+    }, Qt::BlockingQueuedConnection);
+    if (!registered) {
+        qCritical() << "Failed to register stand-in services on the private bus";
+        return 1;
+    }
+
+    // The status service is exported on the private bus too, so it is part
+    // of the measured path and never claims the name on the real session bus
+    const QDBusConnection client = bus.connect("storm-client");
+    HeadsetStatusApp statusApp(HeadsetStatusApp::Mode::Tray, false, client, client);
+
+    QElapsedTimer startup;
+    startup.start();
+    while (statusApp.knownDevices().size() < deviceCount && startup.elapsed() < 5000) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+    if (statusApp.knownDevices().size() < deviceCount) {
+        qCritical() << "Initial enumeration did not complete";
+        return 1;
+    }
+
+    const int initialRequests = statusApp.statusUpdateRequests();
+    const int initialRuns = statusApp.statusUpdatesRun();
+
+    QElapsedTimer clock;
+    clock.start();
+    std::vector<PendingEvent> pendingTray;
+    std::vector<qint64> pendingNotifications;
+    Distribution trayLatency;
+    Distribution notificationLatency;
+    int sequence = 0;
+    int eventsByKind[3] = {0, 0, 0};
+    bool flapLow = false;
+    QStringList addedPaths;
+
+    // Device 0 flaps across the low-battery threshold to drive notifications
+    const QString flapPath = initialDevices.first().path;
+    const QString flapModel = initialDevices.first().properties.value("Model").toString();
+
+    QObject::connect(statusApp.tray(), &TrayIconController::iconUpdated, [&]() {
+        const qint64 now = clock.nsecsElapsed();
+        const DeviceStateCache& cache = statusApp.knownDevices();
+
+        auto it = std::remove_if(pendingTray.begin(), pendingTray.end(), [&](const PendingEvent& event) {
+            bool reflected = false;
+            switch (event.kind) {
+            case PendingEvent::Percentage: {
+                const HeadsetDevice *device = cache.find(event.path);
+                reflected = device && decodeSequence(device->battery) >= event.sequence;
+                break;
+            }
+            case PendingEvent::Added:
+                reflected = cache.contains(event.path);
+                break;
+            case PendingEvent::Removed:
+                reflected = !cache.contains(event.path);
+                break;
+            }
+            if (reflected) {
+                trayLatency.samples.push_back(now - event.emittedNs);
+            }
+            return reflected;
+        });
+        pendingTray.erase(it, pendingTray.end());
+    });
+
+    // Rate limits merge the flaps held back meanwhile into the popup that
+    // finally goes out, so it answers the oldest of them and clears the rest
+    int flapNotifications = 0;
+    int flapPopups = 0;
+    QObject::connect(statusApp.notifications(), &NotificationManager::notificationSent,
+                     [&](const QString& summary, const QString& body) {
+        if ((summary.contains(flapModel) || body.contains(flapModel)) && !pendingNotifications.empty()) {
+            notificationLatency.samples.push_back(clock.nsecsElapsed() - pendingNotifications.front());
+            pendingNotifications.clear();
+            ++flapPopups;
+        }
+    });
+
+    QTimer generator;
+    generator.setTimerType(Qt::PreciseTimer);
+    generator.setInterval(qMax(1, 1000 / rate));
+    QObject::connect(&generator, &QTimer::timeout, [&]() {
+        ++sequence;
+        const int roll = sequence % 20;
+
+        if (roll == 0) {
+            FakeUPowerDevice device = FakeUPower::syntheticDevices(1, 1).first();
+            device.path = QString("%1/devices/storm_headset_%2").arg(FakeUPower::kObjectPath).arg(sequence);
+            addedPaths.append(device.path);
+            pendingTray.push_back({PendingEvent::Added, device.path, sequence, clock.nsecsElapsed()});
+            upower->addDevice(device);
+            ++eventsByKind[PendingEvent::Added];
+        } else if (roll == 10 && !addedPaths.isEmpty()) {
+            const QString path = addedPaths.takeFirst();
+            pendingTray.push_back({PendingEvent::Removed, path, sequence, clock.nsecsElapsed()});
+            upower->removeDevice(path);
+            ++eventsByKind[PendingEvent::Removed];
+        } else {
+            QString path;
+            int base;
+            if (roll % 5 == 1) {
+                flapLow = !flapLow;
+                path = flapPath;
+                base = flapLow ? 10 : 60;
+                if (flapLow) {
+                    pendingNotifications.push_back(clock.nsecsElapsed());
+                    ++flapNotifications;
+                }
+            } else {
+                path = initialDevices.at(1 + QRandomGenerator::global()->bounded(deviceCount - 1)).path;
+                base = 30 + QRandomGenerator::global()->bounded(60);
+            }
+            pendingTray.push_back({PendingEvent::Percentage, path, sequence, clock.nsecsElapsed()});
+            upower->changeProperties(path, {{"Percentage", encodeBattery(base, sequence)}});
+            ++eventsByKind[PendingEvent::Percentage];
+        }
+    });
+
+    generator.start();
+    QTimer::singleShot(durationMs, &generator, &QTimer::stop);
+
+    // Let in-flight events drain after the storm ends
+    QTimer::singleShot(durationMs + 1000, &app, &QCoreApplication::quit);
+    app.exec();
+
+    const int requests = statusApp.statusUpdateRequests() - initialRequests;
+    const int runs = statusApp.statusUpdatesRun() - initialRuns;
+
+    qInfo().noquote() << QString("Storm: %1 events/s for %2 s over %3 headsets")
+                             .arg(rate).arg(durationMs / 1000).arg(deviceCount);
+    qInfo().noquote() << QString("Events: %1 PropertiesChanged, %2 DeviceAdded, %3 DeviceRemoved")
+                             .arg(eventsByKind[PendingEvent::Percentage])
+                             .arg(eventsByKind[PendingEvent::Added])
+                             .arg(eventsByKind[PendingEvent::Removed]);
+    qInfo().noquote() << "Signal -> end of updateIcon:" << trayLatency.summary();
+    qInfo().noquote() << "Signal -> notification dispatch:" << notificationLatency.summary();
+    qInfo().noquote() << QString("Full updates: %1 requested, %2 run, %3 coalesced by the debounce timer")
+                             .arg(requests).arg(runs).arg(requests - runs);
+    qInfo().noquote() << QString("Low battery crossings: %1, shown in %2 popups")
+                             .arg(flapNotifications).arg(flapPopups);
+    qInfo().noquote() << QString("Unreflected events: %1 tray, %2 notification")
+                             .arg(pendingTray.size()).arg(pendingNotifications.size());
+    qInfo().noquote() << "Runtime statistics:\n" + RuntimeStats::global().format();
+
+    QMetaObject::invokeMethod(upower, &QObject::deleteLater);
+    QMetaObject::invokeMethod(notifications, &QObject::deleteLater);
+    serverThread.quit();
+    serverThread.wait();
+    return 0;
+}
+
+#include "stress_EventStorm.moc"
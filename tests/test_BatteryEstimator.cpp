@@ -0,0 +1,136 @@
+#include <QtTest/QtTest>
+#include <cmath>
+#include "../src/BatteryEstimator.h"
+
+/**
+ * @class TestBatteryEstimator
+ * @brief Unit tests for the time-to-empty / time-to-full estimator
+ *
+ * Feeds synthetic charge curves the way headsets report them: the level
+ * moves in whole steps and a sample arrives whenever it changes, plus the
+ * odd sample with an unchanged level from a full enumeration.
+ */
+class TestBatteryEstimator : public QObject {
+    Q_OBJECT
+
+private:
+    static constexpr qint64 kMinute = 60 * 1000;
+
+    // Samples a linear curve at every level step of @p step percent
+    static qint64 feedLinear(BatteryEstimator& estimator, qint64 start, double from, double to,
+                             double percentPerHour, double step, bool charging) {
+        const double direction = to > from ? 1.0 : -1.0;
+        const double msPerPercent = 3600000.0 / percentPerHour;
+        qint64 time = start;
+        for (double level = from; direction * (to - level) >= 0; level += direction * step) {
+            time = start + qint64(std::abs(level - from) * msPerPercent);
+            estimator.addSample(time, level, charging, true);
+        }
+        return time;
+    }
+
+private slots:
+    void testUnknownUntilTwoSteps() {
+        BatteryEstimator estimator;
+        QCOMPARE(estimator.secondsRemaining(), -1);
+
+        estimator.addSample(0, 80.5, false, true);
+        QCOMPARE(estimator.secondsRemaining(), -1);
+
+        // The first step only aligns to a level edge
+        estimator.addSample(10 * kMinute, 80, false, true);
+        QCOMPARE(estimator.secondsRemaining(), -1);
+
+        estimator.addSample(40 * kMinute, 79, false, true);
+        QCOMPARE(estimator.ratePerHour(false), 2.0);
+        QCOMPARE(estimator.secondsRemaining(), 79 * 1800);
+    }
+
+    void testLinearDischarge() {
+        BatteryEstimator estimator;
+        feedLinear(estimator, 0, 100, 60, 10.0, 1, false);
+
+        QVERIFY(qAbs(estimator.ratePerHour(false) - 10.0) < 0.01);
+        QVERIFY(qAbs(estimator.secondsRemaining() - 6 * 3600) < 30);
+    }
+
+    void testCoarseStepsAndRepeatedLevels() {
+        // 10 % steps with unchanged samples in between, as many Bluetooth headsets report
+        BatteryEstimator estimator;
+        for (int step = 0; step <= 5; ++step) {
+            const qint64 start = step * 120 * kMinute;
+            const double level = 100 - 10 * step;
+            estimator.addSample(start, level, false, true);
+            estimator.addSample(start + 30 * kMinute, level, false, true);
+            estimator.addSample(start + 90 * kMinute, level, false, true);
+        }
+
+        QVERIFY(qAbs(estimator.ratePerHour(false) - 5.0) < 0.01);
+        QVERIFY(qAbs(estimator.secondsRemaining() - 10 * 3600) < 30);
+    }
+
+    void testSmoothingFollowsRateChange() {
+        BatteryEstimator estimator;
+        const qint64 end = feedLinear(estimator, 0, 100, 80, 5.0, 1, false);
+        feedLinear(estimator, end, 80, 50, 20.0, 1, false);
+
+        // Thirty observations at the new rate leave nothing of the old one
+        QVERIFY(qAbs(estimator.ratePerHour(false) - 20.0) < 0.1);
+    }
+
+    void testSeparateChargeAndDischargeModels() {
+        BatteryEstimator estimator;
+        qint64 time = feedLinear(estimator, 0, 90, 70, 10.0, 1, false);
+        time = feedLinear(estimator, time + kMinute, 70, 90, 40.0, 1, true);
+
+        QVERIFY(qAbs(estimator.ratePerHour(true) - 40.0) < 0.1);
+        QVERIFY(qAbs(estimator.secondsRemaining() - 15 * 60) < 30);
+
+        // Unplugging reuses the discharge model right away
+        estimator.addSample(time + kMinute, 90, false, true);
+        QVERIFY(qAbs(estimator.ratePerHour(false) - 10.0) < 0.1);
+        QVERIFY(qAbs(estimator.secondsRemaining() - 9 * 3600) < 30);
+    }
+
+    void testFullWhileChargingHasNoEstimate() {
+        BatteryEstimator estimator;
+        const qint64 time = feedLinear(estimator, 0, 90, 100, 30.0, 1, true);
+        QCOMPARE(estimator.secondsRemaining(), -1);
+
+        estimator.addSample(time + kMinute, 100, false, true);
+        QCOMPARE(estimator.secondsRemaining(), -1);
+    }
+
+    void testAbsentOrLongGapRestartsMeasurement() {
+        BatteryEstimator estimator;
+        qint64 time = feedLinear(estimator, 0, 80, 70, 10.0, 1, false);
+        const double rate = estimator.ratePerHour(false);
+
+        estimator.addSample(time + kMinute, 70, false, false);
+        QCOMPARE(estimator.secondsRemaining(), -1);
+
+        // After reconnecting, a step spanning the absence must not count
+        time += 2 * kMinute;
+        estimator.addSample(time, 70, false, true);
+        estimator.addSample(time + kMinute, 60, false, true);
+        QCOMPARE(estimator.ratePerHour(false), rate);
+
+        estimator.addSample(time + BatteryEstimator::kMaxGapMs + 2 * kMinute, 59, false, true);
+        QCOMPARE(estimator.ratePerHour(false), rate);
+    }
+
+    void testRecalibrationJumpIsIgnored() {
+        BatteryEstimator estimator;
+        const qint64 time = feedLinear(estimator, 0, 80, 70, 10.0, 1, false);
+        const double rate = estimator.ratePerHour(false);
+
+        // Level jumps up while discharging: re-anchor instead of a negative rate
+        estimator.addSample(time + kMinute, 75, false, true);
+        estimator.addSample(time + 2 * kMinute, 74, false, true);
+        QCOMPARE(estimator.ratePerHour(false), rate);
+        QVERIFY(estimator.secondsRemaining() > 0);
+    }
+};
+
+QTEST_MAIN(TestBatteryEstimator)
+#include "test_BatteryEstimator.moc"
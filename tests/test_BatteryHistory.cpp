@@ -0,0 +1,167 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include "../src/BatteryHistory.h"
+
+/**
+ * @class TestBatteryHistory
+ * @brief Unit tests for the memory-mapped battery history ring buffer
+ */
+class TestBatteryHistory : public QObject {
+    Q_OBJECT
+
+private:
+    static BatterySample makeSample(qint64 timestamp, double battery, bool charging = false) {
+        BatterySample sample;
+        sample.timestamp = timestamp;
+        sample.battery = battery;
+        sample.isCharging = charging;
+        sample.isPresent = true;
+        return sample;
+    }
+
+    static QList<qint64> timestamps(const QList<BatterySample>& samples) {
+        QList<qint64> result;
+        for (const BatterySample& sample : samples) {
+            result.append(sample.timestamp);
+        }
+        return result;
+    }
+
+    QTemporaryDir m_dir;
+
+private slots:
+    void testAppendAndRead() {
+        BatteryHistory history(m_dir.filePath("append.hist"), 8, "Jabra Evolve2");
+        QVERIFY2(history.isOpen(), qPrintable(history.errorString()));
+        QCOMPARE(history.size(), 0);
+
+        QVERIFY(history.append(makeSample(1000, 87.25, true)));
+        QVERIFY(history.append(makeSample(1060, 86.5)));
+
+        const QList<BatterySample> samples = history.samples();
+        QCOMPARE(samples.size(), 2);
+        QCOMPARE(samples[0].timestamp, qint64(1000));
+        QCOMPARE(samples[0].battery, 87.25);
+        QVERIFY(samples[0].isCharging);
+        QVERIFY(samples[0].isPresent);
+        QCOMPARE(samples[1].battery, 86.5);
+        QVERIFY(!samples[1].isCharging);
+    }
+
+    void testWrapAroundKeepsNewest() {
+        BatteryHistory history(m_dir.filePath("wrap.hist"), 4);
+        for (qint64 t = 1; t <= 10; ++t) {
+            history.append(makeSample(t, 50));
+        }
+
+        QCOMPARE(history.size(), 4);
+        QCOMPARE(timestamps(history.samples()), QList<qint64>({7, 8, 9, 10}));
+    }
+
+    void testReopenContinuesRing() {
+        const QString path = m_dir.filePath("reopen.hist");
+        {
+            BatteryHistory history(path, 4, "Sony WH-1000XM4");
+            for (qint64 t = 1; t <= 5; ++t) {
+                history.append(makeSample(t, 40));
+            }
+        }
+
+        // The existing file keeps its capacity, whatever the caller asks for
+        BatteryHistory history(path, 16);
+        QCOMPARE(history.capacity(), 4u);
+        QCOMPARE(history.size(), 4);
+        history.append(makeSample(6, 39));
+        QCOMPARE(timestamps(history.samples()), QList<qint64>({3, 4, 5, 6}));
+    }
+
+    void testCorruptRecordIsSkipped() {
+        const QString path = m_dir.filePath("corrupt.hist");
+        {
+            BatteryHistory history(path, 4);
+            for (qint64 t = 1; t <= 3; ++t) {
+                history.append(makeSample(t, 30));
+            }
+        }
+
+        // Simulate a torn write: sequence present, battery changed after the check
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        const qint64 secondRecord = sizeof(BatteryHistoryFormat::Header) + sizeof(BatteryHistoryFormat::Record);
+        QVERIFY(file.seek(secondRecord + offsetof(BatteryHistoryFormat::Record, battery)));
+        const quint16 garbage = 0xffff;
+        file.write(reinterpret_cast<const char*>(&garbage), sizeof(garbage));
+        file.close();
+
+        BatteryHistory history(path, 4);
+        QCOMPARE(timestamps(history.samples()), QList<qint64>({1, 3}));
+
+        // Recovery resumes after the newest valid record
+        history.append(makeSample(4, 29));
+        QCOMPARE(timestamps(history.samples()), QList<qint64>({1, 3, 4}));
+    }
+
+    void testForeignFileIsReinitialized() {
+        const QString path = m_dir.filePath("foreign.hist");
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("not a history file");
+        file.close();
+
+        BatteryHistory history(path, 4);
+        QVERIFY(history.isOpen());
+        QCOMPARE(history.size(), 0);
+        QCOMPARE(QFileInfo(path).size(), qint64(64 + 4 * 16));
+    }
+
+    void testReaderSeesWriterAppends() {
+        const QString path = m_dir.filePath("shared.hist");
+        BatteryHistory history(path, 8, "Logitech G Pro X");
+        history.append(makeSample(1, 90));
+
+        BatteryHistoryReader reader(path);
+        QVERIFY(reader.isValid());
+        QCOMPARE(reader.model(), QString("Logitech G Pro X"));
+        QCOMPARE(reader.capacity(), 8u);
+        QCOMPARE(reader.samples().size(), 1);
+
+        // Both sides map the same pages, so appends are visible without reopening
+        history.append(makeSample(2, 89));
+        QCOMPARE(timestamps(reader.samples()), QList<qint64>({1, 2}));
+    }
+
+    void testReaderRejectsInvalidFile() {
+        QVERIFY(!BatteryHistoryReader(m_dir.filePath("missing.hist")).isValid());
+    }
+
+    void testStoreRecordsPerDevice() {
+        BatteryHistoryStore store(m_dir.filePath("store"));
+
+        HeadsetDevice device;
+        device.model = "Jabra Evolve2";
+        device.nativePath = "/sys/class/power_supply/hid-0";
+        device.dbusPath = "/org/freedesktop/UPower/devices/headset_0";
+        device.battery = 75;
+        device.isPresent = true;
+
+        store.record(device, 100);
+        device.battery = 74;
+        store.record(device, 160);
+
+        BatteryHistory *history = store.historyFor(device.dbusPath);
+        QVERIFY(history);
+        QCOMPARE(history->size(), 2);
+        QCOMPARE(QFileInfo(history->filePath()).fileName(),
+                 BatteryHistory::fileNameFor(device.nativePath, device.model));
+
+        store.forget(device.dbusPath);
+        QVERIFY(!store.historyFor(device.dbusPath));
+
+        // A reconnect picks the same file up again
+        store.record(device, 220);
+        QCOMPARE(store.historyFor(device.dbusPath)->size(), 3);
+    }
+};
+
+QTEST_MAIN(TestBatteryHistory)
+#include "test_BatteryHistory.moc"
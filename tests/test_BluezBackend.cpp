@@ -0,0 +1,233 @@
+#include <QtTest/QtTest>
+#include "FakeBluez.h"
+#include "PrivateDBus.h"
+#include "../src/BluezBackend.h"
+
+/**
+ * @class TestBluezBackend
+ * @brief Unit tests for the BlueZ Battery1 backend against a fake bluetoothd
+ */
+class TestBluezBackend : public QObject {
+    Q_OBJECT
+
+private:
+    PrivateDBus m_bus;
+    QString m_busError;
+    QDBusConnection m_serviceBus{QString()};
+    QDBusConnection m_clientBus{QString()};
+    FakeBluez *m_fake = nullptr;
+
+    static const QString kDevice;
+    static const QString kBattery;
+
+    static bool byClass(const QString&, const QString&, const QString&, bool headsetClass) {
+        return headsetClass;
+    }
+
+    static BluezBackend::InterfaceMap headset(const QString& alias, int percentage) {
+        return {{kDevice, FakeBluez::deviceProperties(alias, "audio-headset")},
+                {kBattery, FakeBluez::batteryProperties(percentage)}};
+    }
+
+private slots:
+    void initTestCase() {
+        if (!m_bus.start(&m_busError)) {
+            qWarning() << "Bus tests will be skipped:" << m_busError;
+            return;
+        }
+        m_serviceBus = m_bus.connect("bluez");
+        m_clientBus = m_bus.connect("client");
+    }
+
+    void init() {
+        if (!m_clientBus.isConnected()) {
+            return;
+        }
+        m_fake = new FakeBluez();
+        QVERIFY(m_fake->registerOn(m_serviceBus));
+    }
+
+    void cleanup() {
+        if (m_fake) {
+            m_serviceBus.unregisterService(QLatin1String(BluezBackend::kServiceName));
+            m_serviceBus.unregisterObject("/", QDBusConnection::UnregisterTree);
+            delete m_fake;
+            m_fake = nullptr;
+        }
+    }
+
+    void testHeadsetClass() {
+        QVERIFY(BluezBackend::isHeadsetClass("audio-headset", 0));
+        QVERIFY(BluezBackend::isHeadsetClass("audio-headphones", 0));
+        QVERIFY(!BluezBackend::isHeadsetClass("audio-card", 0x240404));
+        QVERIFY(!BluezBackend::isHeadsetClass("input-mouse", 0));
+
+        // Without an icon the Class of Device decides
+        QVERIFY(BluezBackend::isHeadsetClass(QString(), 0x240404));
+        QVERIFY(BluezBackend::isHeadsetClass(QString(), 0x240418));
+        QVERIFY(!BluezBackend::isHeadsetClass(QString(), 0x240414));
+        QVERIFY(!BluezBackend::isHeadsetClass(QString(), 0x002580));
+        QVERIFY(!BluezBackend::isHeadsetClass(QString(), 0));
+    }
+
+    void testSnapshotClassifiesByDeviceType() {
+        if (!m_clientBus.isConnected()) {
+            QSKIP(qPrintable(m_busError));
+        }
+
+        QVariantMap headphones = FakeBluez::deviceProperties("WH-1000XM4", QString(), false);
+        headphones.insert("Class", QVariant::fromValue(uint(0x240418)));
+
+        m_fake->addInterfaces("/org/bluez/hci0", {{"org.bluez.Adapter1", {{"Powered", true}}}}, false);
+        m_fake->addInterfaces("/org/bluez/hci0/dev_00_1B_66_AA_BB_CC", headset("Jabra Evolve2 65", 80), false);
+        m_fake->addInterfaces("/org/bluez/hci0/dev_38_18_4C_00_11_22",
+                              {{kDevice, headphones}, {kBattery, FakeBluez::batteryProperties(55)}}, false);
+        // Keywords in the name do not make a headset, a missing battery hides one
+        m_fake->addInterfaces("/org/bluez/hci0/dev_DC_2C_26_00_00_01",
+                              {{kDevice, FakeBluez::deviceProperties("Logitech Headset Mouse", "input-mouse")},
+                               {kBattery, FakeBluez::batteryProperties(90)}}, false);
+        m_fake->addInterfaces("/org/bluez/hci0/dev_F4_4E_FD_00_00_02",
+                              {{kDevice, FakeBluez::deviceProperties("Bose QC35", "audio-headset")}}, false);
+
+        BluezBackend backend(&byClass, m_clientBus);
+        QSignalSpy membership(&backend, &BluezBackend::devicesChanged);
+        QVERIFY(backend.start());
+        QTRY_VERIFY(backend.hasSnapshot());
+        QCOMPARE(membership.count(), 1);
+        QCOMPARE(m_fake->snapshotCount(), 1);
+
+        const QList<HeadsetDevice> devices = backend.devices();
+        QCOMPARE(devices.size(), 2);
+
+        const HeadsetDevice& jabra = devices.at(0);
+        QCOMPARE(jabra.model, QString("Jabra Evolve2 65"));
+        QCOMPARE(jabra.dbusPath, QString("/org/bluez/hci0/dev_00_1B_66_AA_BB_CC"));
+        QCOMPARE(jabra.nativePath, jabra.dbusPath);
+        QCOMPARE(jabra.connectionType, ConnectionType::Bluetooth);
+        QCOMPARE(jabra.battery, 80.0);
+        QVERIFY(jabra.isPresent);
+
+        const HeadsetDevice& sony = devices.at(1);
+        QCOMPARE(sony.model, QString("WH-1000XM4"));
+        QCOMPARE(sony.battery, 55.0);
+        QVERIFY(!sony.isPresent);
+    }
+
+    void testFollowsSignalsWithoutNewSnapshot() {
+        if (!m_clientBus.isConnected()) {
+            QSKIP(qPrintable(m_busError));
+        }
+
+        const QString path = "/org/bluez/hci0/dev_00_1B_66_AA_BB_CC";
+        m_fake->addInterfaces(path, {{kDevice, FakeBluez::deviceProperties("Jabra Evolve2 65", "audio-headset")}},
+                              false);
+
+        BluezBackend backend(&byClass, m_clientBus);
+        QVERIFY(backend.start());
+        QTRY_VERIFY(backend.hasSnapshot());
+        QVERIFY(backend.devices().isEmpty());
+
+        QSignalSpy membership(&backend, &BluezBackend::devicesChanged);
+        QSignalSpy properties(&backend, &BluezBackend::devicePropertiesChanged);
+
+        // The battery service shows up once the HFP connection is set up
+        m_fake->addInterfaces(path, {{kBattery, FakeBluez::batteryProperties(40)}});
+        QTRY_COMPARE(membership.count(), 1);
+        QVERIFY(backend.deviceAt(path));
+        QCOMPARE(backend.deviceAt(path)->battery, 40.0);
+
+        m_fake->changeProperties(path, kBattery, {{"Percentage", QVariant::fromValue(uchar(39))}});
+        QTRY_COMPARE(properties.count(), 1);
+        QCOMPARE(properties.last().at(0).toString(), path);
+        QVariantMap changed = properties.last().at(1).toMap();
+        QCOMPARE(changed.size(), 1);
+        QCOMPARE(changed.value("Percentage").toDouble(), 39.0);
+
+        m_fake->changeProperties(path, kDevice, {{"Connected", false}});
+        QTRY_COMPARE(properties.count(), 2);
+        changed = properties.last().at(1).toMap();
+        QCOMPARE(changed.size(), 1);
+        QVERIFY(!changed.value("IsPresent").toBool());
+
+        // Properties nobody displays are not a change
+        m_fake->changeProperties(path, kDevice, {{"RSSI", QVariant::fromValue(qint16(-60))}});
+        m_fake->removeInterfaces(path, {kBattery});
+        QTRY_COMPARE(membership.count(), 2);
+        QCOMPARE(properties.count(), 2);
+        QVERIFY(backend.devices().isEmpty());
+
+        QCOMPARE(m_fake->snapshotCount(), 1);
+    }
+
+    void testOnlyDeviceAndBatteryChangesAreDelivered() {
+        if (!m_clientBus.isConnected()) {
+            QSKIP(qPrintable(m_busError));
+        }
+
+        const QString path = "/org/bluez/hci0/dev_00_1B_66_AA_BB_CC";
+        const QString transport = path + "/sep1/fd0";
+        m_fake->addInterfaces(path, headset("Jabra Evolve2 65", 40), false);
+        m_fake->addInterfaces(transport, {{"org.bluez.MediaTransport1", {{"Volume", QVariant::fromValue(quint16(64))}}}},
+                              false);
+
+        BluezBackend backend(&byClass, m_clientBus);
+        QVERIFY(backend.start());
+        QTRY_VERIFY(backend.hasSnapshot());
+        QSignalSpy properties(&backend, &BluezBackend::devicePropertiesChanged);
+
+        // Signals from one sender arrive in order, so the battery change
+        // comes after any transport change that was delivered
+        for (int volume = 65; volume < 75; ++volume) {
+            m_fake->changeProperties(transport, "org.bluez.MediaTransport1",
+                                     {{"Volume", QVariant::fromValue(quint16(volume))}});
+        }
+        m_fake->changeProperties(path, kBattery, {{"Percentage", QVariant::fromValue(uchar(39))}});
+        QTRY_COMPARE(properties.count(), 1);
+        QCOMPARE(backend.propertySignalCount(), 1);
+
+        m_fake->changeProperties(path, kDevice, {{"Connected", false}});
+        QTRY_COMPARE(properties.count(), 2);
+        QCOMPARE(backend.propertySignalCount(), 2);
+    }
+
+    void testOverrideAndRestart() {
+        if (!m_clientBus.isConnected()) {
+            QSKIP(qPrintable(m_busError));
+        }
+
+        const QString path = "/org/bluez/hci0/dev_00_1B_66_AA_BB_CC";
+        m_fake->addInterfaces(path, headset("Jabra Evolve2 65", 80), false);
+
+        QSet<QString> ignored;
+        BluezBackend backend([&ignored](const QString& objectPath, const QString&, const QString&, bool headsetClass) {
+                                 return headsetClass && !ignored.contains(objectPath);
+                             },
+                             m_clientBus);
+        QVERIFY(backend.start());
+        QTRY_COMPARE(backend.devices().size(), 1);
+
+        QSignalSpy membership(&backend, &BluezBackend::devicesChanged);
+        ignored.insert(path);
+        backend.rescan();
+        QCOMPARE(membership.count(), 1);
+        QVERIFY(backend.devices().isEmpty());
+        ignored.clear();
+        backend.rescan();
+        QCOMPARE(backend.devices().size(), 1);
+
+        // bluetoothd going away drops its devices; the next instance is read again
+        QVERIFY(m_serviceBus.unregisterService(QLatin1String(BluezBackend::kServiceName)));
+        QTRY_VERIFY(backend.devices().isEmpty());
+        QVERIFY(!backend.hasSnapshot());
+
+        QVERIFY(m_serviceBus.registerService(QLatin1String(BluezBackend::kServiceName)));
+        QTRY_COMPARE(backend.devices().size(), 1);
+        QCOMPARE(m_fake->snapshotCount(), 2);
+    }
+};
+
+const QString TestBluezBackend::kDevice = QStringLiteral("org.bluez.Device1");
+const QString TestBluezBackend::kBattery = QStringLiteral("org.bluez.Battery1");
+
+QTEST_MAIN(TestBluezBackend)
+#include "test_BluezBackend.moc"
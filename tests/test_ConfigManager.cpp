@@ -170,6 +170,18 @@ private slots:
         config->setUpdateInterval(originalValue);
     }
 
+    void testPrewarmTrayIcons() {
+        QSignalSpy spy(config, &ConfigManager::configChanged);
+        QVERIFY(config->prewarmTrayIcons());
+
+        config->setPrewarmTrayIcons(false);
+        QVERIFY(!config->prewarmTrayIcons());
+        QCOMPARE(spy.count(), 1);
+
+        ConfigManager reloaded(this, configFilePath);
+        QVERIFY(!reloaded.prewarmTrayIcons());
+    }
+
     void testNoSignalOnSameValue() {
         QSignalSpy spy(config, &ConfigManager::configChanged);
 
@@ -197,6 +209,35 @@ private slots:
         config->setLowBatteryThreshold(originalThreshold);
     }
 
+    void testLegacyUpdateIntervalIsMigrated() {
+        // Written by a version-1 save() that only carried the old default
+        const QString legacyPath = tempDir->path() + "/legacy.ini";
+        {
+            QSettings legacy(legacyPath, QSettings::IniFormat);
+            legacy.setValue("general/updateInterval", 30000);
+            legacy.setValue("notifications/lowBatteryThreshold", 15);
+        }
+        {
+            ConfigManager migrated(nullptr, legacyPath);
+            QCOMPARE(migrated.updateInterval(), 900000);
+            QCOMPARE(migrated.lowBatteryThreshold(), 15);
+
+            // Chosen after the migration, the same value is kept
+            migrated.setUpdateInterval(30000);
+        }
+        ConfigManager reloaded(nullptr, legacyPath);
+        QCOMPARE(reloaded.updateInterval(), 30000);
+
+        // Any other stored value was a deliberate choice
+        const QString customPath = tempDir->path() + "/custom.ini";
+        {
+            QSettings custom(customPath, QSettings::IniFormat);
+            custom.setValue("general/updateInterval", 60000);
+        }
+        ConfigManager custom(nullptr, customPath);
+        QCOMPARE(custom.updateInterval(), 60000);
+    }
+
     void testMultipleChangesEmitMultipleSignals() {
         // Get original values
         int origThreshold = config->lowBatteryThreshold();
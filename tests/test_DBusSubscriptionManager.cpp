@@ -0,0 +1,192 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QDBusConnectionInterface>
+#include "TestDevices.h"
+#include "FakeUPower.h"
+#include "PrivateDBus.h"
+#include "../src/DBusListener.h"
+#include "../src/DBusSubscriptionManager.h"
+#include "../src/HeadsetManager.h"
+
+/**
+ * @class TestDBusSubscriptionManager
+ * @brief Per-path PropertiesChanged subscriptions against a FakeUPower
+ *
+ * Every check changes properties on a mix of tracked and untracked paths
+ * and then on a tracked marker path. Signals from one sender arrive in
+ * order, so once the marker is in, anything else the bus daemon forwarded
+ * is in as well.
+ */
+class TestDBusSubscriptionManager : public QObject {
+    Q_OBJECT
+
+private:
+    PrivateDBus m_bus;
+    QString m_busError;
+    QThread m_serverThread;
+    FakeUPower *m_upower = nullptr;
+    QDBusConnection m_client{QString()};
+    QTemporaryDir m_dir;
+
+    static QString devicePath(const QString& name) {
+        return FakeUPower::kObjectPath + "/devices/" + name;
+    }
+
+    // Changes every path in @p paths, then @p marker, and returns what arrived before the marker
+    QStringList deliveredOf(const QStringList& paths, const QString& marker, QStringList& received) {
+        // A call to the bus daemon returns after it applied our earlier match rule changes
+        m_client.interface()->isServiceRegistered(FakeUPower::kServiceName);
+
+        received.clear();
+        for (const QString& path : paths) {
+            m_upower->changeProperties(path, {{"Percentage", 40.0}});
+        }
+        m_upower->changeProperties(marker, {{"Percentage", 41.0}});
+        if (!QTest::qWaitFor([&]() { return received.contains(marker); }, 5000)) {
+            return {"marker not delivered"};
+        }
+        received.removeAll(marker);
+        return received;
+    }
+
+private slots:
+    void initTestCase() {
+        if (!m_bus.start(&m_busError)) {
+            qWarning() << "Bus tests will be skipped:" << m_busError;
+            return;
+        }
+
+        m_upower = new FakeUPower();
+        m_upower->moveToThread(&m_serverThread);
+        m_serverThread.start();
+
+        QList<FakeUPowerDevice> devices;
+        for (const QString& name : {"headset_a", "headset_b", "headset_c", "mouse_dev_1", "DisplayDevice"}) {
+            devices.append({devicePath(name), {{"Model", name}, {"Percentage", 50.0}}});
+        }
+        m_upower->setDevices(devices);
+
+        const QDBusConnection server = m_bus.connect("subscriptions-upower");
+        bool registered = false;
+        QMetaObject::invokeMethod(m_upower, [&]() { registered = m_upower->registerOn(server); },
+                                  Qt::BlockingQueuedConnection);
+        QVERIFY(registered);
+        m_client = m_bus.connect("subscriptions-client");
+    }
+
+    void cleanupTestCase() {
+        if (m_upower) {
+            QMetaObject::invokeMethod(m_upower, &QObject::deleteLater);
+            m_serverThread.quit();
+            m_serverThread.wait();
+        }
+    }
+
+    void testOnlyTrackedPathsAreDelivered() {
+        if (!m_busError.isEmpty()) {
+            QSKIP("dbus-daemon not available");
+        }
+
+        DBusListener listener;
+        QStringList received;
+        connect(&listener, &DBusListener::devicePropertiesChanged, this,
+                [&](const QString& path, const QVariantMap&) { received.append(path); });
+        DBusSubscriptionManager subscriptions(m_client, &listener,
+                                              SLOT(propertiesChanged(QString,QVariantMap,QStringList,QDBusMessage)));
+
+        const QString a = devicePath("headset_a");
+        const QString b = devicePath("headset_b");
+        const QString c = devicePath("headset_c");
+        const QStringList others = {devicePath("mouse_dev_1"), devicePath("DisplayDevice")};
+
+        // A mouse and the DisplayDevice never reach the process
+        subscriptions.setTrackedPaths({a, b});
+        QCOMPARE(subscriptions.trackedCount(), 2);
+        QCOMPARE(deliveredOf(QStringList{a, c} + others, b, received), QStringList({a}));
+
+        // Dropping a path removes its rule; adding one adds a rule
+        subscriptions.setTrackedPaths({b, c});
+        QVERIFY(!subscriptions.isTracked(a));
+        QCOMPARE(deliveredOf(QStringList{a, c} + others, b, received), QStringList({c}));
+
+        // Untracked and tracked again
+        subscriptions.untrack(c);
+        QCOMPARE(deliveredOf({a, c}, b, received), QStringList());
+        QVERIFY(subscriptions.track(c));
+        QVERIFY(subscriptions.track(c));
+        QCOMPARE(subscriptions.trackedCount(), 2);
+        QCOMPARE(deliveredOf({a, c}, b, received), QStringList({c}));
+
+        subscriptions.setTrackedPaths({});
+        QCOMPARE(subscriptions.trackedCount(), 0);
+    }
+
+    void testHeadsetManagerFollowsTrackedDevicesAndRemovals() {
+        if (!m_busError.isEmpty()) {
+            QSKIP("dbus-daemon not available");
+        }
+
+        HeadsetManager manager(nullptr, m_dir.path() + "/devices.ini");
+        manager.setBus(m_client);
+        manager.watchSignals();
+
+        QStringList received;
+        connect(&manager, &HeadsetManager::devicePropertiesChanged, this,
+                [&](const QString& path, const QVariantMap&) { received.append(path); });
+
+        const QString a = devicePath("headset_a");
+        const QString b = devicePath("headset_b");
+        const QStringList others = {devicePath("mouse_dev_1"), devicePath("DisplayDevice")};
+
+        manager.setTrackedDevices({makeDevice(a, 50), makeDevice(b, 50)});
+        QCOMPARE(deliveredOf(QStringList{a} + others, b, received), QStringList({a}));
+
+        // DeviceRemoved drops the rule before any enumeration runs
+        QSignalSpy changed(&manager, &HeadsetManager::devicesChanged);
+        m_upower->removeDevice(a);
+        QTRY_COMPARE(changed.count(), 1);
+        m_upower->addDevice({a, {{"Model", "headset_a"}, {"Percentage", 50.0}}});
+        QCOMPARE(deliveredOf({a}, b, received), QStringList());
+
+        // The next tracked list subscribes it again
+        manager.setTrackedDevices({makeDevice(a, 50), makeDevice(b, 50)});
+        QCOMPARE(deliveredOf({a}, b, received), QStringList({a}));
+    }
+
+    void testDeviceWithoutModelIsClassifiedOnceItHasOne() {
+        if (!m_busError.isEmpty()) {
+            QSKIP("dbus-daemon not available");
+        }
+
+        HeadsetManager manager(nullptr, m_dir.path() + "/late-model.ini");
+        manager.setBus(m_client);
+        manager.watchSignals();
+        QSignalSpy changed(&manager, &HeadsetManager::devicesChanged);
+
+        // BlueZ devices reach UPower before their name is known
+        const QString late = devicePath("battery_dev_00_11_22_33_44_55");
+        m_upower->addDevice({late, {{"Model", QString()}, {"Percentage", 80.0}}});
+        QTRY_COMPARE(changed.count(), 1);
+        const auto paths = [&manager]() {
+            QStringList result;
+            for (const HeadsetDevice& device : manager.getDevices()) {
+                result << device.dbusPath;
+            }
+            return result;
+        };
+        QVERIFY(!paths().contains(late));
+
+        // The Model change alone brings it in, without waiting for a poll
+        m_client.interface()->isServiceRegistered(FakeUPower::kServiceName);
+        m_upower->changeProperties(late, {{"Model", "Jabra Evolve2 65"}});
+        QTRY_COMPARE(changed.count(), 2);
+        QVERIFY(paths().contains(late));
+
+        m_upower->removeDevice(late);
+        QTRY_COMPARE(changed.count(), 3);
+    }
+};
+
+QTEST_MAIN(TestDBusSubscriptionManager)
+#include "test_DBusSubscriptionManager.moc"
@@ -0,0 +1,131 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include "../src/DeviceClassifier.h"
+
+/**
+ * @class TestDeviceClassifier
+ * @brief Unit tests for cached device classification and persisted overrides
+ *
+ * Tests use an isolated temporary overrides file per test case.
+ */
+class TestDeviceClassifier : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir *tempDir;
+    QString overridesFilePath;
+    int keywordCalls;
+
+    DeviceClassifier::KeywordMatch countingMatcher() {
+        return [this](const QString& model, const QString&) {
+            ++keywordCalls;
+            return model.contains("Headset", Qt::CaseInsensitive);
+        };
+    }
+
+private slots:
+    void init() {
+        tempDir = new QTemporaryDir();
+        QVERIFY(tempDir->isValid());
+        overridesFilePath = tempDir->path() + "/devices.ini";
+        keywordCalls = 0;
+    }
+
+    void cleanup() {
+        delete tempDir;
+        tempDir = nullptr;
+    }
+
+    void testDecisionIsCachedPerIdentity() {
+        DeviceClassifier classifier(countingMatcher(), overridesFilePath);
+
+        QVERIFY(classifier.isHeadset("/dev/a", "/sys/a", "Generic Headset"));
+        QVERIFY(classifier.isHeadset("/dev/a", "/sys/a", "Generic Headset"));
+        QVERIFY(!classifier.isHeadset("/dev/b", "/sys/b", "Mouse"));
+        QVERIFY(!classifier.isHeadset("/dev/b", "/sys/b", "Mouse"));
+        QCOMPARE(keywordCalls, 2);
+    }
+
+    void testKnownNonHeadsetPaths() {
+        DeviceClassifier classifier(countingMatcher(), overridesFilePath);
+
+        classifier.isHeadset("/dev/a", "/sys/a", "Generic Headset");
+        classifier.isHeadset("/dev/b", "/sys/b", "Mouse");
+        QVERIFY(!classifier.isKnownNonHeadset("/dev/a"));
+        QVERIFY(classifier.isKnownNonHeadset("/dev/b"));
+        QVERIFY(!classifier.isKnownNonHeadset("/dev/unknown"));
+
+        classifier.forgetPath("/dev/b");
+        QVERIFY(!classifier.isKnownNonHeadset("/dev/b"));
+
+        classifier.isHeadset("/dev/b", "/sys/b", "Mouse");
+        classifier.clearCache();
+        QVERIFY(!classifier.isKnownNonHeadset("/dev/b"));
+        QVERIFY(!classifier.isHeadset("/dev/b", "/sys/b", "Mouse"));
+        QCOMPARE(keywordCalls, 3);
+    }
+
+    void testEmptyModelIsNotCachedAsNonHeadset() {
+        DeviceClassifier classifier(countingMatcher(), overridesFilePath);
+
+        QVERIFY(!classifier.isHeadset("/dev/bt", "/org/bluez/hci0/dev_1", ""));
+        QVERIFY(!classifier.isKnownNonHeadset("/dev/bt"));
+        QVERIFY(classifier.isHeadset("/dev/bt", "/org/bluez/hci0/dev_1", "BT Headset"));
+    }
+
+    void testOverridesTakePrecedence() {
+        DeviceClassifier classifier(countingMatcher(), overridesFilePath);
+
+        classifier.setOverride("/sys/a", "Generic Headset", DeviceClassifier::Override::NeverHeadset);
+        classifier.setOverride("/sys/b", "Speaker", DeviceClassifier::Override::AlwaysHeadset);
+
+        QVERIFY(!classifier.isHeadset("/dev/a", "/sys/a", "Generic Headset"));
+        QVERIFY(classifier.isHeadset("/dev/b", "/sys/b", "Speaker"));
+        QCOMPARE(keywordCalls, 0);
+    }
+
+    void testOverridesPersist() {
+        {
+            DeviceClassifier classifier(countingMatcher(), overridesFilePath);
+            classifier.setOverride("/sys/a", "Generic Headset", DeviceClassifier::Override::NeverHeadset);
+            classifier.setOverride("/sys/b", "Speaker", DeviceClassifier::Override::AlwaysHeadset);
+        }
+
+        DeviceClassifier reloaded(countingMatcher(), overridesFilePath);
+        QVERIFY(reloaded.overrideFor("/sys/a", "Generic Headset") == DeviceClassifier::Override::NeverHeadset);
+        QVERIFY(reloaded.overrideFor("/sys/b", "Speaker") == DeviceClassifier::Override::AlwaysHeadset);
+        QVERIFY(reloaded.overrideFor("/sys/c", "Other") == DeviceClassifier::Override::None);
+    }
+
+    void testClearingOverride() {
+        DeviceClassifier classifier(countingMatcher(), overridesFilePath);
+        classifier.setOverride("/sys/a", "Generic Headset", DeviceClassifier::Override::NeverHeadset);
+        QVERIFY(!classifier.isHeadset("/dev/a", "/sys/a", "Generic Headset"));
+
+        classifier.setOverride("/sys/a", "Generic Headset", DeviceClassifier::Override::None);
+        QVERIFY(classifier.isHeadset("/dev/a", "/sys/a", "Generic Headset"));
+
+        DeviceClassifier reloaded(countingMatcher(), overridesFilePath);
+        QVERIFY(reloaded.overrideFor("/sys/a", "Generic Headset") == DeviceClassifier::Override::None);
+    }
+
+    void testStoredOverridesCanBeListed() {
+        QVERIFY(DeviceClassifier::readOverrides(overridesFilePath).isEmpty());
+        {
+            DeviceClassifier classifier(countingMatcher(), overridesFilePath);
+            classifier.setOverride("/sys/a", "Generic Headset", DeviceClassifier::Override::NeverHeadset);
+            classifier.setOverride("/sys/b", "Speaker", DeviceClassifier::Override::AlwaysHeadset);
+        }
+
+        const QList<DeviceClassifier::StoredOverride> stored = DeviceClassifier::readOverrides(overridesFilePath);
+        QCOMPARE(stored.size(), 2);
+        QCOMPARE(stored.at(0).nativePath, QString("/sys/b"));
+        QCOMPARE(stored.at(0).model, QString("Speaker"));
+        QVERIFY(stored.at(0).value == DeviceClassifier::Override::AlwaysHeadset);
+        QCOMPARE(stored.at(1).nativePath, QString("/sys/a"));
+        QVERIFY(stored.at(1).value == DeviceClassifier::Override::NeverHeadset);
+    }
+};
+
+QTEST_MAIN(TestDeviceClassifier)
+#include "test_DeviceClassifier.moc"
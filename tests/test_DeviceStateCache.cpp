@@ -0,0 +1,169 @@
+#include <QtTest/QtTest>
+#include "TestDevices.h"
+#include "../src/DeviceStateCache.h"
+
+/**
+ * @class TestDeviceStateCache
+ * @brief Unit tests for merging UPower property changes into cached devices
+ */
+class TestDeviceStateCache : public QObject {
+    Q_OBJECT
+
+private:
+private slots:
+    void testReplaceAllReportsRemovedDevices() {
+        DeviceStateCache cache;
+        QVERIFY(cache.replaceAll({makeDevice("/a", 50), makeDevice("/b", 60)}).isEmpty());
+        QCOMPARE(cache.size(), 2);
+
+        const QList<HeadsetDevice> removed = cache.replaceAll({makeDevice("/b", 60)});
+        QCOMPARE(removed.size(), 1);
+        QCOMPARE(removed.first().dbusPath, QString("/a"));
+        QVERIFY(!cache.contains("/a"));
+        QVERIFY(cache.contains("/b"));
+    }
+
+    void testReplaceAllKeepsEnumerationOrder() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/c", 10), makeDevice("/a", 20), makeDevice("/b", 30)});
+
+        const QList<HeadsetDevice>& devices = cache.devices();
+        QCOMPARE(devices.at(0).dbusPath, QString("/c"));
+        QCOMPARE(devices.at(1).dbusPath, QString("/a"));
+        QCOMPARE(devices.at(2).dbusPath, QString("/b"));
+    }
+
+    void testApplyPercentage() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/a", 50), makeDevice("/b", 60)});
+
+        HeadsetDevice updated;
+        QVERIFY(cache.applyProperties("/a", {{"Percentage", 49.0}}, &updated));
+        QCOMPARE(updated.dbusPath, QString("/a"));
+        QCOMPARE(updated.battery, 49.0);
+        QCOMPARE(cache.find("/a")->battery, 49.0);
+        QCOMPARE(cache.find("/b")->battery, 60.0);
+    }
+
+    void testApplyChargingAndPresence() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/a", 50)});
+
+        QVERIFY(cache.applyProperties("/a", {{"IsCharging", true}}));
+        QVERIFY(cache.find("/a")->isCharging);
+
+        // UPower itself reports charging through State (1 = charging, 2 = discharging)
+        QVERIFY(cache.applyProperties("/a", {{"State", 2u}}));
+        QVERIFY(!cache.find("/a")->isCharging);
+        QVERIFY(cache.applyProperties("/a", {{"State", 1u}}));
+        QVERIFY(cache.find("/a")->isCharging);
+
+        QVERIFY(cache.applyProperties("/a", {{"IsPresent", false}}));
+        QVERIFY(!cache.find("/a")->isPresent);
+    }
+
+    void testUnchangedValuesReportNoChange() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/a", 50)});
+
+        QVERIFY(!cache.applyProperties("/a", {{"Percentage", 50.0}, {"IsPresent", true}}));
+        QVERIFY(!cache.applyProperties("/a", {{"Energy", 1.5}}));
+    }
+
+    void testReplaceAllReportsChangedFields() {
+        DeviceStateCache cache;
+        DeviceChangeSet initial;
+        cache.replaceAll({makeDevice("/a", 50), makeDevice("/b", 60)}, &initial);
+        QCOMPARE(initial.changes.size(), 2);
+        QVERIFY(initial.changes.at(0).fields == DeviceField::Added);
+        QVERIFY(initial.orderChanged);
+
+        HeadsetDevice charging = makeDevice("/b", 61);
+        charging.isCharging = true;
+        DeviceChangeSet changes;
+        cache.replaceAll({makeDevice("/a", 50), charging}, &changes);
+
+        QCOMPARE(changes.changes.size(), 1);
+        QCOMPARE(changes.changes.first().dbusPath, QString("/b"));
+        QVERIFY(changes.changes.first().fields == (DeviceField::Battery | DeviceField::Charging));
+        QVERIFY(!changes.orderChanged);
+    }
+
+    void testReplaceAllReportsRemovalAndOrder() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/a", 50), makeDevice("/b", 60), makeDevice("/c", 70)});
+
+        DeviceChangeSet changes;
+        cache.replaceAll({makeDevice("/c", 70), makeDevice("/b", 60)}, &changes);
+        QCOMPARE(changes.changes.size(), 1);
+        QCOMPARE(changes.changes.first().dbusPath, QString("/a"));
+        QVERIFY(changes.changes.first().fields == DeviceField::Removed);
+        QVERIFY(changes.orderChanged);
+
+        // Unchanged devices in the same order produce an empty change set
+        DeviceChangeSet none;
+        cache.replaceAll({makeDevice("/c", 70), makeDevice("/b", 60)}, &none);
+        QVERIFY(none.isEmpty());
+    }
+
+    void testSwappedStatesAreBothReported() {
+        // Two devices trading states must not cancel each other out
+        DeviceStateCache cache;
+        HeadsetDevice a = makeDevice("/a", 50);
+        HeadsetDevice b = makeDevice("/b", 60);
+        b.isCharging = true;
+        cache.replaceAll({a, b});
+
+        std::swap(a.isCharging, b.isCharging);
+        std::swap(a.battery, b.battery);
+        DeviceChangeSet changes;
+        cache.replaceAll({a, b}, &changes);
+        QCOMPARE(changes.changes.size(), 2);
+        QVERIFY(changes.changes.at(0).fields == (DeviceField::Battery | DeviceField::Charging));
+        QVERIFY(changes.changes.at(1).fields == (DeviceField::Battery | DeviceField::Charging));
+    }
+
+    void testApplyPropertiesReportsFields() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/a", 50)});
+
+        DeviceFields fields;
+        QVERIFY(cache.applyProperties("/a", {{"Percentage", 40.0}, {"IsPresent", false}}, nullptr, &fields));
+        QVERIFY(fields == (DeviceField::Battery | DeviceField::Presence));
+
+        // The stored fingerprint follows merged properties
+        DeviceChangeSet changes;
+        cache.replaceAll({*cache.find("/a")}, &changes);
+        QVERIFY(changes.isEmpty());
+    }
+
+    void testEstimateSurvivesReplaceAll() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/a", 50), makeDevice("/b", 60)});
+
+        QVERIFY(cache.setSecondsRemaining("/a", 3600));
+        QVERIFY(!cache.setSecondsRemaining("/a", 3600));
+        QVERIFY(!cache.setSecondsRemaining("/unknown", 3600));
+
+        DeviceChangeSet changes;
+        cache.replaceAll({makeDevice("/b", 60), makeDevice("/a", 49)}, &changes);
+        QCOMPARE(cache.find("/a")->secondsRemaining, 3600);
+        QCOMPARE(cache.find("/b")->secondsRemaining, -1);
+
+        // The estimate is not an enumerated field
+        QCOMPARE(changes.changes.size(), 1);
+        QVERIFY(changes.changes.first().fields == DeviceField::Battery);
+    }
+
+    void testUnknownPathIsIgnored() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/a", 50)});
+
+        QVERIFY(!cache.applyProperties("/battery_BAT0", {{"Percentage", 10.0}}));
+        QVERIFY(cache.find("/battery_BAT0") == nullptr);
+        QCOMPARE(cache.size(), 1);
+    }
+};
+
+QTEST_MAIN(TestDeviceStateCache)
+#include "test_DeviceStateCache.moc"
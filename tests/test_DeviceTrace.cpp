@@ -0,0 +1,232 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include "TestDevices.h"
+#include "../src/DeviceTrace.h"
+#include "../src/LastStateStore.h"
+#include "../src/ReplaySource.h"
+#include "../src/TraceRecorder.h"
+
+/**
+ * @class TestDeviceTrace
+ * @brief Unit tests for the trace format, TraceRecorder and ReplaySource
+ */
+class TestDeviceTrace : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_dir;
+
+    static DeviceTraceEvent snapshot(qint64 timeUs, const QList<HeadsetDevice>& devices) {
+        DeviceTraceEvent event;
+        event.timeUs = timeUs;
+        event.type = DeviceTraceEvent::Type::Snapshot;
+        event.devices = devices;
+        return event;
+    }
+
+    static DeviceTraceEvent propertiesChanged(qint64 timeUs, const QString& path, const QVariantMap& properties) {
+        DeviceTraceEvent event;
+        event.timeUs = timeUs;
+        event.type = DeviceTraceEvent::Type::PropertiesChanged;
+        event.dbusPath = path;
+        event.properties = properties;
+        return event;
+    }
+
+    // A snapshot of two headsets, then 100 battery changes on the first
+    static QList<DeviceTraceEvent> sampleTrace() {
+        const QString path = "/org/freedesktop/UPower/devices/headset_dev_00_1B_66_AA_BB_CC";
+        QList<DeviceTraceEvent> events;
+        HeadsetDevice usb = makeDevice("/org/mewset/HeadsetStatus/power_supply/hidpp_battery_0", 64.5);
+        usb.connectionType = ConnectionType::USB;
+        usb.isCharging = true;
+        HeadsetDevice bluetooth = makeDevice(path, 100);
+        bluetooth.nativePath = "/org/bluez/hci0/dev_00_1B_66_AA_BB_CC";
+        events.append(snapshot(1500, {bluetooth, usb}));
+        for (int i = 0; i < 100; ++i) {
+            events.append(propertiesChanged(2000 + i * 1000, path, {{"Percentage", 99.0 - i * 0.5}}));
+        }
+        DeviceTraceEvent changed;
+        changed.timeUs = 200000;
+        changed.type = DeviceTraceEvent::Type::DevicesChanged;
+        events.append(changed);
+        return events;
+    }
+
+    QString writeTrace(const char *name, const QList<DeviceTraceEvent>& events) {
+        const QString path = m_dir.path() + '/' + name;
+        DeviceTraceWriter writer;
+        if (!writer.open(path)) {
+            return QString();
+        }
+        for (const DeviceTraceEvent& event : events) {
+            writer.write(event);
+        }
+        return path;
+    }
+
+private slots:
+    void initTestCase() {
+        QVERIFY(m_dir.isValid());
+    }
+
+    void testRoundTrip() {
+        QList<DeviceTraceEvent> events = sampleTrace();
+        events.append(propertiesChanged(300000, events.first().devices.first().dbusPath,
+                                        {{"IsPresent", false}, {"State", 2u}, {"Signed", -3},
+                                         {"Vendor", QString("GN Audio")}}));
+        const QString path = writeTrace("roundtrip.trace", events);
+        QVERIFY(!path.isEmpty());
+
+        QList<DeviceTraceEvent> read;
+        QString error;
+        QVERIFY2(readDeviceTrace(path, &read, &error), qPrintable(error));
+        QCOMPARE(read.size(), events.size());
+
+        for (int i = 0; i < events.size(); ++i) {
+            QCOMPARE(read.at(i).timeUs, events.at(i).timeUs);
+            QCOMPARE(read.at(i).type, events.at(i).type);
+            QCOMPARE(read.at(i).dbusPath, events.at(i).dbusPath);
+            QCOMPARE(read.at(i).properties, events.at(i).properties);
+        }
+
+        const QList<HeadsetDevice>& devices = read.first().devices;
+        QCOMPARE(devices.size(), 2);
+        QCOMPARE(devices.at(0).model, QString("Jabra Evolve2 75"));
+        QCOMPARE(devices.at(0).nativePath, QString("/org/bluez/hci0/dev_00_1B_66_AA_BB_CC"));
+        QCOMPARE(devices.at(1).battery, 64.5);
+        QCOMPARE(devices.at(1).connectionType, ConnectionType::USB);
+        QVERIFY(devices.at(1).isCharging);
+        QVERIFY(devices.at(1).isPresent);
+    }
+
+    void testRepeatedStringsAreReferenced() {
+        const QString path = writeTrace("compact.trace", sampleTrace());
+        // Path and property name are written once; each change is then a
+        // time delta, type, two string references, count, tag and a double
+        QVERIFY(QFileInfo(path).size() < 300 + 100 * 15);
+    }
+
+    void testTruncatedTailIsDropped() {
+        const QString path = writeTrace("truncated.trace", sampleTrace());
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.resize(file.size() - 5));
+        file.close();
+
+        QList<DeviceTraceEvent> read;
+        QVERIFY(readDeviceTrace(path, &read));
+        QVERIFY(read.size() < sampleTrace().size());
+        QVERIFY(read.size() > 90);
+        QCOMPARE(read.first().devices.size(), 2);
+    }
+
+    void testRejectsOtherFiles() {
+        const QString path = m_dir.path() + "/not-a-trace";
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("{\"event\":\"snapshot\"}\n");
+        file.close();
+
+        QList<DeviceTraceEvent> read;
+        QString error;
+        QVERIFY(!readDeviceTrace(path, &read, &error));
+        QVERIFY(error.contains("not a headset trace"));
+    }
+
+    void testReplayAnswersRequestsFromReplayedState() {
+        ReplaySource replay;
+        replay.setEvents(sampleTrace());
+
+        QList<QList<HeadsetDevice>> snapshots;
+        int propertyChanges = 0;
+        connect(&replay, &DeviceSource::devicesReady, this,
+                [&](const QList<HeadsetDevice>& devices) { snapshots.append(devices); });
+        connect(&replay, &DeviceSource::devicePropertiesChanged, this, [&]() {
+            // A request in the middle sees every change played so far
+            if (++propertyChanges == 50) {
+                replay.requestDevices();
+            }
+        });
+        QSignalSpy finished(&replay, &ReplaySource::finished);
+
+        replay.start(ReplaySource::Speed::AsFastAsPossible);
+        QTRY_COMPARE(finished.count(), 1);
+        QCOMPARE(replay.position(), replay.eventCount());
+        QCOMPARE(propertyChanges, 100);
+
+        QCOMPARE(snapshots.size(), 2);
+        QCOMPARE(snapshots.at(0).first().battery, 100.0);
+        QVERIFY(snapshots.at(1).first().battery <= 99.0 - 49 * 0.5);
+        QCOMPARE(snapshots.at(1).at(1).battery, 64.5);
+    }
+
+    void testRealTimeKeepsRecordedGaps() {
+        QList<DeviceTraceEvent> events;
+        events.append(snapshot(0, {makeDevice("/a", 50)}));
+        events.append(propertiesChanged(150000, "/a", {{"Percentage", 49.0}}));
+
+        ReplaySource replay;
+        replay.setEvents(events);
+        QSignalSpy finished(&replay, &ReplaySource::finished);
+
+        QElapsedTimer clock;
+        clock.start();
+        replay.start(ReplaySource::Speed::RealTime);
+        QTRY_COMPARE(finished.count(), 1);
+        QVERIFY(clock.elapsed() >= 150);
+    }
+
+    void testRecordingAReplayReproducesTheTrace() {
+        ReplaySource replay;
+        replay.setEvents(sampleTrace());
+
+        TraceRecorder recorder;
+        const QString path = m_dir.path() + "/rerecorded.trace";
+        QVERIFY(recorder.start(path, &replay));
+
+        QSignalSpy finished(&replay, &ReplaySource::finished);
+        replay.start(ReplaySource::Speed::AsFastAsPossible);
+        QTRY_COMPARE(finished.count(), 1);
+        recorder.stop();
+        QCOMPARE(recorder.eventCount(), sampleTrace().size());
+
+        QList<DeviceTraceEvent> read;
+        QVERIFY(readDeviceTrace(path, &read));
+        QCOMPARE(read.size(), sampleTrace().size());
+        for (int i = 1; i < read.size(); ++i) {
+            QCOMPARE(read.at(i).type, sampleTrace().at(i).type);
+            QVERIFY(read.at(i).timeUs >= read.at(i - 1).timeUs);
+        }
+    }
+    void testLastStateSurvivesRestart() {
+        const QString path = m_dir.path() + "/state/last-state";
+        const qint64 savedAtMs = 1760000000123;
+        QList<HeadsetDevice> devices = {makeDevice("/a", 50), makeDevice("/b", 64.5)};
+        devices[1].isCharging = true;
+
+        LastStateStore first(path);
+        QVERIFY(first.save(devices, savedAtMs));
+
+        QList<HeadsetDevice> loaded;
+        qint64 loadedAtMs = 0;
+        LastStateStore second(path);
+        QVERIFY(second.load(&loaded, &loadedAtMs));
+        QCOMPARE(loadedAtMs, savedAtMs);
+        QCOMPARE(loaded.size(), 2);
+        QCOMPARE(loaded.at(1).dbusPath, QString("/b"));
+        QCOMPARE(loaded.at(1).battery, 64.5);
+        QVERIFY(loaded.at(1).isCharging);
+
+        // A trace with more than one record is not a saved state
+        QFile trace(path);
+        QVERIFY(trace.open(QIODevice::WriteOnly));
+        trace.write(DeviceTraceWriter::encode(sampleTrace()));
+        trace.close();
+        QVERIFY(!second.load(&loaded, &loadedAtMs));
+        QVERIFY(!LastStateStore(m_dir.path() + "/missing").load(&loaded, &loadedAtMs));
+    }
+};
+
+QTEST_MAIN(TestDeviceTrace)
+#include "test_DeviceTrace.moc"
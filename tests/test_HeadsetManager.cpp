@@ -1,4 +1,5 @@
 #include <QtTest/QtTest>
+#include <QRandomGenerator>
 #include "../src/HeadsetManager.h"
 
 /**
@@ -11,6 +12,108 @@ class TestHeadsetManager : public QObject {
 private:
     HeadsetManager *manager;
 
+    // Reference implementation the compiled matcher must agree with
+    static bool naiveIsHeadsetDevice(const QString& model, const QString& path) {
+        const QString modelLower = model.toLower();
+        const QString pathLower = path.toLower();
+        for (const QString& keyword : HeadsetManager::headsetKeywords()) {
+            if (modelLower.contains(keyword) || pathLower.contains(keyword)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Model / object path pairs as reported by UPower on real machines
+    static QList<QPair<QString, QString>> upowerCorpus() {
+        static const QList<QPair<QString, QString>> corpus = {
+            {"5B10W51867", "/org/freedesktop/UPower/devices/battery_BAT0"},
+            {"DELL M3KCN74", "/org/freedesktop/UPower/devices/battery_BAT1"},
+            {"", "/org/freedesktop/UPower/devices/DisplayDevice"},
+            {"", "/org/freedesktop/UPower/devices/line_power_AC"},
+            {"", "/org/freedesktop/UPower/devices/line_power_ucsi_source_psy_USBC000o001"},
+            {"MX Master 3", "/org/freedesktop/UPower/devices/battery_hidpp_battery_0"},
+            {"MX Keys", "/org/freedesktop/UPower/devices/battery_hidpp_battery_1"},
+            {"G502 LIGHTSPEED Wireless Gaming Mouse", "/org/freedesktop/UPower/devices/battery_hidpp_battery_2"},
+            {"PRO X Wireless Gaming Headset", "/org/freedesktop/UPower/devices/battery_hidpp_battery_3"},
+            {"Magic Keyboard", "/org/freedesktop/UPower/devices/keyboard_dev_F0_18_98_11_22_33"},
+            {"Magic Mouse 2", "/org/freedesktop/UPower/devices/mouse_dev_F0_18_98_44_55_66"},
+            {"WH-1000XM4", "/org/freedesktop/UPower/devices/headset_dev_38_18_4C_AA_BB_CC"},
+            {"WF-1000XM5", "/org/freedesktop/UPower/devices/headphones_dev_AC_80_0A_01_02_03"},
+            {"Jabra Evolve2 65", "/org/freedesktop/UPower/devices/headset_dev_50_C2_ED_11_22_33"},
+            {"Bose QC35 II", "/org/freedesktop/UPower/devices/headset_dev_2C_41_A1_44_55_66"},
+            {"AirPods Pro", "/org/freedesktop/UPower/devices/headphones_dev_F8_4E_73_77_88_99"},
+            {"Galaxy Buds2 Pro", "/org/freedesktop/UPower/devices/headset_dev_A8_79_8D_12_34_56"},
+            {"Xbox Wireless Controller", "/org/freedesktop/UPower/devices/gaming_input_dev_98_7A_14_AA_BB_CC"},
+            {"DualSense Wireless Controller", "/org/freedesktop/UPower/devices/gaming_input_ps_controller_battery_a0_ab_51_01_02_03"},
+            {"Pixel 7", "/org/freedesktop/UPower/devices/phone_dev_58_24_29_DE_AD_00"},
+            {"Wacom Intuos Pro M", "/org/freedesktop/UPower/devices/tablet_wacom_battery_0"},
+            {"APC Back-UPS ES 700", "/org/freedesktop/UPower/devices/ups_hiddev0"},
+            {"Arctis Nova 7", "/org/freedesktop/UPower/devices/battery_steelseries_arctis_nova_7"},
+            {"HyperX Cloud Alpha Wireless", "/org/freedesktop/UPower/devices/battery_hyperx_0"},
+            {"Apple Pencil", "/org/freedesktop/UPower/devices/pen_dev_00_11_22_33_44_55"},
+            {"Pebble M350", "/org/freedesktop/UPower/devices/mouse_dev_DA_0B_33_44_55_66"},
+        };
+        return corpus;
+    }
+
+    // Every keyword in several spellings, inside other words and one edit
+    // away, strings that merely contain short keywords, and random runs of
+    // keyword fragments that exercise the automaton's failure transitions
+    static QList<QPair<QString, QString>> generatedCorpus() {
+        const QStringList& keywords = HeadsetManager::headsetKeywords();
+        QStringList texts;
+
+        for (const QString& keyword : keywords) {
+            QString mixed = keyword;
+            for (int i = 0; i < mixed.size(); i += 2) {
+                mixed[i] = mixed[i].toUpper();
+            }
+            const int half = keyword.size() / 2;
+            texts << keyword << keyword.toUpper() << mixed
+                  << "X" + keyword + "y" << keyword + keyword
+                  << keyword.chopped(1) << keyword.mid(1)
+                  << keyword.left(half) + '_' + keyword.mid(half)
+                  << keyword.chopped(1) + keyword;
+        }
+
+        texts << "AQC" << "Qualcomm QCA6174A" << "aqcuire" << "Q-C" << "q c" << "QWC"
+              << "BWH-1" << "newwh-" << "WH_1000XM4" << "wh" << "W-H" << "swf-" << "WF 1000" << "wf_"
+              << "Polymer Battery" << "Pol y" << "Sonya" << "beat" << "Beatsaber" << "jBl" << "j b l"
+              << "Razor" << "Ankers" << "Bosebose" << "headse t" << "head set" << "earbu d"
+              << "evolv" << "audio technica" << "pixelbuds" << "galaxy  buds" << "surface headphone"
+              << QString::fromUtf8("\u212Aeyboard") << QString::fromUtf8("AKG \u212A371")
+              << QString::fromUtf8("\u0130nput") << QString::fromUtf8("QC\u00A035")
+              << QString::fromUtf8("\u00C9couteurs Sony") << QString::fromUtf8("h\u00E9adset");
+
+        QStringList fragments = {" ", "-", "_", "0", "X"};
+        for (const QString& keyword : keywords) {
+            for (int length = 1; length <= 4; ++length) {
+                for (int start = 0; start + length <= keyword.size(); ++start) {
+                    fragments << keyword.mid(start, length);
+                }
+            }
+        }
+        QRandomGenerator random(4711);
+        for (int i = 0; i < 4000; ++i) {
+            QString text;
+            for (int count = random.bounded(1, 7); count > 0; --count) {
+                const QString& fragment = fragments.at(random.bounded(int(fragments.size())));
+                text += random.bounded(2) ? fragment.toUpper() : fragment;
+            }
+            texts << text;
+        }
+
+        QList<QPair<QString, QString>> corpus = upowerCorpus();
+        const QString devices = "/org/freedesktop/UPower/devices/";
+        for (int i = 0; i < texts.size(); ++i) {
+            corpus.append({texts.at(i), devices + QString("battery_hidpp_battery_%1").arg(i)});
+            corpus.append({QString(), devices + texts.at(i)});
+            corpus.append({texts.at(i), devices + texts.at((i * 7 + 3) % texts.size())});
+        }
+        return corpus;
+    }
+
 private slots:
     void initTestCase() {
         manager = new HeadsetManager(this);
@@ -81,6 +184,58 @@ private slots:
         QVERIFY(!manager->isHeadsetDevice("Unknown", ""));
     }
 
+    void testNonAsciiCaseFolding() {
+        // Kelvin sign lowercases to 'k', as in QString::toLower()
+        QVERIFY(manager->isHeadsetDevice(QString::fromUtf8("A\u212AG K371"), "/path"));
+        QVERIFY(!manager->isHeadsetDevice(QString::fromUtf8("\u00C9couteurs"), "/path"));
+    }
+
+    void testMatchesReferenceImplementation() {
+        const auto corpus = generatedCorpus();
+        int headsets = 0;
+        for (const auto& entry : corpus) {
+            const bool expected = naiveIsHeadsetDevice(entry.first, entry.second);
+            if (manager->isHeadsetDevice(entry.first, entry.second) != expected) {
+                QFAIL(qPrintable(QString("Matchers disagree on model \"%1\", path \"%2\"")
+                                     .arg(entry.first, entry.second)));
+            }
+            headsets += expected ? 1 : 0;
+        }
+
+        // Both outcomes are well represented
+        QVERIFY(corpus.size() > 10000);
+        QVERIFY(headsets > corpus.size() / 20);
+        QVERIFY(headsets < corpus.size() * 19 / 20);
+    }
+
+    void benchmarkIsHeadsetDevice_data() {
+        QTest::addColumn<bool>("compiled");
+        QTest::addColumn<bool>("generated");
+
+        // The UPower corpus is what one machine sees; the generated one
+        // is large enough for the matcher to dominate the timing
+        QTest::newRow("naive/upower") << false << false;
+        QTest::newRow("compiled/upower") << true << false;
+        QTest::newRow("naive/generated") << false << true;
+        QTest::newRow("compiled/generated") << true << true;
+    }
+
+    void benchmarkIsHeadsetDevice() {
+        QFETCH(bool, compiled);
+        QFETCH(bool, generated);
+        const auto corpus = generated ? generatedCorpus() : upowerCorpus();
+        int hits = 0;
+
+        // Reported time covers one pass over the whole corpus
+        QBENCHMARK {
+            for (const auto& entry : corpus) {
+                hits += compiled ? manager->isHeadsetDevice(entry.first, entry.second)
+                                 : naiveIsHeadsetDevice(entry.first, entry.second);
+            }
+        }
+        QVERIFY(hits > 0);
+    }
+
     void testPartialMatches() {
         // Partial keyword matches should work
         QVERIFY(manager->isHeadsetDevice("WH-900N", "/path")); // Sony WH- prefix
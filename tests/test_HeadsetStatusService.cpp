@@ -0,0 +1,123 @@
+#include <QtTest/QtTest>
+#include <QDBusArgument>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusPendingCall>
+#include <QDBusPendingReply>
+#include "TestDevices.h"
+#include "PrivateDBus.h"
+#include "../src/DeviceStateCache.h"
+#include "../src/HeadsetStatusService.h"
+
+/**
+ * @class TestHeadsetStatusService
+ * @brief Unit tests for the session-bus export of the cached headset state
+ */
+class TestHeadsetStatusService : public QObject {
+    Q_OBJECT
+
+private:
+    PrivateDBus m_bus;
+    QString m_busError;
+    QList<QDBusMessage> m_signals;
+
+    static QString pathOf(const QVariantMap& properties) {
+        return properties.value("Path").value<QDBusObjectPath>().path();
+    }
+
+public slots:
+    void devicesChanged(const QDBusMessage& message) {
+        m_signals.append(message);
+    }
+
+private slots:
+    void initTestCase() {
+        if (!m_bus.start(&m_busError)) {
+            qWarning() << "Bus tests will be skipped:" << m_busError;
+        }
+    }
+
+    void testDeviceDeltaCarriesOnlyChangedFields() {
+        HeadsetDevice device = makeDevice("/org/freedesktop/UPower/devices/headset_dev_1", 42);
+        device.secondsRemaining = 3600;
+
+        const QVariantMap delta = HeadsetStatusService::deviceDelta(
+            device, DeviceFields(DeviceField::Battery) | DeviceField::Estimate);
+        QCOMPARE(delta.size(), 3);
+        QCOMPARE(pathOf(delta), device.dbusPath);
+        QCOMPARE(delta.value("Percentage").toDouble(), 42.0);
+        QCOMPARE(delta.value("TimeRemaining").toInt(), 3600);
+
+        // A new device is always sent whole
+        const QVariantMap added = HeadsetStatusService::deviceDelta(device, DeviceField::Added);
+        QCOMPARE(added, HeadsetStatusService::deviceProperties(device));
+        QCOMPARE(added.value("Connection").toString(), QString("Bluetooth"));
+        QCOMPARE(added.value("Model").toString(), QString("Jabra Evolve2 75"));
+    }
+
+    void testGetDevicesAnsweredFromCache() {
+        if (!m_busError.isEmpty()) {
+            QSKIP("dbus-daemon not available");
+        }
+
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/org/mewset/test/a", 50), makeDevice("/org/mewset/test/b", 60)});
+        HeadsetStatusService service(cache);
+        QVERIFY(service.registerOn(m_bus.connect("get-service")));
+
+        QDBusConnection client = m_bus.connect("get-client");
+        QDBusPendingReply<QList<QVariantMap>> reply = client.asyncCall(QDBusMessage::createMethodCall(
+            HeadsetStatusService::kServiceName, HeadsetStatusService::kObjectPath,
+            "org.mewset.HeadsetStatus", "GetDevices"));
+        QTRY_VERIFY(reply.isFinished());
+        QVERIFY2(reply.isValid(), qPrintable(reply.error().message()));
+
+        const QList<QVariantMap> devices = reply.value();
+        QCOMPARE(devices.size(), 2);
+        QCOMPARE(pathOf(devices.at(0)), QString("/org/mewset/test/a"));
+        QCOMPARE(devices.at(1).value("Percentage").toDouble(), 60.0);
+        QCOMPARE(devices.at(1).value("TimeRemaining").toInt(), -1);
+    }
+
+    void testDevicesChangedCarriesDeltas() {
+        if (!m_busError.isEmpty()) {
+            QSKIP("dbus-daemon not available");
+        }
+
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/org/mewset/test/a", 50), makeDevice("/org/mewset/test/b", 60)});
+        HeadsetStatusService service(cache);
+        QVERIFY(service.registerOn(m_bus.connect("signal-service")));
+
+        QDBusConnection client = m_bus.connect("signal-client");
+        QVERIFY(client.connect(QString(), HeadsetStatusService::kObjectPath, "org.mewset.HeadsetStatus",
+                               "DevicesChanged", this, SLOT(devicesChanged(QDBusMessage))));
+        m_signals.clear();
+
+        DeviceChangeSet changes;
+        cache.replaceAll({makeDevice("/org/mewset/test/a", 49)}, &changes);
+        service.publish(changes);
+
+        // Nothing visible changed, so nothing is sent
+        service.publish(DeviceChangeSet());
+
+        QTRY_COMPARE(m_signals.size(), 1);
+        QTest::qWait(50);
+        QCOMPARE(m_signals.size(), 1);
+
+        const QList<QVariant> arguments = m_signals.first().arguments();
+        QCOMPARE(arguments.size(), 2);
+        const QList<QVariantMap> changed = qdbus_cast<QList<QVariantMap>>(arguments.at(0));
+        const QList<QDBusObjectPath> removed = qdbus_cast<QList<QDBusObjectPath>>(arguments.at(1));
+
+        QCOMPARE(changed.size(), 1);
+        QCOMPARE(changed.first().size(), 2);
+        QCOMPARE(pathOf(changed.first()), QString("/org/mewset/test/a"));
+        QCOMPARE(changed.first().value("Percentage").toDouble(), 49.0);
+        QCOMPARE(removed.size(), 1);
+        QCOMPARE(removed.first().path(), QString("/org/mewset/test/b"));
+    }
+};
+
+QTEST_MAIN(TestHeadsetStatusService)
+#include "test_HeadsetStatusService.moc"
@@ -0,0 +1,125 @@
+#include <QtTest/QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include "TestDevices.h"
+#include "../src/DeviceStateCache.h"
+#include "../src/JsonWatchWriter.h"
+
+/**
+ * @class TestJsonWatchWriter
+ * @brief Unit tests for the newline-delimited JSON output of --watch --json
+ */
+class TestJsonWatchWriter : public QObject {
+    Q_OBJECT
+
+private:
+    int m_pipe[2] = {-1, -1};
+
+    // Lines that are not valid JSON come back as empty objects
+    QList<QJsonObject> readLines() {
+        QByteArray output;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = ::read(m_pipe[0], buffer, sizeof(buffer))) > 0) {
+            output.append(buffer, n);
+        }
+
+        QList<QJsonObject> lines;
+        if (!output.endsWith('\n')) {
+            return lines;
+        }
+        output.chop(1);
+        for (const QByteArray& line : output.split('\n')) {
+            lines.append(QJsonDocument::fromJson(line).object());
+        }
+        return lines;
+    }
+
+private slots:
+    void init() {
+        QCOMPARE(::pipe2(m_pipe, O_CLOEXEC | O_NONBLOCK), 0);
+    }
+
+    void cleanup() {
+        ::close(m_pipe[0]);
+        ::close(m_pipe[1]);
+    }
+
+    void testSnapshotFirst() {
+        DeviceStateCache cache;
+        JsonWatchWriter writer(cache, m_pipe[1]);
+
+        // An enumeration that changed nothing still produces the snapshot
+        cache.replaceAll({});
+        writer.write(DeviceChangeSet());
+        QList<QJsonObject> lines = readLines();
+        QCOMPARE(lines.size(), 1);
+        QCOMPARE(lines.first().value("event").toString(), QString("snapshot"));
+        QVERIFY(lines.first().value("devices").toArray().isEmpty());
+
+        HeadsetDevice added = makeDevice("/a", "Jabra \"Evolve2\" 75", 42.5);
+        added.nativePath = "/sys/class/power_supply/hidpp_battery_0";
+        DeviceChangeSet changes;
+        cache.replaceAll({added}, &changes);
+        writer.write(changes);
+        lines = readLines();
+        QCOMPARE(lines.size(), 1);
+        QCOMPARE(lines.first().value("event").toString(), QString("added"));
+
+        const QJsonObject device = lines.first().value("device").toObject();
+        QCOMPARE(device.value("path").toString(), QString("/a"));
+        QCOMPARE(device.value("model").toString(), QString("Jabra \"Evolve2\" 75"));
+        QCOMPARE(device.value("native_path").toString(), QString("/sys/class/power_supply/hidpp_battery_0"));
+        QCOMPARE(device.value("connection").toString(), QString("Bluetooth"));
+        QCOMPARE(device.value("battery").toDouble(), 42.5);
+        QCOMPARE(device.value("charging").toBool(), false);
+        QCOMPARE(device.value("present").toBool(), true);
+        QCOMPARE(device.value("time_remaining").toInt(), -1);
+    }
+
+    void testOneLinePerChange() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/a", 50), makeDevice("/b", 60)});
+        JsonWatchWriter writer(cache, m_pipe[1]);
+        writer.write(DeviceChangeSet());
+        QCOMPARE(readLines().first().value("devices").toArray().size(), 2);
+
+        DeviceChangeSet changes;
+        cache.replaceAll({makeDevice("/a", 49)}, &changes);
+        writer.write(changes);
+
+        const QList<QJsonObject> lines = readLines();
+        QCOMPARE(lines.size(), 2);
+        QCOMPARE(lines.at(0).value("event").toString(), QString("changed"));
+        const QJsonObject changed = lines.at(0).value("device").toObject();
+        QCOMPARE(changed.size(), 2);
+        QCOMPARE(changed.value("battery").toDouble(), 49.0);
+        QCOMPARE(lines.at(1).value("event").toString(), QString("removed"));
+        QCOMPARE(lines.at(1).value("device").toObject().value("path").toString(), QString("/b"));
+
+        // Unchanged updates write nothing
+        writer.write(DeviceChangeSet());
+        QVERIFY(readLines().isEmpty());
+    }
+
+    void testClosedOutput() {
+        DeviceStateCache cache;
+        JsonWatchWriter writer(cache, m_pipe[1]);
+        QSignalSpy spy(&writer, &JsonWatchWriter::outputClosed);
+
+        ::signal(SIGPIPE, SIG_IGN);
+        ::close(m_pipe[0]);
+        m_pipe[0] = ::open("/dev/null", O_RDONLY);
+
+        writer.write(DeviceChangeSet());
+        writer.write(DeviceChangeSet::all());
+        QCOMPARE(spy.count(), 1);
+    }
+};
+
+QTEST_MAIN(TestJsonWatchWriter)
+#include "test_JsonWatchWriter.moc"
@@ -0,0 +1,204 @@
+#include <QtTest/QtTest>
+#include "TestDevices.h"
+#include "PrivateDBus.h"
+#include "../src/NotificationManager.h"
+#include "../src/NotificationScheduler.h"
+
+/**
+ * @class RecordingNotifications
+ * @brief org.freedesktop.Notifications that records every Notify call
+ */
+class RecordingNotifications : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.Notifications")
+public:
+    struct Call {
+        uint replacesId;
+        QString summary;
+        QString body;
+    };
+    QList<Call> calls;
+
+public slots:
+    uint Notify(const QString& appName, uint replacesId, const QString& appIcon,
+                const QString& summary, const QString& body, const QStringList& actions,
+                const QVariantMap& hints, int timeout) {
+        Q_UNUSED(appName) Q_UNUSED(appIcon) Q_UNUSED(actions) Q_UNUSED(hints) Q_UNUSED(timeout)
+        calls.append({replacesId, summary, body});
+        return replacesId ? replacesId : ++m_lastId;
+    }
+
+private:
+    uint m_lastId = 0;
+};
+
+/**
+ * @class TestNotificationScheduler
+ * @brief Unit tests for notification batching, rate limits and in-place updates
+ */
+class TestNotificationScheduler : public QObject {
+    Q_OBJECT
+
+private:
+    PrivateDBus m_bus;
+    QString m_busError;
+
+    static NotificationScheduler::Notification makeNotification(const QString& key, const QString& summary,
+                                                                 int urgency = 1) {
+        NotificationScheduler::Notification notification;
+        notification.key = key;
+        notification.summary = summary;
+        notification.body = "Battery level is at 15%.";
+        notification.urgency = urgency;
+        return notification;
+    }
+
+    static NotificationScheduler::Limits limits() {
+        NotificationScheduler::Limits limits;
+        limits.deviceBurst = 2;
+        limits.deviceRefillMs = 60000;
+        limits.overallBurst = 3;
+        limits.overallRefillMs = 10000;
+        return limits;
+    }
+
+private slots:
+    void initTestCase() {
+        if (!m_bus.start(&m_busError)) {
+            qWarning() << "Bus tests will be skipped:" << m_busError;
+            return;
+        }
+        // NotificationManager talks to the session bus
+        qputenv("DBUS_SESSION_BUS_ADDRESS", m_bus.address().toUtf8());
+    }
+
+    void testTokenBucketRefills() {
+        TokenBucket bucket(2, 1000);
+        QVERIFY(bucket.available(0));
+        bucket.take(0);
+        bucket.take(0);
+        QVERIFY(!bucket.available(500));
+        QCOMPARE(bucket.availableAt(500), qint64(1000));
+        QVERIFY(bucket.available(1000));
+        QVERIFY(!bucket.isFull(1000));
+        QVERIFY(bucket.isFull(2000));
+    }
+
+    void testOneUpdateBecomesOneSummary() {
+        NotificationScheduler scheduler(limits());
+        scheduler.post(makeNotification("/a", "Low Battery: Jabra Evolve2 75", 2));
+        scheduler.post(makeNotification("/b", "Charging Complete: Sony WH-1000XM5"));
+        scheduler.post(makeNotification("/c", "Headset Disconnected"));
+
+        NotificationScheduler::Notification popup;
+        QVERIFY(scheduler.take(0, &popup));
+        QCOMPARE(popup.key, NotificationScheduler::kSummaryKey);
+        QCOMPARE(popup.keys, QStringList({"/a", "/b", "/c"}));
+        QCOMPARE(popup.urgency, 2);
+        QCOMPARE(popup.body.count('\n'), 2);
+        QVERIFY(popup.body.startsWith("Low Battery: Jabra Evolve2 75: "));
+        QCOMPARE(scheduler.coalescedCount(), quint64(2));
+
+        QVERIFY(!scheduler.hasPending());
+        QVERIFY(!scheduler.take(0, &popup));
+        QCOMPARE(scheduler.availableAt(0), qint64(-1));
+    }
+
+    void testBurstFromOneDeviceIsLimited() {
+        NotificationScheduler scheduler(limits());
+        NotificationScheduler::Notification popup;
+        QList<NotificationScheduler::Notification> shown;
+
+        // A headset flapping around the threshold every 100 ms for a minute
+        for (qint64 now = 0; now < 60000; now += 100) {
+            const bool low = (now / 100) % 2 == 0;
+            scheduler.post(makeNotification("/flap", low ? "Low Battery: Jabra" : "Charging Complete: Jabra"));
+            while (scheduler.take(now, &popup)) {
+                shown.append(popup);
+            }
+        }
+
+        // The burst, then held back until the device bucket refills
+        QCOMPARE(shown.size(), 2);
+        QVERIFY(scheduler.hasPending());
+        QCOMPARE(scheduler.availableAt(60000), qint64(60000));
+
+        // Only the latest state is left to show
+        QVERIFY(scheduler.take(60000, &popup));
+        QCOMPARE(popup.key, QString("/flap"));
+        QCOMPARE(popup.summary, QString("Charging Complete: Jabra"));
+        QCOMPARE(scheduler.coalescedCount(), quint64(600 - 3));
+    }
+
+    void testOverallLimitHoldsBackEveryDevice() {
+        NotificationScheduler scheduler(limits());
+        NotificationScheduler::Notification popup;
+
+        // Separate updates for separate devices share the overall bucket
+        int shown = 0;
+        for (int i = 0; i < 10; ++i) {
+            scheduler.post(makeNotification(QString("/dev%1").arg(i), "Headset Disconnected"));
+            shown += scheduler.take(i, &popup) ? 1 : 0;
+        }
+        QCOMPARE(shown, 3);
+        QCOMPARE(scheduler.pendingCount(), 7);
+        QCOMPARE(scheduler.availableAt(9), qint64(10000));
+
+        // The rest goes out as one summary once a token is free
+        QVERIFY(!scheduler.take(9999, &popup));
+        QVERIFY(scheduler.take(10000, &popup));
+        QCOMPARE(popup.key, NotificationScheduler::kSummaryKey);
+        QCOMPARE(popup.keys.size(), 7);
+        QVERIFY(!scheduler.hasPending());
+    }
+
+    void testPopupsAreUpdatedInPlace() {
+        if (!m_busError.isEmpty()) {
+            QSKIP("dbus-daemon not available");
+        }
+
+        RecordingNotifications daemon;
+        QDBusConnection server = m_bus.connect("notifications-server");
+        QVERIFY(server.registerObject("/org/freedesktop/Notifications", &daemon,
+                                      QDBusConnection::ExportAllSlots));
+        QVERIFY(server.registerService("org.freedesktop.Notifications"));
+
+        NotificationManager manager;
+        NotificationScheduler::Limits unlimited;
+        unlimited.deviceRefillMs = 0;
+        unlimited.overallRefillMs = 0;
+        manager.setRateLimits(unlimited);
+
+        const HeadsetDevice jabra = makeDevice("/org/freedesktop/UPower/devices/headset_1", "Jabra", 15);
+        const HeadsetDevice sony = makeDevice("/org/freedesktop/UPower/devices/headset_2", "Sony", 12);
+
+        // One update: both cross the threshold, one popup
+        manager.notifyLowBattery(jabra);
+        manager.notifyLowBattery(sony);
+        manager.flush();
+        QTRY_COMPARE(daemon.calls.size(), 1);
+        QCOMPARE(daemon.calls.at(0).replacesId, 0u);
+        QCOMPARE(daemon.calls.at(0).summary, QString("2 Headset Notifications"));
+
+        // Per-device popups: new, then replaced in place
+        manager.notifyLowBattery(jabra);
+        QTRY_COMPARE(daemon.calls.size(), 2);
+        QCOMPARE(daemon.calls.at(1).replacesId, 0u);
+        QTest::qWait(50);
+        manager.notifyChargingComplete(makeDevice(jabra.dbusPath, "Jabra", 100));
+        QTRY_COMPARE(daemon.calls.size(), 3);
+        QCOMPARE(daemon.calls.at(2).replacesId, 2u);
+        QCOMPARE(daemon.calls.at(2).summary, QString("Charging Complete: Jabra"));
+
+        // The next summary replaces the first one
+        manager.notifyDeviceDisconnected(jabra);
+        manager.notifyDeviceDisconnected(sony);
+        QTRY_COMPARE(daemon.calls.size(), 4);
+        QCOMPARE(daemon.calls.at(3).replacesId, 1u);
+
+        server.unregisterService("org.freedesktop.Notifications");
+    }
+};
+
+QTEST_MAIN(TestNotificationScheduler)
+#include "test_NotificationScheduler.moc"
@@ -0,0 +1,144 @@
+#include <QtTest/QtTest>
+#include "../src/PollScheduler.h"
+
+/**
+ * @class TestPollScheduler
+ * @brief Unit tests for the adaptive fallback poll interval
+ */
+class TestPollScheduler : public QObject {
+    Q_OBJECT
+
+private:
+    static constexpr int kMaximum = 60 * 60 * 1000;
+
+    static HeadsetDevice makeDevice(double battery, bool charging = false) {
+        HeadsetDevice device;
+        device.model = "Jabra Evolve2";
+        device.battery = battery;
+        device.isCharging = charging;
+        device.isPresent = true;
+        device.dbusPath = "/org/freedesktop/UPower/devices/headset_0";
+        return device;
+    }
+
+    // Runs one poll cycle by hand
+    static void poll(PollScheduler& scheduler, bool foundChanges) {
+        QMetaObject::invokeMethod(&scheduler, "onTimeout");
+        scheduler.pollFinished(foundChanges);
+    }
+
+private slots:
+    void testDisabledWithoutMaximum() {
+        PollScheduler scheduler;
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::Disabled);
+        QCOMPARE(scheduler.interval(), 0);
+
+        scheduler.setMaximumInterval(kMaximum);
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::Unverified);
+
+        scheduler.setMaximumInterval(0);
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::Disabled);
+    }
+
+    void testBacksOffOnceSignalsAreVerified() {
+        PollScheduler scheduler;
+        scheduler.setMaximumInterval(kMaximum);
+        scheduler.updateDevices({makeDevice(80)});
+        QCOMPARE(scheduler.interval(), PollScheduler::kUnverifiedInterval);
+
+        poll(scheduler, false);
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::SignalsHealthy);
+        QCOMPARE(scheduler.interval(), PollScheduler::kHealthyInterval);
+
+        scheduler.updateDevices({});
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::NoHeadsets);
+        QCOMPARE(scheduler.interval(), PollScheduler::kNoHeadsetsInterval);
+    }
+
+    void testMissedEventsTightenUntilRecovered() {
+        PollScheduler scheduler;
+        scheduler.setMaximumInterval(kMaximum);
+        scheduler.updateDevices({makeDevice(80)});
+
+        poll(scheduler, true);
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::MissedEvents);
+        QCOMPARE(scheduler.interval(), PollScheduler::kMissedEventsInterval);
+
+        for (int i = 1; i < PollScheduler::kRecoveryPolls; ++i) {
+            poll(scheduler, false);
+            QCOMPARE(scheduler.reason(), PollScheduler::Reason::MissedEvents);
+        }
+        poll(scheduler, false);
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::SignalsHealthy);
+    }
+
+    void testChangesReportedBySignalsAreNotMissed() {
+        PollScheduler scheduler;
+        scheduler.setMaximumInterval(kMaximum);
+        scheduler.updateDevices({makeDevice(80)});
+
+        QMetaObject::invokeMethod(&scheduler, "onTimeout");
+        QVERIFY(scheduler.isPollInFlight());
+        scheduler.noteSignal();
+        scheduler.pollFinished(true);
+        QVERIFY(!scheduler.isPollInFlight());
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::SignalsHealthy);
+
+        // Results of enumerations the scheduler did not start are ignored
+        scheduler.pollFinished(true);
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::SignalsHealthy);
+    }
+
+    void testNearThreshold() {
+        PollScheduler scheduler;
+        scheduler.setLowBatteryThreshold(20);
+        scheduler.setMaximumInterval(kMaximum);
+        poll(scheduler, false);
+
+        scheduler.updateDevices({makeDevice(80), makeDevice(24)});
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::NearThreshold);
+        QCOMPARE(scheduler.interval(), PollScheduler::kNearThresholdInterval);
+
+        scheduler.updateDevices({makeDevice(24, true)});
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::SignalsHealthy);
+
+        // Close to full while charging, for the charging-complete notification
+        scheduler.updateDevices({makeDevice(92, true)});
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::NearThreshold);
+    }
+
+    void testMaximumCapsEveryInterval() {
+        PollScheduler scheduler;
+        scheduler.setMaximumInterval(30 * 1000);
+        poll(scheduler, false);
+        scheduler.updateDevices({});
+
+        QCOMPARE(scheduler.reason(), PollScheduler::Reason::NoHeadsets);
+        QCOMPARE(scheduler.interval(), 30 * 1000);
+    }
+
+    void testIntervalChangedSignal() {
+        PollScheduler scheduler;
+        QSignalSpy spy(&scheduler, &PollScheduler::intervalChanged);
+
+        scheduler.setMaximumInterval(kMaximum);
+        scheduler.updateDevices({makeDevice(80)});
+        QCOMPARE(spy.count(), 1);
+
+        poll(scheduler, false);
+        QCOMPARE(spy.count(), 2);
+        QCOMPARE(spy.last().at(0).toInt(), PollScheduler::kHealthyInterval);
+    }
+
+    void testTimerFiresPollDue() {
+        PollScheduler scheduler;
+        QSignalSpy spy(&scheduler, &PollScheduler::pollDue);
+        scheduler.setMaximumInterval(50);
+
+        QVERIFY(spy.wait(2000));
+        QVERIFY(scheduler.isPollInFlight());
+    }
+};
+
+QTEST_MAIN(TestPollScheduler)
+#include "test_PollScheduler.moc"
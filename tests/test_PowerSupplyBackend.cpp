@@ -0,0 +1,157 @@
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include "../src/PowerSupplyBackend.h"
+
+/**
+ * @class TestPowerSupplyBackend
+ * @brief Unit tests for the sysfs power_supply backend against a fake tree
+ */
+class TestPowerSupplyBackend : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir *m_dir = nullptr;
+    QString m_root;
+    QString m_staging;
+
+    static bool isHeadsetModel(const QString&, const QString&, const QString& model) {
+        return model.contains("Headset");
+    }
+
+    static void writeAttribute(const QString& directory, const QString& attribute, const QByteArray& value) {
+        QFile file(directory + '/' + attribute);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        file.write(value + '\n');
+    }
+
+    // Entries are built aside and renamed in, like the kernel adds them at once
+    void addEntry(const QString& name, const QMap<QString, QByteArray>& attributes) {
+        const QString staging = m_staging + '/' + name;
+        QVERIFY(QDir().mkpath(staging));
+        for (auto it = attributes.constBegin(); it != attributes.constEnd(); ++it) {
+            writeAttribute(staging, it.key(), it.value());
+        }
+        QVERIFY(QDir().rename(staging, m_root + '/' + name));
+    }
+
+    void addHeadset(const QString& name, const QByteArray& model, const QByteArray& capacity,
+                    const QString& parent = QString()) {
+        if (!parent.isEmpty()) {
+            // The kernel links each entry to the device it belongs to
+            const QString staging = m_staging + '/' + name;
+            QVERIFY(QDir().mkpath(staging));
+            QVERIFY(QDir().mkpath(m_dir->path() + parent));
+            QVERIFY(QFile::link(m_dir->path() + parent, staging + "/device"));
+        }
+        addEntry(name, {{"type", "Battery"}, {"scope", "Device"}, {"model_name", model},
+                        {"capacity", capacity}, {"status", "Discharging"}});
+    }
+
+private slots:
+    void init() {
+        m_dir = new QTemporaryDir();
+        QVERIFY(m_dir->isValid());
+        m_root = m_dir->path() + "/power_supply";
+        m_staging = m_dir->path() + "/staging";
+        QVERIFY(QDir().mkpath(m_root));
+        QVERIFY(QDir().mkpath(m_staging));
+    }
+
+    void cleanup() {
+        delete m_dir;
+        m_dir = nullptr;
+    }
+
+    void testReadsOnlyPeripheralHeadsets() {
+        addEntry("BAT0", {{"type", "Battery"}, {"model_name", "Laptop Headset Edition"}, {"capacity", "90"}});
+        addEntry("AC", {{"type", "Mains"}, {"online", "1"}});
+        addEntry("hidpp_battery_1", {{"type", "Battery"}, {"scope", "Device"}, {"model_name", "MX Master 3"},
+                                     {"capacity", "40"}});
+        addHeadset("hidpp_battery_0", "PRO X Wireless Gaming Headset", "80");
+        addEntry("ps-controller-battery-a0:ab", {{"type", "Battery"}, {"scope", "Device"},
+                                                 {"model_name", "Arctis Headset"},
+                                                 {"capacity_level", "Normal"}, {"status", "Charging"}});
+
+        PowerSupplyBackend backend(&isHeadsetModel, m_root);
+        QVERIFY(backend.start());
+
+        const QList<HeadsetDevice> devices = backend.devices();
+        QCOMPARE(devices.size(), 2);
+
+        const HeadsetDevice& hidpp = devices.at(0);
+        QCOMPARE(hidpp.model, QString("PRO X Wireless Gaming Headset"));
+        QCOMPARE(hidpp.nativePath, QString("hidpp_battery_0"));
+        QCOMPARE(hidpp.dbusPath, QString("/org/mewset/HeadsetStatus/power_supply/hidpp_battery_0"));
+        QCOMPARE(hidpp.battery, 80.0);
+        QVERIFY(!hidpp.isCharging);
+        QVERIFY(hidpp.isPresent);
+
+        const HeadsetDevice& controller = devices.at(1);
+        QCOMPARE(controller.dbusPath,
+                 QString("/org/mewset/HeadsetStatus/power_supply/ps_2dcontroller_2dbattery_2da0_3aab"));
+        QCOMPARE(controller.battery, 55.0);
+        QVERIFY(controller.isCharging);
+    }
+
+    void testChangeReportsChangedPropertiesOnly() {
+        addHeadset("hidpp_battery_0", "PRO X Wireless Gaming Headset", "80");
+        PowerSupplyBackend backend(&isHeadsetModel, m_root);
+        QVERIFY(backend.start());
+
+        QSignalSpy properties(&backend, &PowerSupplyBackend::devicePropertiesChanged);
+        QSignalSpy membership(&backend, &PowerSupplyBackend::devicesChanged);
+        writeAttribute(m_root + "/hidpp_battery_0", "capacity", "79");
+
+        QTRY_COMPARE(properties.count(), 1);
+        QCOMPARE(properties.first().at(0).toString(), backend.devices().first().dbusPath);
+        const QVariantMap changed = properties.first().at(1).toMap();
+        QCOMPARE(changed.size(), 1);
+        QCOMPARE(changed.value("Percentage").toDouble(), 79.0);
+        QCOMPARE(membership.count(), 0);
+
+        // Rewriting the same value is not a change
+        writeAttribute(m_root + "/hidpp_battery_0", "capacity", "79");
+        QTest::qWait(50);
+        QCOMPARE(properties.count(), 1);
+    }
+
+    void testEntriesAppearAndDisappear() {
+        PowerSupplyBackend backend(&isHeadsetModel, m_root);
+        QVERIFY(backend.start());
+        QVERIFY(backend.devices().isEmpty());
+
+        QSignalSpy membership(&backend, &PowerSupplyBackend::devicesChanged);
+        addHeadset("hid-00:11:22:33:44:55-battery", "Jabra Evolve2 Headset", "64");
+        QTRY_COMPARE(membership.count(), 1);
+        QCOMPARE(backend.devices().size(), 1);
+        QVERIFY(backend.deviceNamed("hid-00:11:22:33:44:55-battery"));
+
+        QVERIFY(QDir(m_root + "/hid-00:11:22:33:44:55-battery").removeRecursively());
+        QTRY_COMPARE(membership.count(), 2);
+        QVERIFY(backend.devices().isEmpty());
+    }
+
+    void testConnectionTypeFromParentDevice() {
+        addHeadset("hidpp_battery_0", "USB Headset", "80", "/devices/pci0000:00/usb1/1-2/1-2:1.2/0003:046D:0AAA.0001");
+        addHeadset("hid-00:11:22:33:44:55-battery", "Bluetooth Headset", "64",
+                   "/devices/pci0000:00/usb1/1-3/1-3:1.0/bluetooth/hci0/hci0:256/0005:0B0E:24C8.0002");
+        addHeadset("virtual_battery", "Virtual Headset", "50");
+
+        PowerSupplyBackend backend(&isHeadsetModel, m_root);
+        QVERIFY(backend.start());
+        QCOMPARE(backend.deviceNamed("hidpp_battery_0")->connectionType, ConnectionType::USB);
+        QCOMPARE(backend.deviceNamed("hid-00:11:22:33:44:55-battery")->connectionType, ConnectionType::Bluetooth);
+        QCOMPARE(backend.deviceNamed("virtual_battery")->connectionType, ConnectionType::Unknown);
+    }
+
+    void testEntryNameOfNativePath() {
+        QCOMPARE(PowerSupplyBackend::entryNameOf("hidpp_battery_0"), QString("hidpp_battery_0"));
+        QCOMPARE(PowerSupplyBackend::entryNameOf("/sys/devices/pci0000:00/usb1/1-2/power_supply/hidpp_battery_0"),
+                 QString("hidpp_battery_0"));
+    }
+};
+
+QTEST_MAIN(TestPowerSupplyBackend)
+#include "test_PowerSupplyBackend.moc"
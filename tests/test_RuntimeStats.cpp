@@ -0,0 +1,107 @@
+#include <QtTest/QtTest>
+#include <thread>
+#include <vector>
+#include "../src/RuntimeStats.h"
+
+/**
+ * @class TestRuntimeStats
+ * @brief Unit tests for the runtime counters, histograms and SIGUSR1 report
+ */
+class TestRuntimeStats : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testHistogramBuckets() {
+        StatHistogram histogram({10, 100, 1000});
+        QCOMPARE(histogram.bucketCount(), 4);
+
+        histogram.record(5);
+        histogram.record(10);
+        histogram.record(11);
+        histogram.record(5000);
+
+        QCOMPARE(histogram.bucketValue(0), quint64(2));
+        QCOMPARE(histogram.bucketValue(1), quint64(1));
+        QCOMPARE(histogram.bucketValue(2), quint64(0));
+        QCOMPARE(histogram.bucketValue(3), quint64(1));
+        QCOMPARE(histogram.bucketBound(3), qint64(-1));
+        QCOMPARE(histogram.count(), quint64(4));
+        QCOMPARE(histogram.sum(), qint64(5026));
+        QCOMPARE(histogram.max(), qint64(5000));
+    }
+
+    void testQuantileBound() {
+        StatHistogram histogram({10, 100, 1000});
+        QCOMPARE(histogram.quantileBound(0.5), qint64(0));
+
+        for (int i = 0; i < 90; ++i) {
+            histogram.record(7);
+        }
+        for (int i = 0; i < 9; ++i) {
+            histogram.record(500);
+        }
+        histogram.record(4000);
+
+        QCOMPARE(histogram.quantileBound(0.5), qint64(10));
+        QCOMPARE(histogram.quantileBound(0.9), qint64(10));
+        QCOMPARE(histogram.quantileBound(0.99), qint64(1000));
+        QCOMPARE(histogram.quantileBound(1.0), qint64(4000));
+    }
+
+    void testConcurrentRecording() {
+        StatHistogram histogram({10, 100});
+        StatCounter counter;
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&histogram, &counter, t]() {
+                for (int i = 0; i < 10000; ++i) {
+                    histogram.record(t * 50);
+                    counter.add();
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        QCOMPARE(histogram.count(), quint64(40000));
+        QCOMPARE(counter.value(), quint64(40000));
+        QCOMPARE(histogram.max(), qint64(150));
+    }
+
+    void testFormat() {
+        RuntimeStats stats;
+        stats.statusUpdateRequests.add(6);
+        stats.statusUpdatesRun.add(2);
+        stats.dbusCallsPerEnumeration.record(3);
+        stats.enumerationUs.record(1200);
+
+        const QString text = stats.format();
+        QVERIFY(text.contains("status_update_requests 6\n"));
+        QVERIFY(text.contains("debounce_coalescing_ratio 3.00\n"));
+        QVERIFY(text.contains("dbus_calls_per_enumeration count=1 mean=3 p50<=3"));
+        QVERIFY(text.contains("enumeration_us count=1 mean=1200 p50<=2500 p90<=2500 p99<=2500 max=1200 buckets=2500:1\n"));
+        QVERIFY(text.contains("icon_render_us count=0\n"));
+
+        stats.reset();
+        QVERIFY(stats.format().contains("status_update_requests 0\n"));
+    }
+
+    void testSignalTriggersReport() {
+        RuntimeStatsReporter reporter;
+        QVERIFY(reporter.installSignalHandler(SIGUSR1));
+
+        QSignalSpy spy(&reporter, &RuntimeStatsReporter::reported);
+        ::raise(SIGUSR1);
+        ::raise(SIGUSR1);
+        QVERIFY(spy.wait(2000));
+
+        // Signals that arrived before the pipe was drained share one report
+        QTest::qWait(50);
+        QCOMPARE(spy.count(), 1);
+    }
+};
+
+QTEST_MAIN(TestRuntimeStats)
+#include "test_RuntimeStats.moc"
@@ -0,0 +1,168 @@
+#include <QtTest/QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "TestDevices.h"
+#include "../src/DeviceStateCache.h"
+#include "../src/StatusSocketServer.h"
+
+/**
+ * @class TestStatusSocketServer
+ * @brief Unit tests for the Unix socket that pushes headset state to local clients
+ */
+class TestStatusSocketServer : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_dir;
+    QList<int> m_fds;
+
+    QString socketPath(const char *name) const {
+        return m_dir.path() + '/' + name;
+    }
+
+    // Socket file nobody listens on, as left behind by a crashed instance
+    int bindOnly(const QString& path) {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        const QByteArray encoded = QFile::encodeName(path);
+        std::memcpy(address.sun_path, encoded.constData(), size_t(encoded.size()));
+        ::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+        return fd;
+    }
+
+    int connectClient(const QString& path) {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        const QByteArray encoded = QFile::encodeName(path);
+        std::memcpy(address.sun_path, encoded.constData(), size_t(encoded.size()));
+        if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        m_fds.append(fd);
+        return fd;
+    }
+
+    static void drain(int fd, QByteArray& received) {
+        char buffer[16384];
+        ssize_t n;
+        while ((n = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            received.append(buffer, n);
+        }
+    }
+
+    // Complete lines received so far, parsed; invalid lines become empty objects
+    static QList<QJsonObject> lines(const QByteArray& received) {
+        QList<QJsonObject> result;
+        for (const QByteArray& line : received.left(received.lastIndexOf('\n')).split('\n')) {
+            result.append(QJsonDocument::fromJson(line).object());
+        }
+        return result;
+    }
+
+private slots:
+    void initTestCase() {
+        QVERIFY(m_dir.isValid());
+    }
+
+    void cleanup() {
+        for (int fd : std::as_const(m_fds)) {
+            ::close(fd);
+        }
+        m_fds.clear();
+    }
+
+    void testSnapshotThenChanges() {
+        DeviceStateCache cache;
+        cache.replaceAll({makeDevice("/a", 50), makeDevice("/b", 60)});
+        StatusSocketServer server(cache);
+        QVERIFY(server.listen(socketPath("feed.sock")));
+
+        const int fd = connectClient(server.path());
+        QVERIFY(fd >= 0);
+        QByteArray received;
+        QTRY_VERIFY((drain(fd, received), received.endsWith('\n')));
+
+        QList<QJsonObject> records = lines(received);
+        QCOMPARE(records.size(), 1);
+        QCOMPARE(records.first().value("event").toString(), QString("snapshot"));
+        QCOMPARE(records.first().value("devices").toArray().size(), 2);
+
+        DeviceChangeSet changes;
+        cache.replaceAll({makeDevice("/a", 49), makeDevice("/b", 60)}, &changes);
+        server.publish(changes);
+
+        received.clear();
+        QTRY_VERIFY((drain(fd, received), received.endsWith('\n')));
+        records = lines(received);
+        QCOMPARE(records.size(), 1);
+        QCOMPARE(records.first().value("event").toString(), QString("changed"));
+        QCOMPARE(records.first().value("device").toObject().value("battery").toDouble(), 49.0);
+
+        // A client that hangs up is forgotten
+        ::close(fd);
+        m_fds.removeAll(fd);
+        QTRY_COMPARE(server.clientCount(), 0);
+    }
+
+    void testStaleSocketIsReplaced() {
+        const QString path = socketPath("stale.sock");
+        const int stale = bindOnly(path);
+        ::close(stale);
+        QVERIFY(QFile::exists(path));
+
+        DeviceStateCache cache;
+        StatusSocketServer server(cache);
+        QString error;
+        QVERIFY2(server.listen(path, &error), qPrintable(error));
+
+        // A running instance keeps its socket
+        StatusSocketServer second(cache);
+        QVERIFY(!second.listen(path, &error));
+        QVERIFY(error.contains("in use"));
+
+        server.close();
+        QVERIFY(!QFile::exists(path));
+    }
+
+    void testStuckClientIsDisconnected() {
+        QList<HeadsetDevice> devices;
+        for (int i = 0; i < 200; ++i) {
+            devices.append(makeDevice(QString("/org/freedesktop/UPower/devices/headset_%1").arg(i), i % 100));
+        }
+        DeviceStateCache cache;
+        cache.replaceAll(devices);
+        StatusSocketServer server(cache);
+        QVERIFY(server.listen(socketPath("fanout.sock")));
+        QSignalSpy dropped(&server, &StatusSocketServer::slowClientDropped);
+
+        const int stuck = connectClient(server.path());
+        const int reader = connectClient(server.path());
+        QVERIFY(stuck >= 0 && reader >= 0);
+        QTRY_COMPARE(server.clientCount(), 2);
+
+        // Far more than the socket buffer plus kMaxPendingBytes
+        QByteArray received;
+        for (int i = 0; i < 60; ++i) {
+            server.publish(DeviceChangeSet::all());
+            QCoreApplication::processEvents();
+            drain(reader, received);
+        }
+
+        QCOMPARE(server.clientCount(), 1);
+        QCOMPARE(dropped.count(), 1);
+        QTRY_COMPARE((drain(reader, received), lines(received).size()), 61);
+        QCOMPARE(lines(received).last().value("devices").toArray().size(), 200);
+    }
+};
+
+QTEST_MAIN(TestStatusSocketServer)
+#include "test_StatusSocketServer.moc"
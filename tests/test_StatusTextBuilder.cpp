@@ -0,0 +1,109 @@
+#include <QtTest/QtTest>
+#include "TestDevices.h"
+#include "../src/StatusTextBuilder.h"
+
+/**
+ * @class TestStatusTextBuilder
+ * @brief Unit tests for incremental tooltip and menu label formatting
+ */
+class TestStatusTextBuilder : public QObject {
+    Q_OBJECT
+
+private:
+private slots:
+    void testTooltipFormat() {
+        StatusTextBuilder builder(20);
+        HeadsetDevice charging = makeDevice("/b", "Sony", 80.6);
+        charging.isCharging = true;
+        charging.connectionType = ConnectionType::USB;
+
+        QVERIFY(builder.update({makeDevice("/a", "Jabra", 50), charging}));
+        QCOMPARE(builder.tooltip(),
+                 QString("Jabra\nConnection: Bluetooth\nBattery: 50%\n\n"
+                         "Sony\nConnection: USB\nBattery: 80% (Charging)"));
+    }
+
+    void testTooltipRanksLowAboveCharging() {
+        StatusTextBuilder builder(20);
+        HeadsetDevice device = makeDevice("/a", "Jabra", 15);
+        device.isCharging = true;
+
+        builder.update({device});
+        QCOMPARE(builder.tooltip(), QString("Jabra\nConnection: Bluetooth\nBattery: 15% (Low)"));
+        QCOMPARE(builder.batteryLabel(0), QString("Battery: 15% (Charging)"));
+        QCOMPARE(builder.menuTitle(0), QString("⚡ Jabra"));
+    }
+
+    void testTooltipTimeRemaining() {
+        StatusTextBuilder builder(20);
+        HeadsetDevice device = makeDevice("/a", "Jabra", 50);
+        device.secondsRemaining = 3 * 3600 + 5 * 60 + 20;
+
+        builder.update({device});
+        QCOMPARE(builder.tooltip(), QString("Jabra\nConnection: Bluetooth\nBattery: 50%\nTime left: 3h 05m"));
+
+        device.isCharging = true;
+        device.secondsRemaining = 45 * 60;
+        DeviceChangeSet changes;
+        changes.changes.append({device.dbusPath, DeviceField::Charging | DeviceField::Estimate});
+        QVERIFY(builder.update({device}, changes));
+        QCOMPARE(builder.tooltip(), QString("Jabra\nConnection: Bluetooth\nBattery: 50% (Charging)\nTime to full: 45m"));
+
+        // Sub-minute drift does not reformat
+        device.secondsRemaining = 45 * 60 + 10;
+        changes.changes = {{device.dbusPath, DeviceField::Estimate}};
+        QVERIFY(!builder.update({device}, changes));
+    }
+
+    void testMenuLabels() {
+        StatusTextBuilder builder(20);
+        HeadsetDevice absent = makeDevice("/b", "Sony", 0);
+        absent.isPresent = false;
+
+        builder.update({makeDevice("/a", "Jabra", 10), absent});
+        QCOMPARE(builder.menuTitle(0), QString("🪫 Jabra"));
+        QCOMPARE(builder.batteryLabel(0), QString("Battery: 10% (Low)"));
+        QCOMPARE(builder.connectionLabel(0), QString("Connection: Bluetooth"));
+        QCOMPARE(builder.menuTitle(1), QString("⚠️ Sony"));
+        QCOMPARE(builder.batteryLabel(1), QString("Battery: Not present"));
+        QCOMPARE(builder.tooltip().section("\n\n", 1), QString("Sony\nConnection: Bluetooth\nBattery: (Not present)"));
+    }
+
+    void testOnlyChangedDevicesAreFormatted() {
+        StatusTextBuilder builder(20);
+        const QList<HeadsetDevice> devices = {makeDevice("/a", "Jabra", 50), makeDevice("/b", "Sony", 60)};
+        builder.update(devices);
+        QCOMPARE(builder.formatCount(), 2);
+
+        // Same whole percentage renders the same text
+        QVERIFY(!builder.update({makeDevice("/a", "Jabra", 50.4), makeDevice("/b", "Sony", 60)}));
+        QCOMPARE(builder.formatCount(), 2);
+
+        QVERIFY(builder.update({makeDevice("/a", "Jabra", 49), makeDevice("/b", "Sony", 60)}));
+        QCOMPARE(builder.formatCount(), 3);
+        QVERIFY(builder.tooltip().startsWith("Jabra\nConnection: Bluetooth\nBattery: 49%"));
+    }
+
+    void testReorderKeepsSegments() {
+        StatusTextBuilder builder(20);
+        builder.update({makeDevice("/a", "Jabra", 50), makeDevice("/b", "Sony", 60)});
+
+        QVERIFY(builder.update({makeDevice("/b", "Sony", 60), makeDevice("/a", "Jabra", 50)}));
+        QCOMPARE(builder.formatCount(), 2);
+        QVERIFY(builder.tooltip().startsWith("Sony"));
+        QCOMPARE(builder.indexOf("/a"), 1);
+        QCOMPARE(builder.indexOf("/c"), -1);
+    }
+
+    void testThresholdChangeReformats() {
+        StatusTextBuilder builder(20);
+        builder.update({makeDevice("/a", "Jabra", 25)});
+
+        builder.setLowBatteryThreshold(30);
+        QVERIFY(builder.update({makeDevice("/a", "Jabra", 25)}));
+        QCOMPARE(builder.batteryLabel(0), QString("Battery: 25% (Low)"));
+    }
+};
+
+QTEST_MAIN(TestStatusTextBuilder)
+#include "test_StatusTextBuilder.moc"
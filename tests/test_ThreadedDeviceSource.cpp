@@ -0,0 +1,182 @@
+#include <QtTest/QtTest>
+#include <QThread>
+#include <atomic>
+#include "TestDevices.h"
+#include "../src/ThreadedDeviceSource.h"
+
+/**
+ * @class WorkerSource
+ * @brief DeviceSource that answers requests with a fixed list and records
+ *        on which thread it was called
+ */
+class WorkerSource : public DeviceSource {
+    Q_OBJECT
+public:
+    QList<HeadsetDevice> devices;
+    QThread *createdOn = QThread::currentThread();
+    std::atomic<QThread*> requestedOn{nullptr};
+    std::atomic<int> requests{0};
+    bool answerRequests = true;  ///< False leaves the enumeration running
+    QList<HeadsetDevice> tracked;
+    QList<HeadsetDevice> ignored;
+    QList<HeadsetDevice> reset;
+
+    void requestDevices() override {
+        requestedOn = QThread::currentThread();
+        ++requests;
+        if (answerRequests) {
+            emit devicesReady(devices);
+        }
+    }
+    bool isRefreshPending() const override { return false; }
+    void setTrackedDevices(const QList<HeadsetDevice>& list) override { tracked = list; }
+    void ignoreDevice(const HeadsetDevice& device) override { ignored.append(device); }
+    void resetDevice(const HeadsetDevice& device) override { reset.append(device); }
+};
+
+/**
+ * @class TestThreadedDeviceSource
+ * @brief Unit tests for the worker thread and the snapshot hand-off
+ */
+class TestThreadedDeviceSource : public QObject {
+    Q_OBJECT
+
+private:
+    // Creates the source and waits until the factory ran on the worker
+    static WorkerSource* start(std::unique_ptr<ThreadedDeviceSource>& source) {
+        std::atomic<WorkerSource*> inner{nullptr};
+        source = std::make_unique<ThreadedDeviceSource>([&inner]() {
+            auto *worker = new WorkerSource();
+            worker->devices = {makeDevice("/a", 50)};
+            inner = worker;
+            return worker;
+        });
+        QElapsedTimer timer;
+        timer.start();
+        while (!inner && timer.elapsed() < 5000) {
+            QThread::msleep(1);
+        }
+        return inner;
+    }
+
+    // Runs @p body on the worker and returns once it finished
+    static void onWorker(WorkerSource *worker, const std::function<void()>& body) {
+        QMetaObject::invokeMethod(worker, body, Qt::BlockingQueuedConnection);
+    }
+
+private slots:
+    void testRequestsAreAnsweredFromTheWorker() {
+        std::unique_ptr<ThreadedDeviceSource> source;
+        WorkerSource *worker = start(source);
+        QVERIFY(worker);
+        QVERIFY(worker->createdOn != QThread::currentThread());
+
+        QList<QList<HeadsetDevice>> snapshots;
+        connect(source.get(), &DeviceSource::devicesReady, this,
+                [&](const QList<HeadsetDevice>& devices) { snapshots.append(devices); });
+        source->requestDevices();
+        QVERIFY(source->isRefreshPending());
+        QTRY_COMPARE(snapshots.size(), 1);
+        QVERIFY(!source->isRefreshPending());
+        QCOMPARE(worker->requestedOn.load(), worker->createdOn);
+
+        QCOMPARE(snapshots.first().size(), 1);
+        QCOMPARE(snapshots.first().first().battery, 50.0);
+    }
+
+    void testOnlyTheNewestSnapshotIsTaken() {
+        std::unique_ptr<ThreadedDeviceSource> source;
+        WorkerSource *worker = start(source);
+        QVERIFY(worker);
+
+        QList<QList<HeadsetDevice>> snapshots;
+        connect(source.get(), &DeviceSource::devicesReady, this,
+                [&](const QList<HeadsetDevice>& devices) { snapshots.append(devices); });
+
+        // Three snapshots while the GUI thread is busy
+        onWorker(worker, [worker]() {
+            for (int battery : {40, 39, 38}) {
+                emit worker->devicesReady({makeDevice("/a", battery)});
+            }
+        });
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+
+        QCOMPARE(snapshots.size(), 1);
+        QCOMPARE(snapshots.first().first().battery, 38.0);
+        QCOMPARE(source->skippedSnapshots(), 2);
+    }
+
+    void testChangesOlderThanTheTakenSnapshotAreDropped() {
+        std::unique_ptr<ThreadedDeviceSource> source;
+        WorkerSource *worker = start(source);
+        QVERIFY(worker);
+
+        QList<double> order;
+        connect(source.get(), &DeviceSource::devicesReady, this,
+                [&](const QList<HeadsetDevice>& devices) { order.append(devices.first().battery); });
+        connect(source.get(), &DeviceSource::devicePropertiesChanged, this,
+                [&](const QString&, const QVariantMap& properties) {
+                    order.append(properties.value("Percentage").toDouble());
+                });
+
+        onWorker(worker, [worker]() {
+            emit worker->devicesReady({makeDevice("/a", 50)});
+            emit worker->devicePropertiesChanged("/a", {{"Percentage", 49.0}});
+            emit worker->devicesReady({makeDevice("/a", 48)});
+            emit worker->devicePropertiesChanged("/a", {{"Percentage", 47.0}});
+        });
+        QTRY_COMPARE(order.size(), 2);
+        QCOMPARE(order, QList<double>({48.0, 47.0}));
+    }
+
+    void testChangesDuringAnEnumerationAreMergedIntoIt() {
+        std::unique_ptr<ThreadedDeviceSource> source;
+        WorkerSource *worker = start(source);
+        QVERIFY(worker);
+        onWorker(worker, [worker]() { worker->answerRequests = false; });
+
+        QList<HeadsetDevice> snapshot;
+        connect(source.get(), &DeviceSource::devicesReady, this,
+                [&](const QList<HeadsetDevice>& devices) { snapshot = devices; });
+        source->requestDevices();
+        QTRY_COMPARE(worker->requests.load(), 1);
+
+        // /a was read at 50, then changed while /b was still being read
+        onWorker(worker, [worker]() {
+            emit worker->devicePropertiesChanged("/a", {{"Percentage", 49.0}, {"IsCharging", true}});
+            emit worker->devicesReady({makeDevice("/a", 50), makeDevice("/b", 60)});
+        });
+        QTRY_COMPARE(snapshot.size(), 2);
+        QCOMPARE(snapshot.at(0).battery, 49.0);
+        QVERIFY(snapshot.at(0).isCharging);
+        QCOMPARE(snapshot.at(1).battery, 60.0);
+
+        // Once it is published, later changes are forwarded as before
+        QSignalSpy changed(source.get(), &DeviceSource::devicePropertiesChanged);
+        onWorker(worker, [worker]() { emit worker->devicePropertiesChanged("/a", {{"Percentage", 48.0}}); });
+        QTRY_COMPARE(changed.count(), 1);
+        QCOMPARE(changed.first().at(1).toMap().value("Percentage").toDouble(), 48.0);
+    }
+
+    void testCallsReachTheWorkerInOrder() {
+        std::unique_ptr<ThreadedDeviceSource> source;
+        WorkerSource *worker = start(source);
+        QVERIFY(worker);
+
+        QSignalSpy changed(source.get(), &DeviceSource::devicesChanged);
+        source->setTrackedDevices({makeDevice("/a", 50), makeDevice("/b", 60)});
+        source->ignoreDevice(makeDevice("/b", 60));
+        source->resetDevice(makeDevice("/b", 60));
+        onWorker(worker, [worker]() { emit worker->devicesChanged(); });
+
+        QCOMPARE(worker->tracked.size(), 2);
+        QCOMPARE(worker->ignored.size(), 1);
+        QCOMPARE(worker->ignored.first().dbusPath, QString("/b"));
+        QCOMPARE(worker->reset.size(), 1);
+        QTRY_COMPARE(changed.count(), 1);
+    }
+};
+
+QTEST_MAIN(TestThreadedDeviceSource)
+#include "test_ThreadedDeviceSource.moc"
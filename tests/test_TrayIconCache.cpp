@@ -0,0 +1,109 @@
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+#include "../src/TrayIconCache.h"
+
+/**
+ * @class TestTrayIconCache
+ * @brief Unit tests for rendering and caching tray icon variants
+ */
+class TestTrayIconCache : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testRenderScalesWithPixelRatio() {
+        const QImage normal = TrayIconCache::render("🎧", 0, 1.0);
+        const QImage hidpi = TrayIconCache::render("🎧", 0, 2.0);
+
+        QCOMPARE(normal.size(), QSize(32, 32));
+        QCOMPARE(hidpi.size(), QSize(64, 64));
+        QCOMPARE(hidpi.devicePixelRatio(), 2.0);
+    }
+
+    void testIconCarriesEveryPixelRatio() {
+        TrayIconCache cache;
+        cache.setDevicePixelRatios({1.0, 2.0, 2.0});
+        QCOMPARE(cache.devicePixelRatios(), QList<qreal>({1.0, 2.0}));
+
+        const QIcon icon = cache.icon("⚡", 2);
+        QVERIFY(!icon.isNull());
+        QCOMPARE(cache.renderCount(), 2);
+
+        const QPixmap sharp = icon.pixmap(QSize(32, 32), 2.0);
+        QCOMPARE(sharp.devicePixelRatio(), 2.0);
+        QCOMPARE(sharp.size(), QSize(64, 64));
+    }
+
+    void testRepeatedStatesAreNotRepainted() {
+        TrayIconCache cache;
+        cache.setDevicePixelRatios({1.0, 2.0});
+
+        cache.icon("🎧", 0);
+        cache.icon("⚠️", 3);
+        QCOMPARE(cache.renderCount(), 4);
+
+        cache.icon("🎧", 0);
+        cache.icon("⚠️", 3);
+        QCOMPARE(cache.renderCount(), 4);
+
+        // A single device shows no badge, so it shares the zero-count images
+        cache.icon("🎧", 1);
+        QCOMPARE(cache.renderCount(), 4);
+    }
+
+    void testNewPixelRatioRendersOnlyMissingVariants() {
+        TrayIconCache cache;
+        cache.setDevicePixelRatios({1.0});
+        cache.icon("🔌", 2);
+        QCOMPARE(cache.renderCount(), 1);
+
+        cache.setDevicePixelRatios({1.0, 1.5});
+        cache.icon("🔌", 2);
+        QCOMPARE(cache.renderCount(), 2);
+    }
+
+    void testAddedPixelRatioExtendsIcons() {
+        TrayIconCache cache;
+        cache.setDevicePixelRatios({1.0, 2.0});
+        QSignalSpy changed(&cache, &TrayIconCache::devicePixelRatiosChanged);
+        cache.icon("🎧", 0);
+        QCOMPARE(cache.renderCount(), 2);
+
+        // A screen scaled to 125% joins the set; the built icon is dropped
+        cache.addDevicePixelRatio(1.25);
+        QCOMPARE(changed.count(), 1);
+        QCOMPARE(cache.devicePixelRatios(), QList<qreal>({1.0, 1.25, 2.0}));
+        const QPixmap scaled = cache.icon("🎧", 0).pixmap(QSize(32, 32), 1.25);
+        QCOMPARE(scaled.devicePixelRatio(), 1.25);
+        QCOMPARE(cache.renderCount(), 3);
+
+        // Ratios already rendered change nothing
+        cache.addDevicePixelRatio(2.0);
+        cache.addDevicePixelRatio(1.25);
+        QCOMPARE(changed.count(), 1);
+
+        // Ratios are told apart in hundredths, by the list and the image keys alike
+        cache.addDevicePixelRatio(1.2504);
+        QCOMPARE(changed.count(), 1);
+        cache.setDevicePixelRatios({1.0, 1.2504, 2.0});
+        cache.icon("🎧", 0);
+        QCOMPARE(cache.renderCount(), 3);
+    }
+
+    void testPrewarmFillsCache() {
+        TrayIconCache cache;
+        cache.setDevicePixelRatios({1.0, 2.0});
+        QSignalSpy spy(&cache, &TrayIconCache::prewarmed);
+
+        cache.prewarm({"🎧", "⚡"}, 3);
+        QVERIFY(spy.wait(5000));
+
+        // Counts 0, 2 and 3 for two glyphs at two ratios
+        QCOMPARE(cache.renderCount(), 12);
+        cache.icon("⚡", 3);
+        cache.icon("🎧", 1);
+        QCOMPARE(cache.renderCount(), 12);
+    }
+};
+
+QTEST_MAIN(TestTrayIconCache)
+#include "test_TrayIconCache.moc"
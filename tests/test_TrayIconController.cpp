@@ -0,0 +1,117 @@
+#include <QtTest/QtTest>
+#include <QAction>
+#include <QMenu>
+#include "TestDevices.h"
+#include "../src/TrayIconController.h"
+
+/**
+ * @class TestTrayIconController
+ * @brief Unit tests for the lazily built, diff-updated devices submenu
+ */
+class TestTrayIconController : public QObject {
+    Q_OBJECT
+
+private:
+    static QMenu *devicesMenu(TrayIconController& tray) {
+        return tray.trayMenu()->actions().first()->menu();
+    }
+
+    static void open(QMenu *menu) {
+        QMetaObject::invokeMethod(menu, "aboutToShow");
+    }
+
+    static QStringList titles(QMenu *menu) {
+        QStringList result;
+        for (QAction *action : menu->actions()) {
+            result << action->text();
+        }
+        return result;
+    }
+
+private slots:
+    void testSubmenuIsBuiltOnlyWhenOpened() {
+        TrayIconController tray;
+        tray.updateIcon({makeDevice("/a", "Jabra", 50), makeDevice("/b", "Sony", 60)});
+
+        QMenu *menu = devicesMenu(tray);
+        QVERIFY(menu);
+        QVERIFY(menu->actions().isEmpty());
+
+        open(menu);
+        QCOMPARE(titles(menu), QStringList({"🎧 Jabra", "🎧 Sony"}));
+        QCOMPARE(menu->actions().first()->menu()->actions().first()->text(), QString("Battery: 50%"));
+    }
+
+    void testUpdatesPatchExistingEntries() {
+        TrayIconController tray;
+        tray.updateIcon({makeDevice("/a", "Jabra", 50), makeDevice("/b", "Sony", 60)});
+        QMenu *menu = devicesMenu(tray);
+        open(menu);
+        QMenu *jabra = menu->actions().at(0)->menu();
+        QMenu *sony = menu->actions().at(1)->menu();
+
+        tray.updateIcon({makeDevice("/a", "Jabra", 49), makeDevice("/b", "Sony", 60)});
+        open(menu);
+
+        QCOMPARE(menu->actions().at(0)->menu(), jabra);
+        QCOMPARE(menu->actions().at(1)->menu(), sony);
+        QCOMPARE(jabra->actions().first()->text(), QString("Battery: 49%"));
+    }
+
+    void testDevicesComeAndGo() {
+        TrayIconController tray;
+        tray.updateIcon({makeDevice("/a", "Jabra", 50), makeDevice("/b", "Sony", 60)});
+        QMenu *menu = devicesMenu(tray);
+        open(menu);
+        QMenu *sony = menu->actions().at(1)->menu();
+
+        tray.updateIcon({makeDevice("/c", "Bose", 70), makeDevice("/b", "Sony", 60)});
+        open(menu);
+        QCOMPARE(titles(menu), QStringList({"🎧 Bose", "🎧 Sony"}));
+        QCOMPARE(menu->actions().at(1)->menu(), sony);
+
+        // A single device has no submenu at all
+        tray.updateIcon({makeDevice("/b", "Sony", 60)});
+        QVERIFY(!tray.trayMenu()->actions().first()->menu());
+        QCOMPARE(tray.trayMenu()->actions().first()->text(), QString("Information"));
+    }
+    void testSingleDeviceOverridesInTrayMenu() {
+        TrayIconController tray;
+        QSignalSpy ignored(&tray, &TrayIconController::deviceIgnoreRequested);
+        QSignalSpy reset(&tray, &TrayIconController::deviceResetRequested);
+
+        // A lone mouse listed as a headset gets no submenu, but can be ignored
+        tray.updateIcon({makeDevice("/mouse", "MX Master", 80)});
+        QStringList menuTitles = titles(tray.trayMenu());
+        QCOMPARE(menuTitles.mid(0, 3), QStringList({"Not a Headset", "Reset Classification", QString()}));
+        QVERIFY(!tray.trayMenu()->actions().first()->menu());
+
+        tray.trayMenu()->actions().at(0)->trigger();
+        QCOMPARE(ignored.count(), 1);
+        QCOMPARE(ignored.first().first().toString(), QString("/mouse"));
+
+        // The actions follow the device that is listed now
+        tray.updateIcon({makeDevice("/a", "Jabra", 50)});
+        QCOMPARE(titles(tray.trayMenu()).count("Not a Headset"), 1);
+        tray.trayMenu()->actions().at(1)->trigger();
+        QCOMPARE(reset.count(), 1);
+        QCOMPARE(reset.first().first().toString(), QString("/a"));
+
+        // With several devices they move into the per-device submenus
+        tray.updateIcon({makeDevice("/a", "Jabra", 50), makeDevice("/b", "Sony", 60)});
+        QVERIFY(!titles(tray.trayMenu()).contains("Not a Headset"));
+        QMenu *menu = devicesMenu(tray);
+        open(menu);
+        const QStringList entryTitles = titles(menu->actions().first()->menu());
+        QVERIFY(entryTitles.contains("Reset Classification"));
+
+        // A listed device already is a headset; pinning it changes nothing
+        QVERIFY(!entryTitles.contains("Always a Headset"));
+
+        tray.updateIcon({});
+        QVERIFY(!titles(tray.trayMenu()).contains("Not a Headset"));
+    }
+};
+
+QTEST_MAIN(TestTrayIconController)
+#include "test_TrayIconController.moc"